@@ -0,0 +1,144 @@
+#include "TaskGenerator.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+    const char* const kWords[] = {
+        "analyze", "the", "module", "and", "report", "every", "failing", "test", "refactor", "parser",
+        "queue", "latency", "for", "with", "output", "summary", "in", "JSON", "check", "rules",
+        "&amp;", "&lt;config&gt;", "document", "review", "prompt", "daemon", "cache", "worker",
+    };
+    constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+    const char* const kPriorities[] = {"low", "medium", "high", "critical"};
+    const char* const kStatuses[] = {"pending", "pending", "pending", "in_progress", "done"};
+    const char* const kTypes[] = {"code", "analysis", "docs", "review"};
+
+    // splitmix64: cheap, and each task's stream depends only on the seed and its index.
+    uint64_t next_random(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    template <size_t N>
+    const char* pick(const char* const (&values)[N], uint64_t& state) {
+        return values[next_random(state) % N];
+    }
+} // namespace
+
+TaskGenerator::TaskGenerator(Options options) : m_options(options) {}
+
+std::string TaskGenerator::taskId(size_t index) {
+    char id[32];
+    std::snprintf(id, sizeof(id), "task-%06zu", index);
+    return id;
+}
+
+void TaskGenerator::appendText(std::string& out, uint64_t& state, size_t bytes) const {
+    size_t start = out.size();
+    while (out.size() - start < bytes) {
+        if (out.size() != start) {
+            out.push_back(' ');
+        }
+        out.append(kWords[next_random(state) % kWordCount]);
+    }
+}
+
+void TaskGenerator::appendTask(std::string& out, size_t index, const char* indent) const {
+    uint64_t state = m_options.seed ^ (static_cast<uint64_t>(index) * 0x2545F4914F6CDD1DULL);
+    char created[32];
+    std::snprintf(created, sizeof(created), "2025-%02u-%02uT%02u:%02u:00Z", unsigned(1 + next_random(state) % 12),
+                  unsigned(1 + next_random(state) % 28), unsigned(next_random(state) % 24),
+                  unsigned(next_random(state) % 60));
+
+    std::string inner = std::string(indent) + "  ";
+    out.append(indent).append("<task id=\"").append(taskId(index)).append("\" type=\"").append(pick(kTypes, state));
+    out.append("\" priority=\"").append(pick(kPriorities, state));
+    out.append("\" status=\"").append(pick(kStatuses, state));
+    out.append("\" created=\"").append(created).push_back('"');
+    appendDependencies(out, index);
+    out.append(">\n");
+
+    out.append(inner).append("<description>");
+    appendText(out, state, m_options.textBytes);
+    out.append("</description>\n");
+
+    out.append(inner).append("<commands>\n");
+    for (size_t i = 0; i < m_options.commands; ++i) {
+        out.append(inner).append("  <command>");
+        appendText(out, state, m_options.textBytes);
+        out.append("</command>\n");
+    }
+    out.append(inner).append("</commands>\n");
+
+    if (m_options.criteria > 0) {
+        out.append(inner).append("<criteria>\n");
+        for (size_t i = 0; i < m_options.criteria; ++i) {
+            out.append(inner).append("  <criterion>");
+            appendText(out, state, m_options.textBytes);
+            out.append("</criterion>\n");
+        }
+        out.append(inner).append("</criteria>\n");
+    }
+    out.append(indent).append("</task>\n");
+}
+
+void TaskGenerator::appendDependencies(std::string& out, size_t index) const {
+    if (m_options.dependencies == 0 || index == 0) {
+        return;
+    }
+    // A stream of its own, so the other attributes and the text do not change with --dependencies.
+    uint64_t state = ~m_options.seed ^ (static_cast<uint64_t>(index) * 0x9E3779B97F4A7C15ULL);
+    size_t count = next_random(state) % (m_options.dependencies + 1);
+    size_t window = std::min<size_t>(index, 64);
+    std::vector<size_t> picked;
+    for (size_t i = 0; i < count; ++i) {
+        size_t dependency = index - 1 - next_random(state) % window;
+        if (std::find(picked.begin(), picked.end(), dependency) == picked.end()) {
+            picked.push_back(dependency);
+        }
+    }
+    for (size_t i = 0; i < picked.size(); ++i) {
+        out.append(i == 0 ? " depends_on=\"" : " ").append(taskId(picked[i]));
+    }
+    if (!picked.empty()) {
+        out.push_back('"');
+    }
+}
+
+std::string TaskGenerator::tasksXml() const {
+    std::string out = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tasks>\n";
+    out.reserve(out.size() + m_options.tasks * (m_options.commands + m_options.criteria + 1) *
+                                 (m_options.textBytes + 40));
+    for (size_t i = 0; i < m_options.tasks; ++i) {
+        appendTask(out, i, "  ");
+    }
+    out.append("</tasks>\n");
+    return out;
+}
+
+std::string TaskGenerator::taskXml(size_t index) const {
+    std::string out = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    appendTask(out, index, "");
+    return out;
+}
+
+size_t TaskGenerator::writeBacklog(const fs::path& directory) const {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    size_t written = 0;
+    for (size_t i = 0; i < m_options.tasks; ++i) {
+        std::string xml = taskXml(i);
+        std::ofstream out(directory / (taskId(i) + ".xml"), std::ios::binary | std::ios::trunc);
+        out.write(xml.data(), static_cast<std::streamsize>(xml.size()));
+        if (!out) {
+            break;
+        }
+        ++written;
+    }
+    return written;
+}
@@ -0,0 +1,59 @@
+#ifndef PRISMQUANTA_TASK_GENERATOR_H
+#define PRISMQUANTA_TASK_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Synthetic PQL workloads for the benchmarks.
+ *
+ * Output is deterministic for a given seed, so results from different
+ * commits are measured against the same input. Tasks are named
+ * task-000000, task-000001, ...; descriptions mix in XML entities so the
+ * parsers' decoding paths are exercised, and attributes vary the way
+ * a real backlog does (priority, status, created, and depends_on when
+ * Options::dependencies is set).
+ */
+class TaskGenerator {
+public:
+    struct Options {
+        size_t tasks = 1000;
+        size_t commands = 4;      ///< Per task.
+        size_t criteria = 2;      ///< Per task.
+        size_t textBytes = 120;   ///< Approximate size of each description, command and criterion.
+        size_t dependencies = 0;  ///< Up to this many depends_on ids per task, on recent earlier tasks.
+        uint64_t seed = 42;
+    };
+
+    explicit TaskGenerator(Options options);
+
+    const Options& options() const { return m_options; }
+
+    /** @brief The id of task @p index. */
+    static std::string taskId(size_t index);
+
+    /** @brief A tasks.xml document holding every task. */
+    std::string tasksXml() const;
+
+    /** @brief Task @p index as a standalone queue file (a <task> root). */
+    std::string taskXml(size_t index) const;
+
+    /**
+     * @brief Writes every task into @p directory as <id>.xml, the way the scheduler's queue holds them.
+     * @return The number of files written.
+     */
+    size_t writeBacklog(const fs::path& directory) const;
+
+private:
+    void appendTask(std::string& out, size_t index, const char* indent) const;
+    void appendText(std::string& out, uint64_t& state, size_t bytes) const;
+    void appendDependencies(std::string& out, size_t index) const;
+
+    Options m_options;
+};
+
+#endif //PRISMQUANTA_TASK_GENERATOR_H
@@ -0,0 +1,1041 @@
+// pq_bench: microbenchmarks for the daemon's hot paths and an end-to-end
+// queue-drain run against a real pq_daemon, with results as JSON so runs
+// from different commits can be compared (see --baseline).
+#include "TaskGenerator.h"
+#include "Config.h"
+#include "Json.h"
+#include "LiveConfig.h"
+#include "LogIndex.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "PQLParser.h"
+#include "PQLStore.h"
+#include "PromptGenerator.h"
+#include "PromptTemplate.h"
+#include "QueueWatcher.h"
+#include "RuleEngine.h"
+#include "RuleProgram.h"
+#include "TaskGraph.h"
+#include "TaskTable.h"
+#include "ThreadPool.h"
+#include "WalQueue.h"
+#include "pq_daemon.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Stops the compiler from discarding a result the benchmark never uses.
+    template <typename T>
+    inline void keep(const T& value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    struct Result {
+        std::string name;
+        uint64_t iterations = 0;
+        double nsPerOp = 0;      ///< Median over the samples.
+        double minNsPerOp = 0;
+        std::vector<std::pair<std::string, double>> metrics;
+    };
+
+    struct Settings {
+        TaskGenerator::Options generator;
+        std::string filter;
+        double minTime = 0.2;
+        std::string daemon;
+        int workers = 4;
+        size_t drainTasks = 0;  // 0: the --tasks count.
+        int drainTimeoutSec = 120;
+        std::string envFile = "environment.txt";
+        std::string rulesFile = "rules/rules.xml";
+        std::string jsonFile;
+        std::string label;
+        std::string baseline;
+    };
+
+    class Bench {
+    public:
+        explicit Bench(const Settings& settings) : m_settings(settings) {}
+
+        bool enabled(const std::string& name) const {
+            return m_settings.filter.empty() || name.find(m_settings.filter) != std::string::npos;
+        }
+
+        /**
+         * Times fn() (one operation per call): the iteration count is doubled
+         * until a batch takes a fifth of --min-time, then five batches are run
+         * and the median is reported.
+         */
+        template <typename Fn>
+        void measure(const std::string& name, Fn&& fn, double itemsPerOp = 1, double bytesPerOp = 0,
+                     std::vector<std::pair<std::string, double>> extra = {}) {
+            if (!enabled(name)) {
+                return;
+            }
+            fn();  // Warm caches and lazy initialisation.
+            auto batch = [&fn](uint64_t iterations) {
+                auto start = Clock::now();
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    fn();
+                }
+                return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            };
+
+            const double target = m_settings.minTime * 1e9 / 5;
+            uint64_t iterations = 1;
+            while (batch(iterations) < target && iterations < (uint64_t(1) << 40)) {
+                iterations *= 2;
+            }
+            std::vector<double> samples;
+            for (int i = 0; i < 5; ++i) {
+                samples.push_back(batch(iterations) / static_cast<double>(iterations));
+            }
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations * samples.size();
+            result.nsPerOp = samples[samples.size() / 2];
+            result.minNsPerOp = samples.front();
+            if (itemsPerOp > 0) {
+                result.metrics.emplace_back("items_per_sec", itemsPerOp * 1e9 / result.nsPerOp);
+            }
+            if (bytesPerOp > 0) {
+                result.metrics.emplace_back("mb_per_sec", bytesPerOp * 1e3 / result.nsPerOp);
+            }
+            result.metrics.insert(result.metrics.end(), extra.begin(), extra.end());
+            add(std::move(result));
+        }
+
+        void add(Result result) {
+            std::printf("%-28s %14.1f ns/op", result.name.c_str(), result.nsPerOp);
+            for (const auto& [metric, value] : result.metrics) {
+                std::printf("  %s=%.1f", metric.c_str(), value);
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+            m_results.push_back(std::move(result));
+        }
+
+        const std::vector<Result>& results() const { return m_results; }
+
+    private:
+        const Settings& m_settings;
+        std::vector<Result> m_results;
+    };
+
+    bool write_file(const fs::path& path, std::string_view content) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        return static_cast<bool>(out);
+    }
+
+    std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        return content.str();
+    }
+
+    double percentile(std::vector<double> sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    // --- Microbenchmarks ---
+
+    void run_pql(Bench& bench, const TaskGenerator& generator, const fs::path& work) {
+        const std::string doc = generator.tasksXml();
+        const double tasks = static_cast<double>(generator.options().tasks);
+        PQLParser parser;
+
+        bench.measure("pql_parse", [&] {
+            size_t commands = 0;
+            parser.parseBuffer(doc, [&commands](const PQLTaskView& task) {
+                commands += task.commands.size();
+                return true;
+            });
+            keep(commands);
+        }, tasks, static_cast<double>(doc.size()));
+
+        bench.measure("pql_validate", [&] {
+            std::vector<std::string> problems;
+            keep(PQLParser::validate(doc, problems));
+        }, tasks, static_cast<double>(doc.size()));
+
+        // What the scheduler does per claimed task: map one queue file and take its task.
+        const fs::path queue_file = work / "queue_task.xml";
+        write_file(queue_file, generator.taskXml(0));
+        bench.measure("pql_parse_queue_file", [&] {
+            PQLTask task;
+            parser.parse(queue_file.string(), [&task](const PQLTaskView& view) {
+                task = PQLTask(view);
+                return false;
+            });
+            keep(task);
+        });
+
+        const fs::path source = work / "tasks.xml";
+        const fs::path store_path = work / "tasks.pqlc";
+        write_file(source, doc);
+        bench.measure("pql_store_compile", [&] {
+            keep(PQLStore::compile(source.string(), store_path.string()));
+        }, tasks, static_cast<double>(doc.size()));
+
+        PQLStore store;
+        if (!bench.enabled("pql_store_find") || !PQLStore::compile(source.string(), store_path.string()) ||
+            !store.open(store_path.string())) {
+            return;
+        }
+        std::vector<std::string> ids;
+        uint64_t state = generator.options().seed;
+        for (size_t i = 0; i < std::min<size_t>(generator.options().tasks, 4096); ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            ids.push_back(TaskGenerator::taskId((state >> 33) % generator.options().tasks));
+        }
+        size_t next = 0;
+        PQLTaskView view;
+        bench.measure("pql_store_find", [&] {
+            keep(store.find(ids[next], view));
+            next = (next + 1) % ids.size();
+        });
+    }
+
+    // Heap bytes behind a PQLTask (libstdc++ keeps short strings inline).
+    size_t heap_bytes(const PQLTask& task) {
+        auto string_bytes = [](const std::string& s) {
+            return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+        };
+        size_t bytes = sizeof(PQLTask);
+        for (const std::string* field : {&task.id, &task.type, &task.priority, &task.status, &task.created,
+                                         &task.description, &task.notes}) {
+            bytes += string_bytes(*field);
+        }
+        for (const auto* lines : {&task.commands, &task.criteria}) {
+            bytes += lines->capacity() * sizeof(std::string);
+            for (const std::string& line : *lines) {
+                bytes += string_bytes(line);
+            }
+        }
+        return bytes;
+    }
+
+    // The columnar table against a vector<PQLTask>: building one from a document and filtering it.
+    void run_task_table(Bench& bench, const TaskGenerator& generator) {
+        const std::string doc = generator.tasksXml();
+        const double tasks = static_cast<double>(generator.options().tasks);
+        PQLParser parser;
+
+        std::vector<PQLTask> vector;
+        parser.parseBuffer(doc, [&vector](const PQLTaskView& view) {
+            vector.emplace_back(view);
+            return true;
+        });
+        size_t text_bytes = 0;
+        for (const PQLTask& task : vector) {
+            text_bytes += task.id.size() + task.created.size() + task.description.size() + task.notes.size();
+            for (const auto* lines : {&task.commands, &task.criteria}) {
+                for (const std::string& line : *lines) {
+                    text_bytes += line.size();
+                }
+            }
+        }
+        TaskTable table;
+        table.reserve(vector.size(), text_bytes);
+        parser.parseBuffer(doc, [&table](const PQLTaskView& view) { return table.add(view); });
+        if (table.size() != vector.size() || table.empty()) {
+            std::fprintf(stderr, "task_table: %zu of %zu tasks added\n", table.size(), vector.size());
+            return;
+        }
+        size_t vector_bytes = vector.capacity() * sizeof(PQLTask) - vector.size() * sizeof(PQLTask);
+        for (const PQLTask& task : vector) {
+            vector_bytes += heap_bytes(task);
+        }
+        
+        bench.measure("task_vector_build", [&] {
+            std::vector<PQLTask> built;
+            parser.parseBuffer(doc, [&built](const PQLTaskView& view) {
+                built.emplace_back(view);
+                return true;
+            });
+            keep(built);
+        }, tasks, static_cast<double>(doc.size()), {{"bytes_per_task", static_cast<double>(vector_bytes) / tasks}});
+
+        TaskTable built;
+        bench.measure("task_table_build", [&] {
+            built.clear();
+            parser.parseBuffer(doc, [&built](const PQLTaskView& view) { return built.add(view); });
+            keep(built);
+        }, tasks, static_cast<double>(doc.size()),
+           {{"bytes_per_task", static_cast<double>(table.memoryBytes()) / tasks}});
+
+        // What a scheduler pass does: find the pending high-priority work.
+        bench.measure("task_vector_select", [&] {
+            std::vector<uint32_t> rows;
+            for (size_t i = 0; i < vector.size(); ++i) {
+                if (vector[i].status == "pending" && vector[i].priority == "high") {
+                    rows.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            keep(rows);
+        }, tasks);
+
+        bench.measure("task_table_select", [&] {
+            keep(table.select(AtomTable::kPending, AtomTable::kHigh));
+        }, tasks);
+
+        size_t next = 0;
+        bench.measure("task_table_find", [&] {
+            keep(table.find(table.id(next)));
+            next = (next + 7919) % table.size();
+        });
+    }
+
+    // Replays a plan on simulated workers, each task taking its duration; returns when the last one ends.
+    double simulate_plan(TaskGraph& graph, const std::vector<double>& durations, size_t workers) {
+        using Finish = std::pair<double, size_t>;
+        std::priority_queue<Finish, std::vector<Finish>, std::greater<Finish>> running;
+        double now = 0;
+        while (!graph.finished()) {
+            while (running.size() < workers) {
+                std::optional<size_t> next = graph.next();
+                if (!next) {
+                    break;
+                }
+                running.emplace(now + durations[*next], *next);
+            }
+            now = running.top().first;
+            graph.finish(running.top().second, true);
+            running.pop();
+        }
+        return now;
+    }
+
+    // Dispatching a generated plan by critical path, against by priority and plan order alone.
+    void run_task_graph(Bench& bench, const Settings& settings) {
+        if (!bench.enabled("task_graph")) {
+            return;
+        }
+        TaskGenerator::Options options = settings.generator;
+        options.dependencies = std::max<size_t>(options.dependencies, 3);
+        options.commands = 1;  // Only the graph matters here.
+        options.criteria = 0;
+        options.textBytes = 16;
+        // As pq_daemon --plan loads it: straight from the parser's views into a TaskTable.
+        TaskTable plan;
+        std::vector<PQLTask> tasks;
+        PQLParser().parseBuffer(TaskGenerator(options).tasksXml(), [&plan, &tasks](const PQLTaskView& view) {
+            tasks.emplace_back(view);
+            return plan.add(view);
+        });
+
+        // Durations of 1 to 10 units, the same for every run with this seed.
+        std::vector<double> durations;
+        double serial = 0;
+        uint64_t state = options.seed;
+        for (const PQLTask& task : tasks) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            durations.push_back(static_cast<double>(1 + (state >> 33) % 10));
+            serial += task.status == "done" ? 0 : durations.back();
+        }
+        const size_t workers = static_cast<size_t>(std::max(1, settings.workers));
+        auto makespan = [&](bool critical_path) {
+            TaskGraph graph;
+            if (!graph.build(plan, critical_path ? durations : std::vector<double>(tasks.size(), 0.0))) {
+                std::fprintf(stderr, "task_graph: %s\n", graph.error().c_str());
+                return 0.0;
+            }
+            return simulate_plan(graph, durations, workers);
+        };
+        TaskGraph graph;
+        graph.build(plan, durations);
+        const double lower_bound = std::max(graph.criticalPathLength(), serial / static_cast<double>(workers));
+        const double count = static_cast<double>(tasks.size());
+
+        bench.measure("task_graph_build", [&] {
+            TaskGraph built;
+            keep(built.build(plan, durations));
+        }, count);
+
+        bench.measure("task_graph_schedule", [&] {
+            keep(makespan(true));
+        }, count, 0, {{"makespan", makespan(true)}, {"makespan_priority_order", makespan(false)},
+                      {"makespan_serial", serial}, {"makespan_lower_bound", lower_bound},
+                      {"workers", static_cast<double>(workers)}});
+    }
+
+    void run_config(Bench& bench, const Settings& settings, const Config& config) {
+        bench.measure("config_load", [&] {
+            Config loaded;
+            keep(loaded.load(settings.envFile));
+        });
+        bench.measure("config_get_string", [&] {
+            keep(config.getString("QUEUE_PENDING_DIR"));
+        });
+        const Scheduler::Keys& keys = Scheduler::keys();
+        ConfigSnapshot snapshot(keys.schema, config, 1);
+        bench.measure("config_snapshot_get", [&] {
+            keep(snapshot.get(keys.pendingDir));
+        });
+    }
+
+    // The cost every pipeline stage pays to be timed.
+    void run_metrics(Bench& bench) {
+        bench.measure("metrics_stage_timer", [] {
+            StageTimer timer(Stage::Parse);
+        });
+    }
+
+    void run_prompt_and_rules(Bench& bench, const Settings& settings, const Config& config,
+                              const TaskGenerator& generator) {
+        PQLTask task;
+        PQLParser().parseBuffer(generator.taskXml(0), [&task](const PQLTaskView& view) {
+            task = PQLTask(view);
+            return false;
+        });
+
+        PromptGenerator prompts;
+        prompts.load(config);
+        bench.measure("prompt_generate", [&] {
+            keep(prompts.generate(task));
+        });
+
+        // The built-in suffix layout as a template, then the shipped chat template through the cache.
+        constexpr std::string_view kTaskTemplate =
+            "Task: {{ task.description }}\n"
+            "Commands:\n{% for command in task.commands %}- {{ command }}\n{% endfor %}"
+            "Criteria:\n{% for criterion in task.criteria %}- {{ criterion }}\n{% endfor %}";
+        bench.measure("prompt_template_compile", [&] {
+            PromptTemplate compiled;
+            keep(compiled.compile(kTaskTemplate));
+        }, 1, static_cast<double>(kTaskTemplate.size()));
+
+        PromptTemplate taskTemplate;
+        taskTemplate.compile(kTaskTemplate);
+        const TemplateValue noContext = TemplateValue::map();
+        std::string rendered;
+        bench.measure("prompt_template_render", [&] {
+            rendered.clear();
+            taskTemplate.render(task, noContext, rendered);
+            keep(rendered.size());
+        });
+
+        TemplateCache templates;
+        std::string devTeamPath = "prompts/dev_team_template.jinja";
+        if (templates.get(devTeamPath)) {
+            TemplateValue message = TemplateValue::map();
+            message.set("role", TemplateValue::of(std::string_view("user")));
+            message.set("content", TemplateValue::of(std::string_view(task.description)));
+            TemplateValue context = TemplateValue::map();
+            context.set("messages", TemplateValue::list({message}));
+            bench.measure("prompt_template_render_dev_team", [&] {
+                rendered.clear();
+                templates.get(devTeamPath)->render(task, context, rendered);
+                keep(rendered.size());
+            });
+        }
+
+        // A response of a few kilobytes, in the generator's vocabulary.
+        std::string response;
+        for (size_t i = 0; response.size() < 4096; ++i) {
+            PQLParser().parseBuffer(generator.taskXml(i), [&response](const PQLTaskView& view) {
+                for (auto command : view.commands) {
+                    response.append(command).append(".\n");
+                }
+                return false;
+            });
+        }
+
+        RuleEngine rules;
+        rules.setBiasPatterns(RuleEngine::defaultBiasPatterns());
+        RuleReport report;
+        bench.measure("rule_engine_evaluate", [&] {
+            report = RuleReport();
+            keep(rules.evaluate(response, &report));
+        }, 1, static_cast<double>(response.size()));
+
+        RuleProgram program;
+        if (!program.loadFile(settings.rulesFile)) {
+            std::fprintf(stderr, "Skipping rule_program_evaluate: %s\n", program.error().c_str());
+            return;
+        }
+        ResponseFeatures features;
+        features.text = response;
+        features.report = &report;
+        features.tokens = static_cast<int>(response.size() / 4);
+        bench.measure("rule_program_evaluate", [&] {
+            keep(program.evaluate(features));
+        }, 1, static_cast<double>(response.size()));
+    }
+
+    void run_action_script(Bench& bench, const TaskGenerator& generator, const fs::path& work) {
+        if (!bench.enabled("action_script_generate")) {
+            return;
+        }
+        fs::path actions = work / "actions";
+        fs::create_directories(actions);
+        write_file(work / "actions.env", "ACTIONS_PENDING_DIR = " + actions.string() + "\n");
+        Config config;
+        config.load((work / "actions.env").string());
+        PQLTask task;
+        PQLParser().parseBuffer(generator.taskXml(0), [&task](const PQLTaskView& view) {
+            task = PQLTask(view);
+            return false;
+        });
+        ActionScriptGenerator scripts;
+        bench.measure("action_script_generate", [&] {
+            keep(scripts.generate(config, task));
+        });
+    }
+
+    // --- Queue backends ---
+
+    /**
+     * Pushes every task through enqueue, claim and complete on --workers
+     * threads at once, the way the daemon's producers and workers do: once
+     * with the queue directories (a file write and rename, a rename, an
+     * unlink) and once with a WalQueue (two committed records and one
+     * buffered one). Reports the time per state transition.
+     */
+    void run_queue_backends(Bench& bench, const Settings& settings, const TaskGenerator& generator,
+                            const fs::path& work) {
+        const size_t tasks = generator.options().tasks;
+        const int threads = settings.workers;
+        std::vector<std::string> files;
+        for (size_t i = 0; i < tasks; ++i) {
+            files.push_back(generator.taskXml(i));
+        }
+        auto report = [&](const std::string& name, double seconds, double commits) {
+            double transitions = 3.0 * static_cast<double>(tasks);
+            Result result;
+            result.name = name;
+            result.iterations = static_cast<uint64_t>(transitions);
+            result.nsPerOp = seconds * 1e9 / transitions;
+            result.minNsPerOp = result.nsPerOp;
+            result.metrics = {{"transitions_per_sec", transitions / seconds}, {"threads", static_cast<double>(threads)}};
+            if (commits > 0) {
+                result.metrics.emplace_back("transitions_per_commit", transitions / commits);
+            }
+            bench.add(std::move(result));
+        };
+        auto on_threads = [threads](auto&& body) {
+            auto start = Clock::now();
+            std::vector<std::thread> pool;
+            for (int t = 0; t < threads; ++t) {
+                pool.emplace_back(body, t);
+            }
+            for (auto& thread : pool) {
+                thread.join();
+            }
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        if (bench.enabled("queue_dir_transitions")) {
+            const fs::path root = work / "queue_dir";
+            for (const char* dir : {"staging", "pending", "in_progress"}) {
+                fs::create_directories(root / dir);
+            }
+            double seconds = on_threads([&](int t) {
+                for (size_t i = static_cast<size_t>(t); i < tasks; i += static_cast<size_t>(threads)) {
+                    std::string name = TaskGenerator::taskId(i) + ".xml";
+                    write_file(root / "staging" / name, files[i]);
+                    fs::rename(root / "staging" / name, root / "pending" / name);
+                    fs::rename(root / "pending" / name, root / "in_progress" / name);
+                    fs::remove(root / "in_progress" / name);
+                }
+            });
+            report("queue_dir_transitions", seconds, 0);
+        }
+
+        if (bench.enabled("queue_wal_transitions")) {
+            WalQueue queue(std::chrono::seconds(300));
+            if (!queue.open((work / "queue_wal" / "tasks.wal").string(), std::chrono::seconds(3600))) {
+                std::fprintf(stderr, "queue_wal_transitions: %s\n", queue.error().c_str());
+                return;
+            }
+            double seconds = on_threads([&](int t) {
+                for (size_t i = static_cast<size_t>(t); i < tasks; i += static_cast<size_t>(threads)) {
+                    queue.enqueue(TaskGenerator::taskId(i) + ".xml", files[i]);
+                    if (std::optional<WalQueue::Claim> claim = queue.claim()) {
+                        queue.complete(*claim);
+                    }
+                    queue.maintain();
+                }
+            });
+            report("queue_wal_transitions", seconds, static_cast<double>(queue.stats().commits));
+        }
+    }
+
+    // --- Log queries ---
+
+    // A Logger-format log of --tasks x 200 lines, one to two seconds apart, from a few components.
+    std::string make_log(const Settings& settings) {
+        const char* components[] = {"Daemon", "Scheduler", "RuleEngine", "PortoManager", "PortoManager:run.sh"};
+        const size_t lines = settings.generator.tasks * 200;
+        uint64_t state = settings.generator.seed;
+        time_t t = 1790000000;
+        std::string log;
+        log.reserve(lines * 80);
+        char stamp[64];
+        for (size_t i = 0; i < lines; ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            t += static_cast<time_t>((state >> 33) % 3);
+            struct tm tm;
+            gmtime_r(&t, &tm);
+            strftime(stamp, sizeof(stamp), "[%a %b %e %H:%M:%S %Y] [", &tm);
+            log.append(stamp).append(components[(state >> 40) % 5]).append("] ");
+            log.append("processed item ").append(std::to_string(i)).append(" token").append(std::to_string((state >> 20) % 10000));
+            log.push_back('\n');
+        }
+        return log;
+    }
+
+    /**
+     * Line splitting (memchr per line against 64-byte newline masks),
+     * building the sidecar index, and searches through it: a rare
+     * substring over the whole log on --workers threads and on one, and an
+     * hour's time range through the index against a scan of every line.
+     */
+    void run_logs(Bench& bench, const Settings& settings, const fs::path& work) {
+        const char* names[] = {"log_lines_memchr", "log_lines_simd", "log_index_build", "log_search_text",
+                               "log_search_text_1thread", "log_search_time_range", "log_scan_time_range"};
+        if (std::none_of(std::begin(names), std::end(names), [&bench](const char* name) { return bench.enabled(name); })) {
+            return;
+        }
+        const std::string log = make_log(settings);
+        const fs::path path = work / "bench.log";
+        write_file(path, log);
+        const double bytes = static_cast<double>(log.size());
+        const double lines = static_cast<double>(std::count(log.begin(), log.end(), '\n'));
+
+        bench.measure("log_lines_memchr", [&] {
+            size_t count = 0;
+            const char* p = log.data();
+            const char* end = p + log.size();
+            while (const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p))) {
+                p = static_cast<const char*>(newline) + 1;
+                ++count;
+            }
+            keep(count);
+        }, lines, bytes);
+
+        bench.measure("log_lines_simd", [&] {
+            size_t count = 0;
+            LineScanner scanner(log);
+            std::string_view line;
+            while (scanner.next(line)) {
+                ++count;
+            }
+            keep(count);
+        }, lines, bytes);
+
+        ThreadPool pool(static_cast<size_t>(settings.workers));
+        ThreadPool single(1);
+        const std::string index_path = LogIndex::indexPathFor(path.string());
+        bench.measure("log_index_build", [&] {
+            fs::remove(index_path);
+            LogIndex index;
+            keep(index.open(path.string(), pool));
+        }, lines, bytes);
+
+        LogIndex index;
+        if (!index.open(path.string(), pool) || !index.save()) {
+            std::fprintf(stderr, "log_*: %s\n", index.error().c_str());
+            return;
+        }
+        const double threads = static_cast<double>(settings.workers);
+        LogIndex::Query rare;
+        rare.text = "token4242";
+        bench.measure("log_search_text", [&] {
+            keep(index.search(rare, pool));
+        }, lines, bytes, {{"threads", threads}});
+        bench.measure("log_search_text_1thread", [&] {
+            keep(index.search(rare, single));
+        }, lines, bytes, {{"threads", 1}});
+
+        // An hour from the middle of the log.
+        std::string_view middle(log.data() + log.size() / 2, 200);
+        middle.remove_prefix(middle.find('\n') + 1);
+        LogIndex::Query hour;
+        hour.since = LogIndex::lineTime(middle);
+        hour.until = *hour.since + 3600;
+        size_t visited = 0;
+        keep(index.search(hour, pool, &visited));
+        bench.measure("log_search_time_range", [&] {
+            keep(index.search(hour, pool));
+        }, 1, 0, {{"blocks_read", static_cast<double>(visited)}, {"blocks", static_cast<double>(index.blockCount())}});
+
+        bench.measure("log_scan_time_range", [&] {
+            std::vector<std::string_view> found;
+            LineScanner scanner(log);
+            std::string_view line;
+            while (scanner.next(line)) {
+                auto time = LogIndex::lineTime(line);
+                if (time && *time >= *hour.since && *time <= *hour.until) {
+                    found.push_back(line);
+                }
+            }
+            keep(found);
+        }, 1, bytes);
+    }
+
+    // --- End-to-end queue drain ---
+
+    /**
+     * Starts the daemon on a private set of queue directories, waits until it
+     * watches the pending queue, then enqueues the backlog one file at a time
+     * (written beside the queue and renamed in, as producers do). A task's
+     * latency runs from its rename to the close of its action script.
+     */
+    bool run_queue_drain(Bench& bench, const Settings& settings, const fs::path& work, const std::string& backend) {
+        const std::string name = backend == "dir" ? "queue_drain" : "queue_drain_" + backend;
+        if (settings.daemon.empty() || !bench.enabled(name)) {
+            return true;
+        }
+        const fs::path daemon = fs::absolute(settings.daemon);
+        if (::access(daemon.c_str(), X_OK) != 0) {
+            std::fprintf(stderr, "Skipping %s: %s is not executable\n", name.c_str(), daemon.c_str());
+            return true;
+        }
+
+        TaskGenerator::Options options = settings.generator;
+        if (settings.drainTasks > 0) {
+            options.tasks = settings.drainTasks;
+        }
+        TaskGenerator generator(options);
+        const fs::path root = work / name;
+        for (const char* dir : {"pending", "in_progress", "failed", "actions", "staging"}) {
+            fs::create_directories(root / dir);
+        }
+        write_file(root / "environment.txt",
+                   "QUEUE_PENDING_DIR = pending\nQUEUE_IN_PROGRESS_DIR = in_progress\nQUEUE_FAILED_DIR = failed\n"
+                   "ACTIONS_PENDING_DIR = actions\nLOG_FILE = daemon.log\nPOLL_INTERVAL_SEC = 1\n"
+                   "SCHEDULER_WORKERS = " + std::to_string(settings.workers) + "\n"
+                   "QUEUE_BACKEND = " + backend + "\nQUEUE_WAL_FILE = queue.wal\n");
+
+        std::vector<std::string> files;
+        for (size_t i = 0; i < options.tasks; ++i) {
+            files.push_back(generator.taskXml(i));
+        }
+
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            std::fprintf(stderr, "%s: fork failed: %s\n", name.c_str(), std::strerror(errno));
+            return false;
+        }
+        if (pid == 0) {
+            int null_fd = ::open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                ::dup2(null_fd, STDIN_FILENO);
+                ::dup2(null_fd, STDOUT_FILENO);
+                ::dup2(null_fd, STDERR_FILENO);
+            }
+            if (::chdir(root.c_str()) == 0) {
+                ::execl(daemon.c_str(), daemon.c_str(), static_cast<char*>(nullptr));
+            }
+            ::_exit(127);
+        }
+        auto stop_daemon = [pid] {
+            ::kill(pid, SIGTERM);
+            ::waitpid(pid, nullptr, 0);
+        };
+
+        // Ready once it reports the queue it monitors.
+        auto deadline = Clock::now() + std::chrono::seconds(10);
+        while (read_file(root / "daemon.log").find("Monitoring queue") == std::string::npos) {
+            if (Clock::now() > deadline || ::waitpid(pid, nullptr, WNOHANG) == pid) {
+                std::fprintf(stderr, "%s: %s did not start\n", name.c_str(), daemon.c_str());
+                stop_daemon();
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        QueueWatcher done_watcher(root / "actions", std::chrono::seconds(1));
+        done_watcher.start();
+        std::vector<Clock::time_point> enqueued(options.tasks);
+        std::vector<Clock::time_point> finished(options.tasks);
+        std::vector<bool> seen(options.tasks, false);
+        size_t completed = 0;
+        auto collect = [&](std::chrono::milliseconds timeout) {
+            while (auto path = done_watcher.next(timeout)) {
+                std::string id = path->stem().string();
+                if (id.rfind("task-", 0) != 0) {
+                    continue;
+                }
+                size_t index = std::strtoul(id.c_str() + 5, nullptr, 10);
+                if (index < seen.size() && !seen[index]) {
+                    seen[index] = true;
+                    finished[index] = Clock::now();
+                    ++completed;
+                }
+                timeout = std::chrono::milliseconds(0);
+            }
+        };
+
+        const Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < options.tasks; ++i) {
+            std::string name = TaskGenerator::taskId(i) + ".xml";
+            write_file(root / "staging" / name, files[i]);
+            fs::rename(root / "staging" / name, root / "pending" / name);
+            enqueued[i] = Clock::now();
+            collect(std::chrono::milliseconds(0));
+        }
+        deadline = Clock::now() + std::chrono::seconds(settings.drainTimeoutSec);
+        while (completed < options.tasks && Clock::now() < deadline) {
+            collect(std::chrono::milliseconds(50));
+        }
+        stop_daemon();
+
+        std::vector<double> latencies;
+        Clock::time_point last = start;
+        for (size_t i = 0; i < options.tasks; ++i) {
+            if (seen[i]) {
+                latencies.push_back(std::chrono::duration<double, std::milli>(finished[i] - enqueued[i]).count());
+                last = std::max(last, finished[i]);
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double wall_ns = std::chrono::duration<double, std::nano>(last - start).count();
+        size_t failed = 0;
+        for (const auto& entry : fs::directory_iterator(root / "failed")) {
+            (void)entry;
+            ++failed;
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = completed;
+        result.nsPerOp = completed ? wall_ns / static_cast<double>(completed) : 0;
+        result.minNsPerOp = result.nsPerOp;
+        result.metrics = {
+            {"tasks", static_cast<double>(options.tasks)},
+            {"completed", static_cast<double>(completed)},
+            {"failed", static_cast<double>(failed)},
+            {"workers", static_cast<double>(settings.workers)},
+            {"tasks_per_sec", wall_ns > 0 ? static_cast<double>(completed) * 1e9 / wall_ns : 0},
+            {"p50_ms", percentile(latencies, 50)},
+            {"p99_ms", percentile(latencies, 99)},
+            {"max_ms", latencies.empty() ? 0 : latencies.back()},
+        };
+        bench.add(std::move(result));
+        if (completed < options.tasks) {
+            std::fprintf(stderr, "%s: only %zu of %zu tasks completed (%zu failed); see %s\n", name.c_str(), completed,
+                         options.tasks, failed, (root / "daemon.log").c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // --- Output ---
+
+    std::string results_json(const Settings& settings, const std::vector<Result>& results) {
+        std::string out;
+        JsonWriter json(out);
+        const TaskGenerator::Options& options = settings.generator;
+        json.beginObject()
+            .key("label").value(settings.label)
+            .key("timestamp").value(static_cast<int64_t>(std::time(nullptr)))
+            .key("cpus").value(static_cast<int64_t>(std::thread::hardware_concurrency()))
+            .key("options").beginObject()
+                .key("tasks").value(static_cast<int64_t>(options.tasks))
+                .key("commands").value(static_cast<int64_t>(options.commands))
+                .key("criteria").value(static_cast<int64_t>(options.criteria))
+                .key("text_bytes").value(static_cast<int64_t>(options.textBytes))
+                .key("seed").value(static_cast<int64_t>(options.seed))
+            .endObject()
+            .key("results").beginArray();
+        for (const Result& result : results) {
+            json.beginObject()
+                .key("name").value(result.name)
+                .key("iterations").value(static_cast<int64_t>(result.iterations))
+                .key("ns_per_op").value(result.nsPerOp)
+                .key("min_ns_per_op").value(result.minNsPerOp);
+            for (const auto& [metric, value] : result.metrics) {
+                json.key(metric).value(value);
+            }
+            json.endObject();
+        }
+        json.endArray().endObject();
+        out.push_back('\n');
+        return out;
+    }
+
+    // Prints each benchmark's change against an earlier run; slower by over 10% is marked.
+    void compare(const std::string& baselineFile, const std::vector<Result>& results) {
+        std::string text = read_file(baselineFile);
+        JsonView baseline = JsonView::parse(text)["results"];
+        if (!baseline.isArray()) {
+            std::fprintf(stderr, "Cannot read baseline results from %s\n", baselineFile.c_str());
+            return;
+        }
+        std::printf("\nChange against %s (ns/op, lower is better):\n", baselineFile.c_str());
+        for (const Result& result : results) {
+            double before = 0;
+            baseline.forEachElement([&](const JsonView& entry) {
+                if (entry["name"].toString() == result.name) {
+                    before = entry["ns_per_op"].toDouble();
+                    return false;
+                }
+                return true;
+            });
+            if (before <= 0 || result.nsPerOp <= 0) {
+                continue;
+            }
+            double change = (result.nsPerOp - before) / before * 100.0;
+            std::printf("%-28s %+7.1f%%%s\n", result.name.c_str(), change, change > 10.0 ? "  REGRESSION" : "");
+        }
+    }
+
+    void usage() {
+        std::cout << "Usage:\n"
+                     "  pq_bench [options]                       Run the benchmarks\n"
+                     "  pq_bench generate tasks <file> [options] Write a synthetic tasks.xml\n"
+                     "  pq_bench generate queue <dir> [options]  Write a synthetic queue backlog (<id>.xml per task)\n"
+                     "\nWorkload options:\n"
+                     "  --tasks N          Tasks to generate (default 1000)\n"
+                     "  --commands N       Commands per task (default 4)\n"
+                     "  --criteria N       Criteria per task (default 2)\n"
+                     "  --text BYTES       Size of each description, command and criterion (default 120)\n"
+                     "  --seed N           Generator seed (default 42)\n"
+                     "  --dependencies N   Up to N depends_on ids per task (default 0; task_graph_* use at least 3)\n"
+                     "\nBenchmark options:\n"
+                     "  --filter TEXT      Only run benchmarks whose name contains TEXT\n"
+                     "  --min-time SEC     Time per benchmark (default 0.2)\n"
+                     "  --env FILE         Configuration for the config and prompt benchmarks (default environment.txt)\n"
+                     "  --rules FILE       Rules for rule_program_evaluate (default rules/rules.xml)\n"
+                     "  --daemon PATH      pq_daemon binary for queue_drain (directory queue) and queue_drain_wal\n"
+                     "                     (QUEUE_BACKEND = wal); without it both are skipped\n"
+                     "  --workers N        SCHEDULER_WORKERS for the drains, threads for queue_*_transitions and\n"
+                     "                     simulated workers for task_graph_schedule and threads for log_search_*\n"
+                     "                     (default 4)\n"
+                     "  --drain-tasks N    Backlog size for queue_drain (default --tasks)\n"
+                     "  --json FILE        Write the results as JSON\n"
+                     "  --label TEXT       Recorded in the JSON, e.g. the commit\n"
+                     "  --baseline FILE    Compare against the JSON of an earlier run\n";
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--tasks") settings.generator.tasks = std::stoul(value());
+        else if (arg == "--commands") settings.generator.commands = std::stoul(value());
+        else if (arg == "--criteria") settings.generator.criteria = std::stoul(value());
+        else if (arg == "--text") settings.generator.textBytes = std::stoul(value());
+        else if (arg == "--seed") settings.generator.seed = std::stoull(value());
+        else if (arg == "--dependencies") settings.generator.dependencies = std::stoul(value());
+        else if (arg == "--filter") settings.filter = value();
+        else if (arg == "--min-time") settings.minTime = std::stod(value());
+        else if (arg == "--env") settings.envFile = value();
+        else if (arg == "--rules") settings.rulesFile = value();
+        else if (arg == "--daemon") settings.daemon = value();
+        else if (arg == "--workers") settings.workers = std::max(1, std::stoi(value()));
+        else if (arg == "--drain-tasks") settings.drainTasks = std::stoul(value());
+        else if (arg == "--json") settings.jsonFile = value();
+        else if (arg == "--label") settings.label = value();
+        else if (arg == "--baseline") settings.baseline = value();
+        else if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage();
+            return 2;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    TaskGenerator generator(settings.generator);
+    if (!positional.empty()) {
+        if (positional.size() != 3 || positional[0] != "generate") {
+            usage();
+            return 2;
+        }
+        if (positional[1] == "tasks") {
+            return write_file(positional[2], generator.tasksXml()) ? 0 : 1;
+        }
+        if (positional[1] == "queue") {
+            return generator.writeBacklog(positional[2]) == settings.generator.tasks ? 0 : 1;
+        }
+        usage();
+        return 2;
+    }
+
+    // Components log as they would in the daemon, but only problems reach the console.
+    Logger::instance().setLevel(LogLevel::Warn);
+
+    fs::path work = fs::temp_directory_path() / ("pq_bench." + std::to_string(::getpid()));
+    fs::create_directories(work);
+
+    Config config;
+    if (!config.load(settings.envFile)) {
+        std::fprintf(stderr, "Cannot read %s; config and prompt benchmarks use an empty configuration.\n",
+                     settings.envFile.c_str());
+    }
+
+    Bench bench(settings);
+    run_pql(bench, generator, work);
+    run_task_table(bench, generator);
+    run_task_graph(bench, settings);
+    run_config(bench, settings, config);
+    run_metrics(bench);
+    run_prompt_and_rules(bench, settings, config, generator);
+    run_action_script(bench, generator, work);
+    run_logs(bench, settings, work);
+    run_queue_backends(bench, settings, generator, work);
+    bool drained = run_queue_drain(bench, settings, work, "dir");
+    drained = run_queue_drain(bench, settings, work, "wal") && drained;
+
+    // A failed drain leaves its queue directories and daemon log behind for inspection.
+    std::error_code cleanup_error;
+    if (drained) {
+        fs::remove_all(work, cleanup_error);
+    }
+
+    if (!settings.jsonFile.empty()) {
+        fs::path out(settings.jsonFile);
+        if (out.has_parent_path()) {
+            fs::create_directories(out.parent_path(), cleanup_error);
+        }
+        if (!write_file(out, results_json(settings, bench.results()))) {
+            std::fprintf(stderr, "Cannot write %s\n", settings.jsonFile.c_str());
+            return 1;
+        }
+        std::printf("Results written to %s\n", settings.jsonFile.c_str());
+    }
+    if (!settings.baseline.empty()) {
+        compare(settings.baseline, bench.results());
+    }
+    return drained ? 0 : 1;
+}
@@ -36,6 +36,9 @@ public:
      */
     std::optional<int> getInt(const std::string& key) const;
 
+    /** @brief Every key and value loaded so far. */
+    const std::map<std::string, std::string>& values() const { return m_values; }
+
 private:
     std::map<std::string, std::string> m_values;
 };
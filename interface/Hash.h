@@ -0,0 +1,71 @@
+#ifndef PRISMQUANTA_HASH_H
+#define PRISMQUANTA_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief 128-bit content hash, used where a collision would hand back the wrong data.
+ */
+struct Hash128 {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const Hash128& other) const { return hi == other.hi && lo == other.lo; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Incremental FNV-1a hasher producing a 64- or 128-bit digest.
+ *
+ * Two FNV-1a streams with different offset bases run side by side, and
+ * each is passed through a 64-bit finalizer so that nearby inputs spread
+ * over the whole digest. Not cryptographic; use it for keys and checksums.
+ */
+class Hasher {
+public:
+    Hasher& update(std::string_view data) {
+        for (unsigned char c : data) {
+            m_a = (m_a ^ c) * kPrime;
+            m_b = (m_b ^ c) * kPrime;
+        }
+        return *this;
+    }
+
+    /** @brief Hashes a field followed by a separator, so ("ab","c") and ("a","bc") differ. */
+    Hasher& field(std::string_view data) {
+        update(data);
+        m_a = (m_a ^ 0xFF) * kPrime;
+        m_b = (m_b ^ 0xFE) * kPrime;
+        return *this;
+    }
+
+    Hash128 digest128() const { return {mix(m_a), mix(m_b ^ m_a)}; }
+    uint64_t digest64() const { return mix(m_a); }
+
+    static uint64_t hash64(std::string_view data) { return Hasher().update(data).digest64(); }
+    static Hash128 hash128(std::string_view data) { return Hasher().update(data).digest128(); }
+
+private:
+    static constexpr uint64_t kPrime = 0x100000001b3ULL;
+
+    // splitmix64 finalizer.
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    uint64_t m_a = 0xcbf29ce484222325ULL;  // Standard FNV-1a 64 offset basis.
+    uint64_t m_b = 0x84222325cbf29ce4ULL;
+};
+
+struct Hash128Hasher {
+    size_t operator()(const Hash128& hash) const { return static_cast<size_t>(hash.lo ^ (hash.hi * 31)); }
+};
+
+#endif //PRISMQUANTA_HASH_H
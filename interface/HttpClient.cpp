@@ -0,0 +1,450 @@
+#include "HttpClient.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+struct HttpClient::Connection {
+    int fd = -1;
+    // Bytes received but not yet consumed; survives between responses on a kept-alive connection.
+    std::string buffer;
+
+    ~Connection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+namespace {
+    bool iequals(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool icontains(std::string_view haystack, std::string_view needle) {
+        if (needle.size() > haystack.size()) {
+            return false;
+        }
+        for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+            if (iequals(haystack.substr(i, needle.size()), needle)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    // Waits until fd is ready for the given events. Returns false on timeout or error.
+    bool wait_for(int fd, short events, std::chrono::milliseconds timeout) {
+        struct pollfd pfd = {fd, events, 0};
+        int ms = timeout.count() > 0 ? static_cast<int>(timeout.count()) : -1;
+        while (true) {
+            int n = poll(&pfd, 1, ms);
+            if (n > 0) return true;
+            if (n == 0) return false;
+            if (errno != EINTR) return false;
+        }
+    }
+
+    // The outcome of reading more bytes from the socket.
+    enum class ReadResult { Data, Closed, TimedOut, Failed };
+
+    ReadResult read_more(int fd, std::string& buffer, std::chrono::milliseconds timeout) {
+        char chunk[16 * 1024];
+        while (true) {
+            if (!wait_for(fd, POLLIN, timeout)) {
+                return ReadResult::TimedOut;
+            }
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            int err = errno;
+            // Acknowledge at once: a server that writes headers and body separately
+            // would otherwise stall on Nagle until our delayed ACK fires (~40 ms).
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+            errno = err;
+            if (n > 0) {
+                buffer.append(chunk, static_cast<size_t>(n));
+                return ReadResult::Data;
+            }
+            if (n == 0) {
+                return ReadResult::Closed;
+            }
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return ReadResult::Failed;
+        }
+    }
+} // namespace
+
+HttpClient::HttpClient(std::string_view baseUrl, std::chrono::milliseconds timeout) : m_timeout(timeout) {
+    constexpr std::string_view scheme = "http://";
+    if (baseUrl.substr(0, scheme.size()) != scheme) {
+        m_error = "unsupported URL (only http:// is supported): " + std::string(baseUrl);
+        return;
+    }
+    std::string_view rest = baseUrl.substr(scheme.size());
+    rest = rest.substr(0, rest.find('/'));
+
+    std::string_view host = rest;
+    size_t colon = rest.rfind(':');
+    if (colon != std::string_view::npos && rest.find(']') == std::string_view::npos) {
+        host = rest.substr(0, colon);
+        std::string_view port = rest.substr(colon + 1);
+        unsigned value = 0;
+        auto [end, ec] = std::from_chars(port.data(), port.data() + port.size(), value);
+        if (ec != std::errc() || end != port.data() + port.size() || value == 0 || value > 65535) {
+            m_error = "invalid port in URL: " + std::string(baseUrl);
+            return;
+        }
+        m_port = static_cast<uint16_t>(value);
+    }
+    if (host.empty()) {
+        m_error = "missing host in URL: " + std::string(baseUrl);
+        return;
+    }
+    m_host = std::string(host);
+    m_hostHeader = std::string(rest);
+}
+
+HttpClient::~HttpClient() = default;
+
+std::unique_ptr<HttpClient::Connection> HttpClient::connect(std::string& error) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    std::string port = std::to_string(m_port);
+    int rc = getaddrinfo(m_host.c_str(), port.c_str(), &hints, &addresses);
+    if (rc != 0) {
+        error = "cannot resolve " + m_host + ": " + gai_strerror(rc);
+        return nullptr;
+    }
+
+    auto connection = std::make_unique<Connection>();
+    error.clear();
+    for (struct addrinfo* ai = addresses; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            continue;
+        }
+        int result = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (result != 0 && errno == EINPROGRESS) {
+            int soError = ETIMEDOUT;
+            socklen_t len = sizeof(soError);
+            if (wait_for(fd, POLLOUT, m_timeout)) {
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &len);
+            }
+            errno = soError;
+            result = soError == 0 ? 0 : -1;
+        }
+        if (result != 0) {
+            error = "cannot connect to " + m_hostHeader + ": " + std::strerror(errno);
+            close(fd);
+            continue;
+        }
+        // Requests are written in one call, so Nagle would only add latency.
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        connection->fd = fd;
+        break;
+    }
+    freeaddrinfo(addresses);
+
+    if (connection->fd < 0) {
+        return nullptr;
+    }
+    m_connectionsOpened.fetch_add(1, std::memory_order_relaxed);
+    return connection;
+}
+
+std::unique_ptr<HttpClient::Connection> HttpClient::acquire(bool& reused, std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        if (!m_idle.empty()) {
+            auto connection = std::move(m_idle.back());
+            m_idle.pop_back();
+            reused = true;
+            return connection;
+        }
+    }
+    reused = false;
+    return connect(error);
+}
+
+void HttpClient::release(std::unique_ptr<Connection> connection) {
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    if (m_idle.size() < kMaxIdle) {
+        m_idle.push_back(std::move(connection));
+    }
+}
+
+HttpResponse HttpClient::post(std::string_view path, std::string_view body,
+                              std::string_view contentType, const BodyCallback& onBody) {
+    HttpResponse response;
+    if (!valid()) {
+        response.error = m_error;
+        return response;
+    }
+
+    std::string head;
+    head.reserve(160 + path.size() + m_hostHeader.size());
+    head.append("POST ").append(path.empty() ? "/" : path).append(" HTTP/1.1\r\n");
+    head.append("Host: ").append(m_hostHeader).append("\r\n");
+    head.append("Content-Type: ").append(contentType).append("\r\n");
+    head.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    head.append("Connection: keep-alive\r\n\r\n");
+
+    // One retry: a pooled connection may have been closed by the server while idle.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = false;
+        std::unique_ptr<Connection> connection = acquire(reused, response.error);
+        if (!connection) {
+            return response;
+        }
+        bool reusable = false;
+        Attempt outcome = exchange(*connection, head, body, onBody, response, reusable);
+        if (outcome == Attempt::Stale && reused) {
+            response = HttpResponse();
+            continue;
+        }
+        if (reusable) {
+            release(std::move(connection));
+        }
+        return response;
+    }
+    return response;
+}
+
+HttpClient::Attempt HttpClient::exchange(Connection& connection, const std::string& head, std::string_view body,
+                                         const BodyCallback& onBody, HttpResponse& response, bool& reusable) {
+    reusable = false;
+    connection.buffer.clear();
+
+    // --- Send ---
+    struct iovec parts[2];
+    parts[0].iov_base = const_cast<char*>(head.data());
+    parts[0].iov_len = head.size();
+    parts[1].iov_base = const_cast<char*>(body.data());
+    parts[1].iov_len = body.size();
+    size_t remaining = head.size() + body.size();
+    int first = 0;
+    while (remaining > 0) {
+        struct msghdr msg = {};
+        msg.msg_iov = parts + first;
+        msg.msg_iovlen = static_cast<size_t>(2 - first);
+        ssize_t n = sendmsg(connection.fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN && wait_for(connection.fd, POLLOUT, m_timeout)) {
+                continue;
+            }
+            bool stale = errno == EPIPE || errno == ECONNRESET;
+            response.error = std::string("send failed: ") + (errno == EAGAIN ? "timed out" : std::strerror(errno));
+            return stale ? Attempt::Stale : Attempt::Done;
+        }
+        remaining -= static_cast<size_t>(n);
+        size_t sent = static_cast<size_t>(n);
+        while (first < 2 && sent >= parts[first].iov_len) {
+            sent -= parts[first].iov_len;
+            ++first;
+        }
+        if (first < 2) {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + sent;
+            parts[first].iov_len -= sent;
+        }
+    }
+
+    std::string& buffer = connection.buffer;
+    auto fail = [&response](ReadResult result) {
+        switch (result) {
+            case ReadResult::Closed: response.error = "connection closed by server"; break;
+            case ReadResult::TimedOut: response.error = "timed out waiting for server"; break;
+            default: response.error = std::string("receive failed: ") + std::strerror(errno); break;
+        }
+        return Attempt::Done;
+    };
+
+    // --- Status line and headers ---
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ReadResult result = read_more(connection.fd, buffer, m_timeout);
+        if (result != ReadResult::Data) {
+            if (buffer.empty() && (result == ReadResult::Closed || (result == ReadResult::Failed && errno == ECONNRESET))) {
+                response.error = "connection closed by server";
+                return Attempt::Stale;
+            }
+            return fail(result);
+        }
+    }
+
+    std::string_view headers(buffer.data(), headerEnd);
+    size_t lineEnd = headers.find("\r\n");
+    std::string_view statusLine = headers.substr(0, lineEnd);
+    if (statusLine.substr(0, 5) != "HTTP/" || statusLine.size() < 12) {
+        response.error = "malformed status line";
+        return Attempt::Done;
+    }
+    std::from_chars(statusLine.data() + 9, statusLine.data() + 12, response.status);
+    bool http10 = statusLine.substr(0, 8) == "HTTP/1.0";
+
+    bool chunked = false;
+    bool closeAfter = http10;
+    long long contentLength = -1;
+    while (lineEnd != std::string_view::npos) {
+        size_t start = lineEnd + 2;
+        lineEnd = headers.find("\r\n", start);
+        std::string_view line = headers.substr(start, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - start);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view name = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+        if (iequals(name, "Content-Length")) {
+            std::from_chars(value.data(), value.data() + value.size(), contentLength);
+        } else if (iequals(name, "Transfer-Encoding")) {
+            chunked = icontains(value, "chunked");
+        } else if (iequals(name, "Connection")) {
+            if (icontains(value, "close")) closeAfter = true;
+            else if (icontains(value, "keep-alive")) closeAfter = false;
+        }
+    }
+    buffer.erase(0, headerEnd + 4);
+
+    // Hands body bytes to the callback or the response; false means the callback aborted.
+    auto emit = [&](std::string_view data) {
+        if (data.empty()) {
+            return true;
+        }
+        if (onBody) {
+            if (!onBody(data)) {
+                response.cancelled = true;
+                return false;
+            }
+            return true;
+        }
+        response.body.append(data);
+        return true;
+    };
+
+    // --- Body ---
+    if (response.status == 204 || response.status == 304 || (response.status >= 100 && response.status < 200)) {
+        reusable = !closeAfter;
+        return Attempt::Done;
+    }
+
+    if (chunked) {
+        while (true) {
+            size_t sizeEnd;
+            while ((sizeEnd = buffer.find("\r\n")) == std::string::npos) {
+                ReadResult result = read_more(connection.fd, buffer, m_timeout);
+                if (result != ReadResult::Data) return fail(result);
+            }
+            size_t chunkSize = 0;
+            auto [end, ec] = std::from_chars(buffer.data(), buffer.data() + sizeEnd, chunkSize, 16);
+            if (ec != std::errc()) {
+                response.error = "malformed chunk size";
+                return Attempt::Done;
+            }
+            (void)end;
+            buffer.erase(0, sizeEnd + 2);
+
+            if (chunkSize == 0) {
+                // Skip any trailers up to the terminating blank line.
+                while (true) {
+                    size_t trailerEnd;
+                    while ((trailerEnd = buffer.find("\r\n")) == std::string::npos) {
+                        ReadResult result = read_more(connection.fd, buffer, m_timeout);
+                        if (result != ReadResult::Data) return fail(result);
+                    }
+                    buffer.erase(0, trailerEnd + 2);
+                    if (trailerEnd == 0) break;
+                }
+                break;
+            }
+
+            // Stream the chunk out as it arrives rather than waiting for all of it.
+            size_t left = chunkSize;
+            while (left > 0) {
+                if (buffer.empty()) {
+                    ReadResult result = read_more(connection.fd, buffer, m_timeout);
+                    if (result != ReadResult::Data) return fail(result);
+                }
+                size_t take = std::min(left, buffer.size());
+                if (!emit(std::string_view(buffer.data(), take))) {
+                    return Attempt::Done;
+                }
+                buffer.erase(0, take);
+                left -= take;
+            }
+            while (buffer.size() < 2) {
+                ReadResult result = read_more(connection.fd, buffer, m_timeout);
+                if (result != ReadResult::Data) return fail(result);
+            }
+            buffer.erase(0, 2);
+        }
+        reusable = !closeAfter;
+        return Attempt::Done;
+    }
+
+    if (contentLength >= 0) {
+        size_t left = static_cast<size_t>(contentLength);
+        if (!onBody) {
+            response.body.reserve(left);
+        }
+        while (left > 0) {
+            if (buffer.empty()) {
+                ReadResult result = read_more(connection.fd, buffer, m_timeout);
+                if (result != ReadResult::Data) return fail(result);
+            }
+            size_t take = std::min(left, buffer.size());
+            if (!emit(std::string_view(buffer.data(), take))) {
+                return Attempt::Done;
+            }
+            buffer.erase(0, take);
+            left -= take;
+        }
+        reusable = !closeAfter;
+        return Attempt::Done;
+    }
+
+    // No length: the body runs until the server closes the connection.
+    while (true) {
+        if (!emit(buffer)) {
+            return Attempt::Done;
+        }
+        buffer.clear();
+        ReadResult result = read_more(connection.fd, buffer, m_timeout);
+        if (result == ReadResult::Closed) {
+            return Attempt::Done;
+        }
+        if (result != ReadResult::Data) {
+            return fail(result);
+        }
+    }
+}
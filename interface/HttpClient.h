@@ -0,0 +1,99 @@
+#ifndef PRISMQUANTA_HTTP_CLIENT_H
+#define PRISMQUANTA_HTTP_CLIENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HttpResponse {
+    int status = 0;              ///< HTTP status code; 0 if no response was received.
+    std::string body;            ///< Empty when the body was streamed to a callback.
+    std::string error;           ///< Transport error, if any.
+    bool cancelled = false;      ///< The body callback asked to stop.
+
+    bool ok() const { return error.empty() && !cancelled && status >= 200 && status < 300; }
+};
+
+/**
+ * @brief Minimal HTTP/1.1 client for one origin, with persistent connections.
+ *
+ * Idle connections are kept in a small pool and reused for later requests,
+ * so a steady stream of calls pays for TCP setup once rather than per call.
+ * Requests are sent with a single writev() of header and body. Responses
+ * may be sized by Content-Length, chunked, or delimited by connection close;
+ * only the first two leave the connection reusable.
+ *
+ * A request on a pooled connection that the server has since closed is
+ * retried once on a fresh connection, as long as no response byte had been
+ * received. Safe to use from several threads at once; each request holds its
+ * own connection for its duration.
+ *
+ * Only plain http:// URLs are supported.
+ */
+class HttpClient {
+public:
+    /** Receives response body bytes as they arrive (after de-chunking); return false to abort. */
+    using BodyCallback = std::function<bool(std::string_view data)>;
+
+    /**
+     * @param baseUrl e.g. "http://localhost:8080"; a path component is ignored.
+     * @param timeout Limit on connecting and on each wait for data; zero means none.
+     */
+    explicit HttpClient(std::string_view baseUrl, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    /** @brief False if the base URL could not be understood; error() says why. */
+    bool valid() const { return m_error.empty(); }
+    const std::string& error() const { return m_error; }
+    const std::string& host() const { return m_host; }
+    uint16_t port() const { return m_port; }
+
+    /**
+     * @brief Sends a POST request and waits for the complete response.
+     *
+     * With @p onBody set the body is streamed to it instead of collected in
+     * HttpResponse::body. Aborting from the callback closes the connection,
+     * which is how a server is told to stop generating.
+     */
+    HttpResponse post(std::string_view path, std::string_view body,
+                      std::string_view contentType = "application/json",
+                      const BodyCallback& onBody = {});
+
+    /** @brief Number of TCP connections opened so far; useful for checking reuse. */
+    uint64_t connectionsOpened() const { return m_connectionsOpened.load(std::memory_order_relaxed); }
+
+private:
+    struct Connection;
+
+    std::unique_ptr<Connection> acquire(bool& reused, std::string& error);
+    void release(std::unique_ptr<Connection> connection);
+    std::unique_ptr<Connection> connect(std::string& error);
+
+    // Result of one attempt; Stale means the pooled connection was dead before any response.
+    enum class Attempt { Done, Stale };
+    Attempt exchange(Connection& connection, const std::string& head, std::string_view body,
+                     const BodyCallback& onBody, HttpResponse& response, bool& reusable);
+
+    std::string m_host;
+    uint16_t m_port = 80;
+    std::string m_hostHeader;
+    std::chrono::milliseconds m_timeout;
+    std::string m_error;
+
+    std::mutex m_poolMutex;
+    std::vector<std::unique_ptr<Connection>> m_idle;
+    std::atomic<uint64_t> m_connectionsOpened{0};
+
+    static constexpr size_t kMaxIdle = 8;
+};
+
+#endif //PRISMQUANTA_HTTP_CLIENT_H
@@ -0,0 +1,262 @@
+#include "JobControl.h"
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace {
+    // How often wait() checks for a signal to pass on.
+    constexpr std::chrono::milliseconds kSignalPoll{100};
+}
+
+// --- Summary ---
+
+bool JobControl::Summary::succeeded() const {
+    return !results.empty() && std::all_of(results.begin(), results.end(),
+                                           [](const ProcessResult& result) { return result.succeeded(); });
+}
+
+std::string JobControl::Summary::describe() const {
+    if (results.empty()) {
+        return "no programs";
+    }
+    for (size_t i = results.size(); i-- > 0;) {
+        if (!results[i].succeeded()) {
+            return results.size() == 1 ? results[i].describe()
+                                       : "stage " + std::to_string(i + 1) + ": " + results[i].describe();
+        }
+    }
+    return results.back().describe();
+}
+
+// --- JobControl ---
+
+JobControl::JobControl(std::ostream& out, std::ostream& err)
+    : m_out(out), m_err(err), m_devNull(open("/dev/null", O_RDONLY | O_CLOEXEC)) {}
+
+JobControl::~JobControl() {
+    killAll(SIGTERM);
+    // wait() gives up on a Ctrl-C, but every thread has to be joined.
+    while (true) {
+        wait();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.empty()) {
+            break;
+        }
+    }
+    if (m_devNull >= 0) {
+        close(m_devNull);
+    }
+}
+
+void JobControl::signalStage(const Job& job, size_t stage, int signal) {
+    pid_t pid = job.pids[stage];
+    if (pid > 0) {
+        ::kill(job.groups[stage] ? -pid : pid, signal);
+    }
+}
+
+int JobControl::start(std::string label, std::vector<std::string> names, std::vector<ProcessOptions> stages,
+                      bool foreground) {
+    auto job = std::make_unique<Job>();
+    Job* raw = job.get();
+    job->label = label;
+    job->foreground = foreground;
+    job->pids.assign(stages.size(), 0);
+    job->summary.label = std::move(label);
+    job->summary.started = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->id = job->summary.id = m_nextId++;
+    }
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        ProcessOptions& stage = stages[i];
+        std::string prefix = "[" + std::to_string(job->id) + " " + (i < names.size() ? names[i] : "?") + "] ";
+        auto multiplex = [this, prefix](std::ostream& stream, ProcessOptions::LineCallback next) {
+            return [this, prefix, &stream, next = std::move(next)](std::string_view line) {
+                {
+                    std::lock_guard<std::mutex> lock(m_outputMutex);
+                    stream << prefix << line << '\n' << std::flush;
+                }
+                if (next) {
+                    next(line);
+                }
+            };
+        };
+        stage.onStdout = multiplex(m_out, std::move(stage.onStdout));
+        stage.onStderr = multiplex(m_err, std::move(stage.onStderr));
+        if (!foreground) {
+            stage.processGroup = true;
+        }
+        job->groups.push_back(stage.ownsGroup());
+        if (i == 0 && stage.stdinFd < 0) {
+            stage.stdinFd = m_devNull;  // The prompt keeps the terminal.
+        }
+        stage.onStart = [this, raw, i](pid_t pid) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            raw->pids[i] = pid;
+            if (raw->signal != 0) {
+                signalStage(*raw, i, raw->signal);
+            }
+        };
+    }
+
+    // The thread, and the runPipeline() threads it starts, inherit the mask.
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    for (int sig : {SIGINT, SIGQUIT, SIGTERM, SIGHUP}) {
+        sigaddset(&blocked, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int id = job->id;
+    job->thread = std::thread([this, raw, stages = std::move(stages)]() mutable {
+        std::vector<ProcessResult> results = ProcessRunner::runPipeline(std::move(stages));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        raw->summary.results = std::move(results);
+        raw->summary.finished = Clock::now();
+        raw->done = true;
+        m_finished.notify_all();
+    });
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    m_jobs.push_back(std::move(job));
+    return id;
+}
+
+std::vector<JobControl::Summary> JobControl::wait(const std::vector<int>& ids) {
+    auto selected = [&ids](const Job& job) {
+        return ids.empty() || std::find(ids.begin(), ids.end(), job.id) != ids.end();
+    };
+    std::vector<std::unique_ptr<Job>> finished;
+    ForegroundSignals signals;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (std::any_of(m_jobs.begin(), m_jobs.end(),
+                           [&](const std::unique_ptr<Job>& job) { return selected(*job) && !job->done; })) {
+            // A signal handler cannot notify the condition variable, so the wait polls for one.
+            m_finished.wait_for(lock, kSignalPoll);
+            int sig = ForegroundSignals::take();
+            if (sig == 0) {
+                continue;
+            }
+            bool foreground = false;
+            for (const auto& job : m_jobs) {
+                if (selected(*job) && !job->done && job->foreground) {
+                    foreground = true;
+                    for (size_t i = 0; i < job->pids.size(); ++i) {
+                        if (job->groups[i]) {
+                            signalStage(*job, i, sig);
+                        }
+                    }
+                }
+            }
+            if (!foreground) {
+                break;
+            }
+        }
+        auto split = std::stable_partition(m_jobs.begin(), m_jobs.end(), [&](const std::unique_ptr<Job>& job) {
+            return !selected(*job) || !job->done;
+        });
+        std::move(split, m_jobs.end(), std::back_inserter(finished));
+        m_jobs.erase(split, m_jobs.end());
+    }
+    std::vector<Summary> summaries;
+    for (auto& job : finished) {
+        job->thread.join();
+        summaries.push_back(std::move(job->summary));
+    }
+    return summaries;
+}
+
+std::vector<JobControl::Summary> JobControl::takeFinished() {
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& job : m_jobs) {
+            if (job->done) {
+                ids.push_back(job->id);
+            }
+        }
+    }
+    return ids.empty() ? std::vector<Summary>() : wait(ids);
+}
+
+bool JobControl::kill(int id, int signal) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& job : m_jobs) {
+        if (job->id != id || job->done) {
+            continue;
+        }
+        job->signal = signal;
+        for (size_t i = 0; i < job->pids.size(); ++i) {
+            signalStage(*job, i, signal);
+        }
+        return true;
+    }
+    return false;
+}
+
+void JobControl::killAll(int signal) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& job : m_jobs) {
+        if (job->done) {
+            continue;
+        }
+        job->signal = signal;
+        for (size_t i = 0; i < job->pids.size(); ++i) {
+            signalStage(*job, i, signal);
+        }
+    }
+}
+
+std::vector<JobControl::Status> JobControl::jobs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Status> statuses;
+    auto now = Clock::now();
+    for (const auto& job : m_jobs) {
+        Status status;
+        status.id = job->id;
+        status.label = job->label;
+        status.running = !job->done;
+        status.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (job->done ? job->summary.finished : now) - job->summary.started);
+        statuses.push_back(std::move(status));
+    }
+    return statuses;
+}
+
+size_t JobControl::running() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<size_t>(std::count_if(m_jobs.begin(), m_jobs.end(),
+                                             [](const std::unique_ptr<Job>& job) { return !job->done; }));
+}
+
+void JobControl::print(std::ostream& stream, std::string_view line) {
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    stream << line << '\n' << std::flush;
+}
+
+std::string JobControl::describeSpeedup(const std::vector<Summary>& summaries) {
+    if (summaries.empty()) {
+        return "";
+    }
+    Clock::time_point first = summaries.front().started;
+    Clock::time_point last = summaries.front().finished;
+    std::chrono::milliseconds busy{0};
+    for (const Summary& summary : summaries) {
+        first = std::min(first, summary.started);
+        last = std::max(last, summary.finished);
+        for (const ProcessResult& result : summary.results) {
+            busy += result.duration;
+        }
+    }
+    double wall = std::chrono::duration<double>(last - first).count();
+    double total = std::chrono::duration<double>(busy).count();
+    char text[128];
+    std::snprintf(text, sizeof(text), "Wall time %.2f s for %.2f s of script time: %.1fx speed-up.", wall, total,
+                  wall > 0 ? total / wall : 1.0);
+    return text;
+}
@@ -0,0 +1,132 @@
+#ifndef PRISMQUANTA_JOB_CONTROL_H
+#define PRISMQUANTA_JOB_CONTROL_H
+
+#include "ProcessRunner.h"
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Jobs for an interactive shell: each job is a pipeline of one or more programs.
+ *
+ * Jobs run on threads of their own through ProcessRunner::runPipeline, so
+ * any number run at once. Their output is multiplexed onto one pair of
+ * streams a line at a time, each line prefixed with "[<job id> <program>] ",
+ * so lines from different jobs never interleave mid-line. Every program
+ * reads /dev/null unless its options give it a stdin. The programs of a
+ * background job get process groups of their own, out of reach of the
+ * terminal's Ctrl-C; those of a foreground job stay in ours unless their
+ * options say otherwise. The job threads block SIGINT, SIGQUIT, SIGTERM and
+ * SIGHUP, so those reach the prompt's thread. Thread-safe.
+ */
+class JobControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief A finished job, as returned by wait() and takeFinished(). */
+    struct Summary {
+        int id = 0;
+        std::string label;                  ///< The command line, e.g. "a.sh | b.sh".
+        std::vector<ProcessResult> results; ///< One per stage.
+        Clock::time_point started;
+        Clock::time_point finished;
+
+        bool succeeded() const;
+        /** @brief The last failing stage's outcome, or the last stage's if all succeeded. */
+        std::string describe() const;
+    };
+
+    /** @brief A job as listed by jobs(). */
+    struct Status {
+        int id = 0;
+        std::string label;
+        bool running = false;
+        std::chrono::milliseconds elapsed{0};
+    };
+
+    explicit JobControl(std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+    /** @brief Sends SIGTERM to the jobs still running and waits for them. */
+    ~JobControl();
+
+    JobControl(const JobControl&) = delete;
+    JobControl& operator=(const JobControl&) = delete;
+
+    /**
+     * @brief Starts a pipeline running.
+     *
+     * The stages' own onStdout/onStderr callbacks (e.g. logging) still see
+     * every line after it has been printed.
+     * @param names One per stage, used in the output prefix.
+     * @param foreground Whether the caller is about to wait() for it, as for a command without "&".
+     * @return The job id, counting from 1.
+     */
+    int start(std::string label, std::vector<std::string> names, std::vector<ProcessOptions> stages,
+              bool foreground = false);
+
+    /**
+     * @brief Blocks until the given jobs (all jobs when empty) have finished and forgets them.
+     *
+     * Meanwhile SIGINT and SIGQUIT do not kill us (see ForegroundSignals).
+     * They are passed on to the foreground jobs waited for, to the stages
+     * that lead their own process group (the terminal signals the others);
+     * with no foreground job among them, they end the wait early.
+     * @return The summaries of those that finished, in id order; unknown ids are skipped.
+     */
+    std::vector<Summary> wait(const std::vector<int>& ids = {});
+
+    /** @brief Finished jobs nobody has waited for yet, forgotten once returned. */
+    std::vector<Summary> takeFinished();
+
+    /** @brief Signals every process of a running job. False if no such job is running. */
+    bool kill(int id, int signal);
+
+    /** @brief Signals every process of every running job, e.g. before exiting. */
+    void killAll(int signal);
+
+    std::vector<Status> jobs() const;
+    size_t running() const;
+
+    /** @brief Prints a line under the output lock, so it does not land in the middle of a job's line. */
+    void print(std::ostream& stream, std::string_view line);
+
+    /**
+     * @brief How long a set of jobs took side by side against one after another.
+     *
+     * E.g. "Wall time 2.04 s for 5.97 s of script time: 2.9x speed-up."
+     */
+    static std::string describeSpeedup(const std::vector<Summary>& summaries);
+
+private:
+    struct Job {
+        int id = 0;
+        std::string label;
+        bool foreground = false;
+        std::vector<pid_t> pids;  // Per stage; 0 until it has started.
+        std::vector<bool> groups; // Per stage, whether its pid is also its process group.
+        bool done = false;
+        int signal = 0;           // Last sent by kill(), also sent to stages that start afterwards.
+        Summary summary;
+        std::thread thread;
+    };
+
+    /** @brief Signals a stage's process group if it leads one, else just the stage. Needs m_mutex. */
+    static void signalStage(const Job& job, size_t stage, int signal);
+
+    std::ostream& m_out;
+    std::ostream& m_err;
+    int m_devNull = -1;
+    int m_nextId = 1;
+    mutable std::mutex m_mutex;   // Guards the jobs.
+    std::condition_variable m_finished;
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::mutex m_outputMutex;
+};
+
+#endif //PRISMQUANTA_JOB_CONTROL_H
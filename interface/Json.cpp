@@ -0,0 +1,485 @@
+#include "Json.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+    // Deeper documents are rejected rather than risking the stack.
+    constexpr int kMaxDepth = 128;
+
+    int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool read_hex4(std::string_view text, size_t pos, uint32_t& out) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        out = 0;
+        for (size_t i = pos; i < pos + 4; ++i) {
+            int digit = hex_value(text[i]);
+            if (digit < 0) {
+                return false;
+            }
+            out = (out << 4) | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    void append_utf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    void skip_ws(std::string_view text, size_t& pos) {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    // Advances pos past a string literal starting at its opening quote.
+    bool skip_string(std::string_view text, size_t& pos, bool& escaped) {
+        ++pos;
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c == '"') {
+                ++pos;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                pos += 2;
+                continue;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return false;
+            }
+            ++pos;
+        }
+        return false;
+    }
+
+    bool skip_number(std::string_view text, size_t& pos) {
+        size_t start = pos;
+        if (pos < text.size() && text[pos] == '-') ++pos;
+        size_t digits = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+        if (pos == digits) return false;
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            size_t fraction = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+            if (pos == fraction) return false;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+            size_t exponent = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+            if (pos == exponent) return false;
+        }
+        return pos > start;
+    }
+
+    bool skip_literal(std::string_view text, size_t& pos, std::string_view literal) {
+        if (text.substr(pos, literal.size()) != literal) {
+            return false;
+        }
+        pos += literal.size();
+        return true;
+    }
+
+    bool skip_value(std::string_view text, size_t& pos, int depth);
+
+    bool skip_container(std::string_view text, size_t& pos, int depth, char close, bool members) {
+        if (depth > kMaxDepth) {
+            return false;
+        }
+        ++pos;
+        bool first = true;
+        while (true) {
+            skip_ws(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == close && first) {
+                ++pos;
+                return true;
+            }
+            if (members) {
+                bool escaped = false;
+                if (text[pos] != '"' || !skip_string(text, pos, escaped)) {
+                    return false;
+                }
+                skip_ws(text, pos);
+                if (pos >= text.size() || text[pos] != ':') {
+                    return false;
+                }
+                ++pos;
+            }
+            if (!skip_value(text, pos, depth + 1)) {
+                return false;
+            }
+            skip_ws(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == ',') {
+                ++pos;
+                first = false;
+                // A trailing comma is not allowed.
+                skip_ws(text, pos);
+                if (pos < text.size() && text[pos] == close) {
+                    return false;
+                }
+                continue;
+            }
+            if (text[pos] == close) {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    bool skip_value(std::string_view text, size_t& pos, int depth) {
+        skip_ws(text, pos);
+        if (pos >= text.size()) {
+            return false;
+        }
+        bool escaped = false;
+        switch (text[pos]) {
+            case '{': return skip_container(text, pos, depth, '}', true);
+            case '[': return skip_container(text, pos, depth, ']', false);
+            case '"': return skip_string(text, pos, escaped);
+            case 't': return skip_literal(text, pos, "true");
+            case 'f': return skip_literal(text, pos, "false");
+            case 'n': return skip_literal(text, pos, "null");
+            default: return skip_number(text, pos);
+        }
+    }
+} // namespace
+
+// --- JsonView ---
+
+JsonView JsonView::parse(std::string_view text) {
+    size_t pos = 0;
+    skipSpace(text, pos);
+    return scan(text, pos);
+}
+
+void JsonView::skipSpace(std::string_view text, size_t& pos) {
+    skip_ws(text, pos);
+}
+
+JsonView JsonView::scan(std::string_view text, size_t& pos) {
+    if (pos >= text.size()) {
+        return {};
+    }
+    size_t start = pos;
+    JsonType type;
+    bool escaped = false;
+    bool ok;
+    switch (text[pos]) {
+        case '{': type = JsonType::Object; ok = skip_container(text, pos, 0, '}', true); break;
+        case '[': type = JsonType::Array; ok = skip_container(text, pos, 0, ']', false); break;
+        case '"': type = JsonType::String; ok = skip_string(text, pos, escaped); break;
+        case 't': type = JsonType::Bool; ok = skip_literal(text, pos, "true"); break;
+        case 'f': type = JsonType::Bool; ok = skip_literal(text, pos, "false"); break;
+        case 'n': type = JsonType::Null; ok = skip_literal(text, pos, "null"); break;
+        default: type = JsonType::Number; ok = skip_number(text, pos); break;
+    }
+    if (!ok) {
+        pos = text.size();
+        return {};
+    }
+    return JsonView(type, text.substr(start, pos - start), escaped);
+}
+
+std::string_view JsonView::str(std::string& scratch) const {
+    if (m_type != JsonType::String) {
+        return {};
+    }
+    std::string_view body = m_raw.substr(1, m_raw.size() - 2);
+    if (!m_escaped) {
+        return body;
+    }
+    scratch.clear();
+    unescape(body, scratch);
+    return scratch;
+}
+
+void JsonView::appendStr(std::string& out) const {
+    if (m_type != JsonType::String) {
+        return;
+    }
+    std::string_view body = m_raw.substr(1, m_raw.size() - 2);
+    if (m_escaped) {
+        unescape(body, out);
+    } else {
+        out.append(body);
+    }
+}
+
+std::string JsonView::toString() const {
+    std::string out;
+    appendStr(out);
+    return out;
+}
+
+double JsonView::toDouble(double fallback) const {
+    if (m_type != JsonType::Number) {
+        return fallback;
+    }
+    // Numbers are short; copy to get the terminator strtod needs.
+    char buffer[64];
+    if (m_raw.size() >= sizeof(buffer)) {
+        return fallback;
+    }
+    m_raw.copy(buffer, m_raw.size());
+    buffer[m_raw.size()] = '\0';
+    return std::strtod(buffer, nullptr);
+}
+
+int64_t JsonView::toInt(int64_t fallback) const {
+    if (m_type != JsonType::Number) {
+        return fallback;
+    }
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(m_raw.data(), m_raw.data() + m_raw.size(), value);
+    if (ec != std::errc()) {
+        return fallback;
+    }
+    if (end != m_raw.data() + m_raw.size()) {
+        // Fractional or exponent form.
+        return static_cast<int64_t>(toDouble(static_cast<double>(fallback)));
+    }
+    return value;
+}
+
+bool JsonView::toBool(bool fallback) const {
+    if (m_type != JsonType::Bool) {
+        return fallback;
+    }
+    return m_raw == "true";
+}
+
+JsonView JsonView::operator[](std::string_view key) const {
+    JsonView found;
+    forEachMember([&](std::string_view name, const JsonView& value) {
+        if (name == key) {
+            found = value;
+            return false;
+        }
+        return true;
+    });
+    return found;
+}
+
+JsonView JsonView::at(size_t index) const {
+    JsonView found;
+    size_t i = 0;
+    forEachElement([&](const JsonView& value) {
+        if (i++ == index) {
+            found = value;
+            return false;
+        }
+        return true;
+    });
+    return found;
+}
+
+size_t JsonView::size() const {
+    size_t count = 0;
+    if (m_type == JsonType::Object) {
+        forEachMember([&count](std::string_view, const JsonView&) { ++count; return true; });
+    } else if (m_type == JsonType::Array) {
+        forEachElement([&count](const JsonView&) { ++count; return true; });
+    }
+    return count;
+}
+
+void JsonView::unescape(std::string_view body, std::string& out) {
+    out.reserve(out.size() + body.size());
+    size_t i = 0;
+    while (i < body.size()) {
+        size_t backslash = body.find('\\', i);
+        if (backslash == std::string_view::npos) {
+            out.append(body.substr(i));
+            return;
+        }
+        out.append(body.substr(i, backslash - i));
+        i = backslash + 1;
+        if (i >= body.size()) {
+            return;
+        }
+        char c = body[i++];
+        switch (c) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(body, i, cp)) {
+                    out += "\\u";
+                    break;
+                }
+                i += 4;
+                // Combine a UTF-16 surrogate pair; a lone surrogate becomes U+FFFD.
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (i + 1 < body.size() && body[i] == '\\' && body[i + 1] == 'u' &&
+                        read_hex4(body, i + 2, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default: out += c; break; // \" \\ \/
+        }
+    }
+}
+
+// --- JsonWriter ---
+
+void JsonWriter::separate() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (!m_first.empty()) {
+        if (!m_first.back()) {
+            m_out += ',';
+        }
+        m_first.back() = false;
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    m_out += '{';
+    m_first.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    m_out += '}';
+    m_first.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    m_out += '[';
+    m_first.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    m_out += ']';
+    m_first.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separate();
+    appendEscaped(m_out, name);
+    m_out += ':';
+    m_afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separate();
+    appendEscaped(m_out, text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t number) {
+    separate();
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    (void)ec;
+    m_out.append(buffer, static_cast<size_t>(end - buffer));
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separate();
+    char buffer[32];
+    int len = std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+    m_out.append(buffer, static_cast<size_t>(len));
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    m_out += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    m_out += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::rawValue(std::string_view json) {
+    separate();
+    m_out.append(json);
+    return *this;
+}
+
+void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    out.reserve(out.size() + text.size() + 2);
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the unescaped run in one go, then the escape.
+        out.append(text.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                out += "\\u00";
+                out += kHex[c >> 4];
+                out += kHex[c & 0xF];
+                break;
+        }
+    }
+    out.append(text.data() + run, text.size() - run);
+    out += '"';
+}
@@ -0,0 +1,187 @@
+#ifndef PRISMQUANTA_JSON_H
+#define PRISMQUANTA_JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JsonType {
+    Invalid,
+    Null,
+    Bool,
+    Number,
+    String,
+    Object,
+    Array
+};
+
+/**
+ * @brief A non-owning view of one JSON value inside a larger document.
+ *
+ * Nothing is parsed up front: a view records the type and the span of its
+ * value, and member or element lookups scan that span on demand. Strings are
+ * only copied when they contain escapes, so reading a few fields out of a
+ * server response costs one pass over the text and no allocations.
+ * The viewed text must outlive the view.
+ */
+class JsonView {
+public:
+    JsonView() = default;
+
+    /** @brief Views the first value in @p text; the result is Invalid if it is malformed. */
+    static JsonView parse(std::string_view text);
+
+    JsonType type() const { return m_type; }
+    bool valid() const { return m_type != JsonType::Invalid; }
+    bool isNull() const { return m_type == JsonType::Null; }
+    bool isString() const { return m_type == JsonType::String; }
+    bool isNumber() const { return m_type == JsonType::Number; }
+    bool isObject() const { return m_type == JsonType::Object; }
+    bool isArray() const { return m_type == JsonType::Array; }
+
+    /** @brief The value's source text, including quotes or brackets. */
+    std::string_view raw() const { return m_raw; }
+
+    /**
+     * @brief The decoded string value.
+     *
+     * Returns a view into the document when the string has no escapes;
+     * otherwise decodes into @p scratch and returns a view of it.
+     */
+    std::string_view str(std::string& scratch) const;
+    /** @brief Appends the decoded string value to @p out. */
+    void appendStr(std::string& out) const;
+    std::string toString() const;
+
+    double toDouble(double fallback = 0.0) const;
+    int64_t toInt(int64_t fallback = 0) const;
+    bool toBool(bool fallback = false) const;
+
+    /** @brief Looks up an object member; Invalid if this is not an object or has no such key. */
+    JsonView operator[](std::string_view key) const;
+    /** @brief Returns an array element; Invalid if out of range. */
+    JsonView at(size_t index) const;
+    /** @brief Number of elements or members. */
+    size_t size() const;
+
+    /**
+     * @brief Calls fn(key, value) for each object member, stopping early if it returns false.
+     * Keys are passed decoded.
+     */
+    template <typename Fn>
+    void forEachMember(Fn&& fn) const;
+    /** @brief Calls fn(value) for each array element, stopping early if it returns false. */
+    template <typename Fn>
+    void forEachElement(Fn&& fn) const;
+
+    /** @brief Decodes the body of a JSON string literal (without its quotes). */
+    static void unescape(std::string_view body, std::string& out);
+
+private:
+    JsonView(JsonType type, std::string_view raw, bool escaped)
+        : m_type(type), m_raw(raw), m_escaped(escaped) {}
+
+    // Reads one value at text[pos], advancing pos past it.
+    static JsonView scan(std::string_view text, size_t& pos);
+    static void skipSpace(std::string_view text, size_t& pos);
+
+    JsonType m_type = JsonType::Invalid;
+    std::string_view m_raw;
+    bool m_escaped = false;
+};
+
+/**
+ * @brief Appends JSON to a caller-owned string.
+ *
+ * Commas are inserted automatically; string values are escaped straight into
+ * the output, so building a request body makes no intermediate copies.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : m_out(out) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(int number) { return value(static_cast<int64_t>(number)); }
+    JsonWriter& value(double number);
+    JsonWriter& value(bool flag);
+    JsonWriter& null();
+    /** @brief Inserts already-serialized JSON as the next value. */
+    JsonWriter& rawValue(std::string_view json);
+
+    /** @brief Appends @p text as a quoted, escaped JSON string. */
+    static void appendEscaped(std::string& out, std::string_view text);
+
+private:
+    void separate();
+
+    std::string& m_out;
+    std::vector<bool> m_first;  // Per open container: no element written yet.
+    bool m_afterKey = false;
+};
+
+// --- Template implementations ---
+
+template <typename Fn>
+void JsonView::forEachMember(Fn&& fn) const {
+    if (m_type != JsonType::Object) {
+        return;
+    }
+    size_t pos = 1;
+    std::string keyScratch;
+    while (true) {
+        skipSpace(m_raw, pos);
+        if (pos >= m_raw.size() || m_raw[pos] == '}') {
+            return;
+        }
+        JsonView key = scan(m_raw, pos);
+        skipSpace(m_raw, pos);
+        if (!key.isString() || pos >= m_raw.size() || m_raw[pos] != ':') {
+            return;
+        }
+        ++pos;
+        skipSpace(m_raw, pos);
+        JsonView value = scan(m_raw, pos);
+        if (!value.valid() || !fn(key.str(keyScratch), value)) {
+            return;
+        }
+        skipSpace(m_raw, pos);
+        if (pos < m_raw.size() && m_raw[pos] == ',') {
+            ++pos;
+        }
+    }
+}
+
+template <typename Fn>
+void JsonView::forEachElement(Fn&& fn) const {
+    if (m_type != JsonType::Array) {
+        return;
+    }
+    size_t pos = 1;
+    while (true) {
+        skipSpace(m_raw, pos);
+        if (pos >= m_raw.size() || m_raw[pos] == ']') {
+            return;
+        }
+        JsonView value = scan(m_raw, pos);
+        if (!value.valid() || !fn(value)) {
+            return;
+        }
+        skipSpace(m_raw, pos);
+        if (pos < m_raw.size() && m_raw[pos] == ',') {
+            ++pos;
+        }
+    }
+}
+
+#endif //PRISMQUANTA_JSON_H
@@ -0,0 +1,162 @@
+#include "LLMBatcher.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace {
+    // Batches between periodic metric summaries in the log.
+    constexpr uint64_t kReportEvery = 100;
+
+    void report(const LLMBatcher::Stats& stats) {
+        char buffer[200];
+        snprintf(buffer, sizeof(buffer),
+                 "%llu requests in %llu batches (average size %.2f, largest %zu); queue wait average %.1f ms, max %.1f ms.",
+                 static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.batches),
+                 stats.averageBatchSize(), stats.maxBatchSize, stats.averageQueueWaitMs(), stats.maxQueueWaitMs);
+        Logger::instance().info("LLMBatcher", buffer);
+    }
+} // namespace
+
+LLMBatcher::LLMBatcher(LLMRunner& runner, const Config& config)
+    : m_runner(runner),
+      m_batchSize(static_cast<size_t>(std::max(1, config.getInt("LLM_BATCH_SIZE").value_or(4)))),
+      m_window(std::max(0, config.getInt("LLM_BATCH_WINDOW_MS").value_or(20))),
+      m_mode(config.getString("LLM_BATCH_MODE").value_or("parallel") == "multi" ? Mode::Multi : Mode::Parallel),
+      m_senders(m_batchSize) {
+    m_dispatcher = std::thread(&LLMBatcher::dispatchLoop, this);
+}
+
+LLMBatcher::~LLMBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_dispatcher.join();
+    // m_senders finishes the batches still in flight as it is destroyed.
+    if (m_stats.batches > 0) {
+        report(m_stats);
+    }
+}
+
+std::future<LLMResult> LLMBatcher::submit(std::string prompt, LLMRunner::TokenCallback onToken, int maxTokens) {
+    Pending pending;
+    pending.prompt = std::move(prompt);
+    pending.onToken = std::move(onToken);
+    pending.maxTokens = maxTokens;
+    pending.queued = Clock::now();
+    std::future<LLMResult> future = pending.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(pending));
+    }
+    m_changed.notify_all();
+    return future;
+}
+
+LLMBatcher::Stats LLMBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void LLMBatcher::finished(size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight -= count;
+    }
+    m_changed.notify_all();
+}
+
+void LLMBatcher::dispatchLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_changed.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+
+        // A multi-prompt request gives other workers until the window closes to
+        // join the oldest prompt, unless a full batch is already waiting. In
+        // parallel mode each prompt is its own request, so waiting would only
+        // add latency.
+        if (m_mode == Mode::Multi) {
+            auto deadline = m_queue.front().queued + m_window;
+            m_changed.wait_until(lock, deadline, [this] { return m_stopping || m_queue.size() >= m_batchSize; });
+        }
+
+        // Never oversubscribe the server's slots; prompts arriving meanwhile join this batch.
+        m_changed.wait(lock, [this] { return m_inFlight < m_batchSize; });
+
+        size_t take = std::min(m_queue.size(), m_batchSize - m_inFlight);
+        std::deque<Pending> batch;
+        auto now = Clock::now();
+        double maxWaitMs = 0;
+        for (size_t i = 0; i < take; ++i) {
+            Pending& pending = m_queue.front();
+            double waitMs = std::chrono::duration<double, std::milli>(now - pending.queued).count();
+            m_stats.totalQueueWaitMs += waitMs;
+            maxWaitMs = std::max(maxWaitMs, waitMs);
+            batch.push_back(std::move(pending));
+            m_queue.pop_front();
+        }
+        m_inFlight += take;
+        m_stats.requests += take;
+        m_stats.batches += 1;
+        m_stats.maxBatchSize = std::max(m_stats.maxBatchSize, take);
+        m_stats.maxQueueWaitMs = std::max(m_stats.maxQueueWaitMs, maxWaitMs);
+        size_t queued = m_queue.size();
+        std::optional<Stats> summary;
+        if (m_stats.batches % kReportEvery == 0) {
+            summary = m_stats;
+        }
+        lock.unlock();
+
+        if (summary) {
+            report(*summary);
+        }
+
+        Logger& log = Logger::instance();
+        if (log.enabled(LogLevel::Debug)) {
+            log.debug("LLMBatcher", "Dispatching batch of " + std::to_string(take) + " (longest queue wait " +
+                      std::to_string(static_cast<int>(maxWaitMs)) + " ms, " + std::to_string(queued) + " still queued).");
+        }
+
+        if (m_mode == Mode::Multi) {
+            sendMulti(batch);
+        } else {
+            sendParallel(batch);
+        }
+        lock.lock();
+    }
+}
+
+void LLMBatcher::sendParallel(std::deque<Pending>& batch) {
+    for (auto& pending : batch) {
+        // Jobs must be copyable, so the move-only promise travels in a shared_ptr.
+        auto job = std::make_shared<Pending>(std::move(pending));
+        m_senders.submit([this, job] {
+            job->promise.set_value(m_runner.run(job->prompt, job->onToken, job->maxTokens));
+            finished(1);
+        });
+    }
+}
+
+void LLMBatcher::sendMulti(std::deque<Pending>& batch) {
+    auto job = std::make_shared<std::deque<Pending>>(std::move(batch));
+    m_senders.submit([this, job] {
+        std::vector<std::string_view> prompts;
+        prompts.reserve(job->size());
+        for (const auto& pending : *job) {
+            prompts.push_back(pending.prompt);
+        }
+        std::vector<LLMResult> results = m_runner.runBatch(prompts);
+        for (size_t i = 0; i < job->size(); ++i) {
+            (*job)[i].promise.set_value(std::move(results[i]));
+        }
+        finished(job->size());
+    });
+}
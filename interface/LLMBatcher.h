@@ -0,0 +1,106 @@
+#ifndef PRISMQUANTA_LLM_BATCHER_H
+#define PRISMQUANTA_LLM_BATCHER_H
+
+#include "LLMRunner.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Config;
+
+/**
+ * @brief Coalesces prompts from concurrent callers into batched submissions.
+ *
+ * Callers get a future immediately. A dispatcher thread sends queued
+ * prompts as they arrive, never keeping more than LLM_BATCH_SIZE prompts
+ * in flight; prompts that queue up while the slots are busy go together.
+ * Set LLM_BATCH_SIZE to the server's slot count (-np) so every slot stays
+ * busy without requests queueing inside the server.
+ *
+ * LLM_BATCH_MODE selects how a batch is sent:
+ * - parallel (default): one request per prompt, concurrently, over the
+ *   runner's keep-alive connections; each prompt completes independently.
+ * - multi: a single multi-prompt request per batch. Before sending, the
+ *   dispatcher gathers prompts until LLM_BATCH_SIZE are waiting or the
+ *   oldest has waited LLM_BATCH_WINDOW_MS.
+ */
+class LLMBatcher {
+public:
+    enum class Mode { Parallel, Multi };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        size_t maxBatchSize = 0;
+        double totalQueueWaitMs = 0;
+        double maxQueueWaitMs = 0;
+
+        double averageBatchSize() const { return batches ? static_cast<double>(requests) / batches : 0.0; }
+        double averageQueueWaitMs() const { return requests ? totalQueueWaitMs / requests : 0.0; }
+    };
+
+    LLMBatcher(LLMRunner& runner, const Config& config);
+
+    /**
+     * @brief Sends everything still queued, waits for it to finish, and stops the dispatcher.
+     */
+    ~LLMBatcher();
+
+    LLMBatcher(const LLMBatcher&) = delete;
+    LLMBatcher& operator=(const LLMBatcher&) = delete;
+
+    /**
+     * @brief Queues a prompt; the future is fulfilled when its batch completes.
+     *
+     * In parallel mode @p onToken streams the prompt's tokens as in
+     * LLMRunner::run and may stop its generation; it runs on a sender thread.
+     * Multi-prompt requests cannot stream, so in multi mode it is not called;
+     * nor is @p maxTokens applied, as a batch shares one LLM_N_PREDICT.
+     */
+    std::future<LLMResult> submit(std::string prompt, LLMRunner::TokenCallback onToken = {}, int maxTokens = 0);
+
+    Stats stats() const;
+    size_t batchSize() const { return m_batchSize; }
+    /** @brief How long a multi-prompt batch waits to fill; unused in parallel mode. */
+    std::chrono::milliseconds window() const { return m_window; }
+    Mode mode() const { return m_mode; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        std::string prompt;
+        LLMRunner::TokenCallback onToken;
+        int maxTokens = 0;
+        std::promise<LLMResult> promise;
+        Clock::time_point queued;
+    };
+
+    void dispatchLoop();
+    void sendParallel(std::deque<Pending>& batch);
+    void sendMulti(std::deque<Pending>& batch);
+    void finished(size_t count);
+
+    LLMRunner& m_runner;
+    size_t m_batchSize;
+    std::chrono::milliseconds m_window;
+    Mode m_mode;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<Pending> m_queue;
+    size_t m_inFlight = 0;
+    bool m_stopping = false;
+    Stats m_stats;
+
+    ThreadPool m_senders;
+    std::thread m_dispatcher;
+};
+
+#endif //PRISMQUANTA_LLM_BATCHER_H
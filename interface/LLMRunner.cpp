@@ -0,0 +1,257 @@
+#include "LLMRunner.h"
+#include "Config.h"
+#include "Json.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Copies the usage and stop fields from a final (or non-streamed) response.
+    void read_summary(const JsonView& doc, LLMResult& result) {
+        result.tokensPredicted = static_cast<int>(doc["tokens_predicted"].toInt(result.tokensPredicted));
+        result.tokensEvaluated = static_cast<int>(doc["tokens_evaluated"].toInt(result.tokensEvaluated));
+        result.tokensCached = static_cast<int>(doc["tokens_cached"].toInt(result.tokensCached));
+
+        JsonView stopType = doc["stop_type"];
+        if (stopType.isString()) {
+            result.stopReason = stopType.toString();
+        } else if (doc["stopped_eos"].toBool()) {
+            result.stopReason = "eos";
+        } else if (doc["stopped_limit"].toBool()) {
+            result.stopReason = "limit";
+        } else if (doc["stopped_word"].toBool()) {
+            result.stopReason = "word";
+        }
+    }
+
+    // Pulls a readable message out of a server error document, or returns the text as-is.
+    std::string error_message(std::string_view body) {
+        JsonView doc = JsonView::parse(body);
+        JsonView error = doc["error"];
+        if (error.isObject() && error["message"].isString()) {
+            return error["message"].toString();
+        }
+        if (error.isString()) {
+            return error.toString();
+        }
+        return std::string(body.substr(0, 200));
+    }
+} // namespace
+
+LLMRunner::LLMRunner(const Config& config)
+    : m_client(config.getString("LLAMACPP_SERVER_URL").value_or("http://localhost:8080"),
+               std::chrono::seconds(std::max(0, config.getInt("LLM_TIMEOUT_SEC").value_or(300)))),
+      m_endpoint(config.getString("LLAMACPP_SERVER_ENDPOINT").value_or("/completion")),
+      m_model(config.getString("LLM_MODEL").value_or(config.getString("MODEL_FILENAME").value_or(""))),
+      m_nPredict(config.getInt("LLM_N_PREDICT").value_or(1024)),
+      m_temperature(0.7),
+      m_cachePrompt(config.getString("LLM_CACHE_PROMPT").value_or("true") != "false") {
+    if (auto temperature = config.getString("LLM_TEMPERATURE")) {
+        char* end = nullptr;
+        double value = std::strtod(temperature->c_str(), &end);
+        if (end != temperature->c_str()) {
+            m_temperature = value;
+        }
+    }
+}
+
+Hash128 LLMRunner::cacheKey(std::string_view prompt) const {
+    char params[64];
+    int len = std::snprintf(params, sizeof(params), "%d|%.17g", m_nPredict, m_temperature);
+    return Hasher()
+        .field(m_model)
+        .field(m_endpoint)
+        .field(std::string_view(params, static_cast<size_t>(len)))
+        .field(prompt)
+        .digest128();
+}
+
+void LLMRunner::buildBatchRequest(std::string& out, const std::vector<std::string_view>& prompts) const {
+    size_t total = 96;
+    for (auto prompt : prompts) {
+        total += prompt.size() + prompt.size() / 8 + 4;
+    }
+    out.reserve(total);
+    JsonWriter json(out);
+    json.beginObject().key("prompt").beginArray();
+    for (auto prompt : prompts) {
+        json.value(prompt);
+    }
+    json.endArray()
+        .key("n_predict").value(m_nPredict)
+        .key("temperature").value(m_temperature)
+        .key("cache_prompt").value(m_cachePrompt)
+        .key("stream").value(false)
+        .endObject();
+}
+
+void LLMRunner::buildRequest(std::string& out, std::string_view prompt, bool stream, int nPredict) const {
+    out.reserve(prompt.size() + prompt.size() / 8 + 96);
+    JsonWriter json(out);
+    json.beginObject()
+        .key("prompt").value(prompt)
+        .key("n_predict").value(nPredict)
+        .key("temperature").value(m_temperature)
+        .key("cache_prompt").value(m_cachePrompt)
+        .key("stream").value(stream)
+        .endObject();
+}
+
+LLMResult LLMRunner::run(std::string_view prompt, const TokenCallback& onToken, int maxTokens) {
+    LLMResult result;
+    auto started = Clock::now();
+    bool stream = static_cast<bool>(onToken);
+
+    std::string request;
+    buildRequest(request, prompt, stream, maxTokens > 0 && maxTokens < m_nPredict ? maxTokens : m_nPredict);
+
+    HttpResponse response;
+    std::string scratch;
+    if (!stream) {
+        response = m_client.post(m_endpoint, request);
+        if (response.ok()) {
+            JsonView doc = JsonView::parse(response.body);
+            if (!doc.isObject()) {
+                result.error = "malformed response from server";
+            } else {
+                doc["content"].appendStr(result.content);
+                read_summary(doc, result);
+                result.ok = true;
+            }
+        }
+    } else {
+        // Server-sent events: "data: {json}" lines, possibly split across reads.
+        std::string pending;
+        std::string other;
+        bool stopped = false;
+        int received = 0;
+        auto onBody = [&](std::string_view data) {
+            pending.append(data);
+            size_t start = 0;
+            size_t newline;
+            while ((newline = pending.find('\n', start)) != std::string::npos) {
+                std::string_view line(pending.data() + start, newline - start);
+                start = newline + 1;
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (line.substr(0, 5) != "data:") {
+                    if (other.size() < 4096) {
+                        other.append(line).append("\n");
+                    }
+                    continue;
+                }
+                line.remove_prefix(line.size() > 5 && line[5] == ' ' ? 6 : 5);
+                // One pass over the event; token events are small and frequent.
+                JsonView event = JsonView::parse(line);
+                std::string_view token;
+                bool last = false;
+                bool failed = false;
+                event.forEachMember([&](std::string_view key, const JsonView& value) {
+                    if (key == "content") token = value.str(scratch);
+                    else if (key == "stop") last = value.toBool();
+                    else if (key == "error") failed = true;
+                    return true;
+                });
+                if (failed) {
+                    result.error = error_message(line);
+                    stopped = true;
+                    break;
+                }
+                if (!token.empty()) {
+                    ++received;
+                    result.content.append(token);
+                    if (!onToken(token)) {
+                        result.cancelled = true;
+                        return false;
+                    }
+                }
+                if (last) {
+                    read_summary(event, result);
+                    stopped = true;
+                }
+            }
+            pending.erase(0, start);
+            return true;
+        };
+        response = m_client.post(m_endpoint, request, "application/json", onBody);
+        if (!response.ok() && !response.cancelled && response.error.empty()) {
+            // An HTTP error arrives as a plain JSON body rather than as events.
+            response.body = other + pending;
+        }
+        result.ok = response.ok() && result.error.empty() && stopped;
+        if (response.ok() && !stopped && result.error.empty()) {
+            result.error = "stream ended before generation finished";
+        }
+        if (!stopped) {
+            // No summary event; each event carries one token.
+            result.tokensPredicted = received;
+        }
+    }
+
+    if (!response.error.empty()) {
+        result.error = response.error;
+    } else if (result.error.empty() && !response.cancelled && (response.status < 200 || response.status >= 300)) {
+        result.error = "server returned HTTP " + std::to_string(response.status) + ": " + error_message(response.body);
+    }
+    if (result.cancelled) {
+        result.ok = false;
+    }
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+    return result;
+}
+
+std::vector<LLMResult> LLMRunner::runBatch(const std::vector<std::string_view>& prompts) {
+    std::vector<LLMResult> results(prompts.size());
+    if (prompts.empty()) {
+        return results;
+    }
+    auto started = Clock::now();
+
+    std::string request;
+    buildBatchRequest(request, prompts);
+    HttpResponse response = m_client.post(m_endpoint, request);
+
+    std::string error = response.error;
+    if (error.empty() && !response.ok()) {
+        error = "server returned HTTP " + std::to_string(response.status) + ": " + error_message(response.body);
+    }
+
+    JsonView doc;
+    if (error.empty()) {
+        doc = JsonView::parse(response.body);
+        // A single prompt may come back as a bare object.
+        if (doc.isObject() && prompts.size() == 1) {
+            doc["content"].appendStr(results[0].content);
+            read_summary(doc, results[0]);
+            results[0].ok = true;
+        } else if (!doc.isArray()) {
+            error = "malformed batch response from server";
+        } else {
+            // Each result names its prompt by "index"; fall back to position.
+            size_t position = 0;
+            doc.forEachElement([&](const JsonView& item) {
+                size_t index = static_cast<size_t>(item["index"].toInt(static_cast<int64_t>(position)));
+                ++position;
+                if (index < results.size() && item.isObject()) {
+                    LLMResult& result = results[index];
+                    item["content"].appendStr(result.content);
+                    read_summary(item, result);
+                    result.ok = true;
+                }
+                return true;
+            });
+        }
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+    for (auto& result : results) {
+        if (!result.ok) {
+            result.error = error.empty() ? "no result for prompt in batch response" : error;
+        }
+        result.duration = duration;
+    }
+    return results;
+}
@@ -0,0 +1,94 @@
+#ifndef PRISMQUANTA_LLM_RUNNER_H
+#define PRISMQUANTA_LLM_RUNNER_H
+
+#include "Hash.h"
+#include "HttpClient.h"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Config;
+
+struct LLMResult {
+    bool ok = false;
+    std::string content;          ///< The generated text (also when streamed).
+    std::string error;            ///< Transport or server error.
+    bool cancelled = false;       ///< The token callback stopped generation.
+    int tokensPredicted = 0;      ///< For a stream stopped by the callback, the tokens received.
+    int tokensEvaluated = 0;      ///< Prompt tokens the server had to evaluate.
+    int tokensCached = 0;         ///< Prompt tokens reused from the server's cache.
+    std::string stopReason;       ///< e.g. "eos", "limit" or "word", when the server reports it.
+    std::chrono::milliseconds duration{0};
+};
+
+/**
+ * @brief Runs completions against a llama.cpp server over persistent HTTP connections.
+ *
+ * Replaces llm_infer_server.sh, which forked jq twice and curl once and opened
+ * a new TCP connection for every prompt. Requests go to LLAMACPP_SERVER_URL +
+ * LLAMACPP_SERVER_ENDPOINT through a keep-alive connection pool, and the JSON
+ * is written and read in place without intermediate documents.
+ *
+ * Configuration: LLM_N_PREDICT (default 1024), LLM_TEMPERATURE (default 0.7),
+ * LLM_TIMEOUT_SEC (default 300, per wait for data) and LLM_CACHE_PROMPT
+ * (default true; lets the server reuse the KV cache of a shared prompt
+ * prefix, and steers each request to the slot that holds it). Safe to share
+ * between scheduler workers.
+ */
+class LLMRunner {
+public:
+    /** Receives each generated piece of text as the server streams it; return false to stop generation. */
+    using TokenCallback = std::function<bool(std::string_view token)>;
+
+    explicit LLMRunner(const Config& config);
+
+    /** @brief False if the server URL is unusable; the reason is in error(). */
+    bool valid() const { return m_client.valid(); }
+    const std::string& error() const { return m_client.error(); }
+
+    /**
+     * @brief Runs one completion.
+     *
+     * Without a callback the server answers with a single JSON document.
+     * With one, the request asks for a server-sent event stream and each
+     * token is handed over as it arrives; returning false closes the
+     * connection, which makes the server abandon the generation.
+     * @param maxTokens Generates at most this many tokens if below LLM_N_PREDICT; 0 means LLM_N_PREDICT.
+     */
+    LLMResult run(std::string_view prompt, const TokenCallback& onToken = {}, int maxTokens = 0);
+
+    /**
+     * @brief Runs several prompts as one multi-prompt request.
+     *
+     * The server spreads the prompts over its parallel slots (-np) and answers
+     * with one result per prompt; results are returned in prompt order.
+     * If the request as a whole fails, every result carries the error.
+     */
+    std::vector<LLMResult> runBatch(const std::vector<std::string_view>& prompts);
+
+    /**
+     * @brief Hashes everything that determines a response: model, endpoint, sampling parameters and prompt.
+     */
+    Hash128 cacheKey(std::string_view prompt) const;
+
+    /** @brief LLM_N_PREDICT: the most tokens a completion may generate. */
+    int nPredict() const { return m_nPredict; }
+
+    /** @brief Number of TCP connections opened so far. */
+    uint64_t connectionsOpened() const { return m_client.connectionsOpened(); }
+
+private:
+    void buildRequest(std::string& out, std::string_view prompt, bool stream, int nPredict) const;
+    void buildBatchRequest(std::string& out, const std::vector<std::string_view>& prompts) const;
+
+    HttpClient m_client;
+    std::string m_endpoint;
+    std::string m_model;
+    int m_nPredict;
+    double m_temperature;
+    bool m_cachePrompt;
+};
+
+#endif //PRISMQUANTA_LLM_RUNNER_H
@@ -0,0 +1,299 @@
+#include "LiveConfig.h"
+#include "Logger.h"
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <optional>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Polling interval when inotify is unavailable.
+    constexpr int kPollMs = 2000;
+
+    // Distinguishes LiveConfig instances in the per-thread snapshot cache.
+    std::atomic<uint64_t> g_instances{0};
+
+    struct ThreadSnapshot {
+        uint64_t instance = 0;
+        uint64_t generation = 0;
+        std::shared_ptr<const ConfigSnapshot> snapshot;
+    };
+    thread_local ThreadSnapshot t_snapshot;
+
+    std::optional<int> parse_int(const std::string& text) {
+        int value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<double> parse_double(const std::string& text) {
+        if (text.empty()) {
+            return std::nullopt;
+        }
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (end != text.c_str() + text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<bool> parse_bool(const std::string& text) {
+        if (text == "true" || text == "yes" || text == "on" || text == "1") return true;
+        if (text == "false" || text == "no" || text == "off" || text == "0") return false;
+        return std::nullopt;
+    }
+
+    // Looks up each declared key, converting and falling back to its default.
+    template <typename T, typename Entries, typename Parse, typename Store>
+    void fill(const Entries& entries, const Config& raw, std::vector<Store>& out, Parse parse) {
+        out.reserve(entries.size());
+        for (const auto& entry : entries) {
+            std::optional<std::string> text = raw.getString(entry.name);
+            if (!text) {
+                out.push_back(entry.fallback);
+                continue;
+            }
+            std::optional<T> value = parse(*text);
+            if (!value) {
+                Logger::instance().warn("Config", "Invalid value for " + entry.name + ": '" + *text + "'; using the default.");
+                out.push_back(entry.fallback);
+                continue;
+            }
+            out.push_back(*value);
+        }
+    }
+
+    // Size of a file, or -1 if it does not exist.
+    int64_t size_of(const std::string& path) {
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            return -1;
+        }
+        return static_cast<int64_t>(info.st_size);
+    }
+
+    int64_t mtime_of(const std::string& path) {
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            return -1;
+        }
+        return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+} // namespace
+
+// --- ConfigSchema ---
+
+ConfigKey<int> ConfigSchema::addInt(std::string name, int fallback) {
+    m_ints.push_back({std::move(name), fallback});
+    return {static_cast<uint32_t>(m_ints.size() - 1)};
+}
+
+ConfigKey<double> ConfigSchema::addDouble(std::string name, double fallback) {
+    m_doubles.push_back({std::move(name), fallback});
+    return {static_cast<uint32_t>(m_doubles.size() - 1)};
+}
+
+ConfigKey<bool> ConfigSchema::addBool(std::string name, bool fallback) {
+    m_bools.push_back({std::move(name), fallback});
+    return {static_cast<uint32_t>(m_bools.size() - 1)};
+}
+
+ConfigKey<std::string> ConfigSchema::addString(std::string name, std::string fallback) {
+    m_strings.push_back({std::move(name), std::move(fallback)});
+    return {static_cast<uint32_t>(m_strings.size() - 1)};
+}
+
+// --- ConfigSnapshot ---
+
+ConfigSnapshot::ConfigSnapshot(const ConfigSchema& schema, Config raw, uint64_t generation)
+    : m_raw(std::move(raw)), m_generation(generation) {
+    fill<int>(schema.m_ints, m_raw, m_ints, parse_int);
+    fill<double>(schema.m_doubles, m_raw, m_doubles, parse_double);
+    fill<bool>(schema.m_bools, m_raw, m_bools, parse_bool);
+    fill<std::string>(schema.m_strings, m_raw, m_strings,
+                      [](const std::string& text) { return std::optional<std::string>(text); });
+}
+
+// --- LiveConfig ---
+
+LiveConfig::LiveConfig(const ConfigSchema& schema, std::vector<std::string> files)
+    : m_schema(schema), m_files(std::move(files)), m_instance(++g_instances) {
+    for (const auto& file : m_files) {
+        m_names.push_back(fs::path(file).filename().string());
+        m_mtimes.push_back(mtime_of(file));
+        m_present.push_back(false);
+    }
+    // Publish an empty snapshot so current() is never null, then the real one.
+    std::atomic_store(&m_current, std::shared_ptr<const ConfigSnapshot>(std::make_shared<ConfigSnapshot>(m_schema, Config(), 0)));
+    reload();
+}
+
+LiveConfig::~LiveConfig() {
+    if (m_watcher.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+        m_watcher.join();
+    }
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+}
+
+bool LiveConfig::reload() {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    Config raw;
+    bool any = false;
+    std::vector<bool> present(m_files.size(), false);
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        m_mtimes[i] = mtime_of(m_files[i]);
+        present[i] = size_of(m_files[i]) > 0;
+        if (m_present[i] && !present[i]) {
+            // Caught between an editor's truncate and its write, or deleted: every key would fall back to its default.
+            Logger::instance().warn("Config", m_files[i] + " is missing or empty; keeping the current configuration.");
+            return false;
+        }
+        any = raw.load(m_files[i]) || any;
+    }
+    if (!any) {
+        return false;
+    }
+    m_present = std::move(present);
+
+    std::shared_ptr<const ConfigSnapshot> previous = std::atomic_load(&m_current);
+    if (previous->generation() > 0 && raw.values() == previous->raw().values()) {
+        return true;
+    }
+    auto next = std::make_shared<const ConfigSnapshot>(m_schema, std::move(raw), previous->generation() + 1);
+    std::atomic_store(&m_current, next);
+    m_generation.store(next->generation(), std::memory_order_release);
+
+    if (previous->generation() > 0) {
+        std::string changed;
+        const auto& before = previous->raw().values();
+        for (const auto& [key, value] : next->raw().values()) {
+            auto it = before.find(key);
+            if (it == before.end() || it->second != value) {
+                changed += (changed.empty() ? "" : ", ") + key + " = " + value;
+            }
+        }
+        for (const auto& [key, value] : before) {
+            if (next->raw().values().count(key) == 0) {
+                changed += (changed.empty() ? "" : ", ") + key + " removed";
+            }
+        }
+        Logger::instance().info("Config", "Reloaded configuration (generation " + std::to_string(next->generation()) +
+                                "): " + changed + ".");
+        for (const auto& listener : m_listeners) {
+            listener(*previous, *next);
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const ConfigSnapshot> LiveConfig::current() const {
+    ThreadSnapshot& cached = t_snapshot;
+    uint64_t generation = m_generation.load(std::memory_order_acquire);
+    if (cached.instance != m_instance || cached.generation != generation || !cached.snapshot) {
+        cached.snapshot = std::atomic_load(&m_current);
+        cached.instance = m_instance;
+        cached.generation = cached.snapshot->generation();
+    }
+    return cached.snapshot;
+}
+
+void LiveConfig::onChange(Listener listener) {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    m_listeners.push_back(std::move(listener));
+}
+
+void LiveConfig::watch() {
+    if (m_watcher.joinable()) {
+        return;
+    }
+    m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+        // Watch the directories: editors and deploy tools replace files by rename. Only
+        // finished writes count; a file that was just created may still be empty.
+        std::vector<std::string> watched;
+        for (const auto& file : m_files) {
+            std::string dir = fs::path(file).parent_path().string();
+            if (dir.empty()) {
+                dir = ".";
+            }
+            bool seen = false;
+            for (const auto& other : watched) {
+                seen = seen || other == dir;
+            }
+            if (seen) {
+                continue;
+            }
+            if (::inotify_add_watch(m_inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+                Logger::instance().warn("Config", "Cannot watch " + dir + "; polling configuration files instead.");
+                ::close(m_inotifyFd);
+                m_inotifyFd = -1;
+                break;
+            }
+            watched.push_back(dir);
+        }
+    }
+    m_watcher = std::thread([this] { watchLoop(); });
+}
+
+bool LiveConfig::filesChanged() {
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        if (mtime_of(m_files[i]) != m_mtimes[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LiveConfig::watchLoop() {
+    alignas(struct inotify_event) char buffer[4096];
+    while (true) {
+        pollfd fds[2] = {{m_wakeFd, POLLIN, 0}, {m_inotifyFd, POLLIN, 0}};
+        int ready = ::poll(fds, m_inotifyFd >= 0 ? 2 : 1, m_inotifyFd >= 0 ? -1 : kPollMs);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+
+        bool relevant = false;
+        if (m_inotifyFd >= 0 && (fds[1].revents & POLLIN)) {
+            ssize_t length;
+            while ((length = ::read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    auto* event = reinterpret_cast<struct inotify_event*>(p);
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        relevant = true;
+                    } else if (event->len > 0) {
+                        for (const auto& name : m_names) {
+                            relevant = relevant || name == event->name;
+                        }
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        } else if (m_inotifyFd < 0) {
+            relevant = filesChanged();
+        }
+        if (relevant) {
+            reload();
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef PRISMQUANTA_LIVE_CONFIG_H
+#define PRISMQUANTA_LIVE_CONFIG_H
+
+#include "Config.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Handle to a declared configuration key; reading it from a snapshot is an array index.
+ */
+template <typename T>
+struct ConfigKey {
+    uint32_t slot = 0;
+};
+
+/**
+ * @brief The keys a component reads, with their types and defaults.
+ *
+ * Declare every key once, before the first snapshot is built, and keep the
+ * returned handles:
+ * @code
+ *     ConfigSchema schema;
+ *     ConfigKey<int> poll = schema.addInt("POLL_INTERVAL_SEC", 5);
+ *     ...
+ *     int seconds = live.current()->get(poll);
+ * @endcode
+ * A value that does not parse as its type is reported once per load and
+ * replaced by the default.
+ */
+class ConfigSchema {
+public:
+    ConfigKey<int> addInt(std::string name, int fallback);
+    ConfigKey<double> addDouble(std::string name, double fallback);
+    /** Accepts true/false, yes/no, on/off and 1/0. */
+    ConfigKey<bool> addBool(std::string name, bool fallback);
+    ConfigKey<std::string> addString(std::string name, std::string fallback);
+
+private:
+    friend class ConfigSnapshot;
+
+    template <typename T>
+    struct Entry {
+        std::string name;
+        T fallback;
+    };
+
+    std::vector<Entry<int>> m_ints;
+    std::vector<Entry<double>> m_doubles;
+    std::vector<Entry<bool>> m_bools;
+    std::vector<Entry<std::string>> m_strings;
+};
+
+/**
+ * @brief An immutable, fully parsed view of the configuration files at one point in time.
+ *
+ * Typed values are converted once, when the snapshot is built. raw() keeps
+ * every key from the files for components that still take a Config.
+ */
+class ConfigSnapshot {
+public:
+    ConfigSnapshot(const ConfigSchema& schema, Config raw, uint64_t generation);
+
+    int get(ConfigKey<int> key) const { return m_ints[key.slot]; }
+    double get(ConfigKey<double> key) const { return m_doubles[key.slot]; }
+    bool get(ConfigKey<bool> key) const { return m_bools[key.slot] != 0; }
+    const std::string& get(ConfigKey<std::string> key) const { return m_strings[key.slot]; }
+
+    const Config& raw() const { return m_raw; }
+
+    /** @brief 1 for the first load, incremented by every reload that changed something. */
+    uint64_t generation() const { return m_generation; }
+
+private:
+    Config m_raw;
+    uint64_t m_generation;
+    std::vector<int> m_ints;
+    std::vector<double> m_doubles;
+    std::vector<char> m_bools;
+    std::vector<std::string> m_strings;
+};
+
+/**
+ * @brief Configuration that follows its files while the process runs.
+ *
+ * The files (later ones override earlier ones, as with repeated
+ * Config::load calls) are parsed into a ConfigSnapshot that is published
+ * through an atomic shared_ptr. watch() starts a thread that waits on
+ * inotify for the files to be written or replaced, and publishes a new
+ * snapshot when their contents change; without inotify it compares
+ * modification times every two seconds. A reload that finds a file
+ * missing or empty which was not before is ignored, so a half-written
+ * file never resets the keys to their defaults.
+ *
+ * Readers never wait for a reload: current() keeps a per-thread copy of
+ * the latest snapshot and only touches the shared pointer when the
+ * generation counter has moved. A snapshot held by a reader stays valid
+ * for as long as it is held, so a task sees one consistent configuration
+ * from start to finish.
+ */
+class LiveConfig {
+public:
+    using Listener = std::function<void(const ConfigSnapshot& previous, const ConfigSnapshot& current)>;
+
+    LiveConfig(const ConfigSchema& schema, std::vector<std::string> files);
+    ~LiveConfig();
+
+    LiveConfig(const LiveConfig&) = delete;
+    LiveConfig& operator=(const LiveConfig&) = delete;
+
+    /**
+     * @brief Reads the files and publishes a snapshot if the result differs from the current one.
+     * @return False if none of the files could be read, or one that was read before is now missing or empty.
+     */
+    bool reload();
+
+    /** @brief The latest snapshot; never null once constructed. */
+    std::shared_ptr<const ConfigSnapshot> current() const;
+
+    /**
+     * @brief Called on the watcher thread after each reload that changed something.
+     *
+     * Register listeners before calling watch().
+     */
+    void onChange(Listener listener);
+
+    /** @brief Starts following the files. */
+    void watch();
+
+    /** @brief True while changes are detected with inotify rather than polling. */
+    bool usingInotify() const { return m_inotifyFd >= 0; }
+
+private:
+    void watchLoop();
+    bool filesChanged();
+
+    const ConfigSchema& m_schema;
+    std::vector<std::string> m_files;
+    std::vector<std::string> m_names;           // Basenames, to filter directory events.
+    std::vector<int64_t> m_mtimes;              // For the polling fallback.
+    std::vector<bool> m_present;                // Non-empty at the last published load.
+    uint64_t m_instance;                        // Key of the per-thread snapshot cache.
+
+    std::shared_ptr<const ConfigSnapshot> m_current;  // Accessed with std::atomic_load/store.
+    std::atomic<uint64_t> m_generation{0};
+    std::mutex m_reloadMutex;                   // Serializes writers only.
+    std::vector<Listener> m_listeners;
+
+    int m_inotifyFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_watcher;
+};
+
+#endif //PRISMQUANTA_LIVE_CONFIG_H
@@ -0,0 +1,403 @@
+#include "LogIndex.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    constexpr char kMagic[4] = {'P', 'Q', 'L', 'I'};
+
+    // Enough of the log's head to tell a rotated or rewritten file from the one indexed.
+    constexpr size_t kHeadBytes = 4096;
+
+    struct IndexHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t blockBytes;
+        uint64_t blockCount;
+        uint64_t indexedBytes;
+        uint64_t headHash;  // Hasher::hash64 of the log's first min(kHeadBytes, indexedBytes) bytes.
+    };
+    static_assert(sizeof(LogIndex::Block) == 40, "index blocks must stay 40 bytes");
+
+    constexpr const char* kMonths = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    bool digits(std::string_view text, size_t pos, size_t count, int& value) {
+        if (pos + count > text.size()) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = pos; i < pos + count; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                return false;
+            }
+            value = value * 10 + (text[i] - '0');
+        }
+        return true;
+    }
+
+    // Days since 1970-01-01 of a proleptic Gregorian date.
+    int64_t days_from_civil(int64_t y, int m, int d) {
+        y -= m <= 2;
+        int64_t era = (y >= 0 ? y : y - 399) / 400;
+        int64_t yoe = y - era * 400;
+        int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    std::optional<int64_t> to_seconds(int year, int month, int day, int hour, int minute, int second) {
+        if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+            return std::nullopt;
+        }
+        return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS", or 'T' in place of the space.
+    std::optional<int64_t> parse_iso(std::string_view text) {
+        int year, month, day, hour, minute, second;
+        if (text.size() < 19 || !digits(text, 0, 4, year) || text[4] != '-' || !digits(text, 5, 2, month) ||
+            text[7] != '-' || !digits(text, 8, 2, day) || (text[10] != ' ' && text[10] != 'T') ||
+            !digits(text, 11, 2, hour) || text[13] != ':' || !digits(text, 14, 2, minute) || text[16] != ':' ||
+            !digits(text, 17, 2, second)) {
+            return std::nullopt;
+        }
+        return to_seconds(year, month, day, hour, minute, second);
+    }
+
+    // "[Fri Oct 16 04:22:04 2026]": ctime() layout, the day padded with a space.
+    std::optional<int64_t> parse_logger(std::string_view line) {
+        if (line.size() < 26 || line[0] != '[' || line[25] != ']' || line[4] != ' ' || line[8] != ' ') {
+            return std::nullopt;
+        }
+        const char* found = std::strstr(kMonths, std::string(line.substr(5, 3)).c_str());
+        if (!found || (found - kMonths) % 3 != 0) {
+            return std::nullopt;
+        }
+        int month = static_cast<int>(found - kMonths) / 3 + 1;
+        int day, hour, minute, second, year;
+        if (line[9] == ' ' ? !digits(line, 10, 1, day) : !digits(line, 9, 2, day)) {
+            return std::nullopt;
+        }
+        if (line[11] != ' ' || !digits(line, 12, 2, hour) || line[14] != ':' || !digits(line, 15, 2, minute) ||
+            line[17] != ':' || !digits(line, 18, 2, second) || line[20] != ' ' || !digits(line, 21, 4, year)) {
+            return std::nullopt;
+        }
+        return to_seconds(year, month, day, hour, minute, second);
+    }
+
+    // The Logger tag after the timestamp: "[ts] [PortoManager:a.sh] ..." matches "PortoManager".
+    bool has_component(std::string_view line, std::string_view component) {
+        size_t open = line.find("] [");
+        if (open == std::string_view::npos) {
+            return false;
+        }
+        std::string_view tag = line.substr(open + 3);
+        return tag.size() > component.size() && tag.compare(0, component.size(), component) == 0 &&
+               (tag[component.size()] == ']' || tag[component.size()] == ':');
+    }
+
+    uint64_t head_hash(const MappedFile& log, uint64_t indexedBytes) {
+        return Hasher::hash64(std::string_view(log.data(), std::min<uint64_t>(kHeadBytes, indexedBytes)));
+    }
+} // namespace
+
+std::string LogIndex::indexPathFor(const std::string& logPath) {
+    return logPath + ".idx";
+}
+
+std::optional<int64_t> LogIndex::parseTime(std::string_view text, bool endOfPeriod) {
+    std::string full(text);
+    int64_t extra = 0;
+    if (full.size() == 10) {
+        full += " 00:00:00";
+        extra = 86399;
+    } else if (full.size() == 16) {
+        full += ":00";
+        extra = 59;
+    } else if (full.size() != 19) {
+        return std::nullopt;
+    }
+    auto seconds = parse_iso(full);
+    if (seconds && endOfPeriod) {
+        *seconds += extra;
+    }
+    return seconds;
+}
+
+std::optional<int64_t> LogIndex::lineTime(std::string_view line) {
+    if (line.empty()) {
+        return std::nullopt;
+    }
+    if (line[0] == '[') {
+        return parse_logger(line);
+    }
+    if (line[0] >= '0' && line[0] <= '9') {
+        return parse_iso(line);
+    }
+    return std::nullopt;
+}
+
+// --- Index ---
+
+bool LogIndex::open(const std::string& logPath, ThreadPool& pool, bool forTimeRange) {
+    m_logPath = logPath;
+    m_blocks.clear();
+    m_indexedBytes = 0;
+    m_newBytes = 0;
+    m_dirty = false;
+    m_error.clear();
+    if (!m_log.open(logPath, forTimeRange ? MappedFile::Access::Random : MappedFile::Access::Sequential)) {
+        m_error = "cannot map " + logPath;
+        return false;
+    }
+
+    if (!load()) {
+        m_blocks.clear();
+        m_indexedBytes = 0;
+        m_dirty = true;
+    }
+
+    // Index complete lines only; the end of a short last block is revisited once it has grown.
+    std::string_view data = m_log.view();
+    size_t lastNewline = data.rfind('\n');
+    uint64_t end = lastNewline == std::string_view::npos ? 0 : lastNewline + 1;
+    uint64_t from = m_indexedBytes;
+    if (!m_blocks.empty() && m_indexedBytes - m_blocks.back().offset < kBlockBytes && end > m_indexedBytes) {
+        from = m_blocks.back().offset;
+        m_blocks.pop_back();
+    }
+    if (end > from) {
+        m_log.prefetch(from, end - from);
+        index(from, end, pool);
+        m_newBytes = end - from;
+        m_dirty = true;
+    }
+    return true;
+}
+
+bool LogIndex::load() {
+    std::ifstream in(indexPathFor(m_logPath), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (image.size() < sizeof(IndexHeader)) {
+        return false;
+    }
+    IndexHeader header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.blockBytes != kBlockBytes || image.size() != sizeof(header) + header.blockCount * sizeof(Block) ||
+        header.indexedBytes > m_log.size() || head_hash(m_log, header.indexedBytes) != header.headHash) {
+        return false;
+    }
+    m_blocks.resize(header.blockCount);
+    std::memcpy(m_blocks.data(), image.data() + sizeof(header), header.blockCount * sizeof(Block));
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        uint64_t limit = i + 1 < m_blocks.size() ? m_blocks[i + 1].offset : header.indexedBytes;
+        if ((i == 0 && m_blocks[i].offset != 0) || m_blocks[i].offset >= limit) {
+            return false;
+        }
+    }
+    m_indexedBytes = header.indexedBytes;
+    return true;
+}
+
+bool LogIndex::save() {
+    if (!m_dirty) {
+        return true;
+    }
+    IndexHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.blockBytes = kBlockBytes;
+    header.blockCount = m_blocks.size();
+    header.indexedBytes = m_indexedBytes;
+    header.headHash = head_hash(m_log, m_indexedBytes);
+
+    std::string path = indexPathFor(m_logPath);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(m_blocks.data()),
+                  static_cast<std::streamsize>(m_blocks.size() * sizeof(Block)));
+        if (!out) {
+            std::remove(temp.c_str());
+            m_error = "cannot write " + temp;
+            return false;
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        m_error = "cannot replace " + path + ": " + std::strerror(errno);
+        std::remove(temp.c_str());
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+void LogIndex::index(uint64_t from, uint64_t to, ThreadPool& pool) {
+    // Block boundaries first: the first line start at or after every kBlockBytes.
+    const char* data = m_log.data();
+    std::vector<uint64_t> starts;
+    for (uint64_t pos = from; pos < to;) {
+        starts.push_back(pos);
+        if (to - pos <= kBlockBytes) {
+            break;
+        }
+        const void* newline = std::memchr(data + pos + kBlockBytes - 1, '\n', to - (pos + kBlockBytes - 1));
+        pos = static_cast<uint64_t>(static_cast<const char*>(newline) - data) + 1;
+    }
+
+    // Each block's own times in parallel; what carries over between them is settled afterwards.
+    std::vector<Block> fresh(starts.size());
+    std::vector<char> leadingUnstamped(starts.size(), 0);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        pool.submit([&, i] {
+            uint64_t end = i + 1 < starts.size() ? starts[i + 1] : to;
+            Block& block = fresh[i];
+            block.offset = starts[i];
+            block.minTime = INT64_MAX;
+            block.maxTime = kNoTime;
+            block.lastTime = kNoTime;
+            LineScanner lines(std::string_view(data + block.offset, end - block.offset));
+            std::string_view line;
+            bool first = true;
+            while (lines.next(line)) {
+                auto time = lineTime(line);
+                if (first) {
+                    leadingUnstamped[i] = !time;
+                    first = false;
+                }
+                if (time) {
+                    block.minTime = std::min(block.minTime, *time);
+                    block.maxTime = std::max(block.maxTime, *time);
+                    block.lastTime = *time;
+                }
+            }
+        });
+    }
+    pool.waitIdle();
+
+    int64_t carry = m_blocks.empty() ? kNoTime : m_blocks.back().lastTime;
+    for (size_t i = 0; i < fresh.size(); ++i) {
+        Block& block = fresh[i];
+        block.carry = carry;
+        if (leadingUnstamped[i] && carry != kNoTime) {
+            block.minTime = std::min(block.minTime, carry);
+            block.maxTime = std::max(block.maxTime, carry);
+        }
+        if (block.lastTime == kNoTime) {
+            block.lastTime = carry;
+        }
+        carry = block.lastTime;
+        m_blocks.push_back(block);
+    }
+    m_indexedBytes = to;
+}
+
+// --- Search ---
+
+std::string_view LogIndex::blockText(size_t block) const {
+    uint64_t begin = m_blocks[block].offset;
+    uint64_t end = block + 1 < m_blocks.size() ? m_blocks[block + 1].offset : m_indexedBytes;
+    return std::string_view(m_log.data() + begin, end - begin);
+}
+
+std::vector<std::string_view> LogIndex::search(const Query& query, ThreadPool& pool, size_t* blocksVisited) const {
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        const Block& block = m_blocks[i];
+        if (!query.timeBounded() ||
+            (block.minTime <= block.maxTime && block.maxTime >= query.since.value_or(INT64_MIN) &&
+             block.minTime <= query.until.value_or(INT64_MAX))) {
+            selected.push_back(i);
+        }
+    }
+    if (blocksVisited) {
+        *blocksVisited = selected.size();
+    }
+    if (query.timeBounded()) {
+        for (size_t i : selected) {
+            m_log.prefetch(m_blocks[i].offset, blockText(i).size());
+        }
+    }
+
+    std::vector<std::vector<std::string_view>> found(selected.size());
+    for (size_t i = 0; i < selected.size(); ++i) {
+        pool.submit([this, &query, &selected, &found, i] { searchBlock(selected[i], query, found[i]); });
+    }
+    pool.waitIdle();
+
+    std::vector<std::string_view> lines;
+    for (auto& part : found) {
+        lines.insert(lines.end(), part.begin(), part.end());
+    }
+    return lines;
+}
+
+void LogIndex::searchBlock(size_t block, const Query& query, std::vector<std::string_view>& out) const {
+    std::string_view text = blockText(block);
+    int64_t since = query.since.value_or(INT64_MIN);
+    int64_t until = query.until.value_or(INT64_MAX);
+    auto matches = [&](std::string_view line, int64_t time) {
+        return (!query.timeBounded() || (time != kNoTime && time >= since && time <= until)) &&
+               (query.component.empty() || has_component(line, query.component)) &&
+               (query.text.empty() || line.find(query.text) != std::string_view::npos);
+    };
+
+    // With something to look for, jump from one occurrence to the next instead of visiting every line.
+    std::string needle = !query.text.empty() ? query.text : !query.component.empty() ? "[" + query.component : "";
+    if (needle.empty()) {
+        int64_t time = m_blocks[block].carry;
+        LineScanner lines(text);
+        std::string_view line;
+        while (lines.next(line)) {
+            if (auto stamped = lineTime(line)) {
+                time = *stamped;
+            }
+            if (matches(line, time)) {
+                out.push_back(line);
+            }
+        }
+        return;
+    }
+
+    size_t pos = 0;
+    while (const void* found = memmem(text.data() + pos, text.size() - pos, needle.data(), needle.size())) {
+        size_t hit = static_cast<size_t>(static_cast<const char*>(found) - text.data());
+        size_t newline = hit == 0 ? std::string_view::npos : text.rfind('\n', hit - 1);
+        size_t start = newline == std::string_view::npos ? 0 : newline + 1;
+        size_t end = text.find('\n', hit);
+        end = end == std::string_view::npos ? text.size() : end;
+        std::string_view line = text.substr(start, end - start);
+
+        // A continuation line takes the time of the nearest stamped line above it.
+        int64_t time = m_blocks[block].carry;
+        if (query.timeBounded()) {
+            for (size_t at = start;;) {
+                if (auto stamped = lineTime(text.substr(at, text.find('\n', at) - at))) {
+                    time = *stamped;
+                    break;
+                }
+                if (at == 0) {
+                    break;
+                }
+                size_t previous = at >= 2 ? text.rfind('\n', at - 2) : std::string_view::npos;
+                at = previous == std::string_view::npos ? 0 : previous + 1;
+            }
+        }
+        if (matches(line, time)) {
+            out.push_back(line);
+        }
+        pos = end + 1;
+        if (pos >= text.size()) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#ifndef PRISMQUANTA_LOG_INDEX_H
+#define PRISMQUANTA_LOG_INDEX_H
+
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+class ThreadPool;
+
+/**
+ * @brief Splits text into lines, finding the newlines of 64 bytes at a time.
+ *
+ * Each 64-byte chunk is compared against '\n' with SSE2 (a portable loop
+ * elsewhere) into a bitmask, and lines are handed out from the mask's set
+ * bits, so short lines cost a bit scan rather than a memchr() call each.
+ * Lines exclude the '\n'; a last line without one is returned as well.
+ */
+class LineScanner {
+public:
+    explicit LineScanner(std::string_view text) : m_data(text.data()), m_size(text.size()) {}
+
+    bool next(std::string_view& line) {
+        while (m_pos < m_size) {
+            if (m_mask != 0) {
+                size_t newline = m_chunk + static_cast<size_t>(__builtin_ctzll(m_mask));
+                m_mask &= m_mask - 1;
+                line = std::string_view(m_data + m_pos, newline - m_pos);
+                m_pos = newline + 1;
+                return true;
+            }
+            if (m_next >= m_size) {
+                line = std::string_view(m_data + m_pos, m_size - m_pos);
+                m_pos = m_size;
+                return true;
+            }
+            m_chunk = m_next;
+            m_mask = newlines(m_data + m_chunk, std::min<size_t>(64, m_size - m_chunk));
+            m_next += 64;
+        }
+        return false;
+    }
+
+private:
+    static uint64_t newlines(const char* p, size_t n) {
+#if defined(__SSE2__)
+        if (n == 64) {
+            const __m128i nl = _mm_set1_epi8('\n');
+            auto mask16 = [&](int i) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+                return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nl))));
+            };
+            return mask16(0) | mask16(1) << 16 | mask16(2) << 32 | mask16(3) << 48;
+        }
+#endif
+        uint64_t mask = 0;
+        for (size_t i = 0; i < n; ++i) {
+            mask |= static_cast<uint64_t>(p[i] == '\n') << i;
+        }
+        return mask;
+    }
+
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos = 0;    // Start of the next line.
+    size_t m_chunk = 0;  // Offset of the chunk m_mask describes.
+    size_t m_next = 0;   // Offset of the next chunk to scan.
+    uint64_t m_mask = 0; // Newlines in the chunk not yet handed out.
+};
+
+/**
+ * @brief A memory-mapped log file with a sparse sidecar index of time to byte offset.
+ *
+ * The log is cut into blocks of about kBlockBytes, ending on line
+ * boundaries, and the sidecar (<log>.idx) records each block's offset and
+ * the earliest and latest timestamp in it, plus the timestamp in effect
+ * where it starts so that continuation lines (an ethics entry's "  - ..."
+ * lines) belong to the entry above them. Opening the log indexes only the
+ * bytes appended since the sidecar was written; a log that was truncated or
+ * rotated underneath it is indexed again from the start.
+ *
+ * Recognised timestamps open a line: "[Fri Oct 16 04:22:04 2026]" as
+ * written by Logger, or "2026-10-16 04:22:04" (also with a 'T') as written
+ * by the scripts and the RuleEngine. Times are compared as written, in
+ * seconds of the log's local clock; lines before the first timestamp have
+ * none and never match a time range.
+ *
+ * A search runs block by block on a ThreadPool. A time range visits only
+ * the blocks whose range overlaps it, and the log is then mapped for random
+ * access and those blocks prefetched, so the rest of the file is not read.
+ */
+class LogIndex {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kBlockBytes = 256 * 1024;
+    static constexpr int64_t kNoTime = INT64_MIN;
+
+    /** @brief What a line must match; empty fields match everything. */
+    struct Query {
+        std::optional<int64_t> since;  ///< Inclusive, as from parseTime().
+        std::optional<int64_t> until;  ///< Inclusive.
+        std::string component;         ///< Logger tag: "PortoManager" matches [PortoManager] and [PortoManager:a.sh].
+        std::string text;              ///< Substring, case-sensitive.
+
+        bool timeBounded() const { return since.has_value() || until.has_value(); }
+    };
+
+    /** @brief Where the index of @p logPath lives: the same path with ".idx" appended. */
+    static std::string indexPathFor(const std::string& logPath);
+
+    /**
+     * @brief Parses "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS" (a 'T' may replace the space).
+     * @param endOfPeriod Give the last second the text covers ("2026-10-16" -> 23:59:59), for upper bounds.
+     * @return Seconds, comparable with the log's timestamps.
+     */
+    static std::optional<int64_t> parseTime(std::string_view text, bool endOfPeriod = false);
+
+    /** @brief The timestamp a log line starts with, if any. */
+    static std::optional<int64_t> lineTime(std::string_view line);
+
+    /**
+     * @brief Maps a log and brings its index up to date, in memory, using the pool for new blocks.
+     *
+     * Lines are indexed up to the last newline; a line still being written
+     * is left for next time. @p forTimeRange maps the log for random access.
+     * @return False (with error()) if the log cannot be mapped.
+     */
+    bool open(const std::string& logPath, ThreadPool& pool, bool forTimeRange = false);
+
+    /** @brief Writes the sidecar if open() indexed anything new; false (with error()) if it cannot be written. */
+    bool save();
+
+    /**
+     * @brief Every matching line, in file order; the views point into the mapping.
+     * @param blocksVisited Receives how many blocks the query had to read.
+     */
+    std::vector<std::string_view> search(const Query& query, ThreadPool& pool, size_t* blocksVisited = nullptr) const;
+
+    const std::string& error() const { return m_error; }
+    size_t blockCount() const { return m_blocks.size(); }
+    uint64_t indexedBytes() const { return m_indexedBytes; }
+    /** @brief Bytes open() had to read to update the index. */
+    uint64_t newBytes() const { return m_newBytes; }
+
+    struct Block {
+        uint64_t offset;
+        int64_t carry;    // Time of the last stamped line before the block, or kNoTime.
+        int64_t minTime;  // Range over the block's lines, continuation lines included;
+        int64_t maxTime;  // minTime > maxTime if none has a time.
+        int64_t lastTime; // Time in effect at the end of the block.
+    };
+
+private:
+    bool load();
+    void index(uint64_t from, uint64_t to, ThreadPool& pool);
+    std::string_view blockText(size_t block) const;
+    void searchBlock(size_t block, const Query& query, std::vector<std::string_view>& out) const;
+
+    std::string m_logPath;
+    MappedFile m_log;
+    std::vector<Block> m_blocks;
+    uint64_t m_indexedBytes = 0;
+    uint64_t m_newBytes = 0;
+    bool m_dirty = false;
+    std::string m_error;
+};
+
+#endif //PRISMQUANTA_LOG_INDEX_H
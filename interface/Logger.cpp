@@ -0,0 +1,290 @@
+#include "Logger.h"
+#include "Config.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr auto kIdleWait = std::chrono::milliseconds(100);
+
+    int64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::string_view file_prefix(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "DEBUG: ";
+            case LogLevel::Warn: return "WARNING: ";
+            case LogLevel::Error: return "ERROR: ";
+            default: return "";
+        }
+    }
+
+    std::string_view console_prefix(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "Debug: ";
+            case LogLevel::Warn: return "Warning: ";
+            case LogLevel::Error: return "Error: ";
+            default: return "Info: ";
+        }
+    }
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : m_slots(new Slot[kCapacity]) {
+    for (size_t i = 0; i < kCapacity; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    m_stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_all();
+    m_writer.join();
+    if (m_fd >= 0) {
+        if (m_fsyncPolicy != FsyncPolicy::Never) {
+            fsync(m_fd);
+        }
+        close(m_fd);
+    }
+}
+
+std::optional<LogLevel> Logger::parseLevel(std::string_view name) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+    if (upper == "DEBUG") return LogLevel::Debug;
+    if (upper == "INFO") return LogLevel::Info;
+    if (upper == "WARN" || upper == "WARNING") return LogLevel::Warn;
+    if (upper == "ERROR") return LogLevel::Error;
+    return std::nullopt;
+}
+
+bool Logger::configure(const Config& config) {
+    if (auto level = config.getString("LOG_LEVEL")) {
+        if (auto parsed = parseLevel(*level)) {
+            setLevel(*parsed);
+        } else {
+            warn("Logger", "Unknown LOG_LEVEL '" + *level + "'; keeping the current level.");
+        }
+    }
+
+    if (auto policy = config.getString("LOG_FSYNC")) {
+        int interval = config.getInt("LOG_FSYNC_INTERVAL_MS").value_or(1000);
+        if (*policy == "batch") setFsyncPolicy(FsyncPolicy::Batch, interval);
+        else if (*policy == "interval") setFsyncPolicy(FsyncPolicy::Interval, interval);
+        else setFsyncPolicy(FsyncPolicy::Never, interval);
+    }
+
+    if (auto file = config.getString("LOG_FILE")) {
+        return open(*file);
+    }
+    return true;
+}
+
+void Logger::setFsyncPolicy(FsyncPolicy policy, int intervalMs) {
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    m_fsyncPolicy = policy;
+    m_fsyncIntervalMs = std::max(1, intervalMs);
+}
+
+bool Logger::open(const std::string& path) {
+    fs::path logPath(path);
+    std::error_code ec;
+    if (logPath.has_parent_path()) {
+        fs::create_directories(logPath.parent_path(), ec);
+    }
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Anything already queued belongs to the old file.
+    flush();
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+    m_fd = fd;
+    return true;
+}
+
+void Logger::log(LogLevel level, std::string_view component, std::string_view message) {
+    if (!enabled(level)) {
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+    uint64_t pos = m_head.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &m_slots[pos & (kCapacity - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring is full: make sure the writer is awake and give it time to catch up.
+            m_wake.notify_one();
+            std::this_thread::yield();
+            pos = m_head.load(std::memory_order_relaxed);
+        } else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    // The slot's strings keep their capacity, so steady-state logging does not allocate.
+    slot->level = level;
+    slot->time = ts.tv_sec;
+    slot->component.assign(component);
+    slot->message.assign(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (m_writerWaiting.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+}
+
+void Logger::flush() {
+    uint64_t target = m_head.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_one();
+    m_flushed.wait(lock, [this, target] { return m_written.load(std::memory_order_acquire) >= target; });
+}
+
+const std::string& Logger::timestamp(int64_t seconds) {
+    if (seconds != m_cachedSecond) {
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        char buffer[64];
+        // Same layout as ctime(), without the trailing newline.
+        size_t len = strftime(buffer, sizeof(buffer), "%a %b %e %H:%M:%S %Y", &tm);
+        m_cachedTimestamp.assign(buffer, len);
+        m_cachedSecond = seconds;
+    }
+    return m_cachedTimestamp;
+}
+
+void Logger::writeOut(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        offset += static_cast<size_t>(n);
+    }
+}
+
+size_t Logger::drainBatch() {
+    m_fileBuffer.clear();
+    m_stdoutBuffer.clear();
+    m_stderrBuffer.clear();
+    bool console = m_console.load(std::memory_order_relaxed);
+
+    size_t count = 0;
+    // Bound the batch so a steady stream of producers cannot postpone the write indefinitely.
+    while (count < kCapacity) {
+        Slot& slot = m_slots[m_tail & (kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+            break;
+        }
+
+        m_fileBuffer += '[';
+        m_fileBuffer += timestamp(slot.time);
+        m_fileBuffer += "] [";
+        m_fileBuffer += slot.component;
+        m_fileBuffer += "] ";
+        m_fileBuffer += file_prefix(slot.level);
+        m_fileBuffer += slot.message;
+        m_fileBuffer += '\n';
+
+        if (console) {
+            std::string& out = slot.level >= LogLevel::Warn ? m_stderrBuffer : m_stdoutBuffer;
+            out += console_prefix(slot.level);
+            out += slot.message;
+            out += '\n';
+        }
+
+        slot.sequence.store(m_tail + kCapacity, std::memory_order_release);
+        ++m_tail;
+        ++count;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        if (m_fd >= 0) {
+            writeOut(m_fd, m_fileBuffer);
+            int64_t now = now_ms();
+            if (m_fsyncPolicy == FsyncPolicy::Batch ||
+                (m_fsyncPolicy == FsyncPolicy::Interval && now - m_lastFsyncMs >= m_fsyncIntervalMs)) {
+                fdatasync(m_fd);
+                m_lastFsyncMs = now;
+            }
+        }
+    }
+    if (!m_stdoutBuffer.empty()) writeOut(STDOUT_FILENO, m_stdoutBuffer);
+    if (!m_stderrBuffer.empty()) writeOut(STDERR_FILENO, m_stderrBuffer);
+
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_written.store(m_tail, std::memory_order_release);
+    }
+    m_flushed.notify_all();
+    return count;
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        if (drainBatch() > 0) {
+            continue;
+        }
+        if (m_stopping.load(std::memory_order_acquire)) {
+            // Producers may still be publishing slots they claimed; drain until the ring is settled.
+            if (m_written.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire)) {
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_writerWaiting.store(true, std::memory_order_seq_cst);
+        // Re-check after announcing we are about to sleep, so a message
+        // published in between is not left waiting for the timeout.
+        Slot& next = m_slots[m_tail & (kCapacity - 1)];
+        if (next.sequence.load(std::memory_order_seq_cst) != m_tail + 1 && !m_stopping.load()) {
+            m_wake.wait_for(lock, kIdleWait);
+        }
+        m_writerWaiting.store(false, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef PRISMQUANTA_LOGGER_H
+#define PRISMQUANTA_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+class Config;
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3
+};
+
+/**
+ * @brief Process-wide asynchronous logger shared by all QuantaPorto binaries.
+ *
+ * Producers copy each message into a slot of a bounded, lock-free MPSC ring
+ * and return immediately. A background writer drains the ring in batches,
+ * formats the timestamp once per second, and issues a single write(2) per
+ * batch and destination, so logging never does file I/O or flushes on the
+ * caller's thread. When the ring is full, producers wait for space rather
+ * than drop messages.
+ *
+ * Log file lines keep the existing format, "[<ctime>] [<Component>] message";
+ * warnings, errors and debug messages carry a level prefix. Console output
+ * (optional) keeps the daemon's "Info: ..." / "Error: ..." style, with info
+ * and debug going to stdout and warnings and errors to stderr.
+ */
+class Logger {
+public:
+    enum class FsyncPolicy {
+        Never,    ///< Leave durability to the kernel.
+        Interval, ///< fsync at most once per LOG_FSYNC_INTERVAL_MS.
+        Batch     ///< fsync after every batch written.
+    };
+
+    static Logger& instance();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * @brief Applies LOG_FILE, LOG_LEVEL, LOG_FSYNC and LOG_FSYNC_INTERVAL_MS from the configuration.
+     * @return False if the log file could not be opened.
+     */
+    bool configure(const Config& config);
+
+    /**
+     * @brief Opens (or switches to) a log file in append mode, creating its directory if needed.
+     * @return False if the file could not be opened; console output is unaffected.
+     */
+    bool open(const std::string& path);
+
+    void setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return m_level.load(std::memory_order_relaxed); }
+    void setConsole(bool enabled) { m_console.store(enabled, std::memory_order_relaxed); }
+    void setFsyncPolicy(FsyncPolicy policy, int intervalMs = 1000);
+
+    /** @brief True if a message at this level would be recorded; check before building expensive messages. */
+    bool enabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    void log(LogLevel level, std::string_view component, std::string_view message);
+
+    void debug(std::string_view component, std::string_view message) { log(LogLevel::Debug, component, message); }
+    void info(std::string_view component, std::string_view message) { log(LogLevel::Info, component, message); }
+    void warn(std::string_view component, std::string_view message) { log(LogLevel::Warn, component, message); }
+    void error(std::string_view component, std::string_view message) { log(LogLevel::Error, component, message); }
+
+    /**
+     * @brief Blocks until every message logged before the call has been written.
+     */
+    void flush();
+
+    /**
+     * @brief Parses DEBUG, INFO, WARN/WARNING or ERROR (case-insensitive).
+     */
+    static std::optional<LogLevel> parseLevel(std::string_view name);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        LogLevel level = LogLevel::Info;
+        int64_t time = 0;
+        std::string component;
+        std::string message;
+    };
+
+    static constexpr size_t kCapacity = 4096; // Must be a power of two.
+
+    Logger();
+    ~Logger();
+
+    void writerLoop();
+    size_t drainBatch();
+    void writeOut(int fd, const std::string& data);
+    const std::string& timestamp(int64_t seconds);
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_head{0};
+    uint64_t m_tail = 0;
+    std::atomic<uint64_t> m_written{0};
+
+    std::atomic<LogLevel> m_level{LogLevel::Info};
+    std::atomic<bool> m_console{false};
+    std::atomic<bool> m_stopping{false};
+    std::atomic<bool> m_writerWaiting{false};
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+
+    // Held by the writer while it writes, and by open() while it swaps files.
+    std::mutex m_fileMutex;
+    int m_fd = -1;
+    FsyncPolicy m_fsyncPolicy = FsyncPolicy::Never;
+    int m_fsyncIntervalMs = 1000;
+    int64_t m_lastFsyncMs = 0;
+
+    // Writer-thread state.
+    int64_t m_cachedSecond = -1;
+    std::string m_cachedTimestamp;
+    std::string m_fileBuffer;
+    std::string m_stdoutBuffer;
+    std::string m_stderrBuffer;
+
+    std::thread m_writer;
+};
+
+#endif //PRISMQUANTA_LOGGER_H
@@ -0,0 +1,58 @@
+#ifndef PRISMQUANTA_MAPPED_FILE_H
+#define PRISMQUANTA_MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/**
+ * @brief Read-only, RAII memory mapping of a whole file.
+ *
+ * The mapping is private and read-only, so views handed out by data()/view()
+ * stay valid until the MappedFile is closed, moved from or destroyed.
+ */
+class MappedFile {
+public:
+    /** @brief How the mapping will be read, passed on to the kernel as a readahead hint. */
+    enum class Access {
+        Sequential, ///< Front to back: read ahead aggressively.
+        Random      ///< Only parts of the file: read what is touched, see prefetch().
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Maps the given file into memory, replacing any current mapping.
+     * @param path The path of the file to map.
+     * @return True if the file was opened and mapped (an empty file maps to an empty view), false otherwise.
+     */
+    bool open(const std::string& path, Access access = Access::Sequential);
+
+    /**
+     * @brief Asks the kernel to start reading a range of the file in now (MADV_WILLNEED).
+     */
+    void prefetch(size_t offset, size_t length) const;
+
+    /**
+     * @brief Releases the mapping. Safe to call on an unmapped object.
+     */
+    void close();
+
+    bool isOpen() const { return m_open; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_open = false;
+};
+
+#endif //PRISMQUANTA_MAPPED_FILE_H
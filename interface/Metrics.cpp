@@ -0,0 +1,229 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+    constexpr size_t kStages = static_cast<size_t>(Stage::Count);
+    constexpr size_t kCounters = static_cast<size_t>(Counter::Count);
+
+    // Shards have a single writer, so a plain load and store is enough and avoids a locked instruction.
+    inline void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // Histogram bounds exported as Prometheus buckets, in seconds (1-2.5-5 steps).
+    constexpr double kBucketBounds[] = {
+        1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2,
+        0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500,
+    };
+    constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    const char* const kStageNames[] = {"claim", "parse", "prompt", "inference", "rule_check", "action_script", "task"};
+    static_assert(sizeof(kStageNames) / sizeof(kStageNames[0]) == kStages, "a name per stage");
+
+    struct CounterInfo {
+        const char* name;
+        const char* help;
+    };
+    const CounterInfo kCounterInfo[] = {
+        {"tasks_claimed", "Queue files claimed from the pending queue."},
+        {"tasks_completed", "Tasks whose action script was generated."},
+        {"tasks_failed", "Tasks moved to the failed queue."},
+        {"retries", "Generations after a task's first attempt."},
+        {"cache_hits", "Responses served from the response cache."},
+        {"cache_misses", "Prompts not found in the response cache."},
+        {"inference_errors", "Generations that failed on the LLM server."},
+    };
+    static_assert(sizeof(kCounterInfo) / sizeof(kCounterInfo[0]) == kCounters, "an entry per counter");
+
+    void append_format(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void append_format(std::string& out, const char* format, ...) {
+        char buffer[512];
+        va_list args;
+        va_start(args, format);
+        int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length > 0) {
+            out.append(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+        }
+    }
+} // namespace
+
+struct Metrics::Shard {
+    std::array<std::array<std::atomic<uint64_t>, HistogramSnapshot::kBuckets>, kStages> buckets{};
+    std::array<std::atomic<uint64_t>, kStages> sums{};
+    std::array<std::atomic<uint64_t>, kCounters> counters{};
+};
+
+// --- HistogramSnapshot ---
+
+size_t HistogramSnapshot::bucketFor(uint64_t ns) {
+    constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    if (ns < kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    if (exponent > kMaxExponent) {
+        return kBuckets - 1;
+    }
+    uint64_t sub = (ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>((exponent - kSubBucketBits + 1) * kSubBuckets + sub);
+}
+
+uint64_t HistogramSnapshot::bucketUpperBound(size_t bucket) {
+    constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    int exponent = static_cast<int>(bucket / kSubBuckets) + kSubBucketBits - 1;
+    uint64_t sub = bucket % kSubBuckets;
+    uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+    return ((kSubBuckets + sub) << (exponent - kSubBucketBits)) + width - 1;
+}
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(kBuckets - 1);
+}
+
+uint64_t HistogramSnapshot::countAtOrBelow(uint64_t ns) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets && bucketUpperBound(i) <= ns; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+// --- Metrics ---
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() : m_started(std::chrono::steady_clock::now()) {}
+
+Metrics::~Metrics() = default;
+
+Metrics::Shard& Metrics::local() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        auto created = std::make_unique<Shard>();
+        shard = created.get();
+        std::lock_guard<std::mutex> lock(m_shardsMutex);
+        m_shards.push_back(std::move(created));
+    }
+    return *shard;
+}
+
+void Metrics::record(Stage stage, std::chrono::nanoseconds duration) {
+    Shard& shard = local();
+    size_t index = static_cast<size_t>(stage);
+    uint64_t ns = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+    bump(shard.buckets[index][HistogramSnapshot::bucketFor(ns)], 1);
+    bump(shard.sums[index], ns);
+}
+
+void Metrics::add(Counter counter, uint64_t amount) {
+    bump(local().counters[static_cast<size_t>(counter)], amount);
+}
+
+HistogramSnapshot Metrics::histogram(Stage stage) const {
+    HistogramSnapshot snapshot;
+    size_t index = static_cast<size_t>(stage);
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    for (const auto& shard : m_shards) {
+        for (size_t i = 0; i < HistogramSnapshot::kBuckets; ++i) {
+            snapshot.counts[i] += shard->buckets[index][i].load(std::memory_order_relaxed);
+        }
+        snapshot.sumNs += shard->sums[index].load(std::memory_order_relaxed);
+    }
+    // Counted from the buckets, so count and buckets agree even while workers record.
+    for (uint64_t bucket : snapshot.counts) {
+        snapshot.count += bucket;
+    }
+    return snapshot;
+}
+
+uint64_t Metrics::counter(Counter counter) const {
+    uint64_t total = 0;
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    for (const auto& shard : m_shards) {
+        total += shard->counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+const char* Metrics::name(Stage stage) {
+    return kStageNames[static_cast<size_t>(stage)];
+}
+
+const char* Metrics::name(Counter counter) {
+    return kCounterInfo[static_cast<size_t>(counter)].name;
+}
+
+std::string Metrics::prometheus() const {
+    std::string out;
+    out.reserve(16384);
+
+    std::vector<HistogramSnapshot> histograms;
+    histograms.reserve(kStages);
+    for (size_t stage = 0; stage < kStages; ++stage) {
+        histograms.push_back(histogram(static_cast<Stage>(stage)));
+    }
+
+    out.append("# HELP pq_stage_duration_seconds Time spent in each stage of the task pipeline.\n"
+               "# TYPE pq_stage_duration_seconds histogram\n");
+    for (size_t stage = 0; stage < kStages; ++stage) {
+        const HistogramSnapshot& h = histograms[stage];
+        for (double bound : kBucketBounds) {
+            append_format(out, "pq_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n", kStageNames[stage],
+                          bound, static_cast<unsigned long long>(h.countAtOrBelow(static_cast<uint64_t>(bound * 1e9))));
+        }
+        append_format(out, "pq_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n", kStageNames[stage],
+                      static_cast<unsigned long long>(h.count));
+        append_format(out, "pq_stage_duration_seconds_sum{stage=\"%s\"} %.9g\n", kStageNames[stage],
+                      static_cast<double>(h.sumNs) / 1e9);
+        append_format(out, "pq_stage_duration_seconds_count{stage=\"%s\"} %llu\n", kStageNames[stage],
+                      static_cast<unsigned long long>(h.count));
+    }
+
+    out.append("# HELP pq_stage_latency_seconds Stage latency quantiles, from the full-resolution histograms.\n"
+               "# TYPE pq_stage_latency_seconds gauge\n");
+    for (size_t stage = 0; stage < kStages; ++stage) {
+        for (double q : kQuantiles) {
+            append_format(out, "pq_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.9g\n", kStageNames[stage], q,
+                          static_cast<double>(histograms[stage].quantile(q)) / 1e9);
+        }
+    }
+
+    for (size_t i = 0; i < kCounters; ++i) {
+        const CounterInfo& info = kCounterInfo[i];
+        append_format(out, "# HELP pq_%s_total %s\n# TYPE pq_%s_total counter\npq_%s_total %llu\n", info.name,
+                      info.help, info.name, info.name,
+                      static_cast<unsigned long long>(counter(static_cast<Counter>(i))));
+    }
+
+    append_format(out, "# HELP pq_queue_depth Queue files waiting to be dispatched.\n"
+                       "# TYPE pq_queue_depth gauge\npq_queue_depth %lld\n",
+                  static_cast<long long>(gauge(Gauge::QueueDepth)));
+    append_format(out, "# HELP pq_workers_busy Tasks handed to the workers and not yet finished.\n"
+                       "# TYPE pq_workers_busy gauge\npq_workers_busy %lld\n",
+                  static_cast<long long>(gauge(Gauge::WorkersBusy)));
+    append_format(out, "# HELP pq_uptime_seconds Time since the process started recording metrics.\n"
+                       "# TYPE pq_uptime_seconds gauge\npq_uptime_seconds %.3f\n",
+                  std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count());
+    return out;
+}
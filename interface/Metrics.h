@@ -0,0 +1,142 @@
+#ifndef PRISMQUANTA_METRICS_H
+#define PRISMQUANTA_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** @brief The pipeline stages the daemon times. */
+enum class Stage : uint8_t {
+    Claim,         ///< Renaming a pending file into the in-progress queue.
+    Parse,         ///< Reading the claimed queue file.
+    Prompt,        ///< Building the prompt.
+    Inference,     ///< One generation on the LLM server (per attempt).
+    RuleCheck,     ///< Ethics/bias checks and rules.xml on one response.
+    ActionScript,  ///< Writing the action script.
+    Task,          ///< A whole task, from claim to its last stage.
+    Count
+};
+
+enum class Counter : uint8_t {
+    TasksClaimed,
+    TasksCompleted,
+    TasksFailed,
+    Retries,          ///< Attempts after a task's first.
+    CacheHits,
+    CacheMisses,
+    InferenceErrors,
+    Count
+};
+
+enum class Gauge : uint8_t {
+    QueueDepth,   ///< Files waiting to be dispatched.
+    WorkersBusy,  ///< Tasks handed to the worker pool and not yet finished.
+    Count
+};
+
+/**
+ * @brief A point-in-time copy of one stage's latency histogram, merged over all threads.
+ *
+ * Buckets are HDR-style: exact below 16 ns, then 16 linear sub-buckets per
+ * power of two, so any recorded value is known to within 1/16 (6.25%) of
+ * itself, from nanoseconds up to about 4.9 hours (larger values are
+ * clamped into the last bucket).
+ */
+struct HistogramSnapshot {
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kMaxExponent = 44;
+    static constexpr size_t kBuckets = (kMaxExponent - kSubBucketBits + 2) << kSubBucketBits;
+
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t count = 0;
+    uint64_t sumNs = 0;
+
+    static size_t bucketFor(uint64_t ns);
+    /** @brief The largest value, in nanoseconds, that falls into @p bucket. */
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    /** @brief The value at quantile @p q (0..1), in nanoseconds; 0 if nothing was recorded. */
+    uint64_t quantile(double q) const;
+    /** @brief How many values were at most @p ns, to the histogram's precision. */
+    uint64_t countAtOrBelow(uint64_t ns) const;
+};
+
+/**
+ * @brief Process-wide latency histograms, counters and gauges for the daemon pipeline.
+ *
+ * Built to stay on permanently: every thread records into its own shard,
+ * so record() and add(Counter) are a thread-local lookup and a few relaxed
+ * load/store pairs, with no locks, no read-modify-write instructions and no
+ * cache lines shared between workers. Readers (the exporter) merge the
+ * shards when asked; a shard outlives its thread, so nothing recorded is
+ * lost when a worker exits. Gauges are single process-wide atomics.
+ */
+class Metrics {
+public:
+    static Metrics& instance();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void record(Stage stage, std::chrono::nanoseconds duration);
+    void add(Counter counter, uint64_t amount = 1);
+    void set(Gauge gauge, int64_t value) { m_gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed); }
+    void add(Gauge gauge, int64_t delta) { m_gauges[static_cast<size_t>(gauge)].fetch_add(delta, std::memory_order_relaxed); }
+
+    HistogramSnapshot histogram(Stage stage) const;
+    uint64_t counter(Counter counter) const;
+    int64_t gauge(Gauge gauge) const { return m_gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed); }
+
+    /** @brief Everything, in the Prometheus text exposition format (version 0.0.4). */
+    std::string prometheus() const;
+
+    static const char* name(Stage stage);
+    static const char* name(Counter counter);
+
+private:
+    struct Shard;
+
+    Metrics();
+    ~Metrics();
+    Shard& local();
+
+    std::chrono::steady_clock::time_point m_started;
+    mutable std::mutex m_shardsMutex;  // Guards the list only; shards are written without it.
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::array<std::atomic<int64_t>, static_cast<size_t>(Gauge::Count)> m_gauges{};
+};
+
+/**
+ * @brief Records the time from construction to stop() (or destruction) against a stage.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+    ~StageTimer() { stop(); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    /** @brief Records now; later calls do nothing. */
+    void stop() {
+        if (m_running) {
+            m_running = false;
+            Metrics::instance().record(m_stage, std::chrono::steady_clock::now() - m_start);
+        }
+    }
+
+    /** @brief Records nothing, e.g. for work that turned out not to be this process's. */
+    void cancel() { m_running = false; }
+
+private:
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_running = true;
+};
+
+#endif //PRISMQUANTA_METRICS_H
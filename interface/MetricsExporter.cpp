@@ -0,0 +1,235 @@
+#include "MetricsExporter.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // A scraper has this long to send its request.
+    constexpr int kRequestTimeoutSec = 2;
+
+    bool write_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    int listen_unix(const std::string& path, std::string& error) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            error = "socket path too long";
+            return -1;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        std::error_code dir_error;
+        if (fs::path(path).has_parent_path()) {
+            fs::create_directories(fs::path(path).parent_path(), dir_error);
+        }
+        ::unlink(path.c_str());  // Left over from a daemon that did not exit cleanly.
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::chmod(path.c_str(), 0600) != 0 || ::listen(fd, 16) != 0) {
+            error = std::strerror(errno);
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int listen_tcp(const std::string& spec, std::string& bound, std::string& error) {
+        size_t colon = spec.rfind(':');
+        std::string host = colon == std::string::npos ? "127.0.0.1" : spec.substr(0, colon);
+        std::string port = colon == std::string::npos ? spec : spec.substr(colon + 1);
+        if (host.empty() || host == "localhost") {
+            host = "127.0.0.1";
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        char* end = nullptr;
+        long number = std::strtol(port.c_str(), &end, 10);
+        if (port.empty() || *end != '\0' || number < 0 || number > 65535 ||
+            ::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            error = "expected host:port, port or a socket path";
+            return -1;
+        }
+        address.sin_port = htons(static_cast<uint16_t>(number));
+
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        if (fd >= 0) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        socklen_t length = sizeof(address);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(fd, 16) != 0 || ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            error = std::strerror(errno);
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+        bound = host + ":" + std::to_string(ntohs(address.sin_port));
+        return fd;
+    }
+} // namespace
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start(const std::string& listen, const std::string& dumpFile, std::chrono::seconds dumpInterval) {
+    Logger& log = Logger::instance();
+    if (!listen.empty()) {
+        std::string error;
+        if (listen.find('/') != std::string::npos) {
+            m_listenFd = listen_unix(listen, error);
+            m_unixPath = listen;
+            m_address = listen;
+        } else {
+            m_listenFd = listen_tcp(listen, m_address, error);
+        }
+        if (m_listenFd < 0) {
+            log.error("Metrics", "Cannot listen on " + listen + ": " + error);
+            m_unixPath.clear();
+            return false;
+        }
+    }
+    if (m_listenFd < 0 && dumpFile.empty()) {
+        return true;
+    }
+
+    m_dumpFile = dumpFile;
+    m_dumpInterval = std::max(std::chrono::seconds(1), dumpInterval);
+    m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_thread = std::thread([this] { loop(); });
+    if (m_listenFd >= 0) {
+        log.info("Metrics", "Serving Prometheus metrics on " + m_address);
+    }
+    if (!m_dumpFile.empty()) {
+        log.info("Metrics", "Writing metrics to " + m_dumpFile + " every " + std::to_string(m_dumpInterval.count()) + " s");
+    }
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (m_thread.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+        m_thread.join();
+        dump();
+    }
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (!m_unixPath.empty()) {
+        ::unlink(m_unixPath.c_str());
+        m_unixPath.clear();
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+void MetricsExporter::loop() {
+    auto next_dump = std::chrono::steady_clock::now() + m_dumpInterval;
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_dump) {
+            dump();
+            next_dump = now + m_dumpInterval;
+        }
+        int timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next_dump - now).count());
+        pollfd fds[2] = {{m_wakeFd, POLLIN, 0}, {m_listenFd, POLLIN, 0}};
+        int ready = ::poll(fds, m_listenFd >= 0 ? 2 : 1, std::max(timeout, 1));
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+        if (m_listenFd >= 0 && (fds[1].revents & POLLIN)) {
+            int client = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0) {
+                serve(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+void MetricsExporter::serve(int fd) {
+    timeval timeout{kRequestTimeoutSec, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; read up to the end of the headers.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+           request.size() < 8192) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    bool head = request.compare(0, 5, "HEAD ") == 0;
+    if (request.compare(0, 4, "GET ") == 0 || head) {
+        body = Metrics::instance().prometheus();
+    } else {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported.\n";
+    }
+    std::string response = "HTTP/1.1 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (!head) {
+        response += body;
+    }
+    write_all(fd, response);
+}
+
+void MetricsExporter::dump() {
+    if (m_dumpFile.empty()) {
+        return;
+    }
+    std::string text = Metrics::instance().prometheus();
+    std::string temp = m_dumpFile + ".tmp";
+    std::error_code error;
+    if (fs::path(m_dumpFile).has_parent_path()) {
+        fs::create_directories(fs::path(m_dumpFile).parent_path(), error);
+    }
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!out) {
+            Logger::instance().warn("Metrics", "Could not write " + temp);
+            return;
+        }
+    }
+    fs::rename(temp, m_dumpFile, error);
+    if (error) {
+        Logger::instance().warn("Metrics", "Could not replace " + m_dumpFile + ": " + error.message());
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PRISMQUANTA_METRICS_EXPORTER_H
+#define PRISMQUANTA_METRICS_EXPORTER_H
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Publishes Metrics::prometheus() for scraping and to a file.
+ *
+ * One background thread answers HTTP GETs (any path) with the Prometheus
+ * text, and rewrites the dump file every interval by writing a temporary
+ * file and renaming it, so readers never see a partial dump. Scrapes are
+ * rare and small, so connections are served one at a time.
+ */
+class MetricsExporter {
+public:
+    MetricsExporter() = default;
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /**
+     * @param listen "host:port" or "port" for TCP (the host defaults to
+     *        127.0.0.1), or a path for a Unix socket (curl --unix-socket);
+     *        empty to only dump.
+     * @param dumpFile Rewritten every @p dumpInterval and on stop(); empty for none.
+     * @return False if the listener could not be set up; nothing is started then.
+     */
+    bool start(const std::string& listen, const std::string& dumpFile, std::chrono::seconds dumpInterval);
+
+    /** @brief Writes a final dump, stops the thread and closes the listener. */
+    void stop();
+
+    /** @brief The address actually bound, e.g. with the port chosen for "host:0". */
+    const std::string& address() const { return m_address; }
+
+private:
+    void loop();
+    void serve(int fd);
+    void dump();
+
+    std::string m_address;
+    std::string m_unixPath;
+    std::string m_dumpFile;
+    std::chrono::seconds m_dumpInterval{60};
+    int m_listenFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+};
+
+#endif //PRISMQUANTA_METRICS_EXPORTER_H
@@ -0,0 +1,366 @@
+#include "PQLParser.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "PQLStore.h"
+#include "xml_parser.h"
+#include <cctype>
+#include <deque>
+#include <filesystem>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// --- Helper Functions for Parsing ---
+
+static std::string_view trim(std::string_view str) {
+    const std::string_view whitespace = " \t\n\r\f\v";
+    size_t first = str.find_first_not_of(whitespace);
+    if (std::string_view::npos == first) {
+        return {};
+    }
+    size_t last = str.find_last_not_of(whitespace);
+    return str.substr(first, (last - first + 1));
+}
+
+// Splits a depends_on value into ids; they are separated by whitespace (an xs:list), commas are tolerated.
+static void split_ids(std::string_view value, std::vector<std::string_view>& ids) {
+    const std::string_view separators = " \t\n\r,";
+    size_t pos = value.find_first_not_of(separators);
+    while (pos != std::string_view::npos) {
+        size_t end = value.find_first_of(separators, pos);
+        ids.push_back(value.substr(pos, end == std::string_view::npos ? end : end - pos));
+        pos = value.find_first_not_of(separators, end);
+    }
+}
+
+// Appends one piece of element text to a task field. The first piece is kept
+// as a view into the source; entity-decoded or fragmented text goes to scratch.
+static void append_text_piece(std::string_view& field, std::string_view raw, bool cdata,
+                              const std::function<std::string&()>& scratch) {
+    bool needs_decode = !cdata && raw.find('&') != std::string_view::npos;
+    if (field.empty() && !needs_decode) {
+        field = raw;
+        return;
+    }
+    std::string& buffer = scratch();
+    buffer.append(field);
+    if (needs_decode) {
+        QuantaPorto::XmlReader::appendDecoded(raw, buffer);
+    } else {
+        buffer.append(raw);
+    }
+    field = buffer;
+}
+
+// True for an xs:dateTime such as 2025-01-31T12:00:00, 2025-01-31T12:00:00.5Z or ...+02:00.
+static bool is_date_time(std::string_view value) {
+    auto digits = [&](size_t at, size_t count) {
+        if (at + count > value.size()) return false;
+        for (size_t i = at; i < at + count; ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(value[i]))) return false;
+        }
+        return true;
+    };
+    if (!digits(0, 4) || value.size() < 19 || value[4] != '-' || !digits(5, 2) || value[7] != '-' || !digits(8, 2) ||
+        value[10] != 'T' || !digits(11, 2) || value[13] != ':' || !digits(14, 2) || value[16] != ':' || !digits(17, 2)) {
+        return false;
+    }
+    size_t pos = 19;
+    if (pos < value.size() && value[pos] == '.') {
+        size_t start = ++pos;
+        while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) ++pos;
+        if (pos == start) return false;
+    }
+    std::string_view zone = value.substr(pos);
+    return zone.empty() || zone == "Z" ||
+           (zone.size() == 6 && (zone[0] == '+' || zone[0] == '-') && digits(pos + 1, 2) && zone[3] == ':' && digits(pos + 4, 2));
+}
+
+// --- PQL Task ---
+
+PQLTask::PQLTask(const PQLTaskView& view)
+    : id(view.id),
+      type(view.type),
+      priority(view.priority),
+      status(view.status),
+      created(view.created),
+      description(view.description),
+      commands(view.commands.begin(), view.commands.end()),
+      criteria(view.criteria.begin(), view.criteria.end()),
+      notes(view.notes),
+      dependsOn(view.dependsOn.begin(), view.dependsOn.end()) {}
+
+// --- PQL Parser ---
+
+std::vector<PQLTask> PQLParser::parse(const std::string& filename) {
+    std::vector<PQLTask> tasks;
+    // An unreadable file yields no tasks; the scheduler handles the error.
+    parse(filename, [&tasks](const PQLTaskView& view) {
+        tasks.emplace_back(view);
+        return true;
+    });
+    return tasks;
+}
+
+bool PQLParser::parse(const std::string& filename, const TaskCallback& on_task) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+    if (PQLStore::isStore(file.view())) {
+        PQLStore store;
+        if (!store.open(filename)) {
+            Logger::instance().error("PQLParser", store.error());
+            return false;
+        }
+        PQLTaskView task;
+        for (size_t i = 0; i < store.size(); ++i) {
+            if (store.task(i, task) && !on_task(task)) {
+                break;
+            }
+        }
+        return true;
+    }
+    parseBuffer(file.view(), on_task);
+    return true;
+}
+
+std::optional<PQLTask> PQLParser::find(const std::string& filename, std::string_view id) {
+    PQLStore store;
+    PQLTaskView view;
+    if (fs::path(filename).extension() == ".pqlc") {
+        if (store.open(filename) && store.find(id, view)) {
+            return PQLTask(view);
+        }
+        return std::nullopt;
+    }
+
+    std::string store_path = PQLStore::storePathFor(filename);
+    if (!store.open(store_path) || !store.isCurrent(filename)) {
+        std::string error;
+        if (!PQLStore::compile(filename, store_path, &error) || !store.open(store_path)) {
+            Logger::instance().debug("PQLParser", "No compiled store for " + filename + ": " +
+                                     (error.empty() ? store.error() : error));
+            std::optional<PQLTask> found;
+            parse(filename, [&](const PQLTaskView& task) {
+                if (task.id != id) {
+                    return true;
+                }
+                found.emplace(task);
+                return false;
+            });
+            return found;
+        }
+    }
+    if (store.find(id, view)) {
+        return PQLTask(view);
+    }
+    return std::nullopt;
+}
+
+size_t PQLParser::parseBuffer(std::string_view xml, const TaskCallback& on_task, std::string* error) {
+    using QuantaPorto::XmlEvent;
+    using QuantaPorto::XmlReader;
+
+    // One view is reused for every task so its vectors keep their capacity, and
+    // decoded text is backed by a pool of strings recycled at each new task.
+    PQLTaskView task;
+    std::deque<std::string> decoded;
+    size_t decoded_used = 0;
+    const std::function<std::string&()> scratch = [&]() -> std::string& {
+        if (decoded_used == decoded.size()) {
+            decoded.emplace_back();
+        }
+        std::string& buffer = decoded[decoded_used++];
+        buffer.clear();
+        return buffer;
+    };
+
+    size_t count = 0;
+    size_t task_depth = 0;
+    size_t field_depth = 0;
+    std::string_view* field = nullptr;
+
+    XmlReader reader(xml);
+    while (true) {
+        XmlEvent event = reader.next();
+        if (event == XmlEvent::EndDocument) {
+            break;
+        }
+        if (event == XmlEvent::Error) {
+            if (error) {
+                *error = reader.error();
+            } else {
+                Logger::instance().error("PQLParser", "Malformed PQL document: " + reader.error());
+            }
+            break;
+        }
+
+        if (event == XmlEvent::StartElement) {
+            std::string_view name = reader.name();
+            if (task_depth == 0) {
+                if (name != "task") {
+                    continue;
+                }
+                task_depth = reader.depth();
+                decoded_used = 0;
+                task.id = task.type = task.priority = task.status = task.created = {};
+                task.description = task.notes = {};
+                task.commands.clear();
+                task.criteria.clear();
+                task.dependsOn.clear();
+
+                for (const auto& attr : reader.attributes()) {
+                    std::string_view value = {};
+                    append_text_piece(value, attr.value, false, scratch);
+                    if (attr.name == "id") task.id = value;
+                    else if (attr.name == "type") task.type = value;
+                    else if (attr.name == "priority") task.priority = value;
+                    else if (attr.name == "status") task.status = value;
+                    else if (attr.name == "created") task.created = value;
+                    else if (attr.name == "depends_on") split_ids(value, task.dependsOn);
+                }
+                continue;
+            }
+
+            if (field) {
+                continue; // Markup nested inside a field is not part of the schema.
+            }
+            if (name == "description") {
+                field = &task.description;
+            } else if (name == "command") {
+                task.commands.emplace_back();
+                field = &task.commands.back();
+            } else if (name == "criterion") {
+                task.criteria.emplace_back();
+                field = &task.criteria.back();
+            } else if (name == "notes") {
+                field = &task.notes;
+            }
+            if (field) {
+                field_depth = reader.depth();
+            }
+        } else if (event == XmlEvent::Text) {
+            if (field && reader.depth() == field_depth) {
+                append_text_piece(*field, reader.text(), reader.isCData(), scratch);
+            }
+        } else if (event == XmlEvent::EndElement) {
+            if (field && reader.depth() + 1 == field_depth) {
+                *field = trim(*field);
+                field = nullptr;
+            } else if (task_depth != 0 && reader.depth() + 1 == task_depth) {
+                task_depth = 0;
+                ++count;
+                if (!on_task(task)) {
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+bool PQLParser::validate(std::string_view xml, std::vector<std::string>& problems) {
+    using QuantaPorto::XmlElement;
+
+    size_t before = problems.size();
+    QuantaPorto::XmlDocument document;
+    if (!document.parse(xml)) {
+        problems.push_back("not well-formed: " + document.error());
+        return false;
+    }
+    const XmlElement* root = document.root();
+    if (!root || root->name != "tasks") {
+        problems.push_back("root element must be <tasks>");
+        return false;
+    }
+
+    std::unordered_set<std::string_view> ids;
+    std::vector<std::pair<std::string, std::vector<std::string_view>>> dependencies;  // Checked once every id is known.
+    size_t position = 0;
+    for (const XmlElement* task = root->firstChild; task; task = task->nextSibling) {
+        ++position;
+        if (task->name != "task") {
+            problems.push_back("unexpected <" + std::string(task->name) + "> in <tasks>");
+            continue;
+        }
+        std::string_view id = task->attribute("id");
+        std::string where = id.empty() ? "task #" + std::to_string(position) : "task '" + std::string(id) + "'";
+        if (id.empty()) {
+            problems.push_back(where + ": missing id attribute");
+        } else if (!ids.insert(id).second) {
+            problems.push_back(where + ": duplicate id");
+        }
+        if (task->attribute("type").empty()) {
+            problems.push_back(where + ": missing type attribute");
+        }
+        if (std::string_view depends_on = task->attribute("depends_on"); !depends_on.empty()) {
+            dependencies.emplace_back(where, std::vector<std::string_view>());
+            split_ids(depends_on, dependencies.back().second);
+            for (std::string_view dependency : dependencies.back().second) {
+                if (dependency == id) {
+                    problems.push_back(where + ": depends on itself");
+                }
+            }
+        }
+        for (const char* name : {"created", "modified"}) {
+            std::string_view value = task->attribute(name);
+            if (!value.empty() && !is_date_time(value)) {
+                problems.push_back(where + ": " + name + " is not an xs:dateTime: " + std::string(value));
+            }
+        }
+
+        // description, commands, criteria?, notes? -- in that order.
+        static const std::string_view order[] = {"description", "commands", "criteria", "notes"};
+        size_t next = 0;
+        bool has_description = false;
+        bool has_commands = false;
+        for (const XmlElement* field = task->firstChild; field; field = field->nextSibling) {
+            size_t slot = next;
+            while (slot < 4 && order[slot] != field->name) ++slot;
+            if (slot == 4) {
+                bool known = false;
+                for (auto name : order) known = known || name == field->name;
+                problems.push_back(where + ": " + (known ? "misplaced or repeated <" : "unexpected <") +
+                                   std::string(field->name) + ">");
+                continue;
+            }
+            next = slot + 1;
+            has_description = has_description || slot == 0;
+            has_commands = has_commands || slot == 1;
+            std::string_view item = slot == 1 ? "command" : slot == 2 ? "criterion" : "";
+            if (item.empty()) {
+                continue;
+            }
+            size_t items = 0;
+            for (const XmlElement* child = field->firstChild; child; child = child->nextSibling) {
+                if (child->name == item) {
+                    ++items;
+                } else {
+                    problems.push_back(where + ": unexpected <" + std::string(child->name) + "> in <" +
+                                       std::string(field->name) + ">");
+                }
+            }
+            if (items == 0) {
+                problems.push_back(where + ": <" + std::string(field->name) + "> needs at least one <" + std::string(item) + ">");
+            }
+        }
+        if (!has_description) {
+            problems.push_back(where + ": missing <description>");
+        }
+        if (!has_commands) {
+            problems.push_back(where + ": missing <commands>");
+        }
+    }
+    if (position == 0) {
+        problems.push_back("<tasks> contains no <task>");
+    }
+    for (const auto& [where, depends_on] : dependencies) {
+        for (std::string_view dependency : depends_on) {
+            if (!ids.count(dependency)) {
+                problems.push_back(where + ": depends on unknown task '" + std::string(dependency) + "'");
+            }
+        }
+    }
+    return problems.size() == before;
+}
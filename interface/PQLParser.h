@@ -0,0 +1,111 @@
+#ifndef PRISMQUANTA_PQL_PARSER_H
+#define PRISMQUANTA_PQL_PARSER_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Non-owning view of a single task.
+ *
+ * Every field points into the buffer being parsed (usually a memory-mapped
+ * file), so a view is only valid inside the PQLParser callback that produced
+ * it. Convert to a PQLTask to keep a task beyond that point.
+ */
+struct PQLTaskView {
+    std::string_view id;
+    std::string_view type;
+    std::string_view priority;
+    std::string_view status;
+    std::string_view created;
+    std::string_view description;
+    std::vector<std::string_view> commands;
+    std::vector<std::string_view> criteria;
+    std::string_view notes;
+    std::vector<std::string_view> dependsOn;  ///< Ids from the depends_on attribute.
+};
+
+/**
+ * @brief Owning task, safe to keep after the source file has been unmapped.
+ */
+struct PQLTask {
+    PQLTask() = default;
+    explicit PQLTask(const PQLTaskView& view);
+
+    std::string id;
+    std::string type;
+    std::string priority;
+    std::string status;
+    std::string created;
+    std::string description;
+    std::vector<std::string> commands;
+    std::vector<std::string> criteria;
+    std::string notes;
+    std::vector<std::string> dependsOn;
+};
+
+class PQLParser {
+public:
+    /**
+     * @brief Receives each task as it is parsed. Return false to stop parsing early.
+     */
+    using TaskCallback = std::function<bool(const PQLTaskView&)>;
+
+    /**
+     * @brief Parses every task in a file into owning PQLTask objects.
+     * @param filename The PQL file to parse.
+     * @return The parsed tasks, or an empty vector if the file could not be read.
+     */
+    std::vector<PQLTask> parse(const std::string& filename);
+
+    /**
+     * @brief Streams the tasks of a memory-mapped file to a callback, one at a time.
+     *
+     * The views handed to the callback point straight into the mapping; only
+     * text containing entity references is decoded into scratch storage that
+     * is recycled between tasks, as are the command/criteria vectors, so
+     * memory use does not grow with the number of tasks. A compiled store
+     * (see PQLStore) is read directly, without parsing.
+     * @param filename The PQL file, or a .pqlc store, to parse.
+     * @param on_task Called once per task, in document order.
+     * @return False if the file could not be opened or mapped, true otherwise.
+     */
+    bool parse(const std::string& filename, const TaskCallback& on_task);
+
+    /**
+     * @brief Returns the task with the given id, in O(1) once the file has been compiled.
+     *
+     * Looks the id up in the PQLStore next to @p filename (tasks.xml ->
+     * tasks.pqlc), compiling it first if it is missing or older than the
+     * file. If the store cannot be written, the file is parsed up to the
+     * task instead. @p filename may also name a store directly.
+     */
+    std::optional<PQLTask> find(const std::string& filename, std::string_view id);
+
+    /**
+     * @brief Checks a PQL document against the structure rules/pql.xsd declares.
+     *
+     * Covers well-formedness, the <tasks>/<task> layout and element order,
+     * required id/type attributes, xs:dateTime created/modified values, at
+     * least one command per task, unique task ids, and depends_on naming
+     * other tasks of the document. Cycles are left to TaskGraph.
+     * @param problems Receives one message per problem found.
+     * @return True if the document is valid.
+     */
+    static bool validate(std::string_view xml, std::vector<std::string>& problems);
+
+    /**
+     * @brief Streams the tasks found in an in-memory buffer to a callback.
+     *
+     * Parsing stops at the first malformed construct; the tasks before it
+     * have been delivered.
+     * @param error If given, receives the reason a malformed document was
+     *        cut short (and nothing is logged); left empty otherwise.
+     * @return The number of tasks delivered to the callback.
+     */
+    size_t parseBuffer(std::string_view xml, const TaskCallback& on_task, std::string* error = nullptr);
+};
+
+#endif //PRISMQUANTA_PQL_PARSER_H
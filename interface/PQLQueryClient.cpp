@@ -0,0 +1,72 @@
+#include "PQLQueryClient.h"
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    bool send_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+} // namespace
+
+PQLQueryClient::Status PQLQueryClient::query(const std::string& socketPath, std::string_view request,
+                                             std::string& payload) {
+    payload.clear();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        payload = "invalid query socket path '" + socketPath + "'";
+        return Status::Unavailable;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        payload = "cannot connect to " + socketPath + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return Status::Unavailable;
+    }
+
+    std::string line(request);
+    line.push_back('\n');
+    std::string reply;
+    bool sent = send_all(fd, line);
+    ::shutdown(fd, SHUT_WR);
+
+    // Read until the status line and the payload it announces have arrived.
+    size_t header_end = std::string::npos;
+    size_t expected = 0;
+    char buffer[65536];
+    while (sent) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        reply.append(buffer, static_cast<size_t>(n));
+        if (header_end == std::string::npos && (header_end = reply.find('\n')) != std::string::npos) {
+            size_t space = reply.find(' ');
+            expected = space < header_end ? std::strtoull(reply.c_str() + space + 1, nullptr, 10) : 0;
+        }
+        if (header_end != std::string::npos && reply.size() - header_end - 1 >= expected) {
+            break;
+        }
+    }
+    ::close(fd);
+
+    if (header_end == std::string::npos || reply.size() - header_end - 1 < expected) {
+        payload = "incomplete reply from " + socketPath;
+        return Status::Unavailable;
+    }
+    payload = reply.substr(header_end + 1, expected);
+    return reply.compare(0, 3, "OK ") == 0 ? Status::Ok : Status::Error;
+}
@@ -0,0 +1,27 @@
+#ifndef PRISMQUANTA_PQL_QUERY_CLIENT_H
+#define PRISMQUANTA_PQL_QUERY_CLIENT_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * @brief One round trip to the daemon's PQL query service (see PQLQueryService).
+ *
+ * Wire format: the request is a single line, "<verb>[ <argument>]\n"; the
+ * reply is a status line, "OK <bytes>\n" or "ERR <bytes>\n", followed by
+ * exactly that many bytes of payload (the answer, or the error message).
+ */
+class PQLQueryClient {
+public:
+    enum class Status { Ok, Error, Unavailable };
+
+    /**
+     * @param socketPath The service's Unix socket (PQL_QUERY_SOCKET).
+     * @param request The request line, without the newline.
+     * @param payload Receives the answer, or the service's error message for Status::Error,
+     *                or the reason the service could not be reached for Status::Unavailable.
+     */
+    static Status query(const std::string& socketPath, std::string_view request, std::string& payload);
+};
+
+#endif //PRISMQUANTA_PQL_QUERY_CLIENT_H
@@ -0,0 +1,358 @@
+#include "PQLQueryService.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "WalQueue.h"
+#include "xml_parser.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Longest request line accepted.
+    constexpr size_t kMaxRequest = 4096;
+    // A client has this long to send its request.
+    constexpr int kRequestTimeoutSec = 5;
+
+    std::string reply(bool ok, std::string_view payload) {
+        std::string out = (ok ? "OK " : "ERR ") + std::to_string(payload.size()) + "\n";
+        out.append(payload);
+        return out;
+    }
+
+    bool write_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    void append_lines(std::string& out, const std::vector<std::string_view>& lines) {
+        for (auto line : lines) {
+            out.append(line).append("\n");
+        }
+    }
+
+    // The task as a standalone queue file.
+    std::string task_xml(const PQLTaskView& task) {
+        using QuantaPorto::XmlNode;
+        XmlNode root{"task", "", {}, {}};
+        root.attributes.emplace_back("id", std::string(task.id));
+        const std::pair<const char*, std::string_view> attributes[] = {
+            {"type", task.type}, {"priority", task.priority}, {"status", task.status}, {"created", task.created}};
+        for (const auto& [name, value] : attributes) {
+            if (!value.empty()) {
+                root.attributes.emplace_back(name, std::string(value));
+            }
+        }
+        if (!task.dependsOn.empty()) {
+            std::string depends_on;
+            for (auto dependency : task.dependsOn) {
+                depends_on.append(depends_on.empty() ? "" : " ").append(dependency);
+            }
+            root.attributes.emplace_back("depends_on", std::move(depends_on));
+        }
+        root.children.push_back({"description", std::string(task.description), {}, {}});
+        auto list = [&](const char* name, const char* item, const std::vector<std::string_view>& values) {
+            XmlNode node{name, "", {}, {}};
+            for (auto value : values) {
+                node.children.push_back({item, std::string(value), {}, {}});
+            }
+            root.children.push_back(std::move(node));
+        };
+        list("commands", "command", task.commands);
+        if (!task.criteria.empty()) {
+            list("criteria", "criterion", task.criteria);
+        }
+        if (!task.notes.empty()) {
+            root.children.push_back({"notes", std::string(task.notes), {}, {}});
+        }
+        return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" + QuantaPorto::XmlTool::serialize(root);
+    }
+} // namespace
+
+PQLQueryService::PQLQueryService(const LiveConfig& config, ConfigKey<std::string> tasksFile,
+                                 ConfigKey<std::string> pendingDir)
+    : m_config(config), m_tasksFile(tasksFile), m_pendingDir(pendingDir) {}
+
+PQLQueryService::~PQLQueryService() {
+    stop();
+}
+
+bool PQLQueryService::start(const std::string& socketPath) {
+    Logger& log = Logger::instance();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        log.error("PQLQueryService", "Invalid socket path '" + socketPath + "'.");
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log.error("PQLQueryService", std::string("Cannot create socket: ") + std::strerror(errno));
+        return false;
+    }
+    // A socket file nobody answers on is left over from a daemon that did not exit cleanly.
+    if (fs::exists(socketPath)) {
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            log.warn("PQLQueryService", "Another process is already serving " + socketPath + "; not starting.");
+            ::close(fd);
+            return false;
+        }
+        ::unlink(socketPath.c_str());
+        ::close(fd);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    std::error_code dir_error;
+    if (fs::path(socketPath).has_parent_path()) {
+        fs::create_directories(fs::path(socketPath).parent_path(), dir_error);
+    }
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::chmod(socketPath.c_str(), 0600) != 0 || ::listen(fd, 64) != 0) {
+        log.error("PQLQueryService", "Cannot listen on " + socketPath + ": " + std::strerror(errno));
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    m_listenFd = fd;
+    m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_socketPath = socketPath;
+    m_acceptor = std::thread([this] { acceptLoop(); });
+    log.info("PQLQueryService", "Answering PQL queries on " + socketPath);
+    return true;
+}
+
+void PQLQueryService::stop() {
+    if (m_acceptor.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+        m_acceptor.join();
+        m_connections.waitIdle();
+        ::unlink(m_socketPath.c_str());
+    }
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+void PQLQueryService::acceptLoop() {
+    while (true) {
+        pollfd fds[2] = {{m_wakeFd, POLLIN, 0}, {m_listenFd, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            int client = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0) {
+                m_connections.submit([this, client] {
+                    serve(client);
+                    ::close(client);
+                });
+            }
+        }
+    }
+}
+
+void PQLQueryService::serve(int fd) {
+    timeval timeout{kRequestTimeoutSec, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    size_t newline = std::string::npos;
+    while (newline == std::string::npos && request.size() <= kMaxRequest) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+        newline = request.find('\n');
+    }
+    if (newline == std::string::npos) {
+        if (request.empty() || request.size() > kMaxRequest) {
+            write_all(fd, reply(false, request.empty() ? "empty request" : "request too long"));
+            return;
+        }
+        newline = request.size();  // Accept a final line without its newline.
+    }
+    write_all(fd, handle(std::string_view(request).substr(0, newline)));
+}
+
+std::shared_ptr<const PQLStore> PQLQueryService::store(std::string& error) {
+    std::string source = m_config.current()->get(m_tasksFile);
+    std::lock_guard<std::mutex> lock(m_storeMutex);
+    if (m_store && m_storeSource == source && m_store->isCurrent(source)) {
+        return m_store;
+    }
+
+    std::string path = PQLStore::storePathFor(source);
+    auto store = std::make_shared<PQLStore>();
+    if (!store->open(path) || !store->isCurrent(source)) {
+        auto started = std::chrono::steady_clock::now();
+        if (!PQLStore::compile(source, path, &error) || !store->open(path)) {
+            if (error.empty()) error = store->error();
+            return nullptr;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        Logger::instance().info("PQLQueryService", "Compiled " + std::to_string(store->size()) + " tasks from " + source +
+                                " in " + std::to_string(ms.count()) + " ms.");
+    }
+    m_store = std::move(store);
+    m_storeSource = source;
+    return m_store;
+}
+
+std::string PQLQueryService::handle(std::string_view request) {
+    while (!request.empty() && (request.back() == '\r' || request.back() == ' ')) {
+        request.remove_suffix(1);
+    }
+    size_t space = request.find(' ');
+    std::string_view verb = request.substr(0, space);
+    std::string_view argument = space == std::string_view::npos ? std::string_view() : request.substr(space + 1);
+    while (!argument.empty() && argument.front() == ' ') {
+        argument.remove_prefix(1);
+    }
+
+    if (verb == "ping") {
+        return reply(true, "pong\n");
+    }
+
+    // Queue files named by the client, read without the index.
+    if (verb == "file_id" || verb == "file_commands") {
+        if (argument.empty()) {
+            return reply(false, std::string(verb) + " needs a file path");
+        }
+        std::string out;
+        bool found = false;
+        bool readable = PQLParser().parse(std::string(argument), [&](const PQLTaskView& task) {
+            found = true;
+            if (verb == "file_id") {
+                out.append(task.id).append("\n");
+            } else {
+                append_lines(out, task.commands);
+            }
+            return false;
+        });
+        if (!readable || !found) {
+            return reply(false, "no task in " + std::string(argument));
+        }
+        return reply(true, out);
+    }
+
+    if (verb == "validate") {
+        std::string source = m_config.current()->get(m_tasksFile);
+        MappedFile file;
+        if (!file.open(source)) {
+            return reply(false, "cannot read " + source);
+        }
+        std::vector<std::string> problems;
+        if (PQLParser::validate(file.view(), problems)) {
+            return reply(true, source + " is valid.\n");
+        }
+        std::string out = source + " is invalid:\n";
+        for (const auto& problem : problems) {
+            out.append("  ").append(problem).append("\n");
+        }
+        return reply(false, out);
+    }
+
+    bool by_id = verb == "commands" || verb == "criteria" || verb == "enqueue";
+    if (!by_id && verb != "list" && verb != "list_by_status") {
+        return reply(false, "unknown request '" + std::string(verb) +
+                            "'; expected ping, list, list_by_status, commands, criteria, validate, enqueue, "
+                            "file_id or file_commands");
+    }
+    if ((by_id || verb == "list_by_status") && argument.empty()) {
+        return reply(false, std::string(verb) + " needs an argument");
+    }
+
+    std::string error;
+    std::shared_ptr<const PQLStore> tasks = store(error);
+    if (!tasks) {
+        return reply(false, "task index unavailable: " + error);
+    }
+
+    PQLTaskView task;
+    std::string out;
+    if (!by_id) {
+        for (size_t i = 0; i < tasks->size(); ++i) {
+            if (tasks->task(i, task) && (verb == "list" || task.status == argument)) {
+                out.append(task.id).append(": ").append(task.description).append("\n");
+            }
+        }
+        return reply(true, out);
+    }
+
+    if (!tasks->find(argument, task)) {
+        return reply(false, "no task '" + std::string(argument) + "'");
+    }
+    if (verb == "commands") {
+        append_lines(out, task.commands);
+        return reply(true, out);
+    }
+    if (verb == "criteria") {
+        append_lines(out, task.criteria);
+        return reply(true, out);
+    }
+
+    // enqueue: the id becomes the file name, so it must not leave the queue directory.
+    if (argument.find('/') != std::string_view::npos || argument.front() == '.') {
+        return reply(false, "task id '" + std::string(argument) + "' cannot be used as a file name");
+    }
+    std::string xml = task_xml(task);
+    if (m_queue) {
+        std::string name = std::string(argument) + ".xml";
+        if (!m_queue->enqueue(name, xml)) {
+            return reply(false, "cannot add to the task queue log: " + m_queue->error());
+        }
+        Logger::instance().info("PQLQueryService", "Enqueued task " + std::string(argument) + " into the queue log.");
+        return reply(true, name + "\n");
+    }
+    fs::path pending = m_config.current()->get(m_pendingDir);
+    if (pending.empty()) {
+        return reply(false, "QUEUE_PENDING_DIR is not configured");
+    }
+    fs::path target = pending / (std::string(argument) + ".xml");
+    // Staged under a hidden .tmp name, which QueueWatcher ignores, and renamed in when complete.
+    fs::path temp = pending / ("." + std::string(argument) + ".xml.tmp");
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(xml.data(), static_cast<std::streamsize>(xml.size()));
+        if (!file) {
+            return reply(false, "cannot write " + temp.string());
+        }
+    }
+    std::error_code rename_error;
+    fs::rename(temp, target, rename_error);
+    if (rename_error) {
+        fs::remove(temp, rename_error);
+        return reply(false, "cannot enqueue into " + pending.string());
+    }
+    Logger::instance().info("PQLQueryService", "Enqueued task " + std::string(argument) + ": " + target.string());
+    return reply(true, fs::absolute(target).string() + "\n");
+}
@@ -0,0 +1,82 @@
+#ifndef PRISMQUANTA_PQL_QUERY_SERVICE_H
+#define PRISMQUANTA_PQL_QUERY_SERVICE_H
+
+#include "LiveConfig.h"
+#include "PQLStore.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+class WalQueue;
+
+/**
+ * @brief Answers the pipeline scripts' task lookups over a Unix-domain socket.
+ *
+ * Replaces the xmlstarlet fork behind every parse_pql.sh call with one
+ * round trip to the daemon (porto_manager query ... is the client). Each
+ * connection carries one request line and gets one reply; the wire format
+ * is described in PQLQueryClient. Requests, with the same names and
+ * output as parse_pql.sh:
+ * - ping
+ * - list: "<id>: <description>" per task
+ * - list_by_status <status>
+ * - commands <id>, criteria <id>: one per line; ERR if there is no such task
+ * - validate: checks TASKS_XML_FILE against the structure of pql.xsd
+ * - enqueue <id>: writes the task to QUEUE_PENDING_DIR as <id>.xml, or
+ *   commits it straight into the daemon's WalQueue when one is set
+ * - file_id <path>, file_commands <path>: the id or the commands of the
+ *   first task in a queue file, as quantaporto_worker.sh reads them
+ *
+ * Lookups go through the PQLStore compiled from TASKS_XML_FILE, which is
+ * recompiled when the file changes; both paths are read from the live
+ * configuration on every request.
+ */
+class PQLQueryService {
+public:
+    PQLQueryService(const LiveConfig& config, ConfigKey<std::string> tasksFile, ConfigKey<std::string> pendingDir);
+    ~PQLQueryService();
+
+    PQLQueryService(const PQLQueryService&) = delete;
+    PQLQueryService& operator=(const PQLQueryService&) = delete;
+
+    /**
+     * @brief Listens on @p socketPath (mode 0600), replacing a stale socket file.
+     * @return False if the socket cannot be created, or another process is already serving it.
+     */
+    bool start(const std::string& socketPath);
+
+    /** @brief Makes enqueue add tasks to @p queue (named <id>.xml) instead of the pending directory. */
+    void setQueue(WalQueue* queue) { m_queue = queue; }
+
+    /** @brief Stops listening and removes the socket file; waits for connections being served. */
+    void stop();
+
+    /** @brief Answers one request line with a full reply (status line and payload). */
+    std::string handle(std::string_view request);
+
+private:
+    // The index for the current TASKS_XML_FILE, recompiled if the file has changed.
+    std::shared_ptr<const PQLStore> store(std::string& error);
+    void acceptLoop();
+    void serve(int fd);
+
+    const LiveConfig& m_config;
+    ConfigKey<std::string> m_tasksFile;
+    ConfigKey<std::string> m_pendingDir;
+    WalQueue* m_queue = nullptr;
+
+    std::mutex m_storeMutex;
+    std::shared_ptr<const PQLStore> m_store;
+    std::string m_storeSource;
+
+    std::string m_socketPath;
+    int m_listenFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_acceptor;
+    ThreadPool m_connections{2};
+};
+
+#endif //PRISMQUANTA_PQL_QUERY_SERVICE_H
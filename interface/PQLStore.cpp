@@ -0,0 +1,351 @@
+#include "PQLStore.h"
+#include "Hash.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+struct PQLStore::StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct PQLStore::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t taskCount;
+    uint32_t slotCount;         // Power of two, at least twice taskCount.
+    uint32_t refCount;
+    uint32_t reserved;
+    int64_t sourceMtimeNs;
+    uint64_t sourceSize;
+    uint64_t recordsOffset;
+    uint64_t refsOffset;
+    uint64_t indexOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t checksum;          // Hasher::hash64 of every byte after the header.
+};
+
+namespace {
+    constexpr char kMagic[4] = {'P', 'Q', 'L', 'C'};
+
+    struct TaskRecord {
+        PQLStore::StringRef id, type, priority, status, created, description, notes;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+        uint32_t firstCriterion;
+        uint32_t criterionCount;
+        uint32_t firstDependency;
+        uint32_t dependencyCount;
+    };
+    static_assert(sizeof(TaskRecord) == 80, "task record must stay 80 bytes");
+
+    struct IndexSlot {
+        uint32_t hash;    // Low bits of the id's hash.
+        uint32_t record;  // Record number + 1; 0 marks an empty slot.
+    };
+
+    size_t align8(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+    bool stat_source(const std::string& path, int64_t& mtimeNs, uint64_t& size) {
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        mtimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        size = static_cast<uint64_t>(info.st_size);
+        return true;
+    }
+
+    // Builds the string table, storing each distinct string once.
+    class StringTable {
+    public:
+        PQLStore::StringRef add(std::string_view text) {
+            auto it = m_offsets.find(std::string(text));
+            if (it != m_offsets.end()) {
+                return {it->second, static_cast<uint32_t>(text.size())};
+            }
+            uint32_t offset = static_cast<uint32_t>(m_data.size());
+            m_data.append(text);
+            m_offsets.emplace(std::string(text), offset);
+            return {offset, static_cast<uint32_t>(text.size())};
+        }
+
+        const std::string& data() const { return m_data; }
+
+    private:
+        std::string m_data;
+        std::unordered_map<std::string, uint32_t> m_offsets;
+    };
+} // namespace
+
+std::string PQLStore::storePathFor(const std::string& sourcePath) {
+    return fs::path(sourcePath).replace_extension(".pqlc").string();
+}
+
+bool PQLStore::isStore(std::string_view data) {
+    return data.size() >= sizeof(Header) && std::memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+bool PQLStore::compile(const std::string& sourcePath, const std::string& storePath, std::string* error) {
+    auto fail = [&](const std::string& reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    // Stat before reading: a file changed while it is compiled then reads as stale.
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    if (!stat_source(sourcePath, header.sourceMtimeNs, header.sourceSize)) {
+        return fail("cannot stat " + sourcePath + ": " + std::strerror(errno));
+    }
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        return fail("cannot read " + sourcePath + ": " + std::strerror(errno));
+    }
+
+    StringTable strings;
+    std::vector<TaskRecord> records;
+    std::vector<StringRef> commands;
+    std::vector<StringRef> criteria;
+    std::vector<StringRef> dependencies;
+    std::vector<uint64_t> hashes;
+    std::string parse_error;
+    PQLParser().parseBuffer(source.view(), [&](const PQLTaskView& task) {
+        TaskRecord record{};
+        record.id = strings.add(task.id);
+        record.type = strings.add(task.type);
+        record.priority = strings.add(task.priority);
+        record.status = strings.add(task.status);
+        record.created = strings.add(task.created);
+        record.description = strings.add(task.description);
+        record.notes = strings.add(task.notes);
+        record.firstCommand = static_cast<uint32_t>(commands.size());
+        record.commandCount = static_cast<uint32_t>(task.commands.size());
+        for (auto command : task.commands) {
+            commands.push_back(strings.add(command));
+        }
+        record.firstCriterion = static_cast<uint32_t>(criteria.size());
+        record.criterionCount = static_cast<uint32_t>(task.criteria.size());
+        for (auto criterion : task.criteria) {
+            criteria.push_back(strings.add(criterion));
+        }
+        record.firstDependency = static_cast<uint32_t>(dependencies.size());
+        record.dependencyCount = static_cast<uint32_t>(task.dependsOn.size());
+        for (auto dependency : task.dependsOn) {
+            dependencies.push_back(strings.add(dependency));
+        }
+        records.push_back(record);
+        hashes.push_back(Hasher::hash64(task.id));
+        return true;
+    }, &parse_error);
+    // A store of the tasks before the error would pass isCurrent() and hide the rest until the file changed.
+    if (!parse_error.empty()) {
+        return fail(sourcePath + " is malformed: " + parse_error);
+    }
+    if (strings.data().size() > UINT32_MAX) {
+        return fail(sourcePath + " is too large for the store format");
+    }
+
+    // Criteria and then dependencies follow commands in one list section.
+    for (auto& record : records) {
+        record.firstCriterion += static_cast<uint32_t>(commands.size());
+        record.firstDependency += static_cast<uint32_t>(commands.size() + criteria.size());
+    }
+    commands.insert(commands.end(), criteria.begin(), criteria.end());
+    commands.insert(commands.end(), dependencies.begin(), dependencies.end());
+
+    uint32_t slots = 16;
+    while (slots < records.size() * 2) {
+        slots *= 2;
+    }
+    std::vector<IndexSlot> index(slots, IndexSlot{0, 0});
+    for (uint32_t i = 0; i < records.size(); ++i) {
+        size_t slot = hashes[i] & (slots - 1);
+        bool duplicate = false;
+        while (index[slot].record != 0) {
+            const TaskRecord& other = records[index[slot].record - 1];
+            if (index[slot].hash == static_cast<uint32_t>(hashes[i]) && other.id.length == records[i].id.length &&
+                other.id.offset == records[i].id.offset) {
+                duplicate = true;  // Interned strings are equal exactly when their refs are.
+                break;
+            }
+            slot = (slot + 1) & (slots - 1);
+        }
+        if (!duplicate) {
+            index[slot] = {static_cast<uint32_t>(hashes[i]), i + 1};
+        }
+    }
+
+    header.taskCount = static_cast<uint32_t>(records.size());
+    header.slotCount = slots;
+    header.refCount = static_cast<uint32_t>(commands.size());
+    header.recordsOffset = align8(sizeof(Header));
+    header.refsOffset = align8(header.recordsOffset + records.size() * sizeof(TaskRecord));
+    header.indexOffset = align8(header.refsOffset + commands.size() * sizeof(StringRef));
+    header.stringsOffset = align8(header.indexOffset + index.size() * sizeof(IndexSlot));
+    header.stringsSize = strings.data().size();
+
+    std::string image(header.stringsOffset + header.stringsSize, '\0');
+    std::memcpy(&image[header.recordsOffset], records.data(), records.size() * sizeof(TaskRecord));
+    std::memcpy(&image[header.refsOffset], commands.data(), commands.size() * sizeof(StringRef));
+    std::memcpy(&image[header.indexOffset], index.data(), index.size() * sizeof(IndexSlot));
+    std::memcpy(&image[header.stringsOffset], strings.data().data(), strings.data().size());
+    header.checksum = Hasher::hash64(std::string_view(image).substr(sizeof(Header)));
+    std::memcpy(&image[0], &header, sizeof(Header));
+
+    // A unique name per writer: a fixed one let concurrent compiles truncate each other's file mid-write.
+    std::string temp = storePath + ".XXXXXX";
+    int fd = ::mkstemp(temp.data());
+    if (fd < 0) {
+        return fail("cannot create " + temp + ": " + std::strerror(errno));
+    }
+    bool written = ::fchmod(fd, 0644) == 0;
+    for (size_t done = 0; written && done < image.size();) {
+        ssize_t n = ::write(fd, image.data() + done, image.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        written = n > 0;
+        done += written ? static_cast<size_t>(n) : 0;
+    }
+    written = written && ::fsync(fd) == 0;
+    std::string reason = std::strerror(errno);
+    ::close(fd);
+    if (!written) {
+        std::remove(temp.c_str());
+        return fail("cannot write " + temp + ": " + reason);
+    }
+    if (std::rename(temp.c_str(), storePath.c_str()) != 0) {
+        reason = std::strerror(errno);
+        std::remove(temp.c_str());
+        return fail("cannot replace " + storePath + ": " + reason);
+    }
+    return true;
+}
+
+bool PQLStore::open(const std::string& storePath) {
+    close();
+    if (!m_file.open(storePath)) {
+        m_error = "cannot map " + storePath;
+        return false;
+    }
+    if (!isStore(m_file.view())) {
+        m_error = storePath + " is not a compiled PQL store";
+        m_file.close();
+        return false;
+    }
+    const auto* header = reinterpret_cast<const Header*>(m_file.data());
+    size_t size = m_file.size();
+    auto fits = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+    if (header->version != kVersion) {
+        m_error = storePath + " has format version " + std::to_string(header->version) + ", expected " +
+                  std::to_string(kVersion);
+    } else if (header->slotCount == 0 || (header->slotCount & (header->slotCount - 1)) != 0 ||
+               header->slotCount < header->taskCount ||
+               !fits(header->recordsOffset, uint64_t(header->taskCount) * sizeof(TaskRecord)) ||
+               !fits(header->refsOffset, uint64_t(header->refCount) * sizeof(StringRef)) ||
+               !fits(header->indexOffset, uint64_t(header->slotCount) * sizeof(IndexSlot)) ||
+               !fits(header->stringsOffset, header->stringsSize) ||
+               header->recordsOffset % 8 != 0 || header->refsOffset % 8 != 0 || header->indexOffset % 8 != 0) {
+        m_error = storePath + " is truncated or damaged";
+    } else {
+        m_header = header;
+        m_error.clear();
+        return true;
+    }
+    m_file.close();
+    return false;
+}
+
+void PQLStore::close() {
+    m_header = nullptr;
+    m_file.close();
+}
+
+bool PQLStore::isCurrent(const std::string& sourcePath) const {
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    return m_header && stat_source(sourcePath, mtime, size) && mtime == m_header->sourceMtimeNs &&
+           size == m_header->sourceSize;
+}
+
+bool PQLStore::verify() const {
+    return m_header && Hasher::hash64(m_file.view().substr(sizeof(Header))) == m_header->checksum;
+}
+
+size_t PQLStore::size() const {
+    return m_header ? m_header->taskCount : 0;
+}
+
+bool PQLStore::string(const StringRef& ref, std::string_view& out) const {
+    if (uint64_t(ref.offset) + ref.length > m_header->stringsSize) {
+        return false;
+    }
+    out = std::string_view(m_file.data() + m_header->stringsOffset + ref.offset, ref.length);
+    return true;
+}
+
+bool PQLStore::task(size_t index, PQLTaskView& out) const {
+    if (!m_header || index >= m_header->taskCount) {
+        return false;
+    }
+    const auto* record = reinterpret_cast<const TaskRecord*>(m_file.data() + m_header->recordsOffset) + index;
+    const auto* refs = reinterpret_cast<const StringRef*>(m_file.data() + m_header->refsOffset);
+    if (uint64_t(record->firstCommand) + record->commandCount > m_header->refCount ||
+        uint64_t(record->firstCriterion) + record->criterionCount > m_header->refCount ||
+        uint64_t(record->firstDependency) + record->dependencyCount > m_header->refCount) {
+        return false;
+    }
+    bool ok = string(record->id, out.id) && string(record->type, out.type) &&
+              string(record->priority, out.priority) && string(record->status, out.status) &&
+              string(record->created, out.created) && string(record->description, out.description) &&
+              string(record->notes, out.notes);
+    out.commands.resize(record->commandCount);
+    for (uint32_t i = 0; ok && i < record->commandCount; ++i) {
+        ok = string(refs[record->firstCommand + i], out.commands[i]);
+    }
+    out.criteria.resize(record->criterionCount);
+    for (uint32_t i = 0; ok && i < record->criterionCount; ++i) {
+        ok = string(refs[record->firstCriterion + i], out.criteria[i]);
+    }
+    out.dependsOn.resize(record->dependencyCount);
+    for (uint32_t i = 0; ok && i < record->dependencyCount; ++i) {
+        ok = string(refs[record->firstDependency + i], out.dependsOn[i]);
+    }
+    return ok;
+}
+
+bool PQLStore::find(std::string_view id, PQLTaskView& out) const {
+    if (!m_header) {
+        return false;
+    }
+    uint32_t mask = m_header->slotCount - 1;
+    uint32_t hash = static_cast<uint32_t>(Hasher::hash64(id));
+    const auto* index = reinterpret_cast<const IndexSlot*>(m_file.data() + m_header->indexOffset);
+    const auto* records = reinterpret_cast<const TaskRecord*>(m_file.data() + m_header->recordsOffset);
+    // The table is never full, so an empty slot always ends the probe; the bound guards damaged files.
+    for (uint32_t probe = 0, slot = hash & mask; probe <= mask; ++probe, slot = (slot + 1) & mask) {
+        const IndexSlot& entry = index[slot];
+        if (entry.record == 0 || entry.record > m_header->taskCount) {
+            return false;
+        }
+        std::string_view candidate;
+        if (entry.hash == hash && string(records[entry.record - 1].id, candidate) && candidate == id) {
+            return task(entry.record - 1, out);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,80 @@
+#ifndef PRISMQUANTA_PQL_STORE_H
+#define PRISMQUANTA_PQL_STORE_H
+
+#include "MappedFile.h"
+#include "PQLParser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief A PQL task file compiled to a flat binary image (.pqlc) that is read in place through mmap.
+ *
+ * Opening a store validates its header and nothing else, and a task is
+ * found by id with one probe sequence in a hash index, so neither depends
+ * on the number of tasks. Layout (native byte order, sections 8-byte
+ * aligned, offsets from the start of the file):
+ * - header: magic "PQLC", format version, counts, section offsets, the
+ *   source file's mtime and size, and a checksum of everything after it;
+ * - records: one fixed-size record per task, in document order, whose
+ *   fields are (offset, length) references into the string table;
+ * - lists: the references of every task's commands, criteria and dependencies;
+ * - index: an open-addressing table of (id hash, record) pairs;
+ * - strings: each distinct string once.
+ *
+ * Every reference is bounds-checked when it is read, so a damaged file
+ * yields no task rather than a crash; verify() checks the checksum.
+ */
+class PQLStore {
+public:
+    static constexpr uint32_t kVersion = 2;
+
+    /** @brief Where the store compiled from @p sourcePath lives: the same path with a .pqlc extension. */
+    static std::string storePathFor(const std::string& sourcePath);
+
+    /**
+     * @brief Compiles a PQL XML file; the store is written to a temporary file and renamed into place.
+     *
+     * Each call writes and syncs its own temporary file, so processes compiling the same
+     * store at once never see each other's partial output: the last rename wins.
+     * A malformed source fails the compile and leaves any existing store untouched.
+     * @param error Receives the reason on failure.
+     */
+    static bool compile(const std::string& sourcePath, const std::string& storePath, std::string* error = nullptr);
+
+    /** @brief Maps a store and checks its header; false (with error()) if it is not a usable store. */
+    bool open(const std::string& storePath);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+    const std::string& error() const { return m_error; }
+
+    /** @brief True if @p sourcePath has the mtime and size it had when the store was compiled. */
+    bool isCurrent(const std::string& sourcePath) const;
+
+    /** @brief Recomputes the checksum over the whole file. */
+    bool verify() const;
+
+    size_t size() const;
+
+    /** @brief Fills @p out with the task at @p index in document order; the views point into the mapping. */
+    bool task(size_t index, PQLTaskView& out) const;
+
+    /** @brief Finds a task by id; with duplicate ids, the first in document order. */
+    bool find(std::string_view id, PQLTaskView& out) const;
+
+    /** @brief True if the first bytes of @p data are a store's magic. */
+    static bool isStore(std::string_view data);
+
+    struct Header;
+    struct StringRef;
+
+private:
+    // The referenced string, or false if the reference points outside the table.
+    bool string(const StringRef& ref, std::string_view& out) const;
+
+    MappedFile m_file;
+    const Header* m_header = nullptr;
+    std::string m_error;
+};
+
+#endif //PRISMQUANTA_PQL_STORE_H
@@ -0,0 +1,108 @@
+#include "PatternMatcher.h"
+#include <deque>
+
+namespace {
+    uint8_t fold(uint8_t c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+    }
+} // namespace
+
+uint32_t PatternMatcher::add(std::string_view pattern, bool caseSensitive) {
+    m_patterns.push_back(Pattern{std::string(pattern), caseSensitive});
+    m_built = false;
+    return static_cast<uint32_t>(m_patterns.size() - 1);
+}
+
+void PatternMatcher::build() {
+    // --- Byte classes ---
+    m_classOf.fill(0);
+    m_classes = 1;
+    for (const auto& pattern : m_patterns) {
+        for (unsigned char c : pattern.text) {
+            uint8_t folded = fold(c);
+            if (m_classOf[folded] == 0) {
+                m_classOf[folded] = static_cast<uint8_t>(m_classes++);
+            }
+        }
+    }
+    for (int c = 'A'; c <= 'Z'; ++c) {
+        m_classOf[c] = m_classOf[fold(static_cast<uint8_t>(c))];
+    }
+
+    // --- Trie ---
+    const uint32_t classes = m_classes;
+    std::vector<int32_t> children(classes, -1);  // Row per state.
+    std::vector<std::vector<uint32_t>> ends(1);
+    for (uint32_t id = 0; id < m_patterns.size(); ++id) {
+        const std::string& text = m_patterns[id].text;
+        if (text.empty()) {
+            continue;
+        }
+        uint32_t state = 0;
+        for (unsigned char c : text) {
+            uint32_t cls = m_classOf[c];
+            int32_t next = children[state * classes + cls];
+            if (next < 0) {
+                next = static_cast<int32_t>(ends.size());
+                children[state * classes + cls] = next;
+                children.resize(children.size() + classes, -1);
+                ends.emplace_back();
+            }
+            state = static_cast<uint32_t>(next);
+        }
+        ends[state].push_back(id);
+    }
+    const size_t states = ends.size();
+
+    // --- Failure links, breadth first, turning the trie into a full DFA ---
+    std::vector<uint32_t> fail(states, 0);
+    std::vector<uint32_t> delta(states * classes, 0);
+    std::vector<std::vector<uint32_t>> outputs(states);
+    std::deque<uint32_t> queue;
+    for (uint32_t cls = 0; cls < classes; ++cls) {
+        int32_t child = children[cls];
+        if (child >= 0) {
+            delta[cls] = static_cast<uint32_t>(child);
+            queue.push_back(static_cast<uint32_t>(child));
+        }
+    }
+    std::vector<uint32_t> order;
+    order.reserve(states);
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        order.push_back(state);
+        for (uint32_t cls = 0; cls < classes; ++cls) {
+            int32_t child = children[state * classes + cls];
+            if (child >= 0) {
+                fail[child] = delta[fail[state] * classes + cls];
+                delta[state * classes + cls] = static_cast<uint32_t>(child);
+                queue.push_back(static_cast<uint32_t>(child));
+            } else {
+                delta[state * classes + cls] = delta[fail[state] * classes + cls];
+            }
+        }
+    }
+
+    // Each state reports its own patterns, then those of its failure chain (already complete in BFS order).
+    for (uint32_t state : order) {
+        outputs[state] = ends[state];
+        const auto& inherited = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+    }
+
+    m_outputStart.assign(states + 1, 0);
+    m_outputs.clear();
+    for (size_t state = 0; state < states; ++state) {
+        m_outputStart[state] = static_cast<uint32_t>(m_outputs.size());
+        m_outputs.insert(m_outputs.end(), outputs[state].begin(), outputs[state].end());
+    }
+    m_outputStart[states] = static_cast<uint32_t>(m_outputs.size());
+
+    m_table.resize(states * classes);
+    for (size_t i = 0; i < m_table.size(); ++i) {
+        uint32_t next = delta[i];
+        m_table[i] = next * classes | (outputs[next].empty() ? 0 : kOutputFlag);
+    }
+    m_built = true;
+}
@@ -0,0 +1,107 @@
+#ifndef PRISMQUANTA_PATTERN_MATCHER_H
+#define PRISMQUANTA_PATTERN_MATCHER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Multi-literal matcher: an Aho-Corasick automaton compiled to a dense DFA.
+ *
+ * All patterns are found in one left-to-right pass, whatever their number.
+ * Matching is ASCII case-insensitive; patterns added as case-sensitive are
+ * confirmed against the original bytes when the automaton reports them.
+ *
+ * Input bytes are first mapped to equivalence classes (bytes that appear in
+ * no pattern share one class), so the transition table is states x classes
+ * rather than states x 256 and stays cache-resident for a few thousand
+ * pattern bytes. Each transition also carries a flag saying whether the
+ * target state ends a pattern, so the inner loop is one table load per byte.
+ */
+class PatternMatcher {
+public:
+    /**
+     * @brief Adds a pattern and returns its id (ids are assigned 0, 1, 2, ...).
+     * Must be called before build(); empty patterns never match.
+     */
+    uint32_t add(std::string_view pattern, bool caseSensitive = false);
+
+    /** @brief Compiles the automaton. Call once after the last add(). */
+    void build();
+
+    size_t patternCount() const { return m_patterns.size(); }
+    const std::string& pattern(uint32_t id) const { return m_patterns[id].text; }
+
+    /**
+     * @brief Reports every occurrence of every pattern, overlapping ones included.
+     * @param onMatch Called as onMatch(patternId, startOffset) in order of match end.
+     */
+    template <typename Fn>
+    void scan(std::string_view text, Fn&& onMatch) const {
+        uint32_t state = 0;
+        scan(text, 0, state, onMatch);
+    }
+
+    /**
+     * @brief Resumable form for text that arrives in pieces: scans text[from, end)
+     * continuing from @p state, and leaves the state for the next call in it.
+     * Start with state 0. Offsets are relative to @p text, which must hold the
+     * earlier pieces too (case-sensitive matches may begin before @p from).
+     */
+    template <typename Fn>
+    void scan(std::string_view text, size_t from, uint32_t& state, Fn&& onMatch) const;
+
+private:
+    struct Pattern {
+        std::string text;
+        bool caseSensitive;
+    };
+
+    static constexpr uint32_t kOutputFlag = 0x80000000u;
+    static constexpr uint32_t kStateMask = 0x7fffffffu;
+
+    std::vector<Pattern> m_patterns;
+    std::array<uint8_t, 256> m_classOf{};
+    uint32_t m_classes = 1;
+    // Row-major: m_table[state * m_classes + class] = nextState * m_classes, ORed with kOutputFlag.
+    std::vector<uint32_t> m_table;
+    // Patterns ending in each state (following dictionary suffix links), as ranges into m_outputs.
+    std::vector<uint32_t> m_outputStart;
+    std::vector<uint32_t> m_outputs;
+    bool m_built = false;
+};
+
+// --- Template implementation ---
+
+template <typename Fn>
+void PatternMatcher::scan(std::string_view text, size_t from, uint32_t& current, Fn&& onMatch) const {
+    if (!m_built || m_table.empty()) {
+        return;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text.data());
+    const size_t size = text.size();
+    const uint32_t* table = m_table.data();
+    const uint8_t* classOf = m_classOf.data();
+    uint32_t state = current;
+    for (size_t i = from; i < size; ++i) {
+        state = table[(state & kStateMask) + classOf[bytes[i]]];
+        if (state & kOutputFlag) {
+            uint32_t index = (state & kStateMask) / m_classes;
+            for (uint32_t k = m_outputStart[index]; k < m_outputStart[index + 1]; ++k) {
+                uint32_t id = m_outputs[k];
+                const Pattern& pattern = m_patterns[id];
+                size_t start = i + 1 - pattern.text.size();
+                if (pattern.caseSensitive && text.compare(start, pattern.text.size(), pattern.text) != 0) {
+                    continue;
+                }
+                onMatch(id, start);
+            }
+        }
+    }
+    current = state;
+}
+
+#endif //PRISMQUANTA_PATTERN_MATCHER_H
@@ -0,0 +1,447 @@
+#include "ProcessRunner.h"
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+
+extern char** environ;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // How often the loop checks on the child while its pipes are quiet.
+    constexpr int kIdleTickMs = 100;
+
+    constexpr int kForegroundSignals[2] = {SIGINT, SIGQUIT};
+    std::atomic<int> g_foregroundSignal{0};
+
+    void on_foreground_signal(int sig) {
+        g_foregroundSignal.store(sig);
+    }
+
+    std::string resolve_program(const std::string& name) {
+        if (name.find('/') != std::string::npos) {
+            return name;
+        }
+        const char* path = getenv("PATH");
+        std::string_view dirs = path ? path : "/usr/local/bin:/usr/bin:/bin";
+        while (true) {
+            size_t colon = dirs.find(':');
+            std::string dir(dirs.substr(0, colon));
+            std::string candidate = (dir.empty() ? "." : dir) + "/" + name;
+            if (access(candidate.c_str(), X_OK) == 0) {
+                return candidate;
+            }
+            if (colon == std::string_view::npos) {
+                break;
+            }
+            dirs.remove_prefix(colon + 1);
+        }
+        return name;
+    }
+
+    void set_nonblocking(int fd) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    struct Stream {
+        int fd = -1;
+        std::string pending;
+        const ProcessOptions::LineCallback* callback = nullptr;
+
+        void deliver(bool eof) {
+            size_t start = 0;
+            size_t newline;
+            while ((newline = pending.find('\n', start)) != std::string::npos) {
+                if (*callback) {
+                    (*callback)(std::string_view(pending).substr(start, newline - start));
+                }
+                start = newline + 1;
+            }
+            pending.erase(0, start);
+            if (eof && !pending.empty()) {
+                if (*callback) {
+                    (*callback)(pending);
+                }
+                pending.clear();
+            }
+        }
+
+        // Reads everything currently available. Returns false once the pipe hits EOF.
+        bool drain() {
+            char buffer[16 * 1024];
+            while (true) {
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    pending.append(buffer, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                bool eof = n == 0;
+                bool again = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                deliver(eof);
+                return again;
+            }
+        }
+
+        void close() {
+            if (fd >= 0) {
+                deliver(true);
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+} // namespace
+
+ForegroundSignals::ForegroundSignals() {
+    g_foregroundSignal.store(0);
+    struct sigaction action = {};
+    action.sa_handler = on_foreground_signal;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < 2; ++i) {
+        sigaction(kForegroundSignals[i], &action, &m_previous[i]);
+    }
+}
+
+ForegroundSignals::~ForegroundSignals() {
+    for (int i = 0; i < 2; ++i) {
+        sigaction(kForegroundSignals[i], &m_previous[i], nullptr);
+    }
+}
+
+int ForegroundSignals::take() {
+    return g_foregroundSignal.exchange(0);
+}
+
+std::string ProcessResult::describe() const {
+    std::string elapsed = " in " + std::to_string(duration.count()) + " ms";
+    if (!spawned) {
+        return "failed to start: " + error;
+    }
+    if (timedOut) {
+        return "timed out after " + std::to_string(duration.count()) + " ms";
+    }
+    if (signal != 0) {
+        return std::string("killed by signal ") + strsignal(signal) + elapsed;
+    }
+    return "exit code " + std::to_string(exitCode) + elapsed;
+}
+
+std::vector<std::string> ProcessRunner::splitArgs(std::string_view args) {
+    std::vector<std::string> words;
+    std::string current;
+    bool inWord = false;
+    char quote = 0;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        char c = args[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            } else if (c == '\\' && quote == '"' && i + 1 < args.size() &&
+                       (args[i + 1] == '"' || args[i + 1] == '\\')) {
+                current += args[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            inWord = true;
+        } else if (c == '\\' && i + 1 < args.size()) {
+            current += args[++i];
+            inWord = true;
+        } else if (c == ' ' || c == '\t' || c == '\n') {
+            if (inWord) {
+                words.push_back(std::move(current));
+                current.clear();
+                inWord = false;
+            }
+        } else {
+            current += c;
+            inWord = true;
+        }
+    }
+    if (inWord) {
+        words.push_back(std::move(current));
+    }
+    return words;
+}
+
+ProcessResult ProcessRunner::run(const ProcessOptions& options) {
+    ProcessResult result;
+    auto started = Clock::now();
+
+    if (options.argv.empty()) {
+        result.error = "empty argv";
+        return result;
+    }
+
+    // Everything the child needs is prepared before vfork(), which shares our memory.
+    std::string program = resolve_program(options.argv[0]);
+    std::vector<char*> argv;
+    argv.reserve(options.argv.size() + 1);
+    for (const auto& arg : options.argv) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // With stdoutFd set there is no stdout pipe: outPipe[0] stays -1 and outPipe[1] is the descriptor given.
+    int outPipe[2] = {-1, options.stdoutFd}, errPipe[2], execPipe[2];
+    if (options.stdoutFd < 0 && pipe2(outPipe, O_CLOEXEC) != 0) {
+        result.error = std::strerror(errno);
+        return result;
+    }
+    auto closeOut = [&]() {
+        if (options.stdoutFd < 0) {
+            close(outPipe[0]);
+            close(outPipe[1]);
+        }
+    };
+    if (pipe2(errPipe, O_CLOEXEC) != 0) {
+        result.error = std::strerror(errno);
+        closeOut();
+        return result;
+    }
+    if (pipe2(execPipe, O_CLOEXEC) != 0) {
+        result.error = std::strerror(errno);
+        closeOut(); close(errPipe[0]); close(errPipe[1]);
+        return result;
+    }
+
+    // With a timeout (or processGroup) the child leads its own process group, so the whole tree can be stopped.
+    const std::string& workdir = options.workingDirectory;
+    // Caught from before the child exists, so a Ctrl-C while it starts cannot kill us either.
+    std::optional<ForegroundSignals> foregroundSignals;
+    if (options.foreground) {
+        foregroundSignals.emplace();
+    }
+    sigset_t noSignals;
+    sigemptyset(&noSignals);
+
+    pid_t pid = vfork();
+    if (pid == 0) {
+        // Child: only async-signal-safe calls until execve().
+        if (options.ownsGroup()) {
+            setpgid(0, 0);
+        }
+        if (options.foreground) {
+            // Our handlers would run here, in memory shared with the parent, until execve().
+            signal(SIGINT, SIG_DFL);
+            signal(SIGQUIT, SIG_DFL);
+        }
+        // The calling thread may block signals (JobControl's do); the program gets none blocked.
+        sigprocmask(SIG_SETMASK, &noSignals, nullptr);
+        if (options.stdinFd >= 0) {
+            dup2(options.stdinFd, STDIN_FILENO);
+        }
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+
+        struct rlimit limit;
+        if (options.limits.cpuSeconds) {
+            limit.rlim_cur = limit.rlim_max = options.limits.cpuSeconds;
+            setrlimit(RLIMIT_CPU, &limit);
+        }
+        if (options.limits.memoryBytes) {
+            limit.rlim_cur = limit.rlim_max = options.limits.memoryBytes;
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        if (options.limits.openFiles) {
+            limit.rlim_cur = limit.rlim_max = options.limits.openFiles;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+
+        if (workdir.empty() || chdir(workdir.c_str()) == 0) {
+            execve(program.c_str(), argv.data(), environ);
+        }
+        int err = errno;
+        ssize_t ignored = write(execPipe[1], &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    if (options.stdoutFd < 0) {
+        close(outPipe[1]);
+    }
+    close(errPipe[1]);
+    close(execPipe[1]);
+    bool hasDeadline = options.timeout.count() > 0;
+    bool ownGroup = options.ownsGroup();
+
+    if (pid < 0) {
+        result.error = std::strerror(errno);
+        if (outPipe[0] >= 0) close(outPipe[0]);
+        close(errPipe[0]); close(execPipe[0]);
+        return result;
+    }
+
+    // The exec pipe is close-on-exec: EOF means execve() succeeded, data is its errno.
+    int execErrno = 0;
+    ssize_t got;
+    while ((got = read(execPipe[0], &execErrno, sizeof(execErrno))) < 0 && errno == EINTR) {}
+    close(execPipe[0]);
+    if (got > 0) {
+        int status;
+        waitpid(pid, &status, 0);
+        if (outPipe[0] >= 0) close(outPipe[0]);
+        close(errPipe[0]);
+        result.error = program + ": " + std::strerror(execErrno);
+        result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+        return result;
+    }
+    result.spawned = true;
+    if (options.onStart) {
+        options.onStart(pid);
+    }
+
+    Stream streams[2];
+    streams[0].fd = outPipe[0];
+    streams[0].callback = &options.onStdout;
+    streams[1].fd = errPipe[0];
+    streams[1].callback = &options.onStderr;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int open = 0;
+    for (int i = 0; i < 2; ++i) {
+        if (streams[i].fd < 0) {
+            continue;
+        }
+        ++open;
+        set_nonblocking(streams[i].fd);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epfd, EPOLL_CTL_ADD, streams[i].fd, &ev);
+    }
+
+    auto signalChild = [&](int sig) {
+        kill(ownGroup ? -pid : pid, sig);
+    };
+
+    auto deadline = started + options.timeout;
+    Clock::time_point killAt;
+    bool termSent = false;
+    bool killSent = false;
+    bool reaped = false;
+    int status = 0;
+
+    while (open > 0) {
+        int waitMs = kIdleTickMs;
+        auto now = Clock::now();
+        if (hasDeadline && !termSent) {
+            waitMs = std::min<long>(waitMs, std::max<long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()));
+        }
+
+        struct epoll_event events[2];
+        int n = epoll_wait(epfd, events, 2, waitMs);
+        for (int i = 0; i < n; ++i) {
+            Stream& stream = streams[events[i].data.u32];
+            if (!stream.drain()) {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, stream.fd, nullptr);
+                stream.close();
+                --open;
+            }
+        }
+
+        // A child in our group already got the terminal's signal; one leading its own did not.
+        if (int sig = options.foreground ? ForegroundSignals::take() : 0; sig != 0 && ownGroup) {
+            signalChild(sig);
+        }
+
+        now = Clock::now();
+        if (hasDeadline && !termSent && now >= deadline) {
+            result.timedOut = true;
+            signalChild(SIGTERM);
+            termSent = true;
+            killAt = now + options.killGrace;
+        } else if (termSent && !killSent && now >= killAt) {
+            signalChild(SIGKILL);
+            killSent = true;
+        }
+
+        // A background descendant can keep the pipes open after the child exits;
+        // don't wait on it once the process we started is gone.
+        if (n == 0 && waitpid(pid, &status, WNOHANG) == pid) {
+            reaped = true;
+            for (auto& stream : streams) {
+                if (stream.fd >= 0) {
+                    stream.drain();
+                    stream.close();
+                }
+            }
+            break;
+        }
+    }
+    close(epfd);
+
+    if (!reaped) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+    if (WIFEXITED(status)) {
+        result.exitCode = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.signal = WTERMSIG(status);
+    }
+    return result;
+}
+
+std::vector<ProcessResult> ProcessRunner::runPipeline(std::vector<ProcessOptions> stages) {
+    std::vector<ProcessResult> results(stages.size());
+    if (stages.empty()) {
+        return results;
+    }
+    // links[i] connects stage i to stage i + 1. The ends are close-on-exec, so a
+    // child only keeps the one it was given as stdin or stdout.
+    std::vector<std::array<int, 2>> links(stages.size() - 1, {-1, -1});
+    for (auto& link : links) {
+        if (pipe2(link.data(), O_CLOEXEC) != 0) {
+            std::string error = std::strerror(errno);
+            for (auto& opened : links) {
+                if (opened[0] >= 0) {
+                    close(opened[0]);
+                    close(opened[1]);
+                }
+            }
+            for (auto& result : results) {
+                result.error = error;
+            }
+            return results;
+        }
+    }
+    for (size_t i = 0; i + 1 < stages.size(); ++i) {
+        stages[i].stdoutFd = links[i][1];
+        stages[i].onStdout = nullptr;
+        stages[i + 1].stdinFd = links[i][0];
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(stages.size());
+    for (size_t i = 0; i < stages.size(); ++i) {
+        threads.emplace_back([&, i] {
+            results[i] = run(stages[i]);
+            // Only now can the neighbours see EOF (downstream) or EPIPE (upstream).
+            if (i + 1 < stages.size()) {
+                close(links[i][1]);
+            }
+            if (i > 0) {
+                close(links[i - 1][0]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
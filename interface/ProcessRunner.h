@@ -0,0 +1,125 @@
+#ifndef PRISMQUANTA_PROCESS_RUNNER_H
+#define PRISMQUANTA_PROCESS_RUNNER_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * @brief Per-process resource limits; zero leaves a limit unchanged.
+ */
+struct ResourceLimits {
+    unsigned long cpuSeconds = 0;      ///< RLIMIT_CPU
+    unsigned long memoryBytes = 0;     ///< RLIMIT_AS
+    unsigned long openFiles = 0;       ///< RLIMIT_NOFILE
+};
+
+struct ProcessOptions {
+    using LineCallback = std::function<void(std::string_view line)>;
+
+    /** Program and arguments; argv[0] is looked up on PATH if it has no '/'. */
+    std::vector<std::string> argv;
+    /** Wall-clock limit; zero means none. On expiry the process group gets SIGTERM, then SIGKILL. */
+    std::chrono::milliseconds timeout{0};
+    /** Time between SIGTERM and SIGKILL once the timeout has expired. */
+    std::chrono::milliseconds killGrace{2000};
+    ResourceLimits limits;
+    /** Directory to run in; empty keeps the current one. */
+    std::string workingDirectory;
+    /** Descriptor to use as the child's stdin; -1 inherits ours. */
+    int stdinFd = -1;
+    /** Descriptor to use as the child's stdout instead of delivering it to onStdout; -1 captures it. */
+    int stdoutFd = -1;
+    /** Start the child in a process group of its own (always done with a timeout), so kill(-pid) reaches its whole tree. */
+    bool processGroup = false;
+    /**
+     * Run it as a shell runs its foreground command: while run() waits, SIGINT and SIGQUIT do
+     * not kill us (see ForegroundSignals) but are passed on to the child's group if it leads one;
+     * otherwise the terminal delivers them to the child itself.
+     */
+    bool foreground = false;
+    /** Called with the child's pid once it is running, from the thread that called run(). */
+    std::function<void(pid_t pid)> onStart;
+    /** Called for each complete line (without the newline); unset streams are discarded. */
+    LineCallback onStdout;
+    LineCallback onStderr;
+
+    /** @brief Whether the child will lead a process group of its own. */
+    bool ownsGroup() const { return processGroup || timeout.count() > 0; }
+};
+
+struct ProcessResult {
+    bool spawned = false;
+    int exitCode = -1;           ///< Valid when the process exited normally.
+    int signal = 0;              ///< Non-zero if the process was killed by a signal.
+    bool timedOut = false;
+    std::chrono::milliseconds duration{0};
+    std::string error;           ///< Why the process could not be started.
+
+    bool succeeded() const { return spawned && !timedOut && signal == 0 && exitCode == 0; }
+
+    /** @brief One-line human-readable outcome, e.g. "exit code 0 in 12 ms". */
+    std::string describe() const;
+};
+
+/**
+ * @brief Keeps SIGINT and SIGQUIT from killing us while a foreground child runs, as a shell does.
+ *
+ * For its lifetime the two signals are caught instead, and take() hands the
+ * last one caught to the code waiting on the child, which passes it on if the
+ * child left our process group. The previous handlers are restored on
+ * destruction, so guards nest.
+ */
+class ForegroundSignals {
+public:
+    ForegroundSignals();
+    ~ForegroundSignals();
+
+    ForegroundSignals(const ForegroundSignals&) = delete;
+    ForegroundSignals& operator=(const ForegroundSignals&) = delete;
+
+    /** @brief The last signal caught since the previous call, or 0. */
+    static int take();
+
+private:
+    struct sigaction m_previous[2];
+};
+
+/**
+ * @brief Runs external programs without a shell.
+ *
+ * The child is created with vfork() and exec'd directly from an argv array,
+ * so arguments are never re-parsed by /bin/sh. Its stdout and stderr are read
+ * through non-blocking pipes in an epoll loop and delivered line by line to
+ * the callbacks as the process runs. The child starts with no signals blocked.
+ */
+class ProcessRunner {
+public:
+    static ProcessResult run(const ProcessOptions& options);
+
+    /**
+     * @brief Runs programs side by side with each one's stdout feeding the next one's stdin, like a shell pipeline.
+     *
+     * Every stage but the last writes straight into a pipe to the next (its
+     * onStdout and stdoutFd are ignored); stderr is delivered to each stage's
+     * callback as with run(). Each stage is waited for on a thread of its
+     * own, and a pipe end is closed as soon as the stage using it exits, so
+     * the next stage sees EOF. Returns when every stage has exited.
+     * @return One result per stage, in order.
+     */
+    static std::vector<ProcessResult> runPipeline(std::vector<ProcessOptions> stages);
+
+    /**
+     * @brief Splits a command-line style argument string into words.
+     *
+     * Whitespace separates words; single quotes, double quotes and backslashes
+     * group and escape as in the shell, but nothing is expanded.
+     */
+    static std::vector<std::string> splitArgs(std::string_view args);
+};
+
+#endif //PRISMQUANTA_PROCESS_RUNNER_H
@@ -0,0 +1,79 @@
+#include "PromptGenerator.h"
+#include "Config.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "pq_daemon.h"
+#include <string_view>
+
+namespace {
+    // Task-independent instructions; part of the cached prefix.
+    constexpr std::string_view kTaskInstructions =
+        "Complete the task below. Carry out the listed commands in order, "
+        "and make sure the result meets every listed criterion.\n\n";
+
+    void append_list(std::string& out, std::string_view heading, const std::vector<std::string>& items) {
+        out.append(heading).append(":\n");
+        for (const auto& item : items) {
+            out.append("- ").append(item).append("\n");
+        }
+    }
+} // namespace
+
+bool PromptGenerator::load(const Config& config) {
+    std::string path = config.getString("SYSTEM_PROMPT_FILE").value_or("prompts/system_prompt.txt");
+    MappedFile file;
+    bool loaded = file.open(path);
+
+    std::string_view system = file.view();
+    while (!system.empty() && (system.back() == '\n' || system.back() == '\r' || system.back() == ' ')) {
+        system.remove_suffix(1);
+    }
+
+    m_prefix.clear();
+    m_prefix.reserve(system.size() + 2 + kTaskInstructions.size());
+    if (!system.empty()) {
+        m_prefix.append(system).append("\n\n");
+    }
+    m_prefix.append(kTaskInstructions);
+
+    m_templatePath = config.getString("PROMPT_TEMPLATE_FILE").value_or("");
+    if (!m_templatePath.empty()) {
+        std::string error;
+        m_templates.get(m_templatePath, &error);
+        if (!error.empty()) {
+            Logger::instance().warn("PromptGenerator", "Prompt template not usable, " + error);
+        }
+    }
+    return loaded;
+}
+
+void PromptGenerator::appendSuffix(const PQLTask& task, std::string& out) const {
+    if (!m_templatePath.empty()) {
+        if (auto compiled = m_templates.get(m_templatePath)) {
+            TemplateValue message = TemplateValue::map();
+            message.set("role", TemplateValue::of(std::string_view("user")));
+            message.set("content", TemplateValue::of(std::string_view(task.description)));
+            TemplateValue context = TemplateValue::map();
+            context.set("messages", TemplateValue::list({std::move(message)}));
+            context.set("bos_token", TemplateValue::of(std::string_view()));
+            context.set("eos_token", TemplateValue::of(std::string_view()));
+            compiled->render(task, context, out);
+            return;
+        }
+    }
+    out.append("Task: ").append(task.description).append("\n");
+    append_list(out, "Commands", task.commands);
+    append_list(out, "Criteria", task.criteria);
+}
+
+std::string PromptGenerator::generate(const PQLTask& task) const {
+    size_t size = m_prefix.size() + task.description.size() + 32;
+    for (const auto& command : task.commands) size += command.size() + 3;
+    for (const auto& criterion : task.criteria) size += criterion.size() + 3;
+
+    std::string prompt;
+    prompt.reserve(size);
+    prompt.append(m_prefix);
+    appendSuffix(task, prompt);
+    return prompt;
+}
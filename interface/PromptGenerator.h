@@ -0,0 +1,48 @@
+#ifndef PRISMQUANTA_PROMPT_GENERATOR_H
+#define PRISMQUANTA_PROMPT_GENERATOR_H
+
+#include "PromptTemplate.h"
+#include <string>
+
+class Config;
+struct PQLTask;
+
+/**
+ * @brief Builds LLM prompts as a stable prefix followed by a per-task suffix.
+ *
+ * The prefix (the system prompt from SYSTEM_PROMPT_FILE, default
+ * prompts/system_prompt.txt, plus the fixed task instructions) is built
+ * once and is byte-for-byte identical for every task, so a llama.cpp server
+ * asked to cache_prompt only has to evaluate the task-specific suffix.
+ * Anything that varies between tasks must therefore go in the suffix.
+ *
+ * The suffix is laid out as "Task:", "Commands:" and "Criteria:" unless
+ * PROMPT_TEMPLATE_FILE names a Jinja template (see PromptTemplate), which is
+ * then rendered with `task`, a one-message chat `messages` (the user asking
+ * for the task description), and empty `bos_token`/`eos_token`. The
+ * template is compiled once and again whenever the file changes; while an
+ * edit does not compile, the last version that did is used.
+ */
+class PromptGenerator {
+public:
+    /**
+     * @brief Loads the system prompt, rebuilds the prefix and compiles PROMPT_TEMPLATE_FILE, if set.
+     * @return False if SYSTEM_PROMPT_FILE could not be read; the prefix then holds only the instructions.
+     */
+    bool load(const Config& config);
+
+    const std::string& prefix() const { return m_prefix; }
+
+    /** @brief Appends the task-specific part of the prompt to @p out. */
+    void appendSuffix(const PQLTask& task, std::string& out) const;
+
+    /** @brief The complete prompt: prefix() followed by the task's suffix. */
+    std::string generate(const PQLTask& task) const;
+
+private:
+    std::string m_prefix;
+    std::string m_templatePath;
+    mutable TemplateCache m_templates;
+};
+
+#endif //PRISMQUANTA_PROMPT_GENERATOR_H
@@ -0,0 +1,1351 @@
+#include "PromptTemplate.h"
+#include "MappedFile.h"
+#include "PQLParser.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <sys/stat.h>
+
+// --- TemplateValue ---
+
+TemplateValue TemplateValue::of(bool value) {
+    TemplateValue v;
+    v.kind = Kind::Bool;
+    v.boolean = value;
+    return v;
+}
+
+TemplateValue TemplateValue::of(int64_t value) {
+    TemplateValue v;
+    v.kind = Kind::Int;
+    v.integer = value;
+    return v;
+}
+
+TemplateValue TemplateValue::of(std::string_view value) {
+    TemplateValue v;
+    v.kind = Kind::String;
+    v.string = value;
+    return v;
+}
+
+TemplateValue TemplateValue::list(std::vector<TemplateValue> items) {
+    TemplateValue v;
+    v.kind = Kind::List;
+    v.items = std::move(items);
+    return v;
+}
+
+TemplateValue TemplateValue::map() {
+    TemplateValue v;
+    v.kind = Kind::Map;
+    return v;
+}
+
+TemplateValue& TemplateValue::set(std::string_view key, TemplateValue value) {
+    for (auto& field : fields) {
+        if (field.first == key) {
+            field.second = std::move(value);
+            return field.second;
+        }
+    }
+    fields.emplace_back(key, std::move(value));
+    return fields.back().second;
+}
+
+const TemplateValue* TemplateValue::find(std::string_view key) const {
+    for (const auto& field : fields) {
+        if (field.first == key) {
+            return &field.second;
+        }
+    }
+    return nullptr;
+}
+
+bool TemplateValue::truthy() const {
+    switch (kind) {
+    case Kind::None: return false;
+    case Kind::Bool: return boolean;
+    case Kind::Int: return integer != 0;
+    case Kind::String: return !string.empty();
+    case Kind::List: return !items.empty();
+    case Kind::Map: return !fields.empty();
+    }
+    return false;
+}
+
+// --- Compiled form ---
+
+enum class ExprOp : uint8_t {
+    Literal, Name, Attr, Index, List, Filter, Test,
+    Not, Neg, And, Or, Eq, Ne, Lt, Le, Gt, Ge, In, NotIn, Concat, Add, Sub
+};
+
+enum class FilterId : uint8_t {
+    Capitalize, Default, First, Indent, Int, Join, Last, Length, Lower, Replace, String, Title, Trim, Upper
+};
+
+enum class TestId : uint8_t { Defined, Undefined, None, String, Number, Mapping, Sequence };
+
+struct PromptTemplate::Expr {
+    ExprOp op = ExprOp::Literal;
+    uint8_t fn = 0;            // FilterId or TestId.
+    bool negate = false;       // "is not".
+    TemplateValue literal;
+    std::string_view name;     // Name, Attr.
+    uint32_t lhs = 0;
+    uint32_t rhs = 0;
+    std::vector<uint32_t> args;  // List items, filter arguments.
+};
+
+struct PromptTemplate::Node {
+    enum class Kind : uint8_t { Text, Output, If, For, Set };
+
+    Kind kind = Kind::Text;
+    std::string_view text;     // Text; the variable of For and Set.
+    uint32_t expr = 0;         // Output, For (the sequence), Set.
+    std::vector<Node> body;    // For.
+    std::vector<Node> orElse;  // If and For.
+    std::vector<std::pair<uint32_t, std::vector<Node>>> branches;  // If and elif.
+};
+
+namespace {
+    using Kind = TemplateValue::Kind;
+
+    const TemplateValue kUndefined;
+
+    struct NamedFilter {
+        std::string_view name;
+        FilterId id;
+    };
+    constexpr NamedFilter kFilters[] = {
+        {"capitalize", FilterId::Capitalize}, {"default", FilterId::Default}, {"d", FilterId::Default},
+        {"first", FilterId::First}, {"indent", FilterId::Indent}, {"int", FilterId::Int}, {"join", FilterId::Join},
+        {"last", FilterId::Last}, {"length", FilterId::Length}, {"count", FilterId::Length},
+        {"lower", FilterId::Lower}, {"replace", FilterId::Replace}, {"string", FilterId::String},
+        {"title", FilterId::Title}, {"trim", FilterId::Trim}, {"upper", FilterId::Upper},
+    };
+
+    struct NamedTest {
+        std::string_view name;
+        TestId id;
+    };
+    constexpr NamedTest kTests[] = {
+        {"defined", TestId::Defined}, {"undefined", TestId::Undefined}, {"none", TestId::None},
+        {"string", TestId::String}, {"number", TestId::Number}, {"mapping", TestId::Mapping},
+        {"sequence", TestId::Sequence}, {"iterable", TestId::Sequence},
+    };
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool is_name_start(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool is_name_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    void append_int(std::string& out, int64_t value) {
+        char buffer[24];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        (void)ec;
+        out.append(buffer, static_cast<size_t>(end - buffer));
+    }
+
+    // How Jinja prints a value; with @p quoted, strings inside lists and maps get quotes.
+    void append_value(std::string& out, const TemplateValue& value, bool quoted = false) {
+        switch (value.kind) {
+        case Kind::None:
+            break;
+        case Kind::Bool:
+            out.append(value.boolean ? "True" : "False");
+            break;
+        case Kind::Int:
+            append_int(out, value.integer);
+            break;
+        case Kind::String:
+            if (quoted) {
+                out.append("'").append(value.string).append("'");
+            } else {
+                out.append(value.string);
+            }
+            break;
+        case Kind::List:
+            out.push_back('[');
+            for (size_t i = 0; i < value.items.size(); ++i) {
+                out.append(i ? ", " : "");
+                append_value(out, value.items[i], true);
+            }
+            out.push_back(']');
+            break;
+        case Kind::Map:
+            out.push_back('{');
+            for (size_t i = 0; i < value.fields.size(); ++i) {
+                out.append(i ? ", '" : "'").append(value.fields[i].first).append("': ");
+                append_value(out, value.fields[i].second, true);
+            }
+            out.push_back('}');
+            break;
+        }
+    }
+
+    bool equal(const TemplateValue& a, const TemplateValue& b) {
+        if (a.kind != b.kind) {
+            return false;
+        }
+        switch (a.kind) {
+        case Kind::None: return true;
+        case Kind::Bool: return a.boolean == b.boolean;
+        case Kind::Int: return a.integer == b.integer;
+        case Kind::String: return a.string == b.string;
+        case Kind::List:
+            return a.items.size() == b.items.size() &&
+                   std::equal(a.items.begin(), a.items.end(), b.items.begin(), equal);
+        case Kind::Map:
+            return a.fields.size() == b.fields.size() &&
+                   std::all_of(a.fields.begin(), a.fields.end(), [&b](const auto& field) {
+                       const TemplateValue* other = b.find(field.first);
+                       return other && equal(field.second, *other);
+                   });
+        }
+        return false;
+    }
+
+    // Strings made while rendering. Each thread keeps its own, and their capacity, from one render to the next.
+    struct Arena {
+        std::vector<std::unique_ptr<std::string>> strings;
+        size_t used = 0;
+
+        std::string& next() {
+            if (used == strings.size()) {
+                strings.push_back(std::make_unique<std::string>());
+            }
+            std::string& s = *strings[used++];
+            s.clear();
+            return s;
+        }
+    };
+    thread_local Arena t_arena;
+
+    // --- Expression tokens ---
+
+    struct Token {
+        enum class Type : uint8_t { End, Name, Int, String, Op };
+        Type type = Type::End;
+        std::string_view text;  // Name, Op, and the raw String literal without quotes.
+        int64_t value = 0;
+        bool escaped = false;   // String contains backslashes.
+    };
+
+    bool tokenize(std::string_view text, std::vector<Token>& tokens, std::string& error) {
+        tokens.clear();
+        size_t i = 0;
+        while (true) {
+            while (i < text.size() && is_space(text[i])) {
+                ++i;
+            }
+            Token token;
+            if (i >= text.size()) {
+                tokens.push_back(token);
+                return true;
+            }
+            char c = text[i];
+            if (is_name_start(c)) {
+                size_t start = i;
+                while (i < text.size() && is_name_char(text[i])) {
+                    ++i;
+                }
+                token.type = Token::Type::Name;
+                token.text = text.substr(start, i - start);
+            } else if (c >= '0' && c <= '9') {
+                size_t start = i;
+                while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+                    ++i;
+                }
+                token.type = Token::Type::Int;
+                token.text = text.substr(start, i - start);
+                std::from_chars(text.data() + start, text.data() + i, token.value);
+            } else if (c == '\'' || c == '"') {
+                size_t start = ++i;
+                while (i < text.size() && text[i] != c) {
+                    if (text[i] == '\\') {
+                        token.escaped = true;
+                        ++i;
+                    }
+                    ++i;
+                }
+                if (i >= text.size()) {
+                    error = "unterminated string";
+                    return false;
+                }
+                token.type = Token::Type::String;
+                token.text = text.substr(start, i - start);
+                ++i;
+            } else {
+                static constexpr std::string_view kTwo[] = {"==", "!=", "<=", ">="};
+                token.type = Token::Type::Op;
+                std::string_view two = text.substr(i, 2);
+                if (std::find(std::begin(kTwo), std::end(kTwo), two) != std::end(kTwo)) {
+                    token.text = two;
+                    i += 2;
+                } else if (std::string_view("()[].,|<>+-~=").find(c) != std::string_view::npos) {
+                    token.text = text.substr(i, 1);
+                    ++i;
+                } else {
+                    error = std::string("unexpected character '") + c + "'";
+                    return false;
+                }
+            }
+            tokens.push_back(token);
+        }
+    }
+} // namespace
+
+// --- Parser ---
+
+class PromptTemplate::Parser {
+public:
+    explicit Parser(PromptTemplate& tmpl) : m_tmpl(tmpl) {}
+
+    bool parse() {
+        std::string_view source = m_tmpl.m_source;
+        std::vector<Frame> open;
+        std::vector<Node>* target = &m_tmpl.m_body;
+        bool trimNext = false;   // A "-" or a block tag asked to strip what follows.
+        bool dropNewline = false;
+        size_t pos = 0;
+
+        auto emit_text = [&](std::string_view text) {
+            if (!text.empty()) {
+                Node node;
+                node.kind = Node::Kind::Text;
+                node.text = text;
+                target->push_back(std::move(node));
+            }
+        };
+
+        while (pos <= source.size()) {
+            size_t tag = source.find('{', pos);
+            while (tag != std::string_view::npos && tag + 1 < source.size() && source[tag + 1] != '{' &&
+                   source[tag + 1] != '%' && source[tag + 1] != '#') {
+                tag = source.find('{', tag + 1);
+            }
+            if (tag + 1 >= source.size()) {
+                tag = std::string_view::npos;
+            }
+            std::string_view text = source.substr(pos, tag == std::string_view::npos ? source.npos : tag - pos);
+            if (trimNext) {
+                while (!text.empty() && is_space(text.front())) {
+                    text.remove_prefix(1);
+                }
+            } else if (dropNewline) {
+                if (text.substr(0, 2) == "\r\n") {
+                    text.remove_prefix(2);
+                } else if (!text.empty() && text.front() == '\n') {
+                    text.remove_prefix(1);
+                }
+            }
+            trimNext = dropNewline = false;
+            if (tag == std::string_view::npos) {
+                emit_text(text);
+                break;
+            }
+
+            char kind = source[tag + 1];
+            m_offset = tag;
+            bool trimBefore = tag + 2 < source.size() && source[tag + 2] == '-';
+            size_t contentStart = tag + 2 + (trimBefore ? 1 : 0);
+            size_t close = kind == '#' ? source.find("#}", contentStart) : find_close(source, contentStart, kind);
+            if (close == std::string_view::npos) {
+                return fail(kind == '{' ? "unclosed {{" : kind == '%' ? "unclosed {%" : "unclosed {#");
+            }
+            bool trimAfter = close > contentStart && source[close - 1] == '-';
+            std::string_view content = source.substr(contentStart, close - contentStart - (trimAfter ? 1 : 0));
+            pos = close + 2;
+
+            if (trimBefore) {
+                while (!text.empty() && is_space(text.back())) {
+                    text.remove_suffix(1);
+                }
+            } else if (kind != '{') {
+                // lstrip_blocks: indentation before a block tag alone at the start of its line.
+                size_t lineStart = text.find_last_of('\n');
+                std::string_view indent = text.substr(lineStart == std::string_view::npos ? 0 : lineStart + 1);
+                size_t indentStart = tag - indent.size();
+                bool atLineStart = indentStart == 0 || source[indentStart - 1] == '\n';
+                if (atLineStart && indent.find_first_not_of(" \t") == std::string_view::npos) {
+                    text.remove_suffix(indent.size());
+                }
+            }
+            emit_text(text);
+            trimNext = trimAfter;
+            dropNewline = kind != '{';
+
+            if (kind == '#') {
+                continue;
+            }
+            if (!tokenize(content, m_tokens, m_error)) {
+                return fail(m_error);
+            }
+            m_next = 0;
+            if (kind == '{') {
+                Node node;
+                node.kind = Node::Kind::Output;
+                if (!expression(node.expr) || !expect_end()) {
+                    return false;
+                }
+                target->push_back(std::move(node));
+                continue;
+            }
+            if (!statement(open, target)) {
+                return false;
+            }
+        }
+        if (!open.empty()) {
+            m_offset = open.back().offset;
+            return fail(open.back().node->kind == Node::Kind::If ? "{% if %} without {% endif %}"
+                                                                 : "{% for %} without {% endfor %}");
+        }
+        return true;
+    }
+
+private:
+    struct Frame {
+        Node* node;
+        size_t offset;
+        bool inElse = false;
+    };
+
+    // The end of a {{ }} or {% %} tag, skipping string literals that might contain it.
+    static size_t find_close(std::string_view source, size_t from, char kind) {
+        char end = kind == '{' ? '}' : '%';
+        char quote = 0;
+        for (size_t i = from; i + 1 < source.size(); ++i) {
+            char c = source[i];
+            if (quote) {
+                if (c == '\\') {
+                    ++i;
+                } else if (c == quote) {
+                    quote = 0;
+                }
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+            } else if (c == end && source[i + 1] == '}') {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    bool statement(std::vector<Frame>& open, std::vector<Node>*& target) {
+        const Token& keyword = m_tokens[m_next];
+        if (keyword.type != Token::Type::Name) {
+            return fail("expected a statement");
+        }
+        std::string_view word = keyword.text;
+        ++m_next;
+
+        if (word == "if" || word == "for") {
+            Node node;
+            if (word == "if") {
+                node.kind = Node::Kind::If;
+                node.branches.emplace_back();
+                if (!expression(node.branches.back().first) || !expect_end()) {
+                    return false;
+                }
+            } else {
+                node.kind = Node::Kind::For;
+                if (m_tokens[m_next].type != Token::Type::Name) {
+                    return fail("expected a loop variable");
+                }
+                node.text = m_tokens[m_next++].text;
+                if (!accept_name("in")) {
+                    return fail("expected 'in'");
+                }
+                if (!expression(node.expr) || !expect_end()) {
+                    return false;
+                }
+            }
+            target->push_back(std::move(node));
+            Node* added = &target->back();
+            open.push_back(Frame{added, m_offset});
+            target = word == "if" ? &added->branches.back().second : &added->body;
+            return true;
+        }
+        if (word == "elif" || word == "else") {
+            if (open.empty() || open.back().inElse ||
+                (word == "elif" && open.back().node->kind != Node::Kind::If)) {
+                return fail("unexpected {% " + std::string(word) + " %}");
+            }
+            Node* node = open.back().node;
+            if (word == "elif") {
+                node->branches.emplace_back();
+                if (!expression(node->branches.back().first) || !expect_end()) {
+                    return false;
+                }
+                target = &node->branches.back().second;
+            } else {
+                if (!expect_end()) {
+                    return false;
+                }
+                open.back().inElse = true;
+                target = &node->orElse;
+            }
+            return true;
+        }
+        if (word == "endif" || word == "endfor") {
+            Node::Kind expected = word == "endif" ? Node::Kind::If : Node::Kind::For;
+            if (open.empty() || open.back().node->kind != expected || !expect_end()) {
+                return fail("unexpected {% " + std::string(word) + " %}");
+            }
+            open.pop_back();
+            target = open.empty() ? &m_tmpl.m_body : current_target(open.back());
+            return true;
+        }
+        if (word == "set") {
+            Node node;
+            node.kind = Node::Kind::Set;
+            if (m_tokens[m_next].type != Token::Type::Name) {
+                return fail("expected a variable name");
+            }
+            node.text = m_tokens[m_next++].text;
+            if (!accept_op("=")) {
+                return fail("expected '='");
+            }
+            if (!expression(node.expr) || !expect_end()) {
+                return false;
+            }
+            target->push_back(std::move(node));
+            return true;
+        }
+        return fail("unknown statement '" + std::string(word) + "'");
+    }
+
+    static std::vector<Node>* current_target(Frame& frame) {
+        if (frame.inElse) {
+            return &frame.node->orElse;
+        }
+        return frame.node->kind == Node::Kind::If ? &frame.node->branches.back().second : &frame.node->body;
+    }
+
+    // --- Expressions, lowest precedence first ---
+
+    bool expression(uint32_t& out) { return parse_or(out); }
+
+    bool parse_or(uint32_t& out) {
+        if (!parse_and(out)) return false;
+        while (accept_name("or")) {
+            uint32_t rhs;
+            if (!parse_and(rhs)) return false;
+            out = binary(ExprOp::Or, out, rhs);
+        }
+        return true;
+    }
+
+    bool parse_and(uint32_t& out) {
+        if (!parse_not(out)) return false;
+        while (accept_name("and")) {
+            uint32_t rhs;
+            if (!parse_not(rhs)) return false;
+            out = binary(ExprOp::And, out, rhs);
+        }
+        return true;
+    }
+
+    bool parse_not(uint32_t& out) {
+        if (accept_name("not")) {
+            if (!parse_not(out)) return false;
+            out = binary(ExprOp::Not, out, 0);
+            return true;
+        }
+        return parse_compare(out);
+    }
+
+    bool parse_compare(uint32_t& out) {
+        if (!parse_concat(out)) return false;
+        while (true) {
+            static constexpr std::pair<std::string_view, ExprOp> kOps[] = {
+                {"==", ExprOp::Eq}, {"!=", ExprOp::Ne}, {"<", ExprOp::Lt},
+                {"<=", ExprOp::Le}, {">", ExprOp::Gt}, {">=", ExprOp::Ge}};
+            const Token& token = m_tokens[m_next];
+            ExprOp op;
+            if (token.type == Token::Type::Op &&
+                std::any_of(std::begin(kOps), std::end(kOps), [&](const auto& entry) {
+                    return entry.first == token.text && (op = entry.second, true);
+                })) {
+                ++m_next;
+            } else if (accept_name("in")) {
+                op = ExprOp::In;
+            } else if (token.type == Token::Type::Name && token.text == "not" &&
+                       m_tokens[m_next + 1].type == Token::Type::Name && m_tokens[m_next + 1].text == "in") {
+                m_next += 2;
+                op = ExprOp::NotIn;
+            } else if (accept_name("is")) {
+                bool negate = accept_name("not");
+                const Token& name = m_tokens[m_next];
+                auto test = std::find_if(std::begin(kTests), std::end(kTests),
+                                         [&name](const NamedTest& t) { return t.name == name.text; });
+                if (name.type != Token::Type::Name || test == std::end(kTests)) {
+                    return fail("unknown test '" + std::string(name.text) + "'");
+                }
+                ++m_next;
+                Expr expr;
+                expr.op = ExprOp::Test;
+                expr.fn = static_cast<uint8_t>(test->id);
+                expr.negate = negate;
+                expr.lhs = out;
+                out = add(std::move(expr));
+                continue;
+            } else {
+                return true;
+            }
+            uint32_t rhs;
+            if (!parse_concat(rhs)) return false;
+            out = binary(op, out, rhs);
+        }
+    }
+
+    bool parse_concat(uint32_t& out) {
+        if (!parse_additive(out)) return false;
+        while (accept_op("~")) {
+            uint32_t rhs;
+            if (!parse_additive(rhs)) return false;
+            out = binary(ExprOp::Concat, out, rhs);
+        }
+        return true;
+    }
+
+    bool parse_additive(uint32_t& out) {
+        if (!parse_unary(out)) return false;
+        while (true) {
+            ExprOp op;
+            if (accept_op("+")) {
+                op = ExprOp::Add;
+            } else if (accept_op("-")) {
+                op = ExprOp::Sub;
+            } else {
+                return true;
+            }
+            uint32_t rhs;
+            if (!parse_unary(rhs)) return false;
+            out = binary(op, out, rhs);
+        }
+    }
+
+    bool parse_unary(uint32_t& out) {
+        if (accept_op("-")) {
+            if (!parse_unary(out)) return false;
+            out = binary(ExprOp::Neg, out, 0);
+            return true;
+        }
+        return parse_filtered(out);
+    }
+
+    bool parse_filtered(uint32_t& out) {
+        if (!parse_postfix(out)) return false;
+        while (accept_op("|")) {
+            const Token& name = m_tokens[m_next];
+            auto filter = std::find_if(std::begin(kFilters), std::end(kFilters),
+                                       [&name](const NamedFilter& f) { return f.name == name.text; });
+            if (name.type != Token::Type::Name || filter == std::end(kFilters)) {
+                return fail("unknown filter '" + std::string(name.text) + "'");
+            }
+            ++m_next;
+            Expr expr;
+            expr.op = ExprOp::Filter;
+            expr.fn = static_cast<uint8_t>(filter->id);
+            expr.lhs = out;
+            if (accept_op("(") && !arguments(")", expr.args)) {
+                return false;
+            }
+            out = add(std::move(expr));
+        }
+        return true;
+    }
+
+    bool parse_postfix(uint32_t& out) {
+        if (!parse_primary(out)) return false;
+        while (true) {
+            if (accept_op(".")) {
+                const Token& name = m_tokens[m_next];
+                if (name.type != Token::Type::Name) {
+                    return fail("expected an attribute name");
+                }
+                ++m_next;
+                Expr expr;
+                expr.op = ExprOp::Attr;
+                expr.lhs = out;
+                expr.name = name.text;
+                out = add(std::move(expr));
+            } else if (accept_op("[")) {
+                uint32_t index;
+                if (!expression(index)) return false;
+                if (!accept_op("]")) {
+                    return fail("expected ']'");
+                }
+                out = binary(ExprOp::Index, out, index);
+            } else if (m_tokens[m_next].type == Token::Type::Op && m_tokens[m_next].text == "(") {
+                return fail("calls are not supported; use a filter");
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool parse_primary(uint32_t& out) {
+        const Token& token = m_tokens[m_next];
+        Expr expr;
+        switch (token.type) {
+        case Token::Type::Int:
+            expr.literal = TemplateValue::of(token.value);
+            break;
+        case Token::Type::String:
+            expr.literal = TemplateValue::of(token.escaped ? unescape(token.text) : token.text);
+            break;
+        case Token::Type::Name:
+            if (token.text == "true" || token.text == "True") {
+                expr.literal = TemplateValue::of(true);
+            } else if (token.text == "false" || token.text == "False") {
+                expr.literal = TemplateValue::of(false);
+            } else if (token.text == "none" || token.text == "None") {
+                // Literal none: the default value.
+            } else {
+                expr.op = ExprOp::Name;
+                expr.name = token.text;
+            }
+            break;
+        case Token::Type::Op:
+            if (token.text == "(") {
+                ++m_next;
+                if (!expression(out)) return false;
+                return accept_op(")") || fail("expected ')'");
+            }
+            if (token.text == "[") {
+                ++m_next;
+                expr.op = ExprOp::List;
+                if (!arguments("]", expr.args)) return false;
+                out = add(std::move(expr));
+                return true;
+            }
+            return fail("unexpected '" + std::string(token.text) + "'");
+        case Token::Type::End:
+            return fail("expected an expression");
+        }
+        ++m_next;
+        out = add(std::move(expr));
+        return true;
+    }
+
+    // Comma-separated expressions up to @p close, which has not been consumed yet.
+    bool arguments(std::string_view close, std::vector<uint32_t>& args) {
+        if (accept_op(close)) {
+            return true;
+        }
+        do {
+            uint32_t arg;
+            if (!expression(arg)) return false;
+            args.push_back(arg);
+        } while (accept_op(","));
+        return accept_op(close) || fail("expected '" + std::string(close) + "'");
+    }
+
+    std::string_view unescape(std::string_view raw) {
+        std::string& text = m_tmpl.m_strings.emplace_back();
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] == '\\' && i + 1 < raw.size()) {
+                char c = raw[++i];
+                text += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+            } else {
+                text += raw[i];
+            }
+        }
+        return text;
+    }
+
+    bool accept_op(std::string_view op) {
+        if (m_tokens[m_next].type == Token::Type::Op && m_tokens[m_next].text == op) {
+            ++m_next;
+            return true;
+        }
+        return false;
+    }
+
+    bool accept_name(std::string_view name) {
+        if (m_tokens[m_next].type == Token::Type::Name && m_tokens[m_next].text == name) {
+            ++m_next;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect_end() {
+        if (m_tokens[m_next].type == Token::Type::End) {
+            return true;
+        }
+        return fail("unexpected '" + std::string(m_tokens[m_next].text) + "'");
+    }
+
+    uint32_t add(Expr expr) {
+        m_tmpl.m_exprs.push_back(std::move(expr));
+        return static_cast<uint32_t>(m_tmpl.m_exprs.size() - 1);
+    }
+
+    uint32_t binary(ExprOp op, uint32_t lhs, uint32_t rhs) {
+        Expr expr;
+        expr.op = op;
+        expr.lhs = lhs;
+        expr.rhs = rhs;
+        return add(std::move(expr));
+    }
+
+    bool fail(const std::string& message) {
+        size_t line = 1 + static_cast<size_t>(std::count(m_tmpl.m_source.begin(),
+                                                         m_tmpl.m_source.begin() + static_cast<std::ptrdiff_t>(m_offset), '\n'));
+        m_tmpl.m_error = "line " + std::to_string(line) + ": " + message;
+        return false;
+    }
+
+    PromptTemplate& m_tmpl;
+    std::vector<Token> m_tokens;
+    size_t m_next = 0;
+    size_t m_offset = 0;  // Of the tag being parsed, for messages.
+    std::string m_error;
+};
+
+// --- Renderer ---
+
+class PromptTemplate::Renderer {
+public:
+    Renderer(const PromptTemplate& tmpl, const TemplateValue& context, const TemplateValue* task, std::string& out)
+        : m_tmpl(tmpl), m_context(context), m_task(task), m_out(out) {
+        m_scope.reserve(16);
+    }
+
+    void run(const std::vector<Node>& nodes) {
+        for (const Node& node : nodes) {
+            switch (node.kind) {
+            case Node::Kind::Text:
+                m_out.append(node.text);
+                break;
+            case Node::Kind::Output: {
+                TemplateValue tmp;
+                append_value(m_out, eval(node.expr, tmp));
+                break;
+            }
+            case Node::Kind::If: {
+                const std::vector<Node>* chosen = &node.orElse;
+                for (const auto& [condition, body] : node.branches) {
+                    TemplateValue tmp;
+                    if (eval(condition, tmp).truthy()) {
+                        chosen = &body;
+                        break;
+                    }
+                }
+                run(*chosen);
+                break;
+            }
+            case Node::Kind::For:
+                loop(node);
+                break;
+            case Node::Kind::Set: {
+                TemplateValue tmp;
+                const TemplateValue& value = eval(node.expr, tmp);
+                m_sets.push_back(value);
+                m_scope.push_back(Binding{node.text, &m_sets.back()});
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    struct Binding {
+        std::string_view name;
+        const TemplateValue* value;
+    };
+
+    void loop(const Node& node) {
+        TemplateValue tmp;
+        const TemplateValue& sequence = eval(node.expr, tmp);
+        std::vector<TemplateValue> keys;
+        const std::vector<TemplateValue>* items = &sequence.items;
+        if (sequence.kind == Kind::Map) {
+            for (const auto& field : sequence.fields) {
+                keys.push_back(TemplateValue::of(field.first));
+            }
+            items = &keys;
+        } else if (sequence.kind != Kind::List) {
+            items = &keys;
+        }
+        if (items->empty()) {
+            run(node.orElse);
+            return;
+        }
+
+        TemplateValue loop = TemplateValue::map();
+        loop.fields.reserve(7);
+        const int64_t length = static_cast<int64_t>(items->size());
+        for (const char* name : {"index", "index0", "first", "last", "length", "revindex", "revindex0"}) {
+            loop.set(name, TemplateValue::of(int64_t(0)));
+        }
+        size_t scopeSize = m_scope.size();
+        for (int64_t i = 0; i < length; ++i) {
+            auto& fields = loop.fields;
+            fields[0].second.integer = i + 1;
+            fields[1].second.integer = i;
+            fields[2].second = TemplateValue::of(i == 0);
+            fields[3].second = TemplateValue::of(i == length - 1);
+            fields[4].second.integer = length;
+            fields[5].second.integer = length - i;
+            fields[6].second.integer = length - i - 1;
+            m_scope.push_back(Binding{"loop", &loop});
+            m_scope.push_back(Binding{node.text, &(*items)[static_cast<size_t>(i)]});
+            run(node.body);
+            m_scope.resize(scopeSize);  // Names set inside the loop end with the iteration.
+        }
+    }
+
+    const TemplateValue& lookup(std::string_view name) const {
+        for (auto it = m_scope.rbegin(); it != m_scope.rend(); ++it) {
+            if (it->name == name) {
+                return *it->value;
+            }
+        }
+        if (m_task && name == "task") {
+            return *m_task;
+        }
+        const TemplateValue* value = m_context.find(name);
+        return value ? *value : kUndefined;
+    }
+
+    // A result found inside @p base: fine to return as is unless base is a temporary of the caller.
+    static const TemplateValue& forward(const TemplateValue& result, const TemplateValue& base,
+                                        const TemplateValue& local, TemplateValue& tmp) {
+        if (&base == &local) {
+            tmp = result;
+            return tmp;
+        }
+        return result;
+    }
+
+    std::string_view stringify(const TemplateValue& value) {
+        if (value.kind == Kind::String) {
+            return value.string;
+        }
+        std::string& text = t_arena.next();
+        append_value(text, value);
+        return text;
+    }
+
+    const TemplateValue& eval(uint32_t id, TemplateValue& tmp) {
+        const Expr& expr = m_tmpl.m_exprs[id];
+        TemplateValue a;
+        TemplateValue b;
+        switch (expr.op) {
+        case ExprOp::Literal:
+            return expr.literal;
+        case ExprOp::Name:
+            return lookup(expr.name);
+        case ExprOp::Attr: {
+            const TemplateValue& base = eval(expr.lhs, a);
+            const TemplateValue* field = base.kind == Kind::Map ? base.find(expr.name) : nullptr;
+            return field ? forward(*field, base, a, tmp) : kUndefined;
+        }
+        case ExprOp::Index: {
+            const TemplateValue& base = eval(expr.lhs, a);
+            const TemplateValue& key = eval(expr.rhs, b);
+            if (base.kind == Kind::Map && key.kind == Kind::String) {
+                const TemplateValue* field = base.find(key.string);
+                return field ? forward(*field, base, a, tmp) : kUndefined;
+            }
+            if (key.kind == Kind::Int && (base.kind == Kind::List || base.kind == Kind::String)) {
+                int64_t size = static_cast<int64_t>(base.kind == Kind::List ? base.items.size() : base.string.size());
+                int64_t index = key.integer < 0 ? key.integer + size : key.integer;
+                if (index < 0 || index >= size) {
+                    return kUndefined;
+                }
+                if (base.kind == Kind::String) {
+                    tmp = TemplateValue::of(base.string.substr(static_cast<size_t>(index), 1));
+                    return tmp;
+                }
+                return forward(base.items[static_cast<size_t>(index)], base, a, tmp);
+            }
+            return kUndefined;
+        }
+        case ExprOp::List: {
+            tmp = TemplateValue::list();
+            for (uint32_t arg : expr.args) {
+                TemplateValue item;
+                tmp.items.push_back(eval(arg, item));
+            }
+            return tmp;
+        }
+        case ExprOp::Filter:
+            return filter(expr, tmp);
+        case ExprOp::Test: {
+            const TemplateValue& value = eval(expr.lhs, a);
+            bool result = false;
+            switch (static_cast<TestId>(expr.fn)) {
+            case TestId::Defined: result = value.kind != Kind::None; break;
+            case TestId::Undefined:
+            case TestId::None: result = value.kind == Kind::None; break;
+            case TestId::String: result = value.kind == Kind::String; break;
+            case TestId::Number: result = value.kind == Kind::Int; break;
+            case TestId::Mapping: result = value.kind == Kind::Map; break;
+            case TestId::Sequence: result = value.kind == Kind::List || value.kind == Kind::String; break;
+            }
+            tmp = TemplateValue::of(result != expr.negate);
+            return tmp;
+        }
+        case ExprOp::Not:
+            tmp = TemplateValue::of(!eval(expr.lhs, a).truthy());
+            return tmp;
+        case ExprOp::Neg: {
+            const TemplateValue& value = eval(expr.lhs, a);
+            int64_t negated;
+            bool ok = value.kind == Kind::Int && !__builtin_sub_overflow(int64_t{0}, value.integer, &negated);
+            tmp = ok ? TemplateValue::of(negated) : TemplateValue();
+            return tmp;
+        }
+        case ExprOp::And:
+        case ExprOp::Or: {
+            // Like Jinja, the result is the operand that decided, not a boolean.
+            const TemplateValue& lhs = eval(expr.lhs, a);
+            if (lhs.truthy() == (expr.op == ExprOp::Or)) {
+                return forward(lhs, lhs, a, tmp);
+            }
+            const TemplateValue& rhs = eval(expr.rhs, b);
+            return forward(rhs, rhs, b, tmp);
+        }
+        case ExprOp::Eq:
+        case ExprOp::Ne:
+            tmp = TemplateValue::of(equal(eval(expr.lhs, a), eval(expr.rhs, b)) == (expr.op == ExprOp::Eq));
+            return tmp;
+        case ExprOp::Lt:
+        case ExprOp::Le:
+        case ExprOp::Gt:
+        case ExprOp::Ge: {
+            const TemplateValue& lhs = eval(expr.lhs, a);
+            const TemplateValue& rhs = eval(expr.rhs, b);
+            int order = 0;
+            if (lhs.kind == Kind::Int && rhs.kind == Kind::Int) {
+                order = lhs.integer < rhs.integer ? -1 : lhs.integer > rhs.integer;
+            } else if (lhs.kind == Kind::String && rhs.kind == Kind::String) {
+                order = lhs.string.compare(rhs.string);
+            } else {
+                tmp = TemplateValue::of(false);
+                return tmp;
+            }
+            bool result = expr.op == ExprOp::Lt ? order < 0 : expr.op == ExprOp::Le ? order <= 0
+                        : expr.op == ExprOp::Gt ? order > 0 : order >= 0;
+            tmp = TemplateValue::of(result);
+            return tmp;
+        }
+        case ExprOp::In:
+        case ExprOp::NotIn: {
+            const TemplateValue& needle = eval(expr.lhs, a);
+            const TemplateValue& haystack = eval(expr.rhs, b);
+            bool found = false;
+            if (haystack.kind == Kind::String && needle.kind == Kind::String) {
+                found = haystack.string.find(needle.string) != std::string_view::npos;
+            } else if (haystack.kind == Kind::List) {
+                found = std::any_of(haystack.items.begin(), haystack.items.end(),
+                                    [&needle](const TemplateValue& item) { return equal(item, needle); });
+            } else if (haystack.kind == Kind::Map && needle.kind == Kind::String) {
+                found = haystack.find(needle.string) != nullptr;
+            }
+            tmp = TemplateValue::of(found == (expr.op == ExprOp::In));
+            return tmp;
+        }
+        case ExprOp::Concat: {
+            std::string& text = t_arena.next();
+            append_value(text, eval(expr.lhs, a));
+            append_value(text, eval(expr.rhs, b));
+            tmp = TemplateValue::of(std::string_view(text));
+            return tmp;
+        }
+        case ExprOp::Add:
+        case ExprOp::Sub: {
+            const TemplateValue& lhs = eval(expr.lhs, a);
+            const TemplateValue& rhs = eval(expr.rhs, b);
+            if (lhs.kind == Kind::Int && rhs.kind == Kind::Int) {
+                // Jinja's integers do not overflow; ours give undefined rather than wrap.
+                int64_t result;
+                bool overflow = expr.op == ExprOp::Add ? __builtin_add_overflow(lhs.integer, rhs.integer, &result)
+                                                       : __builtin_sub_overflow(lhs.integer, rhs.integer, &result);
+                tmp = overflow ? TemplateValue() : TemplateValue::of(result);
+            } else if (expr.op == ExprOp::Add && lhs.kind == Kind::String && rhs.kind == Kind::String) {
+                std::string& text = t_arena.next();
+                text.append(lhs.string).append(rhs.string);
+                tmp = TemplateValue::of(std::string_view(text));
+            } else if (expr.op == ExprOp::Add && lhs.kind == Kind::List && rhs.kind == Kind::List) {
+                tmp = TemplateValue::list(lhs.items);
+                tmp.items.insert(tmp.items.end(), rhs.items.begin(), rhs.items.end());
+            } else {
+                tmp = TemplateValue();
+            }
+            return tmp;
+        }
+        }
+        return kUndefined;
+    }
+
+    const TemplateValue& filter(const Expr& expr, TemplateValue& tmp) {
+        TemplateValue a;
+        const TemplateValue& value = eval(expr.lhs, a);
+        auto arg = [&](size_t i, TemplateValue& slot) -> const TemplateValue& {
+            return i < expr.args.size() ? eval(expr.args[i], slot) : kUndefined;
+        };
+        auto text_result = [&tmp](std::string& text) -> const TemplateValue& {
+            tmp = TemplateValue::of(std::string_view(text));
+            return tmp;
+        };
+        auto mapped = [&](auto&& transform) -> const TemplateValue& {
+            std::string_view source = stringify(value);
+            std::string& text = t_arena.next();
+            text.assign(source);
+            transform(text);
+            return text_result(text);
+        };
+
+        switch (static_cast<FilterId>(expr.fn)) {
+        case FilterId::Upper:
+            return mapped([](std::string& s) {
+                for (char& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            });
+        case FilterId::Lower:
+            return mapped([](std::string& s) {
+                for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            });
+        case FilterId::Capitalize:
+            return mapped([](std::string& s) {
+                for (size_t i = 0; i < s.size(); ++i) {
+                    auto c = static_cast<unsigned char>(s[i]);
+                    s[i] = static_cast<char>(i == 0 ? std::toupper(c) : std::tolower(c));
+                }
+            });
+        case FilterId::Title:
+            return mapped([](std::string& s) {
+                bool start = true;
+                for (char& c : s) {
+                    auto u = static_cast<unsigned char>(c);
+                    c = static_cast<char>(start ? std::toupper(u) : std::tolower(u));
+                    start = !std::isalnum(u);
+                }
+            });
+        case FilterId::Trim: {
+            std::string_view text = stringify(value);
+            while (!text.empty() && is_space(text.front())) text.remove_prefix(1);
+            while (!text.empty() && is_space(text.back())) text.remove_suffix(1);
+            tmp = TemplateValue::of(text);
+            return tmp;
+        }
+        case FilterId::String:
+            tmp = TemplateValue::of(stringify(value));
+            return tmp;
+        case FilterId::Length: {
+            size_t size = value.kind == Kind::List ? value.items.size()
+                        : value.kind == Kind::Map ? value.fields.size()
+                        : value.kind == Kind::String ? value.string.size() : 0;
+            tmp = TemplateValue::of(static_cast<int64_t>(size));
+            return tmp;
+        }
+        case FilterId::Int: {
+            if (value.kind == Kind::Int) {
+                return forward(value, value, a, tmp);
+            }
+            int64_t number = 0;
+            if (value.kind == Kind::String) {
+                std::string_view text = value.string;
+                while (!text.empty() && is_space(text.front())) text.remove_prefix(1);
+                std::from_chars(text.data(), text.data() + text.size(), number);
+            } else if (value.kind == Kind::Bool) {
+                number = value.boolean;
+            }
+            tmp = TemplateValue::of(number);
+            return tmp;
+        }
+        case FilterId::First:
+        case FilterId::Last: {
+            bool first = static_cast<FilterId>(expr.fn) == FilterId::First;
+            if (value.kind == Kind::List && !value.items.empty()) {
+                return forward(first ? value.items.front() : value.items.back(), value, a, tmp);
+            }
+            if (value.kind == Kind::String && !value.string.empty()) {
+                tmp = TemplateValue::of(first ? value.string.substr(0, 1) : value.string.substr(value.string.size() - 1));
+                return tmp;
+            }
+            return kUndefined;
+        }
+        case FilterId::Default: {
+            TemplateValue b, c;
+            bool falsy = arg(1, c).truthy();
+            if (value.kind == Kind::None || (falsy && !value.truthy())) {
+                const TemplateValue& fallback = arg(0, b);
+                return forward(fallback, fallback, b, tmp);
+            }
+            return forward(value, value, a, tmp);
+        }
+        case FilterId::Join: {
+            TemplateValue b;
+            std::string_view separator = stringify(arg(0, b));
+            std::string& text = t_arena.next();
+            if (value.kind == Kind::List) {
+                for (size_t i = 0; i < value.items.size(); ++i) {
+                    if (i) text.append(separator);
+                    append_value(text, value.items[i]);
+                }
+            } else {
+                append_value(text, value);
+            }
+            return text_result(text);
+        }
+        case FilterId::Replace: {
+            TemplateValue b, c;
+            std::string_view source = stringify(value);
+            std::string_view from = stringify(arg(0, b));
+            std::string_view to = stringify(arg(1, c));
+            std::string& text = t_arena.next();
+            if (from.empty()) {
+                text.assign(source);
+                return text_result(text);
+            }
+            size_t pos = 0;
+            for (size_t hit; (hit = source.find(from, pos)) != std::string_view::npos; pos = hit + from.size()) {
+                text.append(source, pos, hit - pos).append(to);
+            }
+            text.append(source.substr(pos));
+            return text_result(text);
+        }
+        case FilterId::Indent: {
+            TemplateValue b, c;
+            const TemplateValue& width = arg(0, b);
+            std::string pad(width.kind == Kind::Int ? static_cast<size_t>(std::max<int64_t>(0, width.integer))
+                          : width.kind == Kind::String ? width.string.size() : 4, ' ');
+            if (width.kind == Kind::String) {
+                pad.assign(width.string);
+            }
+            bool indentFirst = arg(1, c).truthy();
+            std::string_view source = stringify(value);
+            std::string& text = t_arena.next();
+            if (indentFirst && !source.empty()) {
+                text.append(pad);
+            }
+            for (size_t i = 0; i < source.size(); ++i) {
+                text.push_back(source[i]);
+                if (source[i] == '\n' && i + 1 < source.size() && source[i + 1] != '\n') {
+                    text.append(pad);
+                }
+            }
+            return text_result(text);
+        }
+        }
+        return kUndefined;
+    }
+
+    const PromptTemplate& m_tmpl;
+    const TemplateValue& m_context;
+    const TemplateValue* m_task;
+    std::string& m_out;
+    std::vector<Binding> m_scope;
+    std::deque<TemplateValue> m_sets;  // Values of {% set %}, which bindings point at.
+};
+
+// --- PromptTemplate ---
+
+PromptTemplate::PromptTemplate() = default;
+PromptTemplate::~PromptTemplate() = default;
+
+bool PromptTemplate::compile(std::string_view source) {
+    m_source.assign(source);
+    m_strings.clear();
+    m_exprs.clear();
+    m_body.clear();
+    m_error.clear();
+    if (!Parser(*this).parse()) {
+        m_exprs.clear();
+        m_body.clear();
+        return false;
+    }
+    return true;
+}
+
+bool PromptTemplate::loadFile(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        m_error = "cannot read " + path;
+        return false;
+    }
+    if (!compile(file.view())) {
+        m_error = path + ": " + m_error;
+        return false;
+    }
+    return true;
+}
+
+void PromptTemplate::render(const TemplateValue& context, std::string& out) const {
+    t_arena.used = 0;
+    Renderer(*this, context, nullptr, out).run(m_body);
+}
+
+void PromptTemplate::render(const PQLTask& task, const TemplateValue& context, std::string& out) const {
+    t_arena.used = 0;
+    TemplateValue value = taskValue(task);
+    Renderer(*this, context, &value, out).run(m_body);
+}
+
+TemplateValue PromptTemplate::taskValue(const PQLTask& task) {
+    auto strings = [](const std::vector<std::string>& lines) {
+        TemplateValue list = TemplateValue::list();
+        list.items.reserve(lines.size());
+        for (const auto& line : lines) {
+            list.items.push_back(TemplateValue::of(std::string_view(line)));
+        }
+        return list;
+    };
+    TemplateValue value = TemplateValue::map();
+    value.fields.reserve(10);
+    value.fields.emplace_back("id", TemplateValue::of(std::string_view(task.id)));
+    value.fields.emplace_back("type", TemplateValue::of(std::string_view(task.type)));
+    value.fields.emplace_back("priority", TemplateValue::of(std::string_view(task.priority)));
+    value.fields.emplace_back("status", TemplateValue::of(std::string_view(task.status)));
+    value.fields.emplace_back("created", TemplateValue::of(std::string_view(task.created)));
+    value.fields.emplace_back("description", TemplateValue::of(std::string_view(task.description)));
+    value.fields.emplace_back("notes", TemplateValue::of(std::string_view(task.notes)));
+    value.fields.emplace_back("commands", strings(task.commands));
+    value.fields.emplace_back("criteria", strings(task.criteria));
+    value.fields.emplace_back("depends_on", strings(task.dependsOn));
+    return value;
+}
+
+// --- TemplateCache ---
+
+std::shared_ptr<const PromptTemplate> TemplateCache::get(const std::string& path, std::string* error) {
+    struct stat info;
+    bool exists = ::stat(path.c_str(), &info) == 0;
+    int64_t mtimeNs = exists ? static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec : 0;
+    uint64_t size = exists ? static_cast<uint64_t>(info.st_size) : 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto [it, added] = m_entries.try_emplace(path);
+    Entry& entry = it->second;
+    if (added || entry.mtimeNs != mtimeNs || entry.size != size) {
+        entry.mtimeNs = mtimeNs;
+        entry.size = size;
+        auto compiled = std::make_shared<PromptTemplate>();
+        if (compiled->loadFile(path)) {
+            entry.compiled = std::move(compiled);
+            entry.error.clear();
+        } else {
+            entry.error = compiled->error();
+        }
+    }
+    if (error) {
+        *error = entry.error;
+    }
+    return entry.compiled;
+}
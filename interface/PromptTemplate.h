@@ -0,0 +1,139 @@
+#ifndef PRISMQUANTA_PROMPT_TEMPLATE_H
+#define PRISMQUANTA_PROMPT_TEMPLATE_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct PQLTask;
+
+/**
+ * @brief A value a template can see: none, a boolean, an integer, a string, a list or a map.
+ *
+ * Strings and map keys are views: whatever they point at (a PQLTask, the
+ * caller's context) must outlive the render. Lists and maps own their
+ * elements. None doubles as Jinja's undefined.
+ */
+struct TemplateValue {
+    enum class Kind : uint8_t { None, Bool, Int, String, List, Map };
+
+    Kind kind = Kind::None;
+    bool boolean = false;
+    int64_t integer = 0;
+    std::string_view string;
+    std::vector<TemplateValue> items;                                  ///< List elements.
+    std::vector<std::pair<std::string_view, TemplateValue>> fields;    ///< Map entries, in insertion order.
+
+    static TemplateValue of(bool value);
+    static TemplateValue of(int64_t value);
+    static TemplateValue of(std::string_view value);
+    static TemplateValue list(std::vector<TemplateValue> items = {});
+    static TemplateValue map();
+
+    /** @brief Sets a map entry, replacing one with the same key. */
+    TemplateValue& set(std::string_view key, TemplateValue value);
+    /** @brief A map entry, or null. */
+    const TemplateValue* find(std::string_view key) const;
+    bool truthy() const;
+};
+
+/**
+ * @brief A Jinja template compiled once and rendered any number of times, from any thread.
+ *
+ * Supported: {{ expressions }}, {% if %}/{% elif %}/{% else %}/{% endif %},
+ * {% for x in list %} (with {% else %} and loop.index, index0, first,
+ * last, length, revindex, revindex0), {% set x = expression %} and
+ * {# comments #}; whitespace control with {%- -%} and {{- -}}. Blocks are
+ * trimmed as Hugging Face renders chat templates (trim_blocks and
+ * lstrip_blocks): the newline after a {% %} tag and the indentation before
+ * it are dropped.
+ *
+ * Expressions: names, attributes (a.b), subscripts (a['b'], a[-1]), string
+ * and integer literals, true/false/none, list literals, parentheses;
+ * operators or, and, not, == != < <= > >=, in, not in, ~, + and -; tests
+ * (x is [not] defined/undefined/none/string/number/mapping/sequence); and
+ * filters capitalize, default (d), first, indent, int, join, last, length
+ * (count), lower, replace, string, title, trim and upper. A missing name,
+ * attribute or item is undefined and renders as nothing, as in Jinja; so
+ * is integer arithmetic that would overflow 64 bits.
+ *
+ * The source is parsed into a tree of statements over a flat table of
+ * expressions; filters and tests are resolved at compile time, so
+ * rendering is a walk of that tree that appends straight to the caller's
+ * buffer. Strings made while rendering (filters, ~) come from a per-thread
+ * arena that keeps its capacity between renders.
+ */
+class PromptTemplate {
+public:
+    PromptTemplate();
+    ~PromptTemplate();
+
+    PromptTemplate(const PromptTemplate&) = delete;
+    PromptTemplate& operator=(const PromptTemplate&) = delete;
+
+    /** @brief Compiles a template, replacing the current one; false (with error()) on a syntax error. */
+    bool compile(std::string_view source);
+
+    /** @brief Compiles a template file. */
+    bool loadFile(const std::string& path);
+
+    /** @brief "line N: ..." for the first syntax error. */
+    const std::string& error() const { return m_error; }
+
+    /** @brief Renders with @p context (a map) as the top-level names, appending to @p out. */
+    void render(const TemplateValue& context, std::string& out) const;
+
+    /** @brief Renders with the task as `task` (see taskValue()) on top of @p context. */
+    void render(const PQLTask& task, const TemplateValue& context, std::string& out) const;
+
+    /**
+     * @brief A task as a map: id, type, priority, status, created, description, notes,
+     *        and the lists commands, criteria and depends_on. Views into @p task.
+     */
+    static TemplateValue taskValue(const PQLTask& task);
+
+    struct Expr;
+    struct Node;
+
+private:
+    class Parser;
+    class Renderer;
+
+    std::string m_source;
+    std::deque<std::string> m_strings;  // Literals that needed unescaping.
+    std::vector<Expr> m_exprs;
+    std::vector<Node> m_body;
+    std::string m_error;
+};
+
+/**
+ * @brief Compiled templates by path, compiled again when a file's mtime or size changes.
+ *
+ * Checking costs one stat() per get(). A template that stops compiling
+ * (or disappears) keeps being served in its last good version, and the
+ * failure is reported through @p error until the file is fixed. Thread-safe.
+ */
+class TemplateCache {
+public:
+    /** @brief The template at @p path, or null if it never compiled. */
+    std::shared_ptr<const PromptTemplate> get(const std::string& path, std::string* error = nullptr);
+
+private:
+    struct Entry {
+        int64_t mtimeNs = 0;
+        uint64_t size = 0;
+        std::shared_ptr<const PromptTemplate> compiled;
+        std::string error;  // Why the file as it is now did not compile.
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+};
+
+#endif //PRISMQUANTA_PROMPT_TEMPLATE_H
@@ -0,0 +1,135 @@
+#include "QueueWatcher.h"
+#include "Logger.h"
+#include <algorithm>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+QueueWatcher::QueueWatcher(fs::path directory, std::chrono::seconds pollInterval)
+    : m_directory(std::move(directory)), m_pollInterval(pollInterval) {}
+
+QueueWatcher::~QueueWatcher() {
+    disableInotify();
+}
+
+bool QueueWatcher::start() {
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+        m_watchDescriptor = inotify_add_watch(m_inotifyFd, m_directory.c_str(), IN_MOVED_TO | IN_CLOSE_WRITE);
+        if (m_watchDescriptor < 0) {
+            Logger::instance().warn("QueueWatcher", "inotify watch on " + m_directory.string() + " failed (" +
+                                    std::strerror(errno) + "); falling back to polling.");
+            disableInotify();
+        }
+    } else {
+        Logger::instance().warn("QueueWatcher", std::string("inotify unavailable (") + std::strerror(errno) +
+                                "); falling back to polling.");
+    }
+
+    // The watch is installed before the initial scan so no file can slip between the two.
+    return rescan();
+}
+
+void QueueWatcher::disableInotify() {
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+    }
+    m_inotifyFd = -1;
+    m_watchDescriptor = -1;
+}
+
+void QueueWatcher::enqueue(const std::string& name) {
+    // Writers stage files as hidden or .tmp names and rename them in when complete.
+    bool staging = name.empty() || name[0] == '.' ||
+                   (name.size() >= 4 && name.compare(name.size() - 4, 4, ".tmp") == 0);
+    if (!staging && m_queued.insert(name).second) {
+        m_ready.push_back(name);
+    }
+}
+
+bool QueueWatcher::rescan() {
+    m_lastScan = std::chrono::steady_clock::now();
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(m_directory, ec)) {
+        if (entry.is_regular_file(ec)) {
+            enqueue(entry.path().filename().string());
+        }
+    }
+    if (ec) {
+        Logger::instance().error("QueueWatcher", "Could not scan queue directory " + m_directory.string() + ": " + ec.message());
+        return false;
+    }
+    return true;
+}
+
+bool QueueWatcher::waitForEvents(std::chrono::milliseconds timeout) {
+    struct pollfd pfd = {m_inotifyFd, POLLIN, 0};
+    int ready = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    if (ready <= 0) {
+        return false;
+    }
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    bool overflowed = false;
+    while (true) {
+        ssize_t len = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            break;
+        }
+        for (char* ptr = buffer; ptr < buffer + len;) {
+            auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+            } else if (event->mask & IN_IGNORED) {
+                // The directory itself went away; nothing more will arrive from this watch.
+                Logger::instance().warn("QueueWatcher", "Lost inotify watch on " + m_directory.string() + "; falling back to polling.");
+                disableInotify();
+                return rescan() && !m_ready.empty();
+            } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                enqueue(event->name);
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    // Events were dropped, so the ready list may be missing files.
+    if (overflowed) {
+        rescan();
+    }
+    return !m_ready.empty();
+}
+
+std::optional<fs::path> QueueWatcher::next(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    // Callers with work in hand ask with a zero timeout; polling must still look for new files.
+    if (!usingInotify() && std::chrono::steady_clock::now() - m_lastScan >= m_pollInterval) {
+        rescan();
+    }
+
+    while (m_ready.empty()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (usingInotify()) {
+            // A zero timeout still drains events that have already arrived.
+            waitForEvents(std::max(remaining, std::chrono::milliseconds(0)));
+            if (!m_ready.empty()) {
+                break;
+            }
+        } else if (remaining.count() > 0) {
+            std::this_thread::sleep_for(std::min<std::chrono::milliseconds>(remaining, m_pollInterval));
+            rescan();
+            continue;
+        }
+        if (remaining.count() <= 0) {
+            return std::nullopt;
+        }
+    }
+
+    std::string name = std::move(m_ready.front());
+    m_ready.pop_front();
+    m_queued.erase(name);
+    return m_directory / name;
+}
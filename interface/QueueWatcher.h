@@ -0,0 +1,70 @@
+#ifndef PRISMQUANTA_QUEUE_WATCHER_H
+#define PRISMQUANTA_QUEUE_WATCHER_H
+
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Tracks the files waiting in a queue directory.
+ *
+ * On Linux the directory is watched with inotify (IN_MOVED_TO and
+ * IN_CLOSE_WRITE), so new files are appended to an in-memory ready list as
+ * soon as they are complete and the directory is never rescanned per task.
+ * If inotify is unavailable, or its event queue overflows, the watcher falls
+ * back to scanning the directory once per poll interval, whether or not the
+ * caller is waiting, so files dropped in while a backlog drains are seen.
+ *
+ * Hidden files and *.tmp files are never reported: they are how writers
+ * stage a task before renaming it into the queue.
+ *
+ * A path returned by next() may already have been taken by another process;
+ * callers claim it with an atomic rename and skip it if that fails.
+ */
+class QueueWatcher {
+public:
+    QueueWatcher(fs::path directory, std::chrono::seconds pollInterval);
+    ~QueueWatcher();
+
+    QueueWatcher(const QueueWatcher&) = delete;
+    QueueWatcher& operator=(const QueueWatcher&) = delete;
+
+    /**
+     * @brief Starts watching and seeds the ready list with the files already present.
+     * @return False if the directory cannot be read.
+     */
+    bool start();
+
+    /**
+     * @brief Returns the next pending file, waiting up to the given timeout for one to arrive.
+     * @return The file's path, or an empty optional if the timeout expired first.
+     */
+    std::optional<fs::path> next(std::chrono::milliseconds timeout);
+
+    /** @brief True while change notifications come from inotify rather than polling. */
+    bool usingInotify() const { return m_inotifyFd >= 0; }
+
+    /** @brief Number of files currently known to be waiting. */
+    size_t pendingCount() const { return m_ready.size(); }
+
+private:
+    bool rescan();
+    bool waitForEvents(std::chrono::milliseconds timeout);
+    void enqueue(const std::string& name);
+    void disableInotify();
+
+    fs::path m_directory;
+    std::chrono::seconds m_pollInterval;
+    std::chrono::steady_clock::time_point m_lastScan;
+    int m_inotifyFd = -1;
+    int m_watchDescriptor = -1;
+    std::deque<std::string> m_ready;
+    std::unordered_set<std::string> m_queued;
+};
+
+#endif //PRISMQUANTA_QUEUE_WATCHER_H
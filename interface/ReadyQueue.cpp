@@ -0,0 +1,210 @@
+#include "ReadyQueue.h"
+#include "xml_parser.h"
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // The <task> start tag sits at the top of a queue file; this is plenty to reach it.
+    constexpr size_t kHeaderBytes = 4096;
+
+    bool parse_task_header(std::string_view xml, std::string& priority, std::string& created) {
+        QuantaPorto::XmlReader reader(xml.substr(0, kHeaderBytes));
+        while (true) {
+            QuantaPorto::XmlEvent event = reader.next();
+            if (event == QuantaPorto::XmlEvent::EndDocument || event == QuantaPorto::XmlEvent::Error) {
+                return false;
+            }
+            if (event == QuantaPorto::XmlEvent::StartElement && reader.name() == "task") {
+                priority = std::string(reader.attribute("priority"));
+                created = std::string(reader.attribute("created"));
+                return true;
+            }
+        }
+    }
+
+    size_t read_task_header(const fs::path& file, char (&buffer)[kHeaderBytes]) {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return 0;
+        }
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        close(fd);
+        return len > 0 ? static_cast<size_t>(len) : 0;
+    }
+
+    int64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool read_digits(std::string_view value, size_t pos, size_t count, int& out) {
+        if (pos + count > value.size()) {
+            return false;
+        }
+        out = 0;
+        for (size_t i = pos; i < pos + count; ++i) {
+            if (value[i] < '0' || value[i] > '9') {
+                return false;
+            }
+            out = out * 10 + (value[i] - '0');
+        }
+        return true;
+    }
+} // namespace
+
+ReadyQueue::ReadyQueue(std::chrono::seconds agingInterval)
+    : m_agingMs(std::chrono::duration_cast<std::chrono::milliseconds>(agingInterval).count()) {}
+
+int ReadyQueue::priorityRank(std::string_view priority) {
+    if (priority == "high") return 0;
+    if (priority == "low") return 2;
+    return 1;
+}
+
+std::optional<int64_t> ReadyQueue::parseTimestamp(std::string_view value) {
+    struct tm tm = {};
+    int year, month, day, hour, minute, second;
+    if (!read_digits(value, 0, 4, year) || value.size() < 19 || value[4] != '-' ||
+        !read_digits(value, 5, 2, month) || value[7] != '-' || !read_digits(value, 8, 2, day) ||
+        (value[10] != 'T' && value[10] != ' ') || !read_digits(value, 11, 2, hour) || value[13] != ':' ||
+        !read_digits(value, 14, 2, minute) || value[16] != ':' || !read_digits(value, 17, 2, second)) {
+        return std::nullopt;
+    }
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    int64_t ms = static_cast<int64_t>(timegm(&tm)) * 1000;
+
+    size_t pos = 19;
+    if (pos < value.size() && value[pos] == '.') {
+        int64_t scale = 100;
+        for (++pos; pos < value.size() && value[pos] >= '0' && value[pos] <= '9'; ++pos) {
+            ms += (value[pos] - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+        int offset_hours, offset_minutes;
+        if (!read_digits(value, pos + 1, 2, offset_hours) || pos + 3 >= value.size() || value[pos + 3] != ':' ||
+            !read_digits(value, pos + 4, 2, offset_minutes)) {
+            return std::nullopt;
+        }
+        int64_t offset_ms = (offset_hours * 60 + offset_minutes) * 60 * 1000;
+        ms += value[pos] == '+' ? -offset_ms : offset_ms;
+    }
+    // No zone designator (or 'Z') is treated as UTC.
+    return ms;
+}
+
+int64_t ReadyQueue::rank(std::string_view taskXml, int64_t arrivedMs) const {
+    std::string priority;
+    std::string created;
+    int64_t base = arrivedMs;
+    if (parse_task_header(taskXml, priority, created)) {
+        if (auto ts = parseTimestamp(created)) {
+            base = std::min(*ts, arrivedMs);
+        }
+    }
+    return base + priorityRank(priority) * m_agingMs;
+}
+
+void ReadyQueue::add(const fs::path& file) {
+    std::string path = file.string();
+    int64_t arrived = now_ms();
+    if (auto it = m_index.find(path); it != m_index.end()) {
+        arrived = m_heap[it->second].arrivedMs;
+    }
+    char buffer[kHeaderBytes];
+    size_t len = read_task_header(file, buffer);
+    update(std::move(path), rank(std::string_view(buffer, len), arrived), arrived);
+}
+
+void ReadyQueue::push(const fs::path& file, int64_t key) {
+    update(file.string(), key, now_ms());
+}
+
+void ReadyQueue::update(std::string path, int64_t key, int64_t arrivedMs) {
+    if (auto it = m_index.find(path); it != m_index.end()) {
+        size_t index = it->second;
+        if (m_heap[index].key == key) {
+            return;
+        }
+        m_heap[index].key = key;
+        siftDown(siftUp(index));
+        return;
+    }
+    m_heap.push_back(Entry{key, m_sequence++, arrivedMs, path});
+    m_index[std::move(path)] = m_heap.size() - 1;
+    siftUp(m_heap.size() - 1);
+}
+
+std::optional<fs::path> ReadyQueue::pop() {
+    if (m_heap.empty()) {
+        return std::nullopt;
+    }
+    fs::path next = m_heap.front().path;
+    removeAt(0);
+    return next;
+}
+
+bool ReadyQueue::remove(const fs::path& file) {
+    auto it = m_index.find(file.string());
+    if (it == m_index.end()) {
+        return false;
+    }
+    removeAt(it->second);
+    return true;
+}
+
+void ReadyQueue::place(size_t index, Entry entry) {
+    m_index[entry.path] = index;
+    m_heap[index] = std::move(entry);
+}
+
+void ReadyQueue::removeAt(size_t index) {
+    m_index.erase(m_heap[index].path);
+    size_t last = m_heap.size() - 1;
+    if (index != last) {
+        place(index, std::move(m_heap[last]));
+        m_heap.pop_back();
+        siftDown(siftUp(index));
+    } else {
+        m_heap.pop_back();
+    }
+}
+
+size_t ReadyQueue::siftUp(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!before(m_heap[index], m_heap[parent])) {
+            break;
+        }
+        Entry moved = std::move(m_heap[index]);
+        place(index, std::move(m_heap[parent]));
+        place(parent, std::move(moved));
+        index = parent;
+    }
+    return index;
+}
+
+void ReadyQueue::siftDown(size_t index) {
+    size_t count = m_heap.size();
+    while (true) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < count && before(m_heap[left], m_heap[smallest])) smallest = left;
+        if (right < count && before(m_heap[right], m_heap[smallest])) smallest = right;
+        if (smallest == index) {
+            break;
+        }
+        Entry moved = std::move(m_heap[index]);
+        place(index, std::move(m_heap[smallest]));
+        place(smallest, std::move(moved));
+        index = smallest;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef PRISMQUANTA_READY_QUEUE_H
+#define PRISMQUANTA_READY_QUEUE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Indexed min-heap of pending task files ordered by priority and age.
+ *
+ * Each file is ranked once, when it is added, from its task's priority and
+ * created attributes (only the opening <task> tag is read). The sort key is
+ *
+ *     created + rank(priority) * agingInterval
+ *
+ * where rank is 0 for high, 1 for medium (the schema default) and 2 for low.
+ * A task therefore outranks anything of a lower priority that arrived less
+ * than one aging interval after it, and a waiting task cannot be starved:
+ * after agingInterval * 2 even a low-priority task is ahead of any new
+ * arrival. Because keys never change as time passes, the heap never needs
+ * to be re-sorted. Tasks without a created timestamp use their arrival time.
+ */
+class ReadyQueue {
+public:
+    explicit ReadyQueue(std::chrono::seconds agingInterval);
+
+    /**
+     * @brief Ranks a task file and inserts it, or re-ranks it if it is already queued.
+     *
+     * A file keeps the arrival time it was first added with, so seeing it
+     * again (a rescan, a second close of the writer) changes nothing unless
+     * its priority or created attribute did.
+     */
+    void add(const fs::path& file);
+
+    /**
+     * @brief The sort key for a task, from the start of its XML (the opening <task> tag is enough).
+     * @param arrivedMs When the task arrived; used if it has no created timestamp or one in the future.
+     */
+    int64_t rank(std::string_view taskXml, int64_t arrivedMs) const;
+
+    /**
+     * @brief Inserts or updates a file with an explicit sort key (milliseconds since the epoch).
+     */
+    void push(const fs::path& file, int64_t key);
+
+    /**
+     * @brief Removes and returns the file that should run next.
+     */
+    std::optional<fs::path> pop();
+
+    /**
+     * @brief Drops a file, e.g. because it disappeared from the queue.
+     * @return True if the file was queued.
+     */
+    bool remove(const fs::path& file);
+
+    bool empty() const { return m_heap.empty(); }
+    size_t size() const { return m_heap.size(); }
+
+    /**
+     * @brief Maps a PQL priority to its rank: high 0, medium 1, low 2. Unknown values count as medium.
+     */
+    static int priorityRank(std::string_view priority);
+
+    /**
+     * @brief Parses an xs:dateTime value (YYYY-MM-DDThh:mm:ss[.fff][Z|+hh:mm|-hh:mm]).
+     * @return Milliseconds since the epoch, or an empty optional if the value is malformed.
+     */
+    static std::optional<int64_t> parseTimestamp(std::string_view value);
+
+private:
+    struct Entry {
+        int64_t key;
+        uint64_t sequence;
+        int64_t arrivedMs;  // When the file was first added.
+        std::string path;
+    };
+
+    static bool before(const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+    }
+
+    void update(std::string path, int64_t key, int64_t arrivedMs);
+    size_t siftUp(size_t index);
+    void siftDown(size_t index);
+    void place(size_t index, Entry entry);
+    void removeAt(size_t index);
+
+    int64_t m_agingMs;
+    uint64_t m_sequence = 0;
+    std::vector<Entry> m_heap;
+    std::unordered_map<std::string, size_t> m_index;
+};
+
+#endif //PRISMQUANTA_READY_QUEUE_H
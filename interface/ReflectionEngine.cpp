@@ -0,0 +1,63 @@
+#include "ReflectionEngine.h"
+#include "RuleEngine.h"
+#include <algorithm>
+
+namespace {
+    // Bytes of the rejected response quoted back to the model.
+    constexpr size_t kExcerptBytes = 600;
+
+    std::string_view excerpt(std::string_view text, const RuleReport& report) {
+        if (text.size() <= kExcerptBytes) {
+            return text;
+        }
+        const RuleMatch* blocker = report.blocker();
+        if (!blocker && !report.violations.empty()) {
+            blocker = &report.violations.front();
+        }
+        size_t center = blocker && blocker->offset < text.size() ? blocker->offset : text.size();
+        size_t start = center > kExcerptBytes / 2 ? center - kExcerptBytes / 2 : 0;
+        start = std::min(start, text.size() - kExcerptBytes);
+        return text.substr(start, kExcerptBytes);
+    }
+
+    void append_feedback(std::string& out, std::string_view subject, const RuleReport& report,
+                         const std::vector<std::string>& instructions) {
+        out.append(subject);
+        if (report.violations.empty()) {
+            out.append(" was rejected.\n");
+        } else {
+            out.append(" was rejected because it broke these content rules:\n");
+            for (const auto& match : report.violations) {
+                out.append("- ").append(match.violation()).append("\n");
+            }
+        }
+        if (!report.suggestions.empty() || !instructions.empty()) {
+            out.append("Guidance:\n");
+            for (const auto& suggestion : report.suggestions) {
+                out.append("- ").append(suggestion).append("\n");
+            }
+            for (const auto& instruction : instructions) {
+                out.append("- ").append(instruction).append("\n");
+            }
+        }
+    }
+} // namespace
+
+std::string ReflectionEngine::reflect(std::string_view failedResponse, const RuleReport& report,
+                                      const std::vector<std::string>& instructions) const {
+    std::string out;
+    append_feedback(out, "Your previous answer", report, instructions);
+    std::string_view quoted = excerpt(failedResponse, report);
+    if (!quoted.empty()) {
+        out.append("The rejected passage was:\n<<<\n").append(quoted).append("\n>>>\n");
+    }
+    out.append("Answer the task again from the beginning without these problems.\n");
+    return out;
+}
+
+void ReflectionEngine::appendRetry(std::string& conversation, std::string_view failedResponse,
+                                   const RuleReport& report, const std::vector<std::string>& instructions) const {
+    conversation.append(failedResponse).append("\n\n");
+    append_feedback(conversation, "The answer above", report, instructions);
+    conversation.append("Answer the task again from the beginning without these problems.\n\n");
+}
@@ -0,0 +1,41 @@
+#ifndef PRISMQUANTA_REFLECTION_ENGINE_H
+#define PRISMQUANTA_REFLECTION_ENGINE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct RuleReport;
+
+/**
+ * @brief Turns a rejected response into corrective instructions for the next attempt.
+ *
+ * The result names the checker findings, repeats its mitigation
+ * suggestions and the instructions of any rules.xml consequences, and
+ * quotes the offending passage (around the first blocking finding, or the
+ * end of a response that was stopped mid-generation), so the model can be
+ * re-prompted without starting from nothing.
+ */
+class ReflectionEngine {
+public:
+    /**
+     * @param failedResponse The rejected text; may be a partial generation.
+     * @param report What the RuleEngine found in it.
+     * @param instructions Messages from the consequences of rules.xml rules that fired.
+     */
+    std::string reflect(std::string_view failedResponse, const RuleReport& report,
+                        const std::vector<std::string>& instructions = {}) const;
+
+    /**
+     * @brief Extends a conversation with the rejected response and the feedback on it.
+     *
+     * Only appends, so the next request shares everything already sent and
+     * generated as its prefix and the server's cached KV state for it is
+     * reused; the response is in the context itself, so it is not quoted.
+     * @param conversation The prompt that produced @p failedResponse.
+     */
+    void appendRetry(std::string& conversation, std::string_view failedResponse, const RuleReport& report,
+                     const std::vector<std::string>& instructions = {}) const;
+};
+
+#endif //PRISMQUANTA_REFLECTION_ENGINE_H
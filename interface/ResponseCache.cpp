@@ -0,0 +1,371 @@
+#include "ResponseCache.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t size;
+        uint64_t keyHi;
+        uint64_t keyLo;
+        uint64_t lastUsed;
+        uint64_t checksum;  // Of the key, size and value; lastUsed changes in place and is left out.
+    };
+    static_assert(sizeof(RecordHeader) == 40, "record header must stay 40 bytes");
+
+    constexpr char kFileMagic[8] = {'P', 'Q', 'R', 'C', 2, 0, 0, 0};
+    constexpr size_t kFileHeader = sizeof(kFileMagic);
+    constexpr uint32_t kLiveMagic = 0x51524543;  // Record in use.
+    constexpr uint32_t kDeadMagic = 0x44454144;  // Evicted or superseded; skipped when indexing.
+    constexpr size_t kStampOffset = offsetof(RecordHeader, lastUsed);
+
+    // Dead space below this is not worth a rewrite.
+    constexpr size_t kMinCompactBytes = 1 << 20;
+
+    uint64_t checksum(uint64_t keyHi, uint64_t keyLo, uint32_t size, std::string_view value) {
+        Hasher hasher;
+        hasher.update(std::string_view(reinterpret_cast<const char*>(&keyHi), sizeof(keyHi)));
+        hasher.update(std::string_view(reinterpret_cast<const char*>(&keyLo), sizeof(keyLo)));
+        hasher.update(std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)));
+        return hasher.update(value).digest64();
+    }
+
+    bool intact(const char* record) {
+        RecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        return checksum(header.keyHi, header.keyLo, header.size, std::string_view(record + sizeof(header), header.size)) ==
+               header.checksum;
+    }
+
+    bool write_all(int fd, const char* data, size_t size, off_t offset) {
+        while (size > 0) {
+            ssize_t n = pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += n;
+        }
+        return true;
+    }
+} // namespace
+
+ResponseCache::~ResponseCache() {
+    close();
+}
+
+size_t ResponseCache::recordSize(size_t valueSize) {
+    return (sizeof(RecordHeader) + valueSize + 7) & ~static_cast<size_t>(7);
+}
+
+bool ResponseCache::open(const Config& config) {
+    int maxMb = config.getInt("LLM_CACHE_MAX_MB").value_or(64);
+    if (maxMb <= 0) {
+        return false;
+    }
+    std::string path = config.getString("LLM_CACHE_FILE").value_or("cache/llm_responses.cache");
+    if (!open(path, static_cast<size_t>(maxMb) * 1024 * 1024)) {
+        Logger::instance().warn("ResponseCache", "Could not open response cache '" + path + "': " + std::strerror(errno));
+        return false;
+    }
+    Stats loaded = stats();
+    Logger::instance().info("ResponseCache", "Opened " + path + " with " + std::to_string(loaded.entries) + " cached responses.");
+    return true;
+}
+
+bool ResponseCache::open(const std::string& path, size_t maxBytes) {
+    close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    fs::path cachePath(path);
+    std::error_code ec;
+    if (cachePath.has_parent_path()) {
+        fs::create_directories(cachePath.parent_path(), ec);
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // Appends and compaction assume a single writer.
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err == EWOULDBLOCK ? EBUSY : err;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    char magic[kFileHeader] = {};
+    if (size < kFileHeader || pread(fd, magic, kFileHeader, 0) != static_cast<ssize_t>(kFileHeader) ||
+        std::memcmp(magic, kFileMagic, kFileHeader) != 0) {
+        // New, or not ours: start over.
+        if (ftruncate(fd, 0) != 0 || !write_all(fd, kFileMagic, kFileHeader, 0)) {
+            ::close(fd);
+            return false;
+        }
+        size = kFileHeader;
+    }
+
+    m_path = path;
+    m_maxBytes = maxBytes;
+    m_fd = fd;
+    m_fileSize = size;
+    m_stats = Stats();
+    if (!mapTo(m_fileSize)) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    index();
+    evictLocked();
+    return true;
+}
+
+void ResponseCache::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_map) {
+        munmap(m_map, m_mapped);
+        m_map = nullptr;
+        m_mapped = 0;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_entries.clear();
+    m_lru.clear();
+    m_liveBytes = 0;
+    m_fileSize = 0;
+}
+
+bool ResponseCache::mapTo(size_t length) {
+    if (length <= m_mapped) {
+        return true;
+    }
+    if (m_map) {
+        munmap(m_map, m_mapped);
+        m_map = nullptr;
+        m_mapped = 0;
+    }
+    void* addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    m_map = static_cast<char*>(addr);
+    m_mapped = length;
+    return true;
+}
+
+void ResponseCache::index() {
+    size_t offset = kFileHeader;
+    size_t damaged = 0;
+    while (offset + sizeof(RecordHeader) <= m_fileSize) {
+        RecordHeader header;
+        std::memcpy(&header, m_map + offset, sizeof(header));
+        if ((header.magic != kLiveMagic && header.magic != kDeadMagic) ||
+            offset + recordSize(header.size) > m_fileSize) {
+            break;
+        }
+        if (header.magic == kLiveMagic && !intact(m_map + offset)) {
+            // Its value was not fully written before a crash, or was damaged since.
+            std::memcpy(m_map + offset, &kDeadMagic, sizeof(kDeadMagic));
+            ++damaged;
+        } else if (header.magic == kLiveMagic) {
+            // A later record for the same key supersedes an earlier one.
+            Hash128 key{header.keyHi, header.keyLo};
+            auto [it, inserted] = m_entries.try_emplace(key, Entry{offset, header.size, {}});
+            if (!inserted) {
+                m_liveBytes -= recordSize(it->second.size);
+                it->second = Entry{offset, header.size, {}};
+            }
+            m_liveBytes += recordSize(header.size);
+            m_clock = std::max(m_clock, header.lastUsed);
+        }
+        offset += recordSize(header.size);
+    }
+
+    if (damaged > 0) {
+        Logger::instance().warn("ResponseCache", "Dropped " + std::to_string(damaged) + " damaged record(s) from " + m_path + ".");
+    }
+
+    // Drop a torn tail left by a crash mid-append; the next insert reuses the space.
+    if (offset < m_fileSize) {
+        if (ftruncate(m_fd, static_cast<off_t>(offset)) == 0) {
+            m_fileSize = offset;
+        }
+    }
+
+    // Rebuild recency from the stamps: oldest first, so the most recent ends up in front.
+    std::vector<std::pair<uint64_t, Hash128>> order;
+    order.reserve(m_entries.size());
+    for (const auto& [key, entry] : m_entries) {
+        uint64_t stamp;
+        std::memcpy(&stamp, m_map + entry.offset + kStampOffset, sizeof(stamp));
+        order.emplace_back(stamp, key);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& [stamp, key] : order) {
+        m_lru.push_front(key);
+        m_entries[key].lru = m_lru.begin();
+    }
+}
+
+std::optional<std::string> ResponseCache::get(const Hash128& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return std::nullopt;
+    }
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+    Entry& entry = it->second;
+    if (!mapTo(m_fileSize)) {
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+
+    char* record = m_map + entry.offset;
+    if (!intact(record)) {
+        Logger::instance().warn("ResponseCache", "Dropping a damaged record from " + m_path + ".");
+        std::memcpy(record, &kDeadMagic, sizeof(kDeadMagic));
+        m_liveBytes -= recordSize(entry.size);
+        m_lru.erase(entry.lru);
+        m_entries.erase(it);
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+    std::string value(record + sizeof(RecordHeader), entry.size);
+    uint64_t stamp = nextStamp();
+    std::memcpy(record + kStampOffset, &stamp, sizeof(stamp));
+    m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+    ++m_stats.hits;
+    return value;
+}
+
+void ResponseCache::put(const Hash128& key, std::string_view value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0 || value.size() > UINT32_MAX || recordSize(value.size()) > m_maxBytes) {
+        return;
+    }
+
+    auto existing = m_entries.find(key);
+    if (existing != m_entries.end() && mapTo(m_fileSize)) {
+        std::memcpy(m_map + existing->second.offset, &kDeadMagic, sizeof(kDeadMagic));
+        m_liveBytes -= recordSize(existing->second.size);
+        m_lru.erase(existing->second.lru);
+        m_entries.erase(existing);
+    }
+
+    size_t length = recordSize(value.size());
+    std::string record(length, '\0');
+    RecordHeader header{kLiveMagic, static_cast<uint32_t>(value.size()), key.hi, key.lo, nextStamp(), 0};
+    header.checksum = checksum(header.keyHi, header.keyLo, header.size, value);
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), value.data(), value.size());
+    if (!write_all(m_fd, record.data(), record.size(), static_cast<off_t>(m_fileSize))) {
+        Logger::instance().warn("ResponseCache", "Could not append to " + m_path + ": " + std::strerror(errno));
+        return;
+    }
+
+    m_lru.push_front(key);
+    m_entries[key] = Entry{m_fileSize, static_cast<uint32_t>(value.size()), m_lru.begin()};
+    m_fileSize += length;
+    m_liveBytes += length;
+    ++m_stats.inserts;
+    evictLocked();
+}
+
+void ResponseCache::evictLocked() {
+    if (m_liveBytes > m_maxBytes && !mapTo(m_fileSize)) {
+        return;
+    }
+    while (m_liveBytes > m_maxBytes && !m_lru.empty()) {
+        Hash128 victim = m_lru.back();
+        m_lru.pop_back();
+        auto it = m_entries.find(victim);
+        std::memcpy(m_map + it->second.offset, &kDeadMagic, sizeof(kDeadMagic));
+        m_liveBytes -= recordSize(it->second.size);
+        m_entries.erase(it);
+        ++m_stats.evictions;
+    }
+
+    size_t dead = m_fileSize - kFileHeader - m_liveBytes;
+    if (dead > kMinCompactBytes && dead > m_liveBytes) {
+        compactLocked();
+    }
+}
+
+bool ResponseCache::compactLocked() {
+    std::string tmpPath = m_path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!mapTo(m_fileSize)) {
+        ::close(fd);
+        return false;
+    }
+
+    // Copy live records oldest first, so their order in the file follows their age.
+    std::string out(kFileMagic, kFileHeader);
+    out.reserve(kFileHeader + m_liveBytes);
+    for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it) {
+        Entry& entry = m_entries[*it];
+        size_t length = recordSize(entry.size);
+        size_t newOffset = out.size();
+        out.append(m_map + entry.offset, length);
+        entry.offset = newOffset;
+    }
+
+    bool ok = write_all(fd, out.data(), out.size(), 0) && flock(fd, LOCK_EX | LOCK_NB) == 0 &&
+              rename(tmpPath.c_str(), m_path.c_str()) == 0;
+    if (!ok) {
+        // The old file is untouched; put the offsets back by re-indexing it.
+        ::close(fd);
+        unlink(tmpPath.c_str());
+        m_entries.clear();
+        m_lru.clear();
+        m_liveBytes = 0;
+        index();
+        return false;
+    }
+
+    munmap(m_map, m_mapped);
+    m_map = nullptr;
+    m_mapped = 0;
+    ::close(m_fd);
+    m_fd = fd;
+    m_fileSize = out.size();
+    return mapTo(m_fileSize);
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.entries = m_entries.size();
+    stats.liveBytes = m_liveBytes;
+    stats.fileBytes = m_fileSize;
+    return stats;
+}
@@ -0,0 +1,103 @@
+#ifndef PRISMQUANTA_RESPONSE_CACHE_H
+#define PRISMQUANTA_RESPONSE_CACHE_H
+
+#include "Hash.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class Config;
+
+/**
+ * @brief Persistent, content-addressed cache of LLM responses.
+ *
+ * Entries are keyed by a 128-bit hash of everything that determines a
+ * response (model, prompt and sampling parameters; see LLMRunner::cacheKey)
+ * and stored in an append-only file that is memory-mapped for reads, so a
+ * hit costs a hash lookup and one copy out of the page cache.
+ *
+ * Each record carries a last-used stamp that is updated in place on every
+ * hit, so least-recently-used order survives restarts. When live entries
+ * exceed the size cap the oldest are evicted; once more than half of the
+ * file is dead space it is compacted into a fresh file and renamed over
+ * the old one. Thread-safe.
+ *
+ * File layout: an 8-byte header ("PQRC", version), then records of
+ * { magic, value size, key hi, key lo, last used, checksum } followed by
+ * the value, padded to 8 bytes. A torn record at the end (from a crash) is
+ * ignored and overwritten by the next insert. A record whose checksum does
+ * not match its key and value, whether found when the file is indexed or
+ * on a hit, is marked dead and treated as a miss.
+ */
+class ResponseCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t liveBytes = 0;
+        size_t fileBytes = 0;
+
+        double hitRate() const { return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0; }
+    };
+
+    ResponseCache() = default;
+    ~ResponseCache();
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    /**
+     * @brief Opens (or creates) the cache file and indexes its records.
+     * @param maxBytes Cap on the total size of live entries.
+     * @return False if the file could not be opened, created or mapped.
+     */
+    bool open(const std::string& path, size_t maxBytes);
+
+    /** @brief Opens LLM_CACHE_FILE capped at LLM_CACHE_MAX_MB; returns false if disabled (cap of 0) or on error. */
+    bool open(const Config& config);
+
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    std::optional<std::string> get(const Hash128& key);
+    void put(const Hash128& key, std::string_view value);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        uint64_t offset;     // Of the record header.
+        uint32_t size;       // Of the value.
+        std::list<Hash128>::iterator lru;
+    };
+
+    bool mapTo(size_t length);
+    void index();
+    void evictLocked();
+    bool compactLocked();
+    static size_t recordSize(size_t valueSize);
+    uint64_t nextStamp() { return ++m_clock; }
+
+    mutable std::mutex m_mutex;
+    std::string m_path;
+    size_t m_maxBytes = 0;
+    int m_fd = -1;
+    char* m_map = nullptr;
+    size_t m_mapped = 0;
+    size_t m_fileSize = 0;
+    size_t m_liveBytes = 0;
+    uint64_t m_clock = 0;
+
+    std::unordered_map<Hash128, Entry, Hash128Hasher> m_entries;
+    std::list<Hash128> m_lru;  // Most recently used at the front.
+    Stats m_stats;
+};
+
+#endif //PRISMQUANTA_RESPONSE_CACHE_H
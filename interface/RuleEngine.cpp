@@ -0,0 +1,617 @@
+#include "RuleEngine.h"
+#include "Config.h"
+#include "Json.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Trigger words of the script's implicit-bias and intersectional checks.
+    enum class Group : uint8_t {
+        Assumption, GenderTerm, Articulate, BlackAfrican, Normative, FamilyCulture, Identity, Indicator
+    };
+
+    struct Trigger {
+        Group group;
+        std::string_view word;
+    };
+
+    constexpr Trigger kTriggers[] = {
+        {Group::Assumption, "obviously"}, {Group::Assumption, "clearly"},
+        {Group::Assumption, "everyone knows"}, {Group::Assumption, "it's natural that"},
+        {Group::GenderTerm, "men"}, {Group::GenderTerm, "women"}, {Group::GenderTerm, "boys"},
+        {Group::GenderTerm, "girls"}, {Group::GenderTerm, "masculine"}, {Group::GenderTerm, "feminine"},
+        {Group::Articulate, "articulate"}, {Group::Articulate, "well-spoken"},
+        {Group::BlackAfrican, "black"}, {Group::BlackAfrican, "african"},
+        {Group::Normative, "normal"}, {Group::Normative, "standard"}, {Group::Normative, "typical"},
+        {Group::FamilyCulture, "family"}, {Group::FamilyCulture, "culture"}, {Group::FamilyCulture, "tradition"},
+        {Group::Identity, "woman"}, {Group::Identity, "women"}, {Group::Identity, "black"},
+        {Group::Identity, "hispanic"}, {Group::Identity, "asian"}, {Group::Identity, "disabled"},
+        {Group::Identity, "gay"}, {Group::Identity, "lesbian"}, {Group::Identity, "transgender"},
+        {Group::Identity, "muslim"}, {Group::Identity, "jewish"}, {Group::Identity, "elderly"},
+        {Group::Identity, "young"},
+        {Group::Indicator, "aggressive"}, {Group::Indicator, "emotional"}, {Group::Indicator, "irrational"},
+        {Group::Indicator, "threatening"}, {Group::Indicator, "exotic"}, {Group::Indicator, "submissive"},
+        {Group::Indicator, "model minority"},
+    };
+    constexpr size_t kTriggerCount = sizeof(kTriggers) / sizeof(kTriggers[0]);
+
+    constexpr std::string_view kDefaultBiasPatterns =
+        "# Gender Bias Patterns\n"
+        "gender_stereotype_male|men are better at|boys are naturally|masculine traits include\n"
+        "gender_stereotype_female|women are naturally|girls should be|feminine traits include\n"
+        "gender_role_assumption|women belong in|men should provide|traditional gender roles\n"
+        "\n"
+        "# Racial and Ethnic Bias Patterns\n"
+        "racial_stereotype|all [race/ethnicity] people|typical [race/ethnicity] behavior|[race/ethnicity] people always\n"
+        "cultural_appropriation|exotic culture|primitive society|civilized vs uncivilized\n"
+        "racial_profiling|looks suspicious because|criminal type|dangerous neighborhood\n"
+        "\n"
+        "# Age Bias Patterns\n"
+        "ageism_older|too old to learn|past their prime|outdated thinking|senior moment\n"
+        "ageism_younger|too young to understand|inexperienced because of age|millennial entitlement|gen z problems\n"
+        "\n"
+        "# Ability Bias Patterns\n"
+        "ableism_language|suffers from|victim of disability|wheelchair bound|normal people\n"
+        "mental_health_stigma|crazy|insane|psycho|mental case|unstable person\n"
+        "\n"
+        "# Socioeconomic Bias Patterns\n"
+        "class_bias|poor people are lazy|rich people deserve|welfare queens|bootstraps\n"
+        "education_bias|uneducated masses|ivory tower|street smart vs book smart\n"
+        "\n"
+        "# Religious Bias Patterns\n"
+        "religious_stereotype|all [religion] believe|typical [religion] behavior|religious extremism\n"
+        "religious_discrimination|godless society|infidel|heathen|religious superiority\n";
+
+    // Splits file contents into lines, dropping carriage returns.
+    template <typename Fn>
+    void for_each_line(std::string_view text, Fn&& fn) {
+        while (!text.empty()) {
+            size_t newline = text.find('\n');
+            std::string_view line = text.substr(0, newline);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            fn(line);
+            if (newline == std::string_view::npos) {
+                break;
+            }
+            text.remove_prefix(newline + 1);
+        }
+    }
+
+    std::vector<std::string_view> split(std::string_view line, char delimiter) {
+        std::vector<std::string_view> fields;
+        while (true) {
+            size_t pos = line.find(delimiter);
+            fields.push_back(line.substr(0, pos));
+            if (pos == std::string_view::npos) {
+                return fields;
+            }
+            line.remove_prefix(pos + 1);
+        }
+    }
+
+    bool contains(std::string_view haystack, std::string_view needle) {
+        return haystack.find(needle) != std::string_view::npos;
+    }
+
+    // True if a grep basic regular expression uses anything but literal characters.
+    bool has_regex_syntax(std::string_view pattern) {
+        return pattern.find_first_of("[]\\.*^$") != std::string_view::npos;
+    }
+
+    /**
+     * Longest run of literal characters every match of a basic regular
+     * expression must contain, or empty if there is none (or alternation
+     * makes it impossible to tell).
+     */
+    std::string required_literal(std::string_view pattern) {
+        std::string best;
+        std::string run;
+        auto endRun = [&] {
+            if (run.size() > best.size()) best = run;
+            run.clear();
+        };
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c == '[') {
+                endRun();
+                size_t j = i + 1;
+                if (j < pattern.size() && pattern[j] == '^') ++j;
+                if (j < pattern.size() && pattern[j] == ']') ++j;
+                while (j < pattern.size() && pattern[j] != ']') ++j;
+                i = j;
+                // A bracket followed by '*' is optional; either way the run has ended.
+                if (i + 1 < pattern.size() && pattern[i + 1] == '*') ++i;
+            } else if (c == '*') {
+                if (!run.empty()) run.pop_back();
+                endRun();
+            } else if (c == '.' || c == '^' || c == '$') {
+                endRun();
+            } else if (c == '\\' && i + 1 < pattern.size()) {
+                char next = pattern[++i];
+                if (next == '|') {
+                    return {};
+                }
+                if (std::string_view("(){}<>bBwWsS'`+?123456789").find(next) != std::string_view::npos) {
+                    endRun();
+                } else {
+                    run += next;
+                }
+            } else {
+                run += c;
+            }
+        }
+        endRun();
+        return best;
+    }
+
+    // Severity weights from ethics_bias_checker.sh's calculate_severity().
+    int bias_severity(std::string_view violation) {
+        if (contains(violation, "racial_stereotype") || contains(violation, "gender_stereotype") ||
+            contains(violation, "religious_discrimination")) {
+            return 10;
+        }
+        if (contains(violation, "implicit_") || contains(violation, "coded_language") ||
+            contains(violation, "intersectional_")) {
+            return 7;
+        }
+        if (contains(violation, "ageism") || contains(violation, "ableism") || contains(violation, "class_bias")) {
+            return 5;
+        }
+        return 3;
+    }
+
+    int ethics_severity(std::string_view level) {
+        if (level == "critical" || level == "high") return 10;
+        if (level == "medium") return 5;
+        return 3;
+    }
+
+    // Mitigation suggestions from ethics_bias_checker.sh's generate_mitigation().
+    std::string_view suggestion_for(std::string_view violation) {
+        if (contains(violation, "gender_stereotype"))
+            return "Consider using gender-neutral language and avoiding assumptions about gender roles.";
+        if (contains(violation, "racial_stereotype"))
+            return "Avoid generalizations about racial or ethnic groups; focus on individual characteristics.";
+        if (contains(violation, "ageism"))
+            return "Consider age-inclusive language that doesn't make assumptions about capabilities based on age.";
+        if (contains(violation, "ableism"))
+            return "Use person-first language and avoid terms that stigmatize disabilities.";
+        if (contains(violation, "implicit_bias"))
+            return "Question underlying assumptions and consider alternative perspectives.";
+        if (contains(violation, "intersectional_bias"))
+            return "Be aware of how multiple identity factors can compound bias effects and stereotypes.";
+        return {};
+    }
+
+    void append_json_list(std::string& out, std::string_view name, const std::vector<std::string>& items, bool last) {
+        out.append("  \"").append(name).append("\": [\n");
+        for (size_t i = 0; i < items.size(); ++i) {
+            out.append("    ");
+            JsonWriter::appendEscaped(out, items[i]);
+            out.append(i + 1 < items.size() ? ",\n" : "\n");
+        }
+        out.append(last ? "  ]\n" : "  ],\n");
+    }
+} // namespace
+
+// --- RuleReport ---
+
+std::string RuleReport::toJson() const {
+    if (passed()) {
+        return "{\"status\": \"pass\", \"violations\": [], \"severity_score\": 0, \"suggestions\": []}\n";
+    }
+    std::vector<std::string> names;
+    names.reserve(violations.size());
+    for (const auto& match : violations) {
+        names.push_back(match.violation());
+    }
+    std::string out = "{\n  \"status\": \"fail\",\n";
+    append_json_list(out, "violations", names, false);
+    out.append("  \"severity_score\": ").append(std::to_string(severityScore)).append(",\n");
+    append_json_list(out, "suggestions", suggestions, true);
+    out.append("}\n");
+    return out;
+}
+
+std::string RuleReport::toText() const {
+    if (passed()) {
+        return "PASS: No ethics or bias violations detected.\n";
+    }
+    std::string out = "FAIL: Ethics/bias violations detected.\nViolations:\n";
+    for (const auto& match : violations) {
+        out.append("  - ").append(match.violation()).append("\n");
+    }
+    out.append("Severity Score: ").append(std::to_string(severityScore)).append("\nSuggestions:\n");
+    for (const auto& suggestion : suggestions) {
+        out.append("  - ").append(suggestion).append("\n");
+    }
+    return out;
+}
+
+const RuleMatch* RuleReport::blocker() const {
+    for (const auto& match : violations) {
+        if (match.blocking) {
+            return &match;
+        }
+    }
+    return nullptr;
+}
+
+// --- RuleEngine ---
+
+RuleEngine::RuleEngine() {
+    setBiasPatterns(kDefaultBiasPatterns);
+}
+
+std::string_view RuleEngine::defaultBiasPatterns() {
+    return kDefaultBiasPatterns;
+}
+
+bool RuleEngine::load(const Config& config) {
+    Logger& log = Logger::instance();
+    bool ok = true;
+
+    std::string biasPath = config.getString("BIAS_PATTERNS_FILE").value_or("config/bias_patterns.txt");
+    MappedFile bias;
+    if (bias.open(biasPath)) {
+        setBiasPatterns(bias.view());
+    } else {
+        log.info("RuleEngine", "No bias patterns at " + biasPath + "; using the built-in defaults.");
+        setBiasPatterns(kDefaultBiasPatterns);
+    }
+
+    m_ethics.clear();
+    if (auto ethicsPath = config.getString("ETHICS_RULES_FILE")) {
+        MappedFile ethics;
+        if (ethics.open(*ethicsPath)) {
+            setEthicsRules(ethics.view());
+        } else if (fs::exists(*ethicsPath)) {
+            log.warn("RuleEngine", "Could not read ethics rules from " + *ethicsPath);
+            ok = false;
+        }
+    }
+
+    m_intersectional = config.getString("ENABLE_INTERSECTIONAL_CHECK").value_or("true") == "true";
+    m_logging = config.getString("ENABLE_ETHICS_LOGGING").value_or("true") == "true";
+    m_logPath = config.getString("ETHICS_LOG").value_or("logs/ethics_violations.log");
+    m_blockSeverity = config.getInt("RULE_BLOCK_SEVERITY").value_or(10);
+    compile();
+
+    log.info("RuleEngine", "Compiled " + std::to_string(m_bias.size()) + " bias patterns and " +
+             std::to_string(m_ethics.size()) + " ethics rules into " + std::to_string(m_matcher.patternCount()) +
+             " matcher patterns.");
+    return ok;
+}
+
+void RuleEngine::setBiasPatterns(std::string_view text) {
+    m_bias.clear();
+    for_each_line(text, [this](std::string_view line) {
+        if (line.empty() || line.front() == '#') {
+            return;
+        }
+        std::vector<std::string_view> fields = split(line, '|');
+        for (size_t i = 1; i < fields.size(); ++i) {
+            if (fields[i].empty()) {
+                continue;
+            }
+            BiasPattern pattern;
+            pattern.category = std::string(fields[0]);
+            pattern.pattern = std::string(fields[i]);
+            m_bias.push_back(std::move(pattern));
+        }
+    });
+    compile();
+}
+
+void RuleEngine::setEthicsRules(std::string_view text) {
+    m_ethics.clear();
+    bool header = true;
+    for_each_line(text, [this, &header](std::string_view line) {
+        if (header) {
+            header = false;
+            return;
+        }
+        std::vector<std::string_view> fields = split(line, '|');
+        if (fields.size() < 3 || fields[0].empty() || fields[2].empty()) {
+            return;
+        }
+        m_ethics.push_back(EthicsRule{std::string(fields[0]), std::string(fields[1]), std::string(fields[2]),
+                                      fields.size() > 3 ? std::string(fields[3]) : std::string()});
+    });
+    compile();
+}
+
+void RuleEngine::compile() {
+    m_matcher = PatternMatcher();
+    m_targets.clear();
+
+    for (uint32_t i = 0; i < m_bias.size(); ++i) {
+        BiasPattern& pattern = m_bias[i];
+        pattern.isRegex = has_regex_syntax(pattern.pattern);
+        pattern.requiredLiteral = -1;
+        if (!pattern.isRegex) {
+            m_matcher.add(pattern.pattern);
+            m_targets.push_back(Target{Source::Bias, i});
+            continue;
+        }
+        try {
+            pattern.regex = std::regex(pattern.pattern, std::regex::basic | std::regex::icase | std::regex::optimize);
+        } catch (const std::regex_error&) {
+            Logger::instance().warn("RuleEngine", "Skipping invalid pattern '" + pattern.pattern + "' in category " +
+                                    pattern.category);
+            pattern.isRegex = false;
+            pattern.requiredLiteral = -2;  // Never matches.
+            continue;
+        }
+        std::string literal = required_literal(pattern.pattern);
+        if (!literal.empty()) {
+            pattern.requiredLiteral = static_cast<int>(m_matcher.add(literal));
+            m_targets.push_back(Target{Source::Bias, i});
+        }
+    }
+    for (uint32_t i = 0; i < m_ethics.size(); ++i) {
+        m_matcher.add(m_ethics[i].condition, true);
+        m_targets.push_back(Target{Source::Ethics, i});
+    }
+    for (uint32_t i = 0; i < kTriggerCount; ++i) {
+        m_matcher.add(kTriggers[i].word);
+        m_targets.push_back(Target{Source::Trigger, i});
+    }
+    m_matcher.build();
+
+    m_literalOf.assign(m_bias.size(), UINT32_MAX);
+    m_prefilter.assign(m_matcher.patternCount(), false);
+    for (uint32_t id = 0; id < m_targets.size(); ++id) {
+        const Target& target = m_targets[id];
+        if (target.source != Source::Bias) {
+            continue;
+        }
+        if (m_bias[target.index].isRegex) {
+            m_prefilter[id] = true;
+        } else {
+            m_literalOf[target.index] = id;
+        }
+    }
+}
+
+RuleEngine::Scan RuleEngine::beginScan() const {
+    Scan scan;
+    scan.first.assign(m_matcher.patternCount(), std::string_view::npos);
+    scan.count.assign(m_matcher.patternCount(), 0);
+    scan.lines.resize(m_matcher.patternCount());
+    return scan;
+}
+
+void RuleEngine::scanMore(Scan& scan, std::string_view text) const {
+    m_matcher.scan(text, scan.scanned, scan.state, [&](uint32_t id, size_t offset) {
+        if (scan.count[id]++ == 0) {
+            scan.first[id] = offset;
+            scan.changed = true;
+        }
+        if (m_prefilter[id]) {
+            size_t newline = offset == 0 ? std::string_view::npos : text.rfind('\n', offset - 1);
+            size_t start = newline == std::string_view::npos ? 0 : newline + 1;
+            std::vector<size_t>& lines = scan.lines[id];
+            if (lines.empty() || lines.back() != start) {
+                lines.push_back(start);
+                scan.lastLine = start;
+            }
+        }
+    });
+    scan.scanned = text.size();
+}
+
+RuleReport RuleEngine::check(std::string_view text) const {
+    Scan scan = beginScan();
+    scanMore(scan, text);
+    return report(scan, text, true);
+}
+
+RuleReport RuleEngine::report(const Scan& scan, std::string_view text, bool complete) const {
+    constexpr size_t kNone = std::string_view::npos;
+    const std::vector<size_t>& first = scan.first;
+    const std::vector<size_t>& count = scan.count;
+
+    RuleReport report;
+    auto add = [this, &report](RuleMatch match, bool reprompt = false) {
+        match.severity = match.severity ? match.severity : bias_severity(match.violation());
+        match.blocking = reprompt || match.severity >= m_blockSeverity;
+        report.severityScore += match.severity;
+        report.violations.push_back(std::move(match));
+    };
+
+    // Method 1: bias patterns, in file order.
+    std::vector<bool> triggerSeen(kTriggerCount, false);
+    for (uint32_t id = 0; id < m_targets.size(); ++id) {
+        if (m_targets[id].source == Source::Trigger) {
+            triggerSeen[m_targets[id].index] = count[id] > 0;
+        }
+    }
+    for (size_t i = 0; i < m_bias.size(); ++i) {
+        const BiasPattern& pattern = m_bias[i];
+        if (!pattern.isRegex) {
+            uint32_t id = m_literalOf[i];
+            if (id != UINT32_MAX && count[id] > 0) {
+                add(RuleMatch{pattern.category, pattern.pattern, first[id], count[id], 0, {}});
+            }
+            continue;
+        }
+        // Like grep, match line by line; with a required literal, only lines containing it.
+        size_t matches = 0;
+        size_t offset = kNone;
+        auto searchLine = [&](size_t start) {
+            size_t end = text.find('\n', start);
+            auto flags = std::regex_constants::match_default;
+            if (end == std::string_view::npos) {
+                end = text.size();
+                if (!complete) {
+                    flags |= std::regex_constants::match_not_eol;
+                }
+            }
+            const char* base = text.data();
+            for (auto it = std::cregex_iterator(base + start, base + end, pattern.regex, flags);
+                 it != std::cregex_iterator(); ++it) {
+                if (offset == kNone) {
+                    offset = start + static_cast<size_t>(it->position());
+                }
+                ++matches;
+            }
+            return end;
+        };
+        if (pattern.requiredLiteral >= 0) {
+            for (size_t start : scan.lines[static_cast<size_t>(pattern.requiredLiteral)]) {
+                searchLine(start);
+            }
+        } else if (pattern.requiredLiteral == -1) {
+            size_t start = 0;
+            while (start < text.size()) {
+                start = searchLine(start) + 1;
+            }
+        }
+        if (matches > 0) {
+            add(RuleMatch{pattern.category, pattern.pattern, offset, matches, 0, {}});
+        }
+    }
+
+    auto groupSeen = [&](Group group) {
+        for (size_t i = 0; i < kTriggerCount; ++i) {
+            if (kTriggers[i].group == group && triggerSeen[i]) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Method 2: implicit bias, from co-occurring trigger words.
+    if (groupSeen(Group::Assumption) && groupSeen(Group::GenderTerm)) {
+        add(RuleMatch{"implicit_gender_bias", "assumption_language", kNone, 1, 0, {}});
+    }
+    if (groupSeen(Group::Articulate) && groupSeen(Group::BlackAfrican)) {
+        add(RuleMatch{"coded_language", "articulate_assumption", kNone, 1, 0, {}});
+    }
+    if (groupSeen(Group::Normative) && groupSeen(Group::FamilyCulture)) {
+        add(RuleMatch{"cultural_bias", "normative_assumptions", kNone, 1, 0, {}});
+    }
+
+    // Method 3: intersectional bias, identity marker x bias indicator.
+    if (m_intersectional) {
+        for (size_t i = 0; i < kTriggerCount; ++i) {
+            if (kTriggers[i].group != Group::Identity || !triggerSeen[i]) continue;
+            for (size_t j = 0; j < kTriggerCount; ++j) {
+                if (kTriggers[j].group != Group::Indicator || !triggerSeen[j]) continue;
+                add(RuleMatch{"intersectional_bias",
+                              std::string(kTriggers[i].word) + "_" + std::string(kTriggers[j].word), kNone, 1, 0, {}});
+            }
+        }
+    }
+
+    // Ethics rules.
+    for (uint32_t id = 0; id < m_targets.size(); ++id) {
+        if (m_targets[id].source == Source::Ethics && count[id] > 0) {
+            const EthicsRule& rule = m_ethics[m_targets[id].index];
+            add(RuleMatch{rule.id, rule.condition, first[id], count[id], ethics_severity(rule.severity),
+                          rule.consequences},
+                contains(rule.consequences, "reprompt"));
+        }
+    }
+
+    for (const auto& match : report.violations) {
+        std::string_view suggestion = suggestion_for(match.violation());
+        if (!suggestion.empty()) {
+            report.suggestions.emplace_back(suggestion);
+        }
+    }
+    std::sort(report.suggestions.begin(), report.suggestions.end());
+    report.suggestions.erase(std::unique(report.suggestions.begin(), report.suggestions.end()), report.suggestions.end());
+    return report;
+}
+
+bool RuleEngine::evaluate(std::string_view response, RuleReport* report) const {
+    RuleReport local = check(response);
+    bool passed = local.passed();
+    if (!passed) {
+        logViolations(local);
+    }
+    if (report) {
+        *report = std::move(local);
+    }
+    return passed;
+}
+
+RuleEngine::Stream RuleEngine::stream() const {
+    return Stream(*this);
+}
+
+void RuleEngine::logViolations(const RuleReport& report) const {
+    if (!m_logging || report.passed()) {
+        return;
+    }
+    std::error_code ec;
+    fs::path path(m_logPath);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    char stamp[32];
+    time_t now = time(nullptr);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    std::string entry;
+    entry.append(stamp).append(" - Ethics/Bias Violations Detected:\n");
+    for (const auto& match : report.violations) {
+        entry.append("  - ").append(match.violation()).append("\n");
+    }
+    entry.append("  Severity Score: ").append(std::to_string(report.severityScore)).append("\n  Suggestions:\n");
+    for (const auto& suggestion : report.suggestions) {
+        entry.append("    - ").append(suggestion).append("\n");
+    }
+    entry.append("---\n");
+
+    // One append-mode write keeps entries from concurrent workers whole.
+    int fd = ::open(m_logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::instance().warn("RuleEngine", "Could not open ethics log " + m_logPath);
+        return;
+    }
+    ssize_t written = write(fd, entry.data(), entry.size());
+    (void)written;
+    ::close(fd);
+}
+
+// --- RuleEngine::Stream ---
+
+RuleEngine::Stream::Stream(const RuleEngine& engine) : m_engine(engine), m_scan(engine.beginScan()) {}
+
+bool RuleEngine::Stream::feed(std::string_view chunk) {
+    if (chunk.empty()) {
+        return !m_blocked;
+    }
+    ++m_chunks;
+    // Start of the line the chunk extends; a regex candidate on it may now match.
+    size_t newline = m_text.rfind('\n');
+    size_t openLine = newline == std::string::npos ? 0 : newline + 1;
+    m_text.append(chunk);
+
+    m_scan.changed = false;
+    m_engine.scanMore(m_scan, m_text);
+    bool regexPending = m_scan.lastLine != std::string::npos && m_scan.lastLine >= openLine;
+    if (!m_blocked && (m_scan.changed || regexPending)) {
+        m_blocked = m_engine.report(m_scan, m_text, false).blocker() != nullptr;
+    }
+    return !m_blocked;
+}
+
+RuleReport RuleEngine::Stream::finish() const {
+    return m_engine.report(m_scan, m_text, true);
+}
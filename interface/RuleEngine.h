@@ -0,0 +1,199 @@
+#ifndef PRISMQUANTA_RULE_ENGINE_H
+#define PRISMQUANTA_RULE_ENGINE_H
+
+#include "PatternMatcher.h"
+#include <cstddef>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Config;
+
+/**
+ * @brief One detected violation.
+ */
+struct RuleMatch {
+    std::string category;        ///< Bias category, implicit/intersectional label, or ethics rule id.
+    std::string pattern;         ///< The pattern (or label detail) that matched.
+    size_t offset = 0;           ///< Byte offset of the first occurrence; npos for co-occurrence findings.
+    size_t count = 0;            ///< Number of occurrences (1 for co-occurrence findings).
+    int severity = 0;            ///< Contribution to the severity score.
+    std::string consequences;    ///< Comma-separated consequences, for ethics rules.
+    bool blocking = false;       ///< Severe enough to stop generation (see RuleEngine).
+
+    /** @brief "category:pattern", as ethics_bias_checker.sh reports it. */
+    std::string violation() const { return category + ":" + pattern; }
+};
+
+struct RuleReport {
+    std::vector<RuleMatch> violations;
+    int severityScore = 0;
+    std::vector<std::string> suggestions;  ///< Unique and sorted.
+
+    bool passed() const { return violations.empty(); }
+    /** @brief The first blocking finding, or nullptr. */
+    const RuleMatch* blocker() const;
+
+    /** @brief The same document ethics_bias_checker.sh --json prints. */
+    std::string toJson() const;
+    /** @brief The script's human-readable report. */
+    std::string toText() const;
+};
+
+/**
+ * @brief Checks LLM output against the bias patterns and ethics rules in one pass.
+ *
+ * Replaces ethics_bias_checker.sh, which ran a separate grep per pattern,
+ * and ethics_monitor.sh's per-rule substring loop. Every literal pattern
+ * from BIAS_PATTERNS_FILE (category|pattern|pattern...) and every condition
+ * from ETHICS_RULES_FILE (rule_id|severity|condition|consequences, with a
+ * header line) is compiled into a single PatternMatcher, together with the
+ * trigger words of the script's implicit-bias and intersectional checks.
+ * A response is scanned once; the co-occurrence checks are then decided
+ * from which trigger words were seen.
+ *
+ * Bias patterns match case-insensitively, like grep -qi. The script's
+ * patterns are grep basic regular expressions, so the few containing
+ * regex syntax (e.g. "all [race/ethnicity] people") are run through
+ * std::regex instead, and only when a literal they require was seen in the
+ * scan. Ethics rule conditions match case-sensitively, like the monitor.
+ *
+ * Findings are reported in the script's order with the script's severity
+ * weights (10/7/5/3 by category; high/medium/low for ethics rules) and
+ * mitigation suggestions. A finding is blocking when its severity reaches
+ * RULE_BLOCK_SEVERITY (default 10) or it is an ethics rule whose
+ * consequences include reprompt; Stream uses that to stop a generation
+ * early.
+ */
+class RuleEngine {
+public:
+    class Stream;
+
+    RuleEngine();
+
+    /**
+     * @brief Loads BIAS_PATTERNS_FILE and ETHICS_RULES_FILE and the behaviour flags.
+     *
+     * A missing bias patterns file falls back to the script's built-in
+     * defaults; a missing ethics rules file means no ethics rules.
+     * ENABLE_INTERSECTIONAL_CHECK, ENABLE_ETHICS_LOGGING and ETHICS_LOG are
+     * honoured as in the script; RULE_BLOCK_SEVERITY sets the blocking threshold.
+     */
+    bool load(const Config& config);
+
+    /** @brief Replaces the bias patterns with the given file contents. */
+    void setBiasPatterns(std::string_view text);
+    /** @brief Replaces the ethics rules with the given file contents (first line is a header). */
+    void setEthicsRules(std::string_view text);
+    void setIntersectionalCheck(bool enabled) { m_intersectional = enabled; }
+    void setBlockSeverity(int severity) { m_blockSeverity = severity; }
+
+    /** @brief Scans @p text and reports every violation found. */
+    RuleReport check(std::string_view text) const;
+
+    /**
+     * @brief Checks a response, appending any findings to ETHICS_LOG when logging is enabled.
+     * @param report If given, receives the full report.
+     * @return True if the response passed.
+     */
+    bool evaluate(std::string_view response, RuleReport* report = nullptr) const;
+
+    /** @brief Starts an incremental check of a response that is still being generated. */
+    Stream stream() const;
+
+    /** @brief Appends a failed report to ETHICS_LOG when logging is enabled. */
+    void logViolations(const RuleReport& report) const;
+
+    /** @brief The built-in patterns ethics_bias_checker.sh writes when the file is missing. */
+    static std::string_view defaultBiasPatterns();
+
+private:
+    enum class Source : uint8_t { Bias, Ethics, Trigger };
+
+    // What a PatternMatcher id stands for.
+    struct Target {
+        Source source;
+        uint32_t index;  // Into m_bias / m_ethics, or trigger word number.
+    };
+
+    struct BiasPattern {
+        std::string category;
+        std::string pattern;
+        bool isRegex = false;
+        std::regex regex;
+        int requiredLiteral = -1;  // Matcher id that must be seen before the regex is worth running.
+    };
+
+    struct EthicsRule {
+        std::string id;
+        std::string severity;
+        std::string condition;
+        std::string consequences;
+    };
+
+    // Matcher results so far; resumable, so a Stream can scan only what is new.
+    struct Scan {
+        std::vector<size_t> first;               // Per matcher id: first offset, or npos.
+        std::vector<size_t> count;               // Per matcher id: occurrences.
+        std::vector<std::vector<size_t>> lines;  // Per regex literal id: starts of the lines it occurs on.
+        size_t lastLine = std::string::npos;     // Latest line start added to any of those.
+        uint32_t state = 0;
+        size_t scanned = 0;
+        bool changed = false;                    // A pattern was seen for the first time.
+    };
+
+    void compile();
+    Scan beginScan() const;
+    void scanMore(Scan& scan, std::string_view text) const;
+    /** @p complete is false while the last line may still grow, so '$' must not match at its end. */
+    RuleReport report(const Scan& scan, std::string_view text, bool complete) const;
+
+    std::vector<BiasPattern> m_bias;
+    std::vector<EthicsRule> m_ethics;
+    PatternMatcher m_matcher;
+    std::vector<Target> m_targets;
+    std::vector<uint32_t> m_literalOf;  // Per bias pattern: its matcher id (literal patterns only).
+    std::vector<bool> m_prefilter;      // Per matcher id: a regex's required literal.
+
+    int m_blockSeverity = 10;
+    bool m_intersectional = true;
+    bool m_logging = false;
+    std::string m_logPath;
+};
+
+/**
+ * @brief Checks a response chunk by chunk as it streams from the model.
+ *
+ * Matcher state carries over between chunks, so each byte is scanned once
+ * and patterns split across chunk boundaries are still found. feed()
+ * re-evaluates the findings only when a pattern is seen for the first time
+ * or a line holding a regex's required literal grows, and reports false as
+ * soon as a blocking finding appears; the caller then cancels generation.
+ * Holds a reference to the engine, which must outlive it.
+ */
+class RuleEngine::Stream {
+public:
+    explicit Stream(const RuleEngine& engine);
+
+    /** @brief Appends generated text. @return False once a blocking rule has fired. */
+    bool feed(std::string_view chunk);
+
+    bool blocked() const { return m_blocked; }
+    /** @brief Everything fed so far. */
+    const std::string& text() const { return m_text; }
+    size_t chunks() const { return m_chunks; }
+
+    /** @brief The full report on everything fed, with the last line treated as complete. */
+    RuleReport finish() const;
+
+private:
+    const RuleEngine& m_engine;
+    Scan m_scan;
+    std::string m_text;
+    size_t m_chunks = 0;
+    bool m_blocked = false;
+};
+
+#endif //PRISMQUANTA_RULE_ENGINE_H
@@ -0,0 +1,771 @@
+#include "RuleProgram.h"
+#include "Config.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "RuleEngine.h"
+#include "xml_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+struct ConditionNode {
+    enum class Kind : uint8_t { Number, Feature, Contains, Count, Word, Violation, Not, And, Or, Compare };
+
+    Kind kind = Kind::Number;
+    double number = 0;      // Number
+    uint32_t index = 0;     // Feature number, or comparison (0..5 for == != < <= > >=)
+    std::string text;       // Contains/Count/Word literal, Violation category
+    std::unique_ptr<ConditionNode> left;
+    std::unique_ptr<ConditionNode> right;
+};
+
+namespace {
+    using Kind = ConditionNode::Kind;
+    using NodePtr = std::unique_ptr<ConditionNode>;
+
+    constexpr size_t kMaxStack = 64;
+
+    enum Feature : uint32_t { Length, Lines, Words, Tokens, Attempt, Severity, Violations, Empty, FeatureCount };
+
+    constexpr std::string_view kFeatureNames[FeatureCount] = {
+        "length", "lines", "words", "tokens", "attempt", "severity", "violations", "empty",
+    };
+
+    constexpr std::string_view kComparisons[] = {"==", "!=", "<", "<=", ">", ">="};
+
+    NodePtr make_node(Kind kind) {
+        auto node = std::make_unique<ConditionNode>();
+        node->kind = kind;
+        return node;
+    }
+
+    /**
+     * Recursive-descent parser for rule conditions:
+     *   or      := and { ("||" | "or") and }
+     *   and     := unary { ("&&" | "and") unary }
+     *   unary   := ("!" | "not") unary | compare
+     *   compare := primary [ ("==" | "!=" | "<" | "<=" | ">" | ">=") primary ]
+     *   primary := number | string | "true" | "false" | feature
+     *            | ("contains" | "count" | "word" | "violation") "(" string ")" | "(" or ")"
+     */
+    class ConditionParser {
+    public:
+        explicit ConditionParser(std::string_view source) : m_source(source) { advance(); }
+
+        NodePtr parse() {
+            NodePtr node = parseOr();
+            if (node && m_token != Token::End) {
+                return fail("unexpected '" + std::string(m_lexeme) + "'");
+            }
+            return node;
+        }
+
+        const std::string& error() const { return m_error; }
+
+    private:
+        enum class Token { End, Number, String, Ident, LParen, RParen, Not, And, Or, Compare, Invalid };
+
+        NodePtr fail(const std::string& message) {
+            if (m_error.empty()) {
+                m_error = message + " at column " + std::to_string(m_start + 1);
+            }
+            return nullptr;
+        }
+
+        void advance() {
+            while (m_pos < m_source.size() && std::isspace(static_cast<unsigned char>(m_source[m_pos]))) {
+                ++m_pos;
+            }
+            m_start = m_pos;
+            if (m_pos >= m_source.size()) {
+                m_token = Token::End;
+                m_lexeme = {};
+                return;
+            }
+            char c = m_source[m_pos];
+            auto take = [this](Token token, size_t length) {
+                m_token = token;
+                m_lexeme = m_source.substr(m_pos, length);
+                m_pos += length;
+            };
+            auto next_is = [this](char expected) {
+                return m_pos + 1 < m_source.size() && m_source[m_pos + 1] == expected;
+            };
+
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                size_t end = m_pos;
+                while (end < m_source.size() &&
+                       (std::isdigit(static_cast<unsigned char>(m_source[end])) || m_source[end] == '.')) {
+                    ++end;
+                }
+                take(Token::Number, end - m_pos);
+            } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                size_t end = m_pos;
+                while (end < m_source.size() &&
+                       (std::isalnum(static_cast<unsigned char>(m_source[end])) || m_source[end] == '_')) {
+                    ++end;
+                }
+                take(Token::Ident, end - m_pos);
+                if (m_lexeme == "and") m_token = Token::And;
+                else if (m_lexeme == "or") m_token = Token::Or;
+                else if (m_lexeme == "not") m_token = Token::Not;
+            } else if (c == '"' || c == '\'') {
+                m_string.clear();
+                size_t i = m_pos + 1;
+                while (i < m_source.size() && m_source[i] != c) {
+                    if (m_source[i] == '\\' && i + 1 < m_source.size()) {
+                        ++i;
+                    }
+                    m_string += m_source[i++];
+                }
+                if (i >= m_source.size()) {
+                    take(Token::Invalid, m_source.size() - m_pos);
+                    return;
+                }
+                take(Token::String, i + 1 - m_pos);
+            } else if (c == '(') {
+                take(Token::LParen, 1);
+            } else if (c == ')') {
+                take(Token::RParen, 1);
+            } else if (c == '&' && next_is('&')) {
+                take(Token::And, 2);
+            } else if (c == '|' && next_is('|')) {
+                take(Token::Or, 2);
+            } else if ((c == '=' || c == '!' || c == '<' || c == '>') && next_is('=')) {
+                take(Token::Compare, 2);
+            } else if (c == '<' || c == '>') {
+                take(Token::Compare, 1);
+            } else if (c == '!') {
+                take(Token::Not, 1);
+            } else {
+                take(Token::Invalid, 1);
+            }
+        }
+
+        NodePtr parseOr() {
+            NodePtr left = parseAnd();
+            while (left && m_token == Token::Or) {
+                advance();
+                NodePtr node = make_node(Kind::Or);
+                node->left = std::move(left);
+                node->right = parseAnd();
+                if (!node->right) return nullptr;
+                left = std::move(node);
+            }
+            return left;
+        }
+
+        NodePtr parseAnd() {
+            NodePtr left = parseUnary();
+            while (left && m_token == Token::And) {
+                advance();
+                NodePtr node = make_node(Kind::And);
+                node->left = std::move(left);
+                node->right = parseUnary();
+                if (!node->right) return nullptr;
+                left = std::move(node);
+            }
+            return left;
+        }
+
+        NodePtr parseUnary() {
+            if (m_token == Token::Not) {
+                advance();
+                NodePtr node = make_node(Kind::Not);
+                node->left = parseUnary();
+                return node->left ? std::move(node) : nullptr;
+            }
+            return parseCompare();
+        }
+
+        NodePtr parseCompare() {
+            NodePtr left = parsePrimary();
+            if (!left || m_token != Token::Compare) {
+                return left;
+            }
+            NodePtr node = make_node(Kind::Compare);
+            node->index = static_cast<uint32_t>(
+                std::find(std::begin(kComparisons), std::end(kComparisons), m_lexeme) - std::begin(kComparisons));
+            advance();
+            node->left = std::move(left);
+            node->right = parsePrimary();
+            return node->right ? std::move(node) : nullptr;
+        }
+
+        NodePtr parsePrimary() {
+            switch (m_token) {
+            case Token::Number: {
+                NodePtr node = make_node(Kind::Number);
+                std::string digits(m_lexeme);
+                char* end = nullptr;
+                node->number = std::strtod(digits.c_str(), &end);
+                if (end != digits.c_str() + digits.size()) {
+                    return fail("malformed number '" + digits + "'");
+                }
+                advance();
+                return node;
+            }
+            case Token::String: {
+                if (m_string.empty()) {
+                    return fail("empty string");
+                }
+                NodePtr node = make_node(Kind::Contains);
+                node->text = m_string;
+                advance();
+                return node;
+            }
+            case Token::LParen: {
+                advance();
+                NodePtr node = parseOr();
+                if (!node) return nullptr;
+                if (m_token != Token::RParen) {
+                    return fail("expected ')'");
+                }
+                advance();
+                return node;
+            }
+            case Token::Ident:
+                return parseIdentifier();
+            case Token::End:
+                return fail("unexpected end of condition");
+            default:
+                return fail("unexpected '" + std::string(m_lexeme) + "'");
+            }
+        }
+
+        NodePtr parseIdentifier() {
+            std::string_view name = m_lexeme;
+            if (name == "true" || name == "false") {
+                NodePtr node = make_node(Kind::Number);
+                node->number = name == "true" ? 1 : 0;
+                advance();
+                return node;
+            }
+            for (uint32_t i = 0; i < FeatureCount; ++i) {
+                if (name == kFeatureNames[i]) {
+                    NodePtr node = make_node(Kind::Feature);
+                    node->index = i;
+                    advance();
+                    return node;
+                }
+            }
+            Kind kind;
+            if (name == "contains") kind = Kind::Contains;
+            else if (name == "count") kind = Kind::Count;
+            else if (name == "word") kind = Kind::Word;
+            else if (name == "violation") kind = Kind::Violation;
+            else return fail("unknown name '" + std::string(name) + "'");
+
+            std::string function(name);
+            advance();
+            if (m_token != Token::LParen) {
+                return fail("expected '(' after " + function);
+            }
+            advance();
+            if (m_token != Token::String || m_string.empty()) {
+                return fail(function + "() takes a non-empty string");
+            }
+            NodePtr node = make_node(kind);
+            node->text = m_string;
+            advance();
+            if (m_token != Token::RParen) {
+                return fail("expected ')'");
+            }
+            advance();
+            return node;
+        }
+
+        std::string_view m_source;
+        size_t m_pos = 0;
+        size_t m_start = 0;
+        Token m_token = Token::End;
+        std::string_view m_lexeme;
+        std::string m_string;
+        std::string m_error;
+    };
+
+    size_t stack_depth(const ConditionNode& node) {
+        switch (node.kind) {
+        case Kind::Not:
+            return stack_depth(*node.left);
+        case Kind::Compare:
+            return std::max(stack_depth(*node.left), 1 + stack_depth(*node.right));
+        case Kind::And:
+        case Kind::Or:
+            return std::max(stack_depth(*node.left), stack_depth(*node.right));
+        default:
+            return 1;
+        }
+    }
+
+    // A contains() the condition cannot hold without, if there is one at the top of an && chain.
+    const ConditionNode* required_literal(const ConditionNode& node) {
+        if (node.kind == Kind::Contains || node.kind == Kind::Word) {
+            return &node;
+        }
+        if (node.kind == Kind::And) {
+            const ConditionNode* found = required_literal(*node.left);
+            return found ? found : required_literal(*node.right);
+        }
+        return nullptr;
+    }
+
+    std::string trimmed(std::string_view text) {
+        size_t begin = 0;
+        size_t end = text.size();
+        while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) ++begin;
+        while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+        return std::string(text.substr(begin, end - begin));
+    }
+
+    bool is_word_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    // Whether an occurrence of @p literal at @p start stands as a whole word: not
+    // glued to a word character on a side where the literal itself has one.
+    bool at_word_boundary(std::string_view text, size_t start, const std::string& literal) {
+        size_t end = start + literal.size();
+        if (is_word_char(literal.front()) && start > 0 && is_word_char(text[start - 1])) {
+            return false;
+        }
+        return !(is_word_char(literal.back()) && end < text.size() && is_word_char(text[end]));
+    }
+
+    std::string lowered(std::string_view text) {
+        std::string out(text);
+        for (char& c : out) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return out;
+    }
+
+    RuleConsequence::Type consequence_type(std::string_view name) {
+        using Type = RuleConsequence::Type;
+        if (name == "flag_for_review") return Type::FlagForReview;
+        if (name == "reprompt" || name == "reflect") return Type::Reprompt;
+        if (name == "taint") return Type::Taint;
+        if (name == "timeout") return Type::Timeout;
+        if (name == "repeat") return Type::Repeat;
+        if (name == "log") return Type::Log;
+        return Type::Unknown;
+    }
+
+    // "90", "90s", "15m", "2h" or "1d".
+    bool parse_duration(std::string_view text, std::chrono::seconds& out) {
+        if (text.empty()) {
+            return false;
+        }
+        long long unit = 1;
+        switch (text.back()) {
+        case 's': unit = 1; text.remove_suffix(1); break;
+        case 'm': unit = 60; text.remove_suffix(1); break;
+        case 'h': unit = 3600; text.remove_suffix(1); break;
+        case 'd': unit = 86400; text.remove_suffix(1); break;
+        default: break;
+        }
+        if (text.empty() || !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+        out = std::chrono::seconds(std::stoll(std::string(text)) * unit);
+        return true;
+    }
+} // namespace
+
+// --- Compilation ---
+
+bool RuleProgram::load(const Config& config) {
+    m_timeoutMarker = config.getString("TIMEOUT_MARKER").value_or("logs/.timeout");
+    m_timeoutDurationSec = config.getInt("TIMEOUT_DURATION_SEC").value_or(7200);
+
+    std::string path = config.getString("RULES_FILE").value_or("rules/rules.xml");
+    Logger& log = Logger::instance();
+    if (!fs::exists(path)) {
+        compile("<rules/>");
+        log.info("RuleProgram", "No rules file at " + path + "; no rules.xml rules are enforced.");
+        return true;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    bool ok = loadFile(path);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    for (const auto& warning : m_warnings) {
+        log.warn("RuleProgram", warning);
+    }
+    if (!ok) {
+        log.error("RuleProgram", "Could not compile " + path + ": " + m_error);
+        return false;
+    }
+    log.info("RuleProgram", "Compiled " + std::to_string(m_rules.size()) + " rules from " + path + " into " +
+             std::to_string(m_code.size()) + " instructions and " + std::to_string(m_literalText.size()) +
+             " literals in " + std::to_string(elapsed.count()) + " us.");
+    return true;
+}
+
+bool RuleProgram::loadFile(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        compile("<rules/>");
+        m_error = "cannot read " + path;
+        return false;
+    }
+    return compile(file.view());
+}
+
+uint32_t RuleProgram::internLiteral(const std::string& text) {
+    auto [it, inserted] = m_literalIds.emplace(lowered(text), static_cast<uint32_t>(m_literalText.size()));
+    if (inserted) {
+        m_literalText.push_back(it->first);
+    }
+    return it->second;
+}
+
+void RuleProgram::emit(const ConditionNode& node, size_t depth) {
+    auto push = [this, depth](Op op, uint32_t arg) {
+        m_code.push_back(Instr{op, arg});
+        m_maxStack = std::max(m_maxStack, depth + 1);
+    };
+    switch (node.kind) {
+    case Kind::Number:
+        m_constants.push_back(node.number);
+        push(Op::Const, static_cast<uint32_t>(m_constants.size() - 1));
+        break;
+    case Kind::Feature:
+        m_featuresUsed |= 1u << node.index;
+        push(Op::Feature, node.index);
+        break;
+    case Kind::Contains:
+        push(Op::Contains, internLiteral(node.text));
+        break;
+    case Kind::Count:
+        push(Op::Count, internLiteral(node.text));
+        break;
+    case Kind::Word:
+        push(Op::Word, internLiteral(node.text));
+        break;
+    case Kind::Violation: {
+        auto found = std::find(m_categories.begin(), m_categories.end(), node.text);
+        if (found == m_categories.end()) {
+            m_categories.push_back(node.text);
+            found = m_categories.end() - 1;
+        }
+        push(Op::Violation, static_cast<uint32_t>(found - m_categories.begin()));
+        break;
+    }
+    case Kind::Not:
+        emit(*node.left, depth);
+        m_code.push_back(Instr{Op::Not, 0});
+        break;
+    case Kind::Compare:
+        emit(*node.left, depth);
+        emit(*node.right, depth + 1);
+        m_code.push_back(Instr{static_cast<Op>(static_cast<uint32_t>(Op::Eq) + node.index), 0});
+        break;
+    case Kind::And:
+    case Kind::Or: {
+        emit(*node.left, depth);
+        size_t jump = m_code.size();
+        m_code.push_back(Instr{node.kind == Kind::And ? Op::JumpIfFalse : Op::JumpIfTrue, 0});
+        emit(*node.right, depth);
+        m_code[jump].arg = static_cast<uint32_t>(m_code.size());
+        break;
+    }
+    }
+}
+
+bool RuleProgram::compile(std::string_view xml) {
+    m_rules.clear();
+    m_code.clear();
+    m_constants.clear();
+    m_categories.clear();
+    m_literalText.clear();
+    m_literalIds.clear();
+    m_guarded.clear();
+    m_unguarded.clear();
+    m_featuresUsed = 0;
+    m_maxStack = 0;
+    m_error.clear();
+    m_warnings.clear();
+
+    QuantaPorto::XmlDocument document;
+    bool ok = document.parse(xml);
+    if (!ok) {
+        m_error = document.error();
+    } else if (document.root()->name != "rules") {
+        m_error = "root element is <" + std::string(document.root()->name) + ">, not <rules>";
+        ok = false;
+    }
+
+    std::vector<int64_t> guards;  // Per rule: required literal id, or -1.
+    const QuantaPorto::XmlElement* element = ok ? document.root()->child("rule") : nullptr;
+    for (; element; element = element->nextNamed("rule")) {
+        CompiledRule rule;
+        rule.id = std::string(element->attribute("id"));
+        rule.severity = std::string(element->attribute("severity", "medium"));
+        const auto* condition = element->child("condition");
+        rule.condition = condition ? trimmed(condition->text) : std::string();
+        if (const auto* note = element->child("note")) {
+            rule.note = trimmed(note->text);
+        }
+        std::string label = "rule '" + rule.id + "'";
+        if (rule.id.empty()) {
+            m_warnings.push_back("Skipping a rule without an id.");
+            continue;
+        }
+        if (rule.condition.empty()) {
+            m_warnings.push_back("Skipping " + label + ": no condition.");
+            continue;
+        }
+
+        ConditionParser parser(rule.condition);
+        NodePtr tree = parser.parse();
+        if (!tree) {
+            m_warnings.push_back("Skipping " + label + ": " + parser.error() + " in '" + rule.condition + "'.");
+            continue;
+        }
+        if (stack_depth(*tree) > kMaxStack) {
+            m_warnings.push_back("Skipping " + label + ": condition nests too deeply.");
+            continue;
+        }
+
+        for (const auto* item = element->child("consequence"); item; item = item->nextNamed("consequence")) {
+            RuleConsequence consequence;
+            consequence.id = std::string(item->attribute("id"));
+            const auto* type = item->child("type");
+            consequence.typeName = type ? trimmed(type->text) : std::string();
+            consequence.type = consequence_type(consequence.typeName);
+            if (consequence.type == RuleConsequence::Type::Unknown) {
+                m_warnings.push_back(label + ": unknown consequence type '" + consequence.typeName + "'.");
+            }
+            if (const auto* duration = item->child("duration")) {
+                if (!parse_duration(trimmed(duration->text), consequence.duration)) {
+                    m_warnings.push_back(label + ": ignoring malformed duration '" + trimmed(duration->text) + "'.");
+                }
+            }
+            if (const auto* message = item->child("message")) {
+                consequence.message = trimmed(message->text);
+            }
+            if (const auto* repeat = item->child("repeat_count")) {
+                consequence.repeatCount = std::max(1, std::atoi(trimmed(repeat->text).c_str()));
+            }
+            rule.consequences.push_back(std::move(consequence));
+        }
+        if (rule.consequences.empty()) {
+            m_warnings.push_back(label + " has no consequences.");
+        }
+
+        rule.entry = static_cast<uint32_t>(m_code.size());
+        emit(*tree, 0);
+        m_code.push_back(Instr{Op::Return, 0});
+        const ConditionNode* guard = required_literal(*tree);
+        guards.push_back(guard ? static_cast<int64_t>(internLiteral(guard->text)) : -1);
+        m_rules.push_back(std::move(rule));
+    }
+
+    m_guarded.assign(m_literalText.size(), {});
+    for (uint32_t i = 0; i < m_rules.size(); ++i) {
+        if (guards[i] < 0) {
+            m_unguarded.push_back(i);
+        } else {
+            m_guarded[static_cast<size_t>(guards[i])].push_back(i);
+        }
+    }
+    m_literals = PatternMatcher();
+    for (const auto& literal : m_literalText) {
+        m_literals.add(literal);
+    }
+    m_literals.build();
+    return ok;
+}
+
+// --- Evaluation ---
+
+std::vector<uint32_t> RuleProgram::evaluate(const ResponseFeatures& input) const {
+    std::vector<uint32_t> fired;
+    if (m_rules.empty()) {
+        return fired;
+    }
+
+    std::vector<uint32_t> counts(m_literalText.size(), 0);
+    std::vector<uint32_t> wordCounts(m_literalText.size(), 0);
+    if (!counts.empty()) {
+        m_literals.scan(input.text, [&](uint32_t id, size_t start) {
+            ++counts[id];
+            wordCounts[id] += at_word_boundary(input.text, start, m_literalText[id]);
+        });
+    }
+
+    double features[FeatureCount] = {};
+    features[Length] = static_cast<double>(input.text.size());
+    features[Tokens] = input.tokens;
+    features[Attempt] = input.attempt;
+    if (input.report) {
+        features[Severity] = input.report->severityScore;
+        features[Violations] = static_cast<double>(input.report->violations.size());
+    }
+    if (m_featuresUsed & ((1u << Lines) | (1u << Words) | (1u << Empty))) {
+        size_t lines = 0;
+        size_t words = 0;
+        bool inWord = false;
+        for (char c : input.text) {
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            words += !space && !inWord;
+            inWord = !space;
+            lines += c == '\n';
+        }
+        if (!input.text.empty() && input.text.back() != '\n') {
+            ++lines;
+        }
+        features[Lines] = static_cast<double>(lines);
+        features[Words] = static_cast<double>(words);
+        features[Empty] = words == 0;
+    }
+
+    // Rules without a required literal always run; the rest only if their literal occurred.
+    std::vector<uint32_t> candidates = m_unguarded;
+    bool merged = false;
+    for (uint32_t id = 0; id < counts.size(); ++id) {
+        if (counts[id] > 0 && !m_guarded[id].empty()) {
+            candidates.insert(candidates.end(), m_guarded[id].begin(), m_guarded[id].end());
+            merged = true;
+        }
+    }
+    if (merged) {
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    double stack[kMaxStack];
+    for (uint32_t index : candidates) {
+        size_t sp = 0;
+        for (uint32_t pc = m_rules[index].entry;; ++pc) {
+            const Instr& instr = m_code[pc];
+            switch (instr.op) {
+            case Op::Const: stack[sp++] = m_constants[instr.arg]; break;
+            case Op::Feature: stack[sp++] = features[instr.arg]; break;
+            case Op::Contains: stack[sp++] = counts[instr.arg] > 0; break;
+            case Op::Count: stack[sp++] = counts[instr.arg]; break;
+            case Op::Word: stack[sp++] = wordCounts[instr.arg] > 0; break;
+            case Op::Violation: {
+                bool found = false;
+                if (input.report) {
+                    const std::string& category = m_categories[instr.arg];
+                    for (const auto& match : input.report->violations) {
+                        if (match.category.compare(0, category.size(), category) == 0) {
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                stack[sp++] = found;
+                break;
+            }
+            case Op::Not: stack[sp - 1] = stack[sp - 1] == 0; break;
+            case Op::Eq: --sp; stack[sp - 1] = stack[sp - 1] == stack[sp]; break;
+            case Op::Ne: --sp; stack[sp - 1] = stack[sp - 1] != stack[sp]; break;
+            case Op::Lt: --sp; stack[sp - 1] = stack[sp - 1] < stack[sp]; break;
+            case Op::Le: --sp; stack[sp - 1] = stack[sp - 1] <= stack[sp]; break;
+            case Op::Gt: --sp; stack[sp - 1] = stack[sp - 1] > stack[sp]; break;
+            case Op::Ge: --sp; stack[sp - 1] = stack[sp - 1] >= stack[sp]; break;
+            case Op::JumpIfFalse:
+                if (stack[sp - 1] == 0) pc = instr.arg - 1;
+                else --sp;
+                break;
+            case Op::JumpIfTrue:
+                if (stack[sp - 1] != 0) pc = instr.arg - 1;
+                else --sp;
+                break;
+            case Op::Return:
+                if (stack[sp - 1] != 0) {
+                    fired.push_back(index);
+                }
+                goto next_rule;
+            }
+        }
+    next_rule:;
+    }
+    return fired;
+}
+
+// --- Consequences ---
+
+RuleOutcome RuleProgram::enforce(const std::vector<uint32_t>& fired, std::string_view response) const {
+    using Type = RuleConsequence::Type;
+    Logger& log = Logger::instance();
+    RuleOutcome outcome;
+    for (uint32_t index : fired) {
+        const CompiledRule& rule = m_rules[index];
+        outcome.fired.push_back(rule.id);
+        for (const RuleConsequence& consequence : rule.consequences) {
+            const std::string& message =
+                !consequence.message.empty() ? consequence.message
+                                             : !rule.note.empty() ? rule.note : "Follow rule " + rule.id + ".";
+            switch (consequence.type) {
+            case Type::FlagForReview:
+                log.warn("RuleEnforcer", "Flagged for review: " + rule.id + " (Severity: " + rule.severity + ")");
+                outcome.flagged = true;
+                break;
+            case Type::Reprompt:
+                outcome.rejected = true;
+                outcome.instructions.push_back(message);
+                break;
+            case Type::Repeat:
+                outcome.rejected = true;
+                outcome.instructions.push_back("Before answering, write the following " +
+                                               std::to_string(consequence.repeatCount) + " time(s): " + message);
+                break;
+            case Type::Taint:
+                log.warn("RuleEnforcer", "TAINTED_OUTPUT (" + rule.id + "): " + std::string(response));
+                outcome.tainted = true;
+                break;
+            case Type::Timeout: {
+                outcome.rejected = true;
+                outcome.timeout = std::max(outcome.timeout, consequence.duration);
+                if (!consequence.message.empty()) {
+                    outcome.instructions.push_back(consequence.message);
+                }
+                std::error_code ec;
+                fs::path marker(m_timeoutMarker);
+                if (marker.has_parent_path()) {
+                    fs::create_directories(marker.parent_path(), ec);
+                }
+                std::ofstream(marker) << "timeout";
+                // The marker counts as active for TIMEOUT_DURATION_SEC after its mtime;
+                // backdating it makes a shorter timeout expire on time.
+                auto remaining = std::chrono::seconds(m_timeoutDurationSec) - consequence.duration;
+                if (consequence.duration.count() > 0 && remaining.count() > 0) {
+                    fs::last_write_time(marker, fs::file_time_type::clock::now() - remaining, ec);
+                }
+                log.warn("RuleEnforcer", "Timeout imposed by rule " + rule.id + ".");
+                break;
+            }
+            case Type::Log:
+                log.info("RuleEnforcer", rule.id + ": " + message);
+                break;
+            case Type::Unknown:
+                log.warn("RuleEnforcer", "Unknown consequence defined in rules: '" + consequence.typeName + "'");
+                break;
+            }
+        }
+    }
+    return outcome;
+}
+
+std::chrono::seconds RuleProgram::timeoutRemaining() const {
+    std::error_code ec;
+    fs::file_time_type modified = fs::last_write_time(m_timeoutMarker, ec);
+    if (ec) {
+        return std::chrono::seconds(0);
+    }
+    auto age = std::chrono::duration_cast<std::chrono::seconds>(fs::file_time_type::clock::now() - modified);
+    auto remaining = std::chrono::seconds(m_timeoutDurationSec) - age;
+    if (remaining.count() <= 0) {
+        fs::remove(m_timeoutMarker, ec);
+        return std::chrono::seconds(0);
+    }
+    return remaining;
+}
@@ -0,0 +1,177 @@
+#ifndef PRISMQUANTA_RULE_PROGRAM_H
+#define PRISMQUANTA_RULE_PROGRAM_H
+
+#include "PatternMatcher.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Config;
+struct ConditionNode;
+struct RuleReport;
+
+/**
+ * @brief A consequence from rules.xml, with its type resolved when the rules are compiled.
+ */
+struct RuleConsequence {
+    enum class Type : uint8_t { FlagForReview, Reprompt, Taint, Timeout, Repeat, Log, Unknown };
+
+    Type type = Type::Unknown;
+    std::string id;
+    std::string typeName;              ///< As written in the file.
+    std::chrono::seconds duration{0};  ///< For timeout.
+    std::string message;
+    int repeatCount = 1;               ///< For repeat.
+};
+
+struct CompiledRule {
+    std::string id;
+    std::string severity;
+    std::string condition;  ///< Source text, for diagnostics.
+    std::string note;
+    uint32_t entry = 0;     ///< First instruction of the condition's code.
+    std::vector<RuleConsequence> consequences;
+};
+
+/**
+ * @brief What a rule condition can inspect about a response.
+ */
+struct ResponseFeatures {
+    std::string_view text;
+    const RuleReport* report = nullptr;  ///< Ethics/bias findings, if the response was checked.
+    int tokens = 0;                      ///< Tokens generated, if known.
+    int attempt = 1;                     ///< 1 for the first generation, 2 for the first retry, ...
+};
+
+/**
+ * @brief What enforcing the fired rules' consequences decided.
+ */
+struct RuleOutcome {
+    std::vector<std::string> fired;         ///< Ids of the rules whose condition held.
+    bool rejected = false;                  ///< A reprompt, repeat or timeout consequence fired.
+    bool flagged = false;
+    bool tainted = false;
+    std::chrono::seconds timeout{0};        ///< Longest timeout imposed.
+    std::vector<std::string> instructions;  ///< For the ReflectionEngine's corrective prompt.
+};
+
+/**
+ * @brief rules.xml compiled to a flat bytecode program.
+ *
+ * Replaces the line-by-line read of rules.xml and rule_enforcer.sh's
+ * per-violation grep and case dispatch. Each rule's <condition> is parsed
+ * once into an expression tree and lowered into a shared instruction
+ * array for a small stack machine; consequences are resolved to an enum
+ * and applied natively by enforce().
+ *
+ * Condition language:
+ * - Features: length, lines, words, tokens, attempt, severity (the ethics
+ *   checker's score), violations (its finding count), empty.
+ * - Functions: contains("text") and count("text") (ASCII case-insensitive
+ *   substring search), word("text") (like contains, but not inside a longer
+ *   word: word("rm") matches "rm -rf", not "perform"), violation("category")
+ *   (a checker finding whose category starts with the argument).
+ * - Numbers, true, false; comparisons == != < <= > >=; ! / not,
+ *   && / and, || / or (short-circuiting); parentheses.
+ * A bare string literal means contains(...). In XML, write < as &lt; or
+ * use a CDATA section.
+ *
+ * Every contains/count literal of every rule goes into one PatternMatcher,
+ * so a response is scanned once whatever the number of rules. A rule whose
+ * condition requires a literal (contains(...) or word(...) at the top of an && chain) is
+ * indexed under it and only run when that literal occurred, so thousands of
+ * keyword rules cost little more than the scan.
+ */
+class RuleProgram {
+public:
+    /**
+     * @brief Compiles RULES_FILE (default rules/rules.xml) and reads TIMEOUT_MARKER and TIMEOUT_DURATION_SEC.
+     * @return False if the file exists but cannot be read or parsed; a missing file means no rules.
+     */
+    bool load(const Config& config);
+
+    /** @brief Compiles a rules.xml file. */
+    bool loadFile(const std::string& path);
+
+    /**
+     * @brief Compiles a rules document, replacing the current program.
+     *
+     * Rules whose condition does not compile are skipped and reported in
+     * warnings(); only a malformed document fails as a whole.
+     */
+    bool compile(std::string_view xml);
+
+    const std::string& error() const { return m_error; }
+    const std::vector<std::string>& warnings() const { return m_warnings; }
+
+    size_t ruleCount() const { return m_rules.size(); }
+    const CompiledRule& rule(uint32_t index) const { return m_rules[index]; }
+    size_t instructionCount() const { return m_code.size(); }
+
+    /** @brief Indices of the rules whose condition holds, in file order. */
+    std::vector<uint32_t> evaluate(const ResponseFeatures& features) const;
+
+    /**
+     * @brief Applies the consequences of the given rules.
+     *
+     * flag_for_review and taint are logged as rule_enforcer.sh did, timeout
+     * refreshes TIMEOUT_MARKER so that it expires after the given duration,
+     * and reprompt, repeat and timeout reject the response, contributing
+     * their messages to the corrective prompt.
+     */
+    RuleOutcome enforce(const std::vector<uint32_t>& fired, std::string_view response) const;
+
+    /**
+     * @brief How much longer the timeout recorded in TIMEOUT_MARKER lasts; zero when there is none.
+     *
+     * An expired marker is removed, as the shell interface did.
+     */
+    std::chrono::seconds timeoutRemaining() const;
+
+private:
+    enum class Op : uint8_t {
+        Const,        // push m_constants[arg]
+        Feature,      // push feature #arg
+        Contains,     // push count of literal #arg > 0
+        Count,        // push count of literal #arg
+        Word,         // push whether literal #arg occurred as a whole word
+        Violation,    // push whether a finding's category starts with m_categories[arg]
+        Not,
+        Eq, Ne, Lt, Le, Gt, Ge,
+        JumpIfFalse,  // if top is false jump to arg, else pop
+        JumpIfTrue,   // if top is true jump to arg, else pop
+        Return,
+    };
+
+    struct Instr {
+        Op op;
+        uint32_t arg;
+    };
+
+    // Appends code for @p node at stack depth @p depth; tracks m_maxStack.
+    void emit(const ConditionNode& node, size_t depth);
+    uint32_t internLiteral(const std::string& text);
+
+    std::vector<CompiledRule> m_rules;
+    std::vector<Instr> m_code;
+    std::vector<double> m_constants;
+    std::vector<std::string> m_categories;
+    std::vector<std::string> m_literalText;        // Lower-cased, per literal id.
+    std::unordered_map<std::string, uint32_t> m_literalIds;
+    PatternMatcher m_literals;
+    std::vector<std::vector<uint32_t>> m_guarded;  // Per literal: rules that require it.
+    std::vector<uint32_t> m_unguarded;             // Rules that must always run.
+    uint32_t m_featuresUsed = 0;                   // Bit per feature.
+    size_t m_maxStack = 0;
+
+    std::string m_timeoutMarker = "logs/.timeout";
+    int m_timeoutDurationSec = 7200;
+
+    std::string m_error;
+    std::vector<std::string> m_warnings;
+};
+
+#endif //PRISMQUANTA_RULE_PROGRAM_H
@@ -0,0 +1,237 @@
+#include "TaskGraph.h"
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    // ReadyQueue::priorityRank, on the table's interned priorities.
+    int priority_rank(Atom priority) {
+        if (priority == AtomTable::kHigh) return 0;
+        if (priority == AtomTable::kLow) return 2;
+        return 1;
+    }
+} // namespace
+
+bool TaskGraph::build(const std::vector<PQLTask>& tasks, std::vector<double> weights) {
+    TaskTable table;
+    size_t textBytes = 0;
+    for (const PQLTask& task : tasks) {
+        textBytes += task.id.size() + task.created.size() + task.description.size() + task.notes.size();
+        for (const auto* lines : {&task.commands, &task.criteria, &task.dependsOn}) {
+            for (const std::string& line : *lines) {
+                textBytes += line.size();
+            }
+        }
+    }
+    table.reserve(tasks.size(), textBytes);
+    PQLTaskView view;  // Reused, so adding a task allocates nothing once the vectors have grown.
+    for (const PQLTask& task : tasks) {
+        view.id = task.id;
+        view.type = task.type;
+        view.priority = task.priority;
+        view.status = task.status;
+        view.created = task.created;
+        view.description = task.description;
+        view.notes = task.notes;
+        view.commands.assign(task.commands.begin(), task.commands.end());
+        view.criteria.assign(task.criteria.begin(), task.criteria.end());
+        view.dependsOn.assign(task.dependsOn.begin(), task.dependsOn.end());
+        if (!table.add(view)) {
+            m_tasks.clear();
+            m_error = "the plan's tasks do not fit in a task table";
+            return false;
+        }
+    }
+    return build(std::move(table), std::move(weights));
+}
+
+bool TaskGraph::build(TaskTable tasks, std::vector<double> weights) {
+    const size_t n = tasks.size();
+    m_tasks = std::move(tasks);
+    m_state.assign(n, State::Waiting);
+    m_dependencies.assign(n, {});
+    m_dependents.assign(n, {});
+    m_waiting.assign(n, 0);
+    m_criticalPath.assign(n, 0);
+    m_priority.assign(n, 1);
+    m_ready.clear();
+    m_running = 0;
+    m_error.clear();
+    if (!weights.empty() && weights.size() != n) {
+        m_error = "expected " + std::to_string(n) + " task weights, got " + std::to_string(weights.size());
+        return false;
+    }
+
+    // The table's id index returns the first row with an id, so any other row with it is a duplicate.
+    for (uint32_t i = 0; i < n; ++i) {
+        if (m_tasks.find(m_tasks.id(i)) != i) {
+            m_error = "duplicate task id '" + std::string(m_tasks.id(i)) + "'";
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        for (size_t d = 0; d < m_tasks.dependencyCount(i); ++d) {
+            std::string_view id = m_tasks.dependency(i, d);
+            uint32_t dependency = m_tasks.find(id);
+            if (dependency == TaskTable::npos) {
+                m_error = "task '" + std::string(m_tasks.id(i)) + "' depends on unknown task '" + std::string(id) + "'";
+                return false;
+            }
+            // A dependency listed twice is still one edge.
+            if (std::find(m_dependencies[i].begin(), m_dependencies[i].end(), dependency) == m_dependencies[i].end()) {
+                m_dependencies[i].push_back(dependency);
+                m_dependents[dependency].push_back(i);
+            }
+        }
+        m_priority[i] = priority_rank(m_tasks.priority(i));
+        if (m_tasks.status(i) == AtomTable::kDone) {
+            m_state[i] = State::Done;
+        }
+    }
+
+    // Kahn's algorithm; whatever it cannot order is on, or behind, a cycle.
+    std::vector<uint32_t> order;
+    order.reserve(n);
+    std::vector<uint32_t> unresolved(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        unresolved[i] = static_cast<uint32_t>(m_dependencies[i].size());
+        if (unresolved[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+        for (uint32_t dependent : m_dependents[order[head]]) {
+            if (--unresolved[dependent] == 0) {
+                order.push_back(dependent);
+            }
+        }
+    }
+    if (order.size() != n) {
+        m_error = "dependency cycle: " + describeCycle(unresolved);
+        return false;
+    }
+
+    // Dependents come later in the order, so walking it backwards finishes them first.
+    for (size_t k = n; k-- > 0;) {
+        uint32_t i = order[k];
+        double longest = 0;
+        for (uint32_t dependent : m_dependents[i]) {
+            longest = std::max(longest, m_criticalPath[dependent]);
+        }
+        double weight = m_state[i] == State::Done ? 0 : weights.empty() ? 1 : weights[i];
+        m_criticalPath[i] = weight + longest;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        if (m_state[i] == State::Done) {
+            continue;
+        }
+        for (uint32_t dependency : m_dependencies[i]) {
+            m_waiting[i] += m_state[dependency] != State::Done;
+        }
+        if (m_waiting[i] == 0) {
+            pushReady(i);
+        }
+    }
+    return true;
+}
+
+std::string TaskGraph::describeCycle(const std::vector<uint32_t>& unresolved) const {
+    // Every unresolved task waits for another unresolved task, so following
+    // those edges from any of them must come back to a task already seen.
+    uint32_t start = 0;
+    while (unresolved[start] == 0) {
+        ++start;
+    }
+    std::vector<uint32_t> path;
+    std::unordered_map<uint32_t, size_t> seen;
+    uint32_t current = start;
+    while (seen.emplace(current, path.size()).second) {
+        path.push_back(current);
+        for (uint32_t dependency : m_dependencies[current]) {
+            if (unresolved[dependency] != 0) {
+                current = dependency;
+                break;
+            }
+        }
+    }
+    std::string cycle;
+    for (size_t k = seen[current]; k < path.size(); ++k) {
+        cycle.append(m_tasks.id(path[k])).append(" -> ");
+    }
+    return cycle.append(m_tasks.id(current)).append(" (each depends on the next)");
+}
+
+double TaskGraph::criticalPathLength() const {
+    double longest = 0;
+    for (size_t i = 0; i < m_tasks.size(); ++i) {
+        if (m_state[i] == State::Waiting || m_state[i] == State::Ready || m_state[i] == State::Running) {
+            longest = std::max(longest, m_criticalPath[i]);
+        }
+    }
+    return longest;
+}
+
+std::optional<size_t> TaskGraph::next() {
+    if (m_ready.empty()) {
+        return std::nullopt;
+    }
+    // std::*_heap keep the greatest element in front, so the comparison is reversed.
+    auto after = [this](uint32_t a, uint32_t b) { return before(b, a); };
+    std::pop_heap(m_ready.begin(), m_ready.end(), after);
+    uint32_t index = m_ready.back();
+    m_ready.pop_back();
+    m_state[index] = State::Running;
+    ++m_running;
+    return index;
+}
+
+std::vector<size_t> TaskGraph::finish(size_t index, bool succeeded) {
+    std::vector<size_t> skipped;
+    if (m_state[index] != State::Running) {
+        return skipped;
+    }
+    --m_running;
+    m_state[index] = succeeded ? State::Done : State::Failed;
+    if (succeeded) {
+        for (uint32_t dependent : m_dependents[index]) {
+            if (m_state[dependent] == State::Waiting && --m_waiting[dependent] == 0) {
+                pushReady(dependent);
+            }
+        }
+        return skipped;
+    }
+
+    std::vector<uint32_t> pending(m_dependents[index]);
+    while (!pending.empty()) {
+        uint32_t dependent = pending.back();
+        pending.pop_back();
+        if (m_state[dependent] != State::Waiting) {
+            continue;  // Already skipped through another path, or done before the plan was loaded.
+        }
+        m_state[dependent] = State::Skipped;
+        skipped.push_back(dependent);
+        pending.insert(pending.end(), m_dependents[dependent].begin(), m_dependents[dependent].end());
+    }
+    return skipped;
+}
+
+size_t TaskGraph::count(State state) const {
+    return static_cast<size_t>(std::count(m_state.begin(), m_state.end(), state));
+}
+
+bool TaskGraph::before(uint32_t a, uint32_t b) const {
+    if (m_criticalPath[a] != m_criticalPath[b]) {
+        return m_criticalPath[a] > m_criticalPath[b];
+    }
+    if (m_priority[a] != m_priority[b]) {
+        return m_priority[a] < m_priority[b];
+    }
+    return a < b;
+}
+
+void TaskGraph::pushReady(uint32_t index) {
+    m_state[index] = State::Ready;
+    m_ready.push_back(index);
+    std::push_heap(m_ready.begin(), m_ready.end(), [this](uint32_t a, uint32_t b) { return before(b, a); });
+}
@@ -0,0 +1,101 @@
+#ifndef PRISMQUANTA_TASK_GRAPH_H
+#define PRISMQUANTA_TASK_GRAPH_H
+
+#include "PQLParser.h"
+#include "TaskTable.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The dependency DAG of a plan's tasks, handing out ready tasks longest critical path first.
+ *
+ * build() resolves every depends_on id to a task of the plan and refuses
+ * the plan if an id is unknown or duplicated or the dependencies form a
+ * cycle; the error names the tasks involved. Tasks whose status is already
+ * "done" count as finished and are not offered, so a plan can be resumed.
+ *
+ * A task's critical path is its own weight plus the heaviest chain of
+ * tasks that can only start after it. The longest chain bounds how soon
+ * the plan can finish however many workers there are, so next() always
+ * starts the ready task at the head of the longest remaining chain and
+ * lets shorter branches fill the other workers. Ties go to the higher PQL
+ * priority, then to the task that comes first in the plan. Without
+ * weights every task weighs 1 and the critical path counts tasks.
+ *
+ * When a task fails, everything that depends on it, directly or not, is
+ * skipped and never offered. The tasks are kept in a TaskTable, so a large
+ * plan costs a few columns and one text arena rather than a PQLTask each.
+ * Not thread-safe; an executor running tasks concurrently calls it under
+ * its own lock, although task(), id() and tasks() only read the table,
+ * which never changes after build().
+ */
+class TaskGraph {
+public:
+    enum class State : uint8_t {
+        Waiting,  ///< On a dependency.
+        Ready,
+        Running,
+        Done,
+        Failed,
+        Skipped   ///< A dependency failed.
+    };
+
+    /**
+     * @brief Takes a plan's tasks, in plan order, and links them.
+     * @param weights The expected cost of each task (e.g. seconds), in the same order; empty for 1 each.
+     * @return False (see error()) if the plan has duplicate ids, unknown dependencies or a cycle.
+     */
+    bool build(TaskTable tasks, std::vector<double> weights = {});
+
+    /** @brief As above, for tasks already parsed into PQLTasks. */
+    bool build(const std::vector<PQLTask>& tasks, std::vector<double> weights = {});
+
+    const std::string& error() const { return m_error; }
+
+    size_t size() const { return m_tasks.size(); }
+    const TaskTable& tasks() const { return m_tasks; }
+    std::string_view id(size_t index) const { return m_tasks.id(index); }
+    /** @brief An owning copy of a task, e.g. to execute it. */
+    PQLTask task(size_t index) const { return m_tasks.task(index); }
+    State state(size_t index) const { return m_state[index]; }
+
+    /** @brief The weight of the longest chain of unfinished tasks starting at @p index. */
+    double criticalPath(size_t index) const { return m_criticalPath[index]; }
+
+    /** @brief The longest chain of tasks to run: what the plan takes with unlimited workers. */
+    double criticalPathLength() const;
+
+    /** @brief The ready task with the longest critical path, now marked Running; empty if none is ready. */
+    std::optional<size_t> next();
+
+    /**
+     * @brief Records how a running task ended, readying or skipping its dependents.
+     * @return The tasks skipped because of this failure; empty when it succeeded.
+     */
+    std::vector<size_t> finish(size_t index, bool succeeded);
+
+    /** @brief True once nothing is ready or running, so nothing more will run. */
+    bool finished() const { return m_ready.empty() && m_running == 0; }
+
+    size_t count(State state) const;
+
+private:
+    bool before(uint32_t a, uint32_t b) const;  // True if a should run before b.
+    void pushReady(uint32_t index);
+    std::string describeCycle(const std::vector<uint32_t>& unresolved) const;
+
+    TaskTable m_tasks;
+    std::vector<State> m_state;
+    std::vector<std::vector<uint32_t>> m_dependencies;  // Per task, the tasks it waits for.
+    std::vector<std::vector<uint32_t>> m_dependents;    // Per task, the tasks waiting for it.
+    std::vector<uint32_t> m_waiting;                    // Unfinished dependencies per task.
+    std::vector<double> m_criticalPath;
+    std::vector<int> m_priority;                        // As ReadyQueue::priorityRank.
+    std::vector<uint32_t> m_ready;                      // A heap ordered by before().
+    size_t m_running = 0;
+    std::string m_error;
+};
+
+#endif //PRISMQUANTA_TASK_GRAPH_H
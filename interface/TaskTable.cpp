@@ -0,0 +1,300 @@
+#include "TaskTable.h"
+#include "Hash.h"
+#include "ReadyQueue.h"
+#include <algorithm>
+#include <climits>
+
+// --- AtomTable ---
+
+AtomTable::AtomTable() {
+    // The order must match the constants in the header.
+    for (std::string_view name : {"", "high", "medium", "low", "pending", "in_progress", "done", "failed"}) {
+        intern(name);
+    }
+}
+
+AtomTable::AtomTable(const AtomTable& other) : m_names(other.m_names) {
+    m_atoms.reserve(m_names.size());
+    for (size_t atom = 0; atom < m_names.size(); ++atom) {
+        m_atoms.emplace(m_names[atom], static_cast<Atom>(atom));
+    }
+}
+
+AtomTable& AtomTable::operator=(const AtomTable& other) {
+    if (this != &other) {
+        AtomTable copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+std::optional<Atom> AtomTable::intern(std::string_view name) {
+    if (auto it = m_atoms.find(name); it != m_atoms.end()) {
+        return it->second;
+    }
+    if (m_names.size() >= kAny) {
+        return std::nullopt;
+    }
+    Atom atom = static_cast<Atom>(m_names.size());
+    m_atoms.emplace(m_names.emplace_back(name), atom);
+    return atom;
+}
+
+std::optional<Atom> AtomTable::find(std::string_view name) const {
+    auto it = m_atoms.find(name);
+    if (it == m_atoms.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+// --- TaskTable ---
+
+void TaskTable::reserve(size_t tasks, size_t textBytes) {
+    m_text.reserve(textBytes);
+    for (auto* column : {&m_type, &m_priority, &m_status}) {
+        column->reserve(tasks);
+    }
+    for (auto* column : {&m_id, &m_createdText, &m_description, &m_notes}) {
+        column->reserve(tasks);
+    }
+    m_created.reserve(tasks);
+    m_lists.reserve(tasks);
+    size_t slots = 16;
+    while (slots < tasks * 2) {
+        slots *= 2;
+    }
+    if (slots > m_index.size()) {
+        rehash(slots);
+    }
+}
+
+void TaskTable::clear() {
+    // The vocabulary is kept; it is what the next batch will use too.
+    m_text.clear();
+    for (auto* column : {&m_type, &m_priority, &m_status}) {
+        column->clear();
+    }
+    for (auto* column : {&m_id, &m_createdText, &m_description, &m_notes, &m_lines}) {
+        column->clear();
+    }
+    m_created.clear();
+    m_lists.clear();
+    std::fill(m_index.begin(), m_index.end(), 0);
+}
+
+bool TaskTable::add(const PQLTaskView& task) {
+    size_t bytes = task.id.size() + task.created.size() + task.description.size() + task.notes.size();
+    for (std::string_view line : task.commands) {
+        bytes += line.size();
+    }
+    for (std::string_view line : task.criteria) {
+        bytes += line.size();
+    }
+    for (std::string_view line : task.dependsOn) {
+        bytes += line.size();
+    }
+    size_t lines = task.commands.size() + task.criteria.size() + task.dependsOn.size();
+    if (m_text.size() + bytes > UINT32_MAX || size() >= npos - 1 || task.commands.size() > UINT16_MAX ||
+        task.criteria.size() > UINT16_MAX || task.dependsOn.size() > UINT16_MAX || m_lines.size() + lines > UINT32_MAX) {
+        return false;
+    }
+    std::optional<Atom> type = m_atoms.intern(task.type);
+    std::optional<Atom> priority = m_atoms.intern(task.priority);
+    std::optional<Atom> status = m_atoms.intern(task.status);
+    if (!type || !priority || !status) {
+        return false;
+    }
+
+    m_type.push_back(*type);
+    m_priority.push_back(*priority);
+    m_status.push_back(*status);
+    m_created.push_back(ReadyQueue::parseTimestamp(task.created).value_or(INT64_MIN));
+    m_id.push_back(store(task.id));
+    m_createdText.push_back(store(task.created));
+    m_description.push_back(store(task.description));
+    m_notes.push_back(store(task.notes));
+    m_lists.push_back({static_cast<uint32_t>(m_lines.size()), static_cast<uint16_t>(task.commands.size()),
+                       static_cast<uint16_t>(task.criteria.size()), static_cast<uint16_t>(task.dependsOn.size())});
+    for (std::string_view line : task.commands) {
+        m_lines.push_back(store(line));
+    }
+    for (std::string_view line : task.criteria) {
+        m_lines.push_back(store(line));
+    }
+    for (std::string_view line : task.dependsOn) {
+        m_lines.push_back(store(line));
+    }
+    index(static_cast<uint32_t>(size() - 1));
+    return true;
+}
+
+bool TaskTable::add(const PQLTask& task) {
+    PQLTaskView view;
+    view.id = task.id;
+    view.type = task.type;
+    view.priority = task.priority;
+    view.status = task.status;
+    view.created = task.created;
+    view.description = task.description;
+    view.commands.assign(task.commands.begin(), task.commands.end());
+    view.criteria.assign(task.criteria.begin(), task.criteria.end());
+    view.notes = task.notes;
+    view.dependsOn.assign(task.dependsOn.begin(), task.dependsOn.end());
+    return add(view);
+}
+
+size_t TaskTable::load(const std::string& filename) {
+    size_t added = 0;
+    PQLParser parser;
+    parser.parse(filename, [&](const PQLTaskView& task) {
+        if (!add(task)) {
+            return false;
+        }
+        ++added;
+        return true;
+    });
+    return added;
+}
+
+bool TaskTable::setStatus(size_t row, std::string_view status) {
+    std::optional<Atom> atom = m_atoms.intern(status);
+    if (!atom) {
+        return false;
+    }
+    m_status[row] = *atom;
+    return true;
+}
+
+uint32_t TaskTable::find(std::string_view id) const {
+    if (m_index.empty()) {
+        return npos;
+    }
+    size_t mask = m_index.size() - 1;
+    for (size_t slot = Hasher::hash64(id) & mask; m_index[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t row = m_index[slot] - 1;
+        if (text(m_id[row]) == id) {
+            return row;
+        }
+    }
+    return npos;
+}
+
+std::vector<uint32_t> TaskTable::select(Atom status, Atom priority) const {
+    std::vector<uint32_t> rows;
+    const size_t n = size();
+    const Atom* statuses = m_status.data();
+    const Atom* priorities = m_priority.data();
+    if (priority == AtomTable::kAny) {
+        for (size_t row = 0; row < n; ++row) {
+            if (status == AtomTable::kAny || statuses[row] == status) {
+                rows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    } else if (status == AtomTable::kAny) {
+        for (size_t row = 0; row < n; ++row) {
+            if (priorities[row] == priority) {
+                rows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    } else {
+        for (size_t row = 0; row < n; ++row) {
+            if (statuses[row] == status && priorities[row] == priority) {
+                rows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    }
+    return rows;
+}
+
+size_t TaskTable::count(Atom status) const {
+    size_t matches = 0;
+    for (Atom atom : m_status) {
+        matches += atom == status;
+    }
+    return matches;
+}
+
+void TaskTable::view(size_t row, PQLTaskView& out) const {
+    out.id = id(row);
+    out.type = m_atoms.name(m_type[row]);
+    out.priority = m_atoms.name(m_priority[row]);
+    out.status = m_atoms.name(m_status[row]);
+    out.created = text(m_createdText[row]);
+    out.description = description(row);
+    out.notes = notes(row);
+    out.commands.clear();
+    for (size_t i = 0; i < commandCount(row); ++i) {
+        out.commands.push_back(command(row, i));
+    }
+    out.criteria.clear();
+    for (size_t i = 0; i < criterionCount(row); ++i) {
+        out.criteria.push_back(criterion(row, i));
+    }
+    out.dependsOn.clear();
+    for (size_t i = 0; i < dependencyCount(row); ++i) {
+        out.dependsOn.push_back(dependency(row, i));
+    }
+}
+
+PQLTask TaskTable::task(size_t row) const {
+    PQLTaskView fields;
+    view(row, fields);
+    return PQLTask(fields);
+}
+
+size_t TaskTable::memoryBytes() const {
+    size_t bytes = m_text.capacity() + m_index.capacity() * sizeof(uint32_t) + m_created.capacity() * sizeof(int64_t) +
+                   m_lists.capacity() * sizeof(Lists);
+    for (const auto* column : {&m_type, &m_priority, &m_status}) {
+        bytes += column->capacity() * sizeof(Atom);
+    }
+    for (const auto* column : {&m_id, &m_createdText, &m_description, &m_notes, &m_lines}) {
+        bytes += column->capacity() * sizeof(Span);
+    }
+    for (size_t atom = 0; atom < m_atoms.size(); ++atom) {
+        bytes += m_atoms.name(static_cast<Atom>(atom)).size() + sizeof(std::string) + 2 * sizeof(void*);
+    }
+    return bytes;
+}
+
+TaskTable::Span TaskTable::store(std::string_view value) {
+    Span span{static_cast<uint32_t>(m_text.size()), static_cast<uint32_t>(value.size())};
+    m_text.append(value);
+    return span;
+}
+
+void TaskTable::index(uint32_t row) {
+    if ((size() + 1) * 2 > m_index.size()) {
+        rehash(m_index.empty() ? 16 : m_index.size() * 2);
+    }
+    std::string_view key = id(row);
+    size_t mask = m_index.size() - 1;
+    size_t slot = Hasher::hash64(key) & mask;
+    for (; m_index[slot] != 0; slot = (slot + 1) & mask) {
+        if (id(m_index[slot] - 1) == key) {
+            return;  // A duplicate id; the first row keeps it.
+        }
+    }
+    m_index[slot] = row + 1;
+}
+
+void TaskTable::rehash(size_t slots) {
+    m_index.assign(slots, 0);
+    size_t mask = slots - 1;
+    // Rows go back in order, so the first of any duplicates wins again.
+    for (uint32_t row = 0; row < size(); ++row) {
+        std::string_view key = id(row);
+        size_t slot = Hasher::hash64(key) & mask;
+        bool duplicate = false;
+        for (; m_index[slot] != 0; slot = (slot + 1) & mask) {
+            if (id(m_index[slot] - 1) == key) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            m_index[slot] = row + 1;
+        }
+    }
+}
@@ -0,0 +1,183 @@
+#ifndef PRISMQUANTA_TASK_TABLE_H
+#define PRISMQUANTA_TASK_TABLE_H
+
+#include "PQLParser.h"
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/** @brief An interned string; two atoms from the same AtomTable are equal exactly when their strings are. */
+using Atom = uint16_t;
+
+/**
+ * @brief Interns the small vocabularies of task attributes (type, priority, status).
+ *
+ * The schema leaves these open, so any value is accepted, but the ones the
+ * pipeline uses are registered up front with fixed atoms: comparing a task's
+ * priority against kHigh is an integer compare, with no lookup at all.
+ * Atom 0 is the empty string, i.e. an attribute that was not given.
+ */
+class AtomTable {
+public:
+    static constexpr Atom kEmpty = 0;
+    static constexpr Atom kHigh = 1;
+    static constexpr Atom kMedium = 2;
+    static constexpr Atom kLow = 3;
+    static constexpr Atom kPending = 4;
+    static constexpr Atom kInProgress = 5;
+    static constexpr Atom kDone = 6;
+    static constexpr Atom kFailed = 7;
+    /** @brief Never assigned; TaskTable::select() takes it as "any value". */
+    static constexpr Atom kAny = UINT16_MAX;
+
+    AtomTable();
+    // The map's keys view m_names, so a copy must index its own names.
+    AtomTable(const AtomTable& other);
+    AtomTable& operator=(const AtomTable& other);
+    AtomTable(AtomTable&&) = default;
+    AtomTable& operator=(AtomTable&&) = default;
+
+    /** @brief The atom for @p name, assigning the next free one if it is new; empty once all are taken. */
+    std::optional<Atom> intern(std::string_view name);
+
+    /** @brief The atom for @p name if it has been interned. */
+    std::optional<Atom> find(std::string_view name) const;
+
+    std::string_view name(Atom atom) const { return m_names[atom]; }
+    size_t size() const { return m_names.size(); }
+
+private:
+    std::deque<std::string> m_names;  // A deque keeps the map's keys in place as it grows.
+    std::unordered_map<std::string_view, Atom> m_atoms;
+};
+
+/**
+ * @brief Tasks stored column by column, for scans over many resident tasks.
+ *
+ * A PQLTask costs seven strings and three vectors of strings, each its own
+ * allocation. Here type, priority and status are atoms in 2-byte columns,
+ * created is also kept as milliseconds since the epoch, and all text (ids,
+ * descriptions, commands, criteria, notes, dependencies) is appended to one
+ * arena per table and referenced by 8-byte (offset, length) spans. A filter such
+ * as "pending and high priority" walks two contiguous uint16_t arrays, and
+ * a table of a million tasks is a handful of allocations.
+ *
+ * Rows keep the order they were added in. Ids are indexed in an
+ * open-addressing hash table; with duplicates, find() returns the first.
+ * Views returned by the accessors point into the arena and are valid until
+ * the next add(). Not thread-safe; share a finished table read-only.
+ */
+class TaskTable {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    TaskTable() = default;
+
+    /** @brief Pre-sizes the columns and the text arena to avoid regrowth while loading. */
+    void reserve(size_t tasks, size_t textBytes);
+    void clear();
+
+    /**
+     * @brief Appends a task.
+     * @return False, adding nothing, if the arena would pass 4 GiB or an attribute vocabulary is full.
+     */
+    bool add(const PQLTaskView& task);
+    bool add(const PQLTask& task);
+
+    /**
+     * @brief Appends every task of a PQL file (or a compiled store), streamed through PQLParser.
+     * @return The number of tasks added.
+     */
+    size_t load(const std::string& filename);
+
+    size_t size() const { return m_id.size(); }
+    bool empty() const { return m_id.empty(); }
+
+    Atom type(size_t row) const { return m_type[row]; }
+    Atom priority(size_t row) const { return m_priority[row]; }
+    Atom status(size_t row) const { return m_status[row]; }
+    /** @brief The created attribute in milliseconds since the epoch; INT64_MIN if absent or malformed. */
+    int64_t createdMs(size_t row) const { return m_created[row]; }
+
+    std::string_view id(size_t row) const { return text(m_id[row]); }
+    std::string_view description(size_t row) const { return text(m_description[row]); }
+    std::string_view notes(size_t row) const { return text(m_notes[row]); }
+    size_t commandCount(size_t row) const { return m_lists[row].commands; }
+    std::string_view command(size_t row, size_t i) const { return text(m_lines[m_lists[row].first + i]); }
+    size_t criterionCount(size_t row) const { return m_lists[row].criteria; }
+    std::string_view criterion(size_t row, size_t i) const {
+        return text(m_lines[m_lists[row].first + m_lists[row].commands + i]);
+    }
+    size_t dependencyCount(size_t row) const { return m_lists[row].dependencies; }
+    std::string_view dependency(size_t row, size_t i) const {
+        const Lists& lists = m_lists[row];
+        return text(m_lines[lists.first + lists.commands + lists.criteria + i]);
+    }
+
+    /** @brief Changes a task's status in place, e.g. as the scheduler moves it along. */
+    bool setStatus(size_t row, std::string_view status);
+    void setStatus(size_t row, Atom status) { m_status[row] = status; }
+
+    const AtomTable& atoms() const { return m_atoms; }
+
+    /** @brief The row of the task with this id, or npos. */
+    uint32_t find(std::string_view id) const;
+
+    /**
+     * @brief The rows whose status and priority match, in row order.
+     * @param status An atom, or AtomTable::kAny.
+     * @param priority An atom, or AtomTable::kAny.
+     */
+    std::vector<uint32_t> select(Atom status, Atom priority = AtomTable::kAny) const;
+
+    /** @brief How many rows have this status. */
+    size_t count(Atom status) const;
+
+    /** @brief Fills @p out with views of a row, reusing its vectors; valid until the next add(). */
+    void view(size_t row, PQLTaskView& out) const;
+
+    /** @brief An owning copy of a row, for code that takes a PQLTask. */
+    PQLTask task(size_t row) const;
+
+    /** @brief Heap bytes held by the columns, arena, index and atoms. */
+    size_t memoryBytes() const;
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint32_t size;
+    };
+    struct Lists {
+        uint32_t first;     // Into m_lines: the commands, the criteria, then the dependencies.
+        uint16_t commands;
+        uint16_t criteria;
+        uint16_t dependencies;
+    };
+
+    std::string_view text(Span span) const { return std::string_view(m_text).substr(span.offset, span.size); }
+    Span store(std::string_view value);
+    void index(uint32_t row);
+    void rehash(size_t slots);
+
+    AtomTable m_atoms;
+    std::string m_text;  // The arena.
+
+    std::vector<Atom> m_type;
+    std::vector<Atom> m_priority;
+    std::vector<Atom> m_status;
+    std::vector<int64_t> m_created;
+    std::vector<Span> m_id;
+    std::vector<Span> m_createdText;
+    std::vector<Span> m_description;
+    std::vector<Span> m_notes;
+    std::vector<Lists> m_lists;
+    std::vector<Span> m_lines;
+
+    std::vector<uint32_t> m_index;  // Row + 1 per slot, 0 when empty; a power of two, at most half full.
+};
+
+#endif //PRISMQUANTA_TASK_TABLE_H
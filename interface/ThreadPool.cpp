@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+namespace {
+    // Index of the pool worker running on this thread, or -1 for outside threads.
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local size_t t_workerIndex = 0;
+}
+
+ThreadPool::ThreadPool(size_t workers) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(Job job) {
+    size_t index = (t_pool == this)
+        ? t_workerIndex
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    m_outstanding.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->jobs.push_back(std::move(job));
+    }
+    {
+        // Taking the sleep mutex orders the increment against a worker that is about to wait.
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued.fetch_add(1, std::memory_order_release);
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::popLocal(size_t index, Job& job) {
+    WorkQueue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Job& job) {
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkQueue& victim = *m_queues[(thief + offset) % m_queues.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.jobs.empty()) {
+            continue;
+        }
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::finishJob() {
+    {
+        // Decrement under the mutex so waitBelow() cannot miss the wake-up.
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_outstanding.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    m_progress.notify_all();
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    t_pool = this;
+    t_workerIndex = index;
+
+    while (true) {
+        Job job;
+        if (popLocal(index, job) || steal(index, job)) {
+            m_queued.fetch_sub(1, std::memory_order_acq_rel);
+            job();
+            finishJob();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        // A failed try_lock during stealing can miss a job, so only sleep when none are queued anywhere.
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_acquire) > 0; });
+        if (m_stopping && m_queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::waitBelow(size_t limit) {
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_progress.wait(lock, [this, limit] { return m_outstanding.load(std::memory_order_acquire) < limit; });
+}
@@ -0,0 +1,79 @@
+#ifndef PRISMQUANTA_THREAD_POOL_H
+#define PRISMQUANTA_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size thread pool with per-worker deques and work stealing.
+ *
+ * Jobs submitted from inside a worker go to the back of that worker's own
+ * deque and are popped LIFO, which keeps related work on one core. Jobs from
+ * other threads are spread round-robin. A worker whose deque is empty steals
+ * from the front of the other deques before it goes to sleep.
+ */
+class ThreadPool {
+public:
+    using Job = std::function<void()>;
+
+    /**
+     * @brief Starts the workers.
+     * @param workers Number of threads; values below 1 are treated as 1.
+     */
+    explicit ThreadPool(size_t workers);
+
+    /**
+     * @brief Finishes all queued jobs, then joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Job job);
+
+    /**
+     * @brief Blocks until fewer than limit jobs are queued or running.
+     */
+    void waitBelow(size_t limit);
+
+    /**
+     * @brief Blocks until every submitted job has finished.
+     */
+    void waitIdle() { waitBelow(1); }
+
+    size_t size() const { return m_queues.size(); }
+
+    /** @brief Jobs submitted but not yet finished. */
+    size_t outstanding() const { return m_outstanding.load(std::memory_order_acquire); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Job& job);
+    bool steal(size_t thief, Job& job);
+    void finishJob();
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_nextQueue{0};
+    std::atomic<size_t> m_queued{0};
+    std::atomic<size_t> m_outstanding{0};
+    std::atomic<bool> m_stopping{false};
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_progress;
+};
+
+#endif //PRISMQUANTA_THREAD_POOL_H
@@ -0,0 +1,559 @@
+#include "WalQueue.h"
+#include "Hash.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace {
+    enum RecordType : uint8_t {
+        kEnqueue = 1,   // value: arrival time (ms since the epoch); rest: the task's XML.
+        kClaim = 2,     // value: claim token.
+        kComplete = 3,  // value: claim token.
+        kFail = 4,      // value: claim token; rest: the reason.
+        kRelease = 5,   // value: claim token.
+    };
+
+    struct RecordHeader {
+        uint32_t size;  // Of the body.
+        uint32_t type;
+        uint64_t checksum;
+    };
+    static_assert(sizeof(RecordHeader) == 16, "record header must stay 16 bytes");
+
+    constexpr char kFileMagic[8] = {'P', 'Q', 'W', 'L', 1, 0, 0, 0};
+    constexpr size_t kFileHeader = sizeof(kFileMagic);
+    constexpr size_t kBodyFixed = sizeof(uint64_t) + sizeof(uint32_t);
+
+    // Dead records below this are not worth a rewrite.
+    constexpr uint64_t kMinCompactBytes = 1 << 20;
+
+    // How long a record that nobody waits for may stay in memory.
+    constexpr auto kCommitDelay = std::chrono::milliseconds(10);
+
+    // Leases are checked at most this often.
+    constexpr auto kLeaseCheckInterval = std::chrono::seconds(1);
+
+    size_t record_size(std::string_view name, std::string_view rest) {
+        return sizeof(RecordHeader) + kBodyFixed + name.size() + rest.size();
+    }
+
+    uint64_t checksum(uint32_t size, uint32_t type, std::string_view body) {
+        Hasher hasher;
+        hasher.update(std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)));
+        hasher.update(std::string_view(reinterpret_cast<const char*>(&type), sizeof(type)));
+        return hasher.update(body).digest64();
+    }
+
+    void append_record(std::string& out, uint8_t type, uint64_t value, std::string_view name, std::string_view rest) {
+        RecordHeader header{};
+        header.size = static_cast<uint32_t>(kBodyFixed + name.size() + rest.size());
+        header.type = type;
+        size_t start = out.size();
+        out.resize(start + sizeof(header));
+        uint32_t name_size = static_cast<uint32_t>(name.size());
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        out.append(reinterpret_cast<const char*>(&name_size), sizeof(name_size));
+        out.append(name);
+        out.append(rest);
+        header.checksum = checksum(header.size, header.type, std::string_view(out).substr(start + sizeof(header)));
+        std::memcpy(&out[start], &header, sizeof(header));
+    }
+
+    bool write_all(int fd, const char* data, size_t size, off_t offset) {
+        while (size > 0) {
+            ssize_t n = pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += n;
+        }
+        return true;
+    }
+
+    // Makes a rename in the directory durable.
+    void sync_parent(const std::string& path) {
+        fs::path parent = fs::path(path).parent_path();
+        int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    int64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+} // namespace
+
+WalQueue::WalQueue(std::chrono::seconds agingInterval) : m_ready(agingInterval) {}
+
+WalQueue::~WalQueue() {
+    close();
+}
+
+bool WalQueue::open(const std::string& path, std::chrono::seconds lease) {
+    close();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_error.clear();
+
+    std::error_code ec;
+    if (fs::path(path).has_parent_path()) {
+        fs::create_directories(fs::path(path).parent_path(), ec);
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        m_error = std::strerror(errno);
+        return false;
+    }
+    // Replay, appends and compaction assume a single owner.
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        m_error = errno == EWOULDBLOCK ? "in use by another process" : std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        m_error = std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint64_t end = kFileHeader;
+    if (size == 0) {
+        if (!write_all(fd, kFileMagic, kFileHeader, 0) || ::fdatasync(fd) != 0) {
+            m_error = std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+    } else {
+        MappedFile file;
+        if (!file.open(path) || file.view().size() < kFileHeader ||
+            std::memcmp(file.data(), kFileMagic, kFileHeader) != 0) {
+            // Unlike a cache, a queue is never thrown away.
+            m_error = "not a task queue log";
+            ::close(fd);
+            return false;
+        }
+        end = replayLocked(file.view());
+    }
+
+    if (end < size) {
+        Logger::instance().warn("WalQueue", "Discarding " + std::to_string(size - end) + " bytes of torn or corrupt records at the end of " + path);
+        if (ftruncate(fd, static_cast<off_t>(end)) != 0 || ::fdatasync(fd) != 0) {
+            m_error = std::strerror(errno);
+            ::close(fd);
+            resetLocked();
+            return false;
+        }
+    }
+
+    m_path = path;
+    m_fd = fd;
+    m_lease = lease;
+    m_fileSize = end;
+    m_buffer.clear();
+    m_appended = m_durable = 0;
+    m_failed = false;
+    m_stats = Stats();
+    m_nextLeaseCheck = std::chrono::steady_clock::now() + kLeaseCheckInterval;
+    m_stopping = false;
+    m_committer = std::thread([this] { commitLoop(); });
+
+    // The lock says whoever claimed these is gone.
+    size_t released = 0;
+    for (auto& [name, task] : m_tasks) {
+        if (task.state == State::Claimed) {
+            releaseLocked(name, task);
+            ++released;
+        }
+    }
+    if (released > 0) {
+        commitLocked(lock, m_appended);
+        Logger::instance().warn("WalQueue", "Offered " + std::to_string(released) + " task(s) claimed by a previous run again.");
+    }
+    Logger::instance().info("WalQueue", "Opened " + path + " with " + std::to_string(m_tasks.size()) + " queued task(s).");
+    return true;
+}
+
+void WalQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_fd < 0) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_appendedSignal.notify_all();
+    m_committer.join();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    commitLocked(lock, m_appended);
+    m_flushed.wait(lock, [this] { return !m_flushing; });
+    ::close(m_fd);
+    m_fd = -1;
+    resetLocked();
+}
+
+void WalQueue::resetLocked() {
+    m_tasks.clear();
+    while (m_ready.pop()) {
+    }
+    m_liveBytes = 0;
+    m_nextToken = 1;
+}
+
+size_t WalQueue::replayLocked(std::string_view data) {
+    size_t offset = kFileHeader;
+    while (offset + sizeof(RecordHeader) <= data.size()) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        if (header.size < kBodyFixed || header.size > data.size() - offset - sizeof(header)) {
+            break;
+        }
+        std::string_view body = data.substr(offset + sizeof(header), header.size);
+        if (checksum(header.size, header.type, body) != header.checksum) {
+            break;
+        }
+        uint64_t value;
+        uint32_t name_size;
+        std::memcpy(&value, body.data(), sizeof(value));
+        std::memcpy(&name_size, body.data() + sizeof(value), sizeof(name_size));
+        if (name_size > body.size() - kBodyFixed || header.type < kEnqueue || header.type > kRelease) {
+            break;
+        }
+        std::string name(body.substr(kBodyFixed, name_size));
+        applyLocked(static_cast<uint8_t>(header.type), value, name, body.substr(kBodyFixed + name_size));
+        offset += sizeof(header) + header.size;
+    }
+    return offset;
+}
+
+void WalQueue::applyLocked(uint8_t type, uint64_t value, const std::string& name, std::string_view rest) {
+    auto it = m_tasks.find(name);
+    const size_t claim_bytes = record_size(name, {});
+    if (type == kEnqueue) {
+        if (it != m_tasks.end()) {
+            m_liveBytes -= record_size(name, it->second.payload) + (it->second.state == State::Claimed ? claim_bytes : 0);
+            m_ready.remove(name);
+            m_tasks.erase(it);
+        }
+        Task task;
+        task.payload = std::string(rest);
+        task.arrivedMs = static_cast<int64_t>(value);
+        task.rank = m_ready.rank(task.payload, task.arrivedMs);
+        m_ready.push(name, task.rank);
+        m_liveBytes += record_size(name, task.payload);
+        m_tasks.emplace(name, std::move(task));
+        return;
+    }
+
+    m_nextToken = std::max(m_nextToken, value + 1);
+    if (it == m_tasks.end()) {
+        return;
+    }
+    Task& task = it->second;
+    switch (type) {
+    case kClaim:
+        if (task.state == State::Pending) {
+            m_ready.remove(name);
+            task.state = State::Claimed;
+            task.token = value;
+            task.leaseEnd = std::chrono::steady_clock::now() + m_lease;
+            m_liveBytes += claim_bytes;
+        }
+        break;
+    case kRelease:
+        if (task.state == State::Claimed && task.token == value) {
+            task.state = State::Pending;
+            m_ready.push(name, task.rank);
+            m_liveBytes -= claim_bytes;
+        }
+        break;
+    case kComplete:
+    case kFail:
+        // A released claim still counts as long as nobody has claimed the task since.
+        if (task.token == value) {
+            if (task.state == State::Claimed) {
+                m_liveBytes -= claim_bytes;
+            } else {
+                m_ready.remove(name);
+            }
+            m_liveBytes -= record_size(name, task.payload);
+            m_tasks.erase(it);
+        }
+        break;
+    }
+}
+
+uint64_t WalQueue::appendLocked(uint8_t type, uint64_t value, std::string_view name, std::string_view rest) {
+    append_record(m_buffer, type, value, name, rest);
+    ++m_stats.records;
+    if (m_appended == m_durable) {
+        m_appendedSignal.notify_one();
+    }
+    return ++m_appended;
+}
+
+void WalQueue::commitLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_appendedSignal.wait(lock, [this] { return m_stopping || (m_appended > m_durable && !m_failed); });
+        if (m_stopping) {
+            return;
+        }
+        // Give the records a moment to gather, unless an enqueue commits them first.
+        m_appendedSignal.wait_for(lock, kCommitDelay, [this] { return m_stopping; });
+        commitLocked(lock, m_appended);
+    }
+}
+
+bool WalQueue::commitLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn) {
+    while (m_durable < lsn && !m_failed) {
+        if (m_flushing) {
+            // Someone is writing; whatever they did not take goes out with the next leader.
+            m_flushed.wait(lock);
+            continue;
+        }
+        m_flushing = true;
+        std::string batch;
+        batch.swap(m_buffer);
+        uint64_t target = m_appended;
+        uint64_t offset = m_fileSize;
+        int fd = m_fd;
+
+        lock.unlock();
+        bool ok = write_all(fd, batch.data(), batch.size(), static_cast<off_t>(offset)) && ::fdatasync(fd) == 0;
+        int error = errno;
+        lock.lock();
+
+        m_flushing = false;
+        ++m_stats.commits;
+        if (ok) {
+            m_fileSize = offset + batch.size();
+            m_durable = target;
+        } else {
+            // The queue in memory is now ahead of the log; refuse further work rather than diverge.
+            m_failed = true;
+            m_error = std::strerror(error);
+            Logger::instance().error("WalQueue", "Could not write " + m_path + ": " + m_error);
+        }
+        m_flushed.notify_all();
+    }
+    return m_durable >= lsn;
+}
+
+bool WalQueue::enqueue(const std::vector<std::pair<std::string, std::string>>& tasks) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_fd < 0 || m_failed) {
+        return false;
+    }
+    if (tasks.empty()) {
+        return true;
+    }
+    int64_t arrived = now_ms();
+    uint64_t lsn = 0;
+    for (const auto& [name, payload] : tasks) {
+        lsn = appendLocked(kEnqueue, static_cast<uint64_t>(arrived), name, payload);
+        applyLocked(kEnqueue, static_cast<uint64_t>(arrived), name, payload);
+    }
+    return commitLocked(lock, lsn);
+}
+
+bool WalQueue::enqueue(const std::string& name, std::string_view payload) {
+    return enqueue({{name, std::string(payload)}});
+}
+
+size_t WalQueue::importFiles(const std::vector<fs::path>& files, const std::function<bool(const fs::path&)>& accept) {
+    std::vector<std::pair<std::string, std::string>> tasks;
+    std::vector<fs::path> imported;
+    for (const fs::path& file : files) {
+        std::string name = file.filename().string();
+        if (name.empty() || name[0] == '.' || (accept && !accept(file))) {
+            continue;
+        }
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            continue;  // Gone already.
+        }
+        std::ostringstream content;
+        content << in.rdbuf();
+        tasks.emplace_back(std::move(name), content.str());
+        imported.push_back(file);
+    }
+    if (tasks.empty() || !enqueue(tasks)) {
+        return 0;
+    }
+    std::error_code ec;
+    for (const fs::path& file : imported) {
+        fs::remove(file, ec);
+    }
+    return imported.size();
+}
+
+size_t WalQueue::importDirectory(const fs::path& dir, const std::function<bool(const fs::path&)>& accept) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            files.push_back(it->path());
+        }
+    }
+    return importFiles(files, accept);
+}
+
+std::optional<WalQueue::Claim> WalQueue::claim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0 || m_failed) {
+        return std::nullopt;
+    }
+    std::optional<fs::path> next = m_ready.pop();
+    if (!next) {
+        return std::nullopt;
+    }
+    Claim claim;
+    claim.name = next->string();
+    claim.token = m_nextToken++;
+    appendLocked(kClaim, claim.token, claim.name, {});
+    applyLocked(kClaim, claim.token, claim.name, {});
+    claim.payload = m_tasks[claim.name].payload;
+    return claim;
+}
+
+bool WalQueue::finishLocked(const Claim& claim, uint8_t type, std::string_view reason) {
+    if (m_fd < 0 || m_failed) {
+        return false;
+    }
+    auto it = m_tasks.find(claim.name);
+    if (it == m_tasks.end() || it->second.token != claim.token) {
+        return false;
+    }
+    appendLocked(type, claim.token, claim.name, reason);
+    applyLocked(type, claim.token, claim.name, reason);
+    return true;
+}
+
+bool WalQueue::complete(const Claim& claim) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return finishLocked(claim, kComplete, {});
+}
+
+bool WalQueue::fail(const Claim& claim, std::string_view reason) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return finishLocked(claim, kFail, reason);
+}
+
+void WalQueue::releaseLocked(const std::string& name, Task& task) {
+    appendLocked(kRelease, task.token, name, {});
+    applyLocked(kRelease, task.token, name, {});
+}
+
+size_t WalQueue::maintain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_fd < 0 || m_failed) {
+        return 0;
+    }
+    size_t released = 0;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= m_nextLeaseCheck) {
+        m_nextLeaseCheck = now + kLeaseCheckInterval;
+        for (auto& [name, task] : m_tasks) {
+            if (task.state == State::Claimed && task.leaseEnd <= now) {
+                Logger::instance().warn("WalQueue", "Claim on " + name + " held for over " + std::to_string(m_lease.count()) +
+                                        " s; offering it again.");
+                releaseLocked(name, task);
+                ++released;
+            }
+        }
+    }
+
+    auto worth_compacting = [this] {
+        uint64_t records = m_fileSize + m_buffer.size() - kFileHeader;
+        uint64_t dead = records - std::min(records, m_liveBytes);
+        return dead > kMinCompactBytes && dead > m_liveBytes;
+    };
+    if (worth_compacting()) {
+        // Checked again once no commit is in flight: another caller may have compacted meanwhile.
+        m_flushed.wait(lock, [this] { return !m_flushing; });
+        if (worth_compacting()) {
+            compactLocked();
+        }
+    }
+    return released;
+}
+
+bool WalQueue::compactLocked() {
+    uint64_t before = m_fileSize + m_buffer.size();
+
+    // The tasks in memory already include everything buffered, so the buffer is folded in too.
+    std::string out(kFileMagic, kFileHeader);
+    out.reserve(kFileHeader + m_liveBytes);
+    for (const auto& [name, task] : m_tasks) {
+        append_record(out, kEnqueue, static_cast<uint64_t>(task.arrivedMs), name, task.payload);
+        if (task.state == State::Claimed) {
+            append_record(out, kClaim, task.token, name, {});
+        }
+    }
+
+    std::string temp = m_path + ".tmp";
+    int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && write_all(fd, out.data(), out.size(), 0) && ::fdatasync(fd) == 0 &&
+              flock(fd, LOCK_EX | LOCK_NB) == 0 && ::rename(temp.c_str(), m_path.c_str()) == 0;
+    if (!ok) {
+        Logger::instance().warn("WalQueue", "Could not compact " + m_path + ": " + std::strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        ::unlink(temp.c_str());
+        return false;
+    }
+    sync_parent(m_path);
+
+    ::close(m_fd);
+    m_fd = fd;
+    m_fileSize = out.size();
+    m_buffer.clear();
+    m_durable = m_appended;
+    ++m_stats.compactions;
+    m_flushed.notify_all();
+    Logger::instance().info("WalQueue", "Compacted " + m_path + " from " + std::to_string(before) + " to " +
+                            std::to_string(out.size()) + " bytes (" + std::to_string(m_tasks.size()) + " queued task(s)).");
+    return true;
+}
+
+std::string WalQueue::error() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+bool WalQueue::failed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+size_t WalQueue::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready.size();
+}
+
+WalQueue::Stats WalQueue::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.pending = m_ready.size();
+    stats.claimed = m_tasks.size() - m_ready.size();
+    stats.fileBytes = m_fileSize + m_buffer.size();
+    stats.liveBytes = kFileHeader + m_liveBytes;
+    return stats;
+}
@@ -0,0 +1,184 @@
+#ifndef PRISMQUANTA_WAL_QUEUE_H
+#define PRISMQUANTA_WAL_QUEUE_H
+
+#include "ReadyQueue.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Crash-safe task queue kept in an append-only write-ahead log.
+ *
+ * Every state change is a checksummed record appended to one file:
+ * enqueue (the task's name and XML), claim, complete, fail, and release
+ * (a claim given back). The pending and claimed tasks are held in memory,
+ * ranked by a ReadyQueue, and rebuilt by replaying the log on open().
+ *
+ * Commits are grouped: an enqueue appends its records and waits, and
+ * whichever waiter gets there first writes everything appended so far with
+ * a single fdatasync while the others queue up behind it. Claims,
+ * completions, failures and releases do not wait; they go out with the next
+ * commit, which a background thread makes at most 10 ms after they were
+ * appended. A crash can therefore make tasks finished in those last
+ * milliseconds run again, but never loses an enqueued one. One fsync
+ * covers many transitions, where the directory queue pays a rename for each.
+ *
+ * Recovery: a torn or corrupt record at the end of the log (a crash
+ * mid-append) is cut off. The file is flocked, so claims found in the log
+ * belong to a process that has died; they are released at once. While the
+ * queue is open, a claim not completed within the lease is released too,
+ * so a hung worker cannot hold its task forever; if it finishes later its
+ * completion still counts unless the task was claimed again meanwhile.
+ *
+ * Completed and failed tasks leave the log at the next compaction, which
+ * rewrites the live tasks into a fresh file and renames it over the old one
+ * once the dead records outweigh them.
+ *
+ * File layout: an 8-byte header ("PQWL", version), then records of
+ * { body size, type, checksum } followed by the body
+ * { arrival time or claim token, name size, name, payload or reason }.
+ * Thread-safe.
+ */
+class WalQueue {
+public:
+    /** @brief A claimed task; hand it back to complete() or fail(). */
+    struct Claim {
+        std::string name;
+        std::string payload;
+        uint64_t token = 0;
+    };
+
+    struct Stats {
+        size_t pending = 0;
+        size_t claimed = 0;
+        uint64_t records = 0;      ///< Appended since open().
+        uint64_t commits = 0;      ///< fdatasync calls since open().
+        uint64_t compactions = 0;
+        uint64_t fileBytes = 0;
+        uint64_t liveBytes = 0;    ///< What the log would shrink to if compacted now.
+    };
+
+    explicit WalQueue(std::chrono::seconds agingInterval);
+    ~WalQueue();
+
+    WalQueue(const WalQueue&) = delete;
+    WalQueue& operator=(const WalQueue&) = delete;
+
+    /**
+     * @brief Opens (or creates) the log, replays it and releases the claims of the previous run.
+     * @param lease How long a claim may stay open before its task is offered again.
+     * @return False on error (see error()), e.g. when another process has the log open.
+     */
+    bool open(const std::string& path, std::chrono::seconds lease);
+
+    /** @brief Stops the background commits, commits anything still buffered and closes the log. */
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+    std::string error() const;
+
+    /** @brief True once a commit has failed; every change is refused from then on. */
+    bool failed() const;
+
+    /**
+     * @brief Queues tasks by name, replacing any queued task of the same name; durable on return.
+     *
+     * A replaced task that is claimed keeps running, but its completion no
+     * longer removes the new one.
+     */
+    bool enqueue(const std::vector<std::pair<std::string, std::string>>& tasks);
+    bool enqueue(const std::string& name, std::string_view payload);
+
+    /**
+     * @brief Moves task files into the queue: reads them, commits them, then deletes them.
+     *
+     * Hidden files (a producer's temporaries) and files @p accept turns down
+     * are left alone. A crash between the commit and the deletes leaves files
+     * that are imported again on the next call; the second copy replaces the
+     * first if it has not run yet.
+     * @return How many files were imported.
+     */
+    size_t importFiles(const std::vector<fs::path>& files, const std::function<bool(const fs::path&)>& accept = {});
+    size_t importDirectory(const fs::path& dir, const std::function<bool(const fs::path&)>& accept = {});
+
+    /** @brief Takes the highest-ranked pending task, if any. */
+    std::optional<Claim> claim();
+
+    /** @brief Removes a claimed task from the queue. False if the claim was superseded. */
+    bool complete(const Claim& claim);
+
+    /** @brief Like complete(), but records why the task failed. */
+    bool fail(const Claim& claim, std::string_view reason);
+
+    /**
+     * @brief Releases claims held longer than the lease and compacts the log when it is worth it.
+     *
+     * Call it now and then from the dispatching thread.
+     * @return How many claims were released.
+     */
+    size_t maintain();
+
+    size_t pendingCount() const;
+    Stats stats() const;
+
+private:
+    enum class State : uint8_t { Pending, Claimed };
+
+    struct Task {
+        std::string payload;
+        int64_t arrivedMs = 0;
+        int64_t rank = 0;     // ReadyQueue sort key.
+        State state = State::Pending;
+        uint64_t token = 0;   // Of the latest claim; 0 if never claimed since it was enqueued.
+        std::chrono::steady_clock::time_point leaseEnd;
+    };
+
+    uint64_t appendLocked(uint8_t type, uint64_t value, std::string_view name, std::string_view rest);
+    bool commitLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn);
+    void applyLocked(uint8_t type, uint64_t value, const std::string& name, std::string_view rest);
+    bool finishLocked(const Claim& claim, uint8_t type, std::string_view reason);
+    void releaseLocked(const std::string& name, Task& task);
+    size_t replayLocked(std::string_view data);
+    void resetLocked();
+    bool compactLocked();  // Only while no commit is in flight.
+    void commitLoop();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_flushed;
+    std::condition_variable m_appendedSignal;  // Wakes the committer.
+    std::thread m_committer;
+    bool m_stopping = false;
+    std::string m_path;
+    std::string m_error;
+    int m_fd = -1;
+    std::chrono::seconds m_lease{1800};
+    std::chrono::steady_clock::time_point m_nextLeaseCheck;
+
+    ReadyQueue m_ready;
+    std::unordered_map<std::string, Task> m_tasks;  // Pending and claimed.
+    uint64_t m_nextToken = 1;
+    uint64_t m_liveBytes = 0;  // Enqueue and claim records of the tasks above.
+
+    // Group commit: m_buffer holds records m_durable+1 .. m_appended, not yet written.
+    std::string m_buffer;
+    uint64_t m_appended = 0;
+    uint64_t m_durable = 0;
+    bool m_flushing = false;
+    bool m_failed = false;
+    uint64_t m_fileSize = 0;
+    Stats m_stats;
+};
+
+#endif //PRISMQUANTA_WAL_QUEUE_H
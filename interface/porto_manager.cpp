@@ -1,18 +1,75 @@
 #include "Config.h"
+#include "JobControl.h"
+#include "LogIndex.h"
+#include "Logger.h"
+#include "PQLQueryClient.h"
+#include "ProcessRunner.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
-#include <fstream>
-#include <chrono>
-#include <ctime>
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <signal.h>
 #include <sstream>
-#include <sys/wait.h>
+#include <thread>
 
 namespace fs = std::filesystem;
 
+static std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+// Removes a trailing "&" (run in the background) from a command line.
+static bool take_background(std::string& line) {
+    line = trim(line);
+    if (line.empty() || line.back() != '&') {
+        return false;
+    }
+    line = trim(line.substr(0, line.size() - 1));
+    return true;
+}
+
+// Splits "a.sh x | b.sh 'y|z'" at the pipes outside quotes.
+static std::vector<std::string> split_pipeline(const std::string& line) {
+    std::vector<std::string> stages(1);
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '\\' && i + 1 < line.size()) {
+            stages.back() += c;
+            c = line[++i];
+        } else if (c == '|') {
+            stages.emplace_back();
+            continue;
+        }
+        stages.back() += c;
+    }
+    for (auto& stage : stages) {
+        stage = trim(stage);
+    }
+    return stages;
+}
+
+// Set by SIGINT at the prompt, SIGTERM or SIGHUP, which end the prompt loop so the jobs are stopped.
+static volatile sig_atomic_t g_stopSignal = 0;
+
+static void on_stop_signal(int sig) {
+    g_stopSignal = sig;
+}
+
 class PortoManager {
 public:
     PortoManager() : m_scriptsDir("scripts"), m_logFile("logs/quantaporto.log") {}
@@ -30,6 +87,11 @@ public:
         if (logFileOpt) {
             m_logFile = *logFileOpt;
         }
+        // configure() opens LOG_FILE itself; fall back to the default path when it is unset.
+        Logger& logger = Logger::instance();
+        if (!logger.configure(m_config) || (!logFileOpt && !logger.open(m_logFile))) {
+            std::cerr << "Warning: Could not open log file: " << m_logFile << std::endl;
+        }
 
         if (!fs::exists(m_scriptsDir)) {
             std::cerr << "Error: Scripts directory does not exist: " << m_scriptsDir << std::endl;
@@ -43,20 +105,7 @@ public:
     }
 
     void writeLog(const std::string& message) {
-        fs::path logPath(m_logFile);
-        if (!fs::exists(logPath.parent_path())) {
-            fs::create_directories(logPath.parent_path());
-        }
-
-        std::ofstream log(m_logFile, std::ios_base::app);
-        if (log.is_open()) {
-            auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            std::string timeStr = std::ctime(&now);
-            if (!timeStr.empty() && timeStr.back() == '\n') {
-                timeStr.pop_back();
-            }
-            log << "[" << timeStr << "] [PortoManager] " << message << "\n";
-        }
+        Logger::instance().info("PortoManager", message);
     }
 
     void discoverScripts() {
@@ -88,51 +137,186 @@ public:
         std::cout << "-------------------------------\n";
     }
 
-    std::string sanitize(const std::string& input) {
-        std::string sanitized;
-        for (char c : input) {
-            if (std::isalnum(c) || c == '_' || c == '-' || c == '.' || c == '/' || c == ' ') {
-                sanitized += c;
+    /** @brief A script by its index in list (counting from 1) or its file name. */
+    std::optional<std::string> resolveScript(const std::string& target) const {
+        try {
+            size_t index = std::stoul(target);
+            if (index > 0 && index <= m_scripts.size()) {
+                return m_scripts[index - 1];
             }
+        } catch (...) {}
+
+        auto it = std::find(m_scripts.begin(), m_scripts.end(), target);
+        if (it != m_scripts.end()) {
+            return *it;
         }
-        return sanitized;
+        return std::nullopt;
     }
 
-    bool executeScript(const std::string& scriptName, const std::string& args = "") {
+    /**
+     * @brief How a script runs: under bash with the configured timeout and limits, its output logged.
+     * @return False (after printing why) if the script does not exist.
+     */
+    bool scriptOptions(const std::string& scriptName, const std::string& args, ProcessOptions& options) {
         fs::path scriptPath = fs::path(m_scriptsDir) / scriptName;
         if (!fs::exists(scriptPath)) {
             std::cerr << "Error: Script not found: " << scriptPath << std::endl;
             return false;
         }
 
-        std::string sanitizedArgs = sanitize(args);
-        writeLog("Executing script: " + scriptName + (sanitizedArgs.empty() ? "" : " with sanitized args: " + sanitizedArgs));
-        std::cout << "Executing: " << scriptName << " " << sanitizedArgs << " ..." << std::endl;
+        // Arguments are passed to bash as separate argv entries, never through a shell command line.
+        options.argv = {"bash", scriptPath.string()};
+        for (auto& arg : ProcessRunner::splitArgs(args)) {
+            options.argv.push_back(std::move(arg));
+        }
+        options.timeout = std::chrono::seconds(m_config.getInt("SCRIPT_TIMEOUT_SEC").value_or(0));
+        options.limits.cpuSeconds = static_cast<unsigned long>(std::max(0, m_config.getInt("SCRIPT_CPU_LIMIT_SEC").value_or(0)));
+        options.limits.memoryBytes = static_cast<unsigned long>(std::max(0, m_config.getInt("SCRIPT_MEMORY_LIMIT_MB").value_or(0))) * 1024 * 1024;
 
-        std::string command = "bash " + scriptPath.string() + " " + sanitizedArgs;
-        int status = std::system(command.c_str());
+        std::string component = "PortoManager:" + scriptName;
+        options.onStdout = [component](std::string_view line) {
+            Logger::instance().info(component, line);
+        };
+        options.onStderr = [component](std::string_view line) {
+            Logger::instance().warn(component, line);
+        };
+        return true;
+    }
 
-        int exitCode = -1;
-        if (WIFEXITED(status)) {
-            exitCode = WEXITSTATUS(status);
+    bool executeScript(const std::string& scriptName, const std::string& args = "") {
+        ProcessOptions options;
+        if (!scriptOptions(scriptName, args, options)) {
+            return false;
         }
+        options.onStdout = [log = std::move(options.onStdout)](std::string_view line) {
+            std::cout << line << '\n';
+            log(line);
+        };
+        options.onStderr = [log = std::move(options.onStderr)](std::string_view line) {
+            std::cerr << line << '\n';
+            log(line);
+        };
+
+        // Ctrl-C stops the script, not us.
+        options.foreground = true;
 
-        if (exitCode == 0) {
-            writeLog("Script executed successfully: " + scriptName);
-            std::cout << "Success: " << scriptName << " finished with exit code 0." << std::endl;
+        writeLog("Executing script: " + scriptName + (args.empty() ? "" : " with args: " + args));
+        std::cout << "Executing: " << scriptName << " " << args << " ..." << std::endl;
+
+        ProcessResult result = ProcessRunner::run(options);
+        std::cout.flush();
+
+        if (result.succeeded()) {
+            writeLog("Script executed successfully: " + scriptName + " (" + result.describe() + ")");
+            std::cout << "Success: " << scriptName << " finished with " << result.describe() << "." << std::endl;
             return true;
         } else {
-            writeLog("Script failed: " + scriptName + " with exit code " + std::to_string(exitCode));
-            std::cerr << "Error: " << scriptName << " failed with exit code " << exitCode << std::endl;
+            writeLog("Script failed: " + scriptName + " (" + result.describe() + ")");
+            std::cerr << "Error: " << scriptName << " failed: " << result.describe() << std::endl;
             return false;
         }
     }
 
+    // --- Jobs ---
+
+    /**
+     * @brief Starts a pipeline of "<id|name> [args]" commands as one job.
+     * @return The job id, or 0 (after printing why) if a script was not found.
+     */
+    int startJob(const std::vector<std::string>& commands, bool background) {
+        std::vector<std::string> names;
+        std::vector<ProcessOptions> stages;
+        std::string label;
+        for (const auto& command : commands) {
+            std::stringstream ss(command);
+            std::string target;
+            ss >> target;
+            std::string args;
+            std::getline(ss, args);
+            args = trim(args);
+
+            auto script = resolveScript(target);
+            if (!script) {
+                std::cout << "Error: Script not found: " << (target.empty() ? "(empty)" : target) << std::endl;
+                return 0;
+            }
+            ProcessOptions options;
+            if (!scriptOptions(*script, args, options)) {
+                return 0;
+            }
+            label += (label.empty() ? "" : " | ") + *script + (args.empty() ? "" : " " + args);
+            names.push_back(*script);
+            stages.push_back(std::move(options));
+        }
+        int id = m_jobs.start(label, std::move(names), std::move(stages), !background);
+        writeLog("Started job " + std::to_string(id) + ": " + label);
+        return id;
+    }
+
+    void reportJob(const JobControl::Summary& summary) {
+        bool ok = summary.succeeded();
+        writeLog("Job " + std::to_string(summary.id) + (ok ? " finished: " : " failed: ") + summary.label +
+                 " (" + summary.describe() + ")");
+        m_jobs.print(ok ? std::cout : std::cerr, "[" + std::to_string(summary.id) + "] " + (ok ? "Done   " : "Failed ") +
+                     summary.label + " (" + summary.describe() + ")");
+    }
+
+    /** @brief Reports the jobs that finished in the background since the last prompt. */
+    void reportFinishedJobs() {
+        for (const auto& summary : m_jobs.takeFinished()) {
+            reportJob(summary);
+        }
+    }
+
+    /** @brief Waits for jobs started in the foreground, or announces them when started with "&". */
+    void finishJobs(const std::vector<int>& ids, bool background) {
+        if (background) {
+            for (int id : ids) {
+                m_jobs.print(std::cout, "[" + std::to_string(id) + "] started");
+            }
+            return;
+        }
+        waitJobs(ids);
+    }
+
+    void waitJobs(const std::vector<int>& ids) {
+        auto summaries = m_jobs.wait(ids);
+        for (const auto& summary : summaries) {
+            reportJob(summary);
+        }
+        if (summaries.size() > 1) {
+            std::cout << JobControl::describeSpeedup(summaries) << std::endl;
+        }
+    }
+
+    void listJobs() {
+        auto jobs = m_jobs.jobs();
+        if (jobs.empty()) {
+            std::cout << "No jobs." << std::endl;
+            return;
+        }
+        for (const auto& job : jobs) {
+            char elapsed[32];
+            std::snprintf(elapsed, sizeof(elapsed), "%7.1f s", job.elapsed.count() / 1000.0);
+            std::cout << "[" << job.id << "] " << (job.running ? "Running " : "Finished") << elapsed << "  "
+                      << job.label << std::endl;
+        }
+    }
+
     void showHelp() {
         std::cout << "\n--- Porto Manager Help ---\n";
         std::cout << "list           : List available porto scripts\n";
-        std::cout << "run <id|name> [args] : Run a script by its ID (index) or filename with optional arguments\n";
+        std::cout << "run <id|name> [args] [&] : Run a script by its ID (index) or filename with optional arguments\n";
+        std::cout << "run-parallel <script> <script> ... [&] : Run scripts side by side and report the speed-up;\n";
+        std::cout << "                 quote a script with its arguments, e.g. \"fetch.sh --all\"\n";
+        std::cout << "pipe <script> [args] | <script> [args] ... [&] : Feed each script's output into the next\n";
+        std::cout << "jobs           : List background jobs\n";
+        std::cout << "wait [ids]     : Wait for background jobs (all by default); Ctrl-C stops waiting\n";
+        std::cout << "kill <id>      : Terminate a background job\n";
+        std::cout << "(a trailing & runs the command in the background; job output is prefixed with [<job> <script>])\n";
         std::cout << "help           : Show this help message\n";
+        std::cout << "(porto_manager query [--socket <path>] <request> asks the daemon's PQL query service)\n";
+        std::cout << "(porto_manager logs [--since|--until <time>] [--component <tag>] [--grep <text>] [log...] searches the logs)\n";
         std::cout << "exit           : Exit the application\n";
         std::cout << "--------------------------\n";
     }
@@ -140,14 +324,27 @@ public:
     void run() {
         std::cout << "Porto Manager Started. Type 'help' for commands." << std::endl;
 
+        // Without SA_RESTART, so the signal interrupts the read at the prompt (the job threads block it).
+        struct sigaction action = {};
+        action.sa_handler = on_stop_signal;
+        sigemptyset(&action.sa_mask);
+        for (int sig : {SIGINT, SIGTERM, SIGHUP}) {
+            sigaction(sig, &action, nullptr);
+        }
+
         std::string line;
-        while (true) {
+        while (!g_stopSignal) {
+            reportFinishedJobs();
             std::cout << "\nPorto Manager > ";
             if (!std::getline(std::cin, line)) break;
 
+            bool background = take_background(line);
             std::stringstream ss(line);
             std::string cmd;
             ss >> cmd;
+            std::string rest;
+            std::getline(ss, rest);
+            rest = trim(rest);
 
             if (cmd == "exit") {
                 break;
@@ -156,48 +353,85 @@ public:
             } else if (cmd == "help") {
                 showHelp();
             } else if (cmd == "run") {
+                std::stringstream words(rest);
                 std::string target;
-                ss >> target;
+                words >> target;
                 if (target.empty()) {
-                    std::cout << "Usage: run <id|name> [args]" << std::endl;
+                    std::cout << "Usage: run <id|name> [args] [&]" << std::endl;
                     continue;
                 }
 
-                std::string args;
-                std::getline(ss, args);
-                if (!args.empty()) {
-                    size_t first = args.find_first_not_of(" \t");
-                    if (first != std::string::npos) {
-                        args = args.substr(first);
-                    } else {
-                        args = "";
+                if (background) {
+                    if (int id = startJob({rest}, true)) {
+                        finishJobs({id}, true);
                     }
+                    continue;
                 }
 
-                bool found = false;
-                try {
-                    size_t index = std::stoul(target);
-                    if (index > 0 && index <= m_scripts.size()) {
-                        executeScript(m_scripts[index - 1], args);
-                        found = true;
-                    }
-                } catch (...) {}
+                std::string args;
+                std::getline(words, args);
+                args = trim(args);
 
-                if (!found) {
-                    auto it = std::find(m_scripts.begin(), m_scripts.end(), target);
-                    if (it != m_scripts.end()) {
-                        executeScript(*it, args);
-                        found = true;
+                auto script = resolveScript(target);
+                if (script) {
+                    executeScript(*script, args);
+                } else {
+                    std::cout << "Error: Script not found: " << target << std::endl;
+                }
+            } else if (cmd == "run-parallel") {
+                auto commands = ProcessRunner::splitArgs(rest);
+                if (commands.empty()) {
+                    std::cout << "Usage: run-parallel <script> <script> ... [&]" << std::endl;
+                    continue;
+                }
+                std::vector<int> ids;
+                for (const auto& command : commands) {
+                    if (int id = startJob({command}, background)) {
+                        ids.push_back(id);
                     }
                 }
-
-                if (!found) {
-                    std::cout << "Error: Script not found: " << target << std::endl;
+                finishJobs(ids, background);
+            } else if (cmd == "pipe") {
+                auto commands = split_pipeline(rest);
+                if (rest.empty() || std::any_of(commands.begin(), commands.end(),
+                                                [](const std::string& command) { return command.empty(); })) {
+                    std::cout << "Usage: pipe <script> [args] | <script> [args] ... [&]" << std::endl;
+                    continue;
+                }
+                if (int id = startJob(commands, background)) {
+                    finishJobs({id}, background);
+                }
+            } else if (cmd == "jobs") {
+                listJobs();
+            } else if (cmd == "wait") {
+                std::vector<int> ids;
+                std::stringstream words(rest);
+                int id;
+                while (words >> id) {
+                    ids.push_back(id);
+                }
+                waitJobs(ids);
+            } else if (cmd == "kill") {
+                int id = 0;
+                std::stringstream(rest) >> id;
+                if (!m_jobs.kill(id, SIGTERM)) {
+                    std::cout << "Error: No running job " << rest << std::endl;
                 }
             } else if (!cmd.empty()) {
                 std::cout << "Unknown command: " << cmd << ". Type 'help' for usage." << std::endl;
             }
         }
+        if (g_stopSignal) {
+            writeLog(std::string("Stopping on signal: ") + strsignal(g_stopSignal));
+            std::cout << "\nReceived " << strsignal(g_stopSignal) << "." << std::endl;
+        }
+        if (size_t running = m_jobs.running()) {
+            std::cout << "Terminating " << running << " running job(s)." << std::endl;
+            m_jobs.killAll(SIGTERM);
+        }
+        for (const auto& summary : m_jobs.wait()) {
+            reportJob(summary);
+        }
         std::cout << "Exiting Porto Manager." << std::endl;
     }
 
@@ -206,9 +440,168 @@ private:
     std::string m_scriptsDir;
     std::string m_logFile;
     std::vector<std::string> m_scripts;
+    JobControl m_jobs;  // Declared last: its destructor stops the jobs before the rest goes.
 };
 
-int main() {
+// porto_manager query [--socket <path>] <verb> [argument]: one request to the
+// daemon's PQL query service, for scripts. Prints the answer and exits 0; prints
+// the service's error and exits 1; exits 2 if the service cannot be reached.
+static int runQuery(int argc, char* argv[]) {
+    int arg = 2;
+    std::string socket;
+    if (arg + 1 < argc && std::string(argv[arg]) == "--socket") {
+        socket = argv[arg + 1];
+        arg += 2;
+    } else {
+        Config config;
+        config.load("environment.txt");
+        config.load(".quanta");
+        socket = config.getString("PQL_QUERY_SOCKET").value_or("");
+    }
+    if (arg >= argc) {
+        std::cerr << "Usage: porto_manager query [--socket <path>] <verb> [argument]" << std::endl;
+        return 2;
+    }
+    if (socket.empty()) {
+        std::cerr << "PQL_QUERY_SOCKET is not set" << std::endl;
+        return 2;
+    }
+
+    std::string verb = argv[arg++];
+    std::string request = verb;
+    for (; arg < argc; ++arg) {
+        std::string value = argv[arg];
+        // The daemon resolves paths against its own working directory.
+        if (verb.rfind("file_", 0) == 0 && fs::path(value).is_relative()) {
+            value = fs::absolute(value).string();
+        }
+        request += " " + value;
+    }
+
+    std::string payload;
+    switch (PQLQueryClient::query(socket, request, payload)) {
+    case PQLQueryClient::Status::Ok:
+        std::cout << payload << std::flush;
+        return 0;
+    case PQLQueryClient::Status::Error:
+        std::cerr << payload << (payload.empty() || payload.back() != '\n' ? "\n" : "") << std::flush;
+        return 1;
+    case PQLQueryClient::Status::Unavailable:
+        std::cerr << payload << std::endl;
+        return 2;
+    }
+    return 2;
+}
+
+// porto_manager logs [options] [log...]: the lines of LOG_FILE (or of the logs
+// named, as paths or as LOG_FILE, ETHICS_LOG, BIAS_LOG, LLM_OUTPUT_LOG) that
+// match every filter given, searched through a LogIndex. Exits 0 if any line
+// matched, 1 if none did, 2 on bad usage or a log that cannot be read.
+static int runLogs(int argc, char* argv[]) {
+    auto usage = [] {
+        std::cerr << "Usage: porto_manager logs [--since <time>] [--until <time>] [--component <tag>] [--grep <text>]\n"
+                     "                          [--count] [--stats] [--threads <n>] [LOG_FILE|ETHICS_LOG|BIAS_LOG|LLM_OUTPUT_LOG|<path>...]\n"
+                     "Times are YYYY-MM-DD[ HH:MM[:SS]] in the logs' local time." << std::endl;
+        return 2;
+    };
+
+    Config config;
+    config.load("environment.txt");
+    config.load(".quanta");
+
+    LogIndex::Query query;
+    bool countOnly = false;
+    bool stats = false;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> logs;
+    for (int arg = 2; arg < argc; ++arg) {
+        std::string option = argv[arg];
+        bool hasValue = arg + 1 < argc;
+        if (option == "--count") {
+            countOnly = true;
+        } else if (option == "--stats") {
+            stats = true;
+        } else if (option.rfind("--", 0) != 0) {
+            logs.push_back(option);
+        } else if (!hasValue) {
+            return usage();
+        } else if (option == "--since" || option == "--until") {
+            auto time = LogIndex::parseTime(argv[++arg], option == "--until");
+            if (!time) {
+                std::cerr << "Bad time: " << argv[arg] << std::endl;
+                return usage();
+            }
+            (option == "--since" ? query.since : query.until) = time;
+        } else if (option == "--component") {
+            query.component = argv[++arg];
+        } else if (option == "--grep") {
+            query.text = argv[++arg];
+        } else if (option == "--threads") {
+            threads = static_cast<size_t>(std::max(1, std::atoi(argv[++arg])));
+        } else {
+            return usage();
+        }
+    }
+    if (logs.empty()) {
+        logs.push_back("LOG_FILE");
+    }
+
+    ThreadPool pool(threads);
+    size_t matched = 0;
+    for (const auto& name : logs) {
+        std::string path = name;
+        if (name == "LOG_FILE" || name == "ETHICS_LOG" || name == "BIAS_LOG" || name == "LLM_OUTPUT_LOG") {
+            auto configured = config.getString(name);
+            if (!configured && name != "LOG_FILE") {
+                std::cerr << name << " is not set" << std::endl;
+                return 2;
+            }
+            path = configured.value_or("logs/quantaporto.log");
+        }
+
+        LogIndex index;
+        if (!index.open(path, pool, query.timeBounded())) {
+            std::cerr << index.error() << std::endl;
+            return 2;
+        }
+        if (!index.save()) {
+            std::cerr << "Warning: " << index.error() << "; the log will be indexed again next time." << std::endl;
+        }
+        size_t visited = 0;
+        auto lines = index.search(query, pool, &visited);
+        matched += lines.size();
+
+        std::string prefix = logs.size() > 1 ? path + ":" : "";
+        if (countOnly) {
+            std::cout << prefix << lines.size() << '\n';
+        } else {
+            std::string out;
+            for (auto line : lines) {
+                out.append(prefix).append(line).push_back('\n');
+                if (out.size() >= 64 * 1024) {
+                    std::cout << out;
+                    out.clear();
+                }
+            }
+            std::cout << out;
+        }
+        if (stats) {
+            std::cerr << path << ": " << lines.size() << " matching lines; read " << visited << " of "
+                      << index.blockCount() << " blocks; indexed " << index.newBytes() << " new bytes" << std::endl;
+        }
+    }
+    std::cout.flush();
+    return matched > 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "query") {
+        return runQuery(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "logs") {
+        return runLogs(argc, argv);
+    }
+
     PortoManager manager;
     if (manager.initialize("environment.txt")) {
         manager.run();
@@ -1,122 +1,31 @@
 #include "pq_daemon.h"
 #include "Config.h"
+#include "QueueWatcher.h"
+#include "ThreadPool.h"
+#include "ReadyQueue.h"
+#include "TaskGraph.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Json.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <filesystem>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <sys/stat.h>
-
-namespace fs = std::filesystem;
-
-// --- Helper Functions for Parsing ---
-
-static std::string trim(const std::string& str) {
-    const std::string whitespace = " \t\n\r\f\v";
-    size_t first = str.find_first_not_of(whitespace);
-    if (std::string::npos == first) {
-        return "";
-    }
-    size_t last = str.find_last_not_of(whitespace);
-    return str.substr(first, (last - first + 1));
-}
-
-static std::string get_tag_content(const std::string& xml, const std::string& tag, size_t& pos) {
-    std::string start_tag = "<" + tag + ">";
-    std::string end_tag = "</" + tag + ">";
-    size_t start = xml.find(start_tag, pos);
-    if (start == std::string::npos) {
-        return "";
-    }
-    start += start_tag.length();
-    size_t end = xml.find(end_tag, start);
-    if (end == std::string::npos) {
-        return "";
-    }
-    pos = end + end_tag.length();
-    return xml.substr(start, end - start);
-}
-
-static std::vector<std::string> get_all_tag_contents(const std::string& xml, const std::string& tag) {
-    std::vector<std::string> contents;
-    std::string start_tag = "<" + tag + ">";
-    std::string end_tag = "</" + tag + ">";
-    size_t pos = 0;
-    while ((pos = xml.find(start_tag, pos)) != std::string::npos) {
-        pos += start_tag.length();
-        size_t end = xml.find(end_tag, pos);
-        if (end == std::string::npos) {
-            break;
-        }
-        contents.push_back(trim(xml.substr(pos, end - pos)));
-        pos = end + end_tag.length();
-    }
-    return contents;
-}
-
-// --- PQL Parser ---
-
-std::vector<PQLTask> PQLParser::parse(const std::string& filename) {
-    std::vector<PQLTask> tasks;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        // Silently fail, scheduler will handle the error.
-        return tasks;
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string xml_content = buffer.str();
-
-    size_t pos = 0;
-    while ((pos = xml_content.find("<task", pos)) != std::string::npos) {
-        size_t end_of_task_tag = xml_content.find(">", pos);
-        size_t end_of_task = xml_content.find("</task>", pos);
-        if (end_of_task_tag == std::string::npos || end_of_task == std::string::npos) {
-            break;
-        }
-
-        std::string task_attributes = xml_content.substr(pos, end_of_task_tag - pos);
-        std::string task_inner_xml = xml_content.substr(end_of_task_tag + 1, end_of_task - (end_of_task_tag + 1));
-
-        PQLTask task;
-
-        std::string temp = task_attributes;
-        std::replace(temp.begin(), temp.end(), '=', ' ');
-        std::replace(temp.begin(), temp.end(), '"', ' ');
-        std::stringstream ss(temp);
-        std::string key, value;
-        ss >> key; // <task
-        while(ss >> key >> value) {
-            if (key == "id") task.id = value;
-            else if (key == "type") task.type = value;
-            else if (key == "priority") task.priority = value;
-            else if (key == "status") task.status = value;
-            else if (key == "created") task.created = value;
-        }
-
-        size_t inner_pos = 0;
-        task.description = trim(get_tag_content(task_inner_xml, "description", inner_pos));
-        std::string commands_xml = get_tag_content(task_inner_xml, "commands", inner_pos);
-        task.commands = get_all_tag_contents(commands_xml, "command");
-        std::string criteria_xml = get_tag_content(task_inner_xml, "criteria", inner_pos);
-        task.criteria = get_all_tag_contents(criteria_xml, "criterion");
-        task.notes = trim(get_tag_content(task_inner_xml, "notes", inner_pos));
-
-        tasks.push_back(task);
-        pos = end_of_task + std::string("</task>").length();
-    }
-    return tasks;
-}
+#include <fcntl.h>
+#include <unistd.h>
 
 // --- Action Script Generator ---
 
 bool ActionScriptGenerator::generate(const Config& config, const PQLTask& task) {
     auto actions_pending_dir_opt = config.getString("ACTIONS_PENDING_DIR");
     if (!actions_pending_dir_opt) {
-        std::cerr << "Error: ACTIONS_PENDING_DIR not set in config." << std::endl;
+        Logger::instance().error("ActionScriptGenerator", "ACTIONS_PENDING_DIR not set in config.");
         return false;
     }
 
@@ -124,7 +33,7 @@ bool ActionScriptGenerator::generate(const Config& config, const PQLTask& task)
 
     std::ofstream out_file(action_script_path);
     if (!out_file) {
-        std::cerr << "Error: Could not create action script: " << action_script_path << std::endl;
+        Logger::instance().error("ActionScriptGenerator", "Could not create action script: " + action_script_path.string());
         return false;
     }
 
@@ -139,132 +48,640 @@ bool ActionScriptGenerator::generate(const Config& config, const PQLTask& task)
     out_file.close();
 
     if (chmod(action_script_path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0) {
-        std::cerr << "Error: Could not set executable permissions on " << action_script_path << std::endl;
+        Logger::instance().error("ActionScriptGenerator", "Could not set executable permissions on " + action_script_path.string());
         return false;
     }
 
-    std::cout << "Info: Successfully created action script: " << action_script_path.string() << std::endl;
+    Logger::instance().info("ActionScriptGenerator", "Successfully created action script: " + action_script_path.string());
     return true;
 }
 
 // --- Scheduler ---
 
-void Scheduler::run(const Config& config) {
-    auto pending_dir_opt = config.getString("QUEUE_PENDING_DIR");
-    auto in_progress_dir_opt = config.getString("QUEUE_IN_PROGRESS_DIR");
-    auto failed_dir_opt = config.getString("QUEUE_FAILED_DIR");
-    auto poll_interval_opt = config.getInt("POLL_INTERVAL_SEC");
+const Scheduler::Keys& Scheduler::keys() {
+    static const Keys keys;
+    return keys;
+}
 
-    if (!pending_dir_opt || !in_progress_dir_opt || !failed_dir_opt || !poll_interval_opt) {
-        std::cerr << "Error: Queue directories or poll interval not fully configured." << std::endl;
+// Creates the queue directories named by a snapshot; false if one is missing from the configuration.
+static bool prepare_queue_dirs(const ConfigSnapshot& config) {
+    const Scheduler::Keys& keys = Scheduler::keys();
+    const std::string& pending = config.get(keys.pendingDir);
+    const std::string& in_progress = config.get(keys.inProgressDir);
+    const std::string& failed = config.get(keys.failedDir);
+    if (pending.empty() || in_progress.empty() || failed.empty()) {
+        Logger::instance().error("Scheduler", "Queue directories not fully configured.");
+        return false;
+    }
+    for (const std::string& dir : {pending, in_progress, failed}) {
+        std::error_code error;
+        fs::create_directories(dir, error);
+        if (error) {
+            Logger::instance().error("Scheduler", "Cannot create queue directory " + dir + ": " + error.message());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Moves what the directory queue left behind into the log: pending files, and
+// claimed files that never got as far as an action script.
+static void import_directory_queue(const ConfigSnapshot& config, WalQueue& wal) {
+    const Scheduler::Keys& keys = Scheduler::keys();
+    fs::path actions = config.raw().getString("ACTIONS_PENDING_DIR").value_or("");
+    size_t abandoned = wal.importDirectory(config.get(keys.inProgressDir), [&actions](const fs::path& file) {
+        std::error_code error;
+        return actions.empty() || !fs::exists(actions / (file.stem().string() + ".sh"), error);
+    });
+    size_t pending = wal.importDirectory(config.get(keys.pendingDir));
+    if (abandoned > 0 || pending > 0) {
+        Logger::instance().info("Scheduler", "Imported " + std::to_string(pending) + " pending and " +
+                                std::to_string(abandoned) + " unfinished in-progress task file(s) into the queue log.");
+    }
+}
+
+// Writes a copy of a failed task into QUEUE_FAILED_DIR, where the directory queue would have moved it.
+static void write_failed_copy(const ConfigSnapshot& config, const WalQueue::Claim& claim) {
+    fs::path failed_dir = config.get(Scheduler::keys().failedDir);
+    fs::path temp = failed_dir / ("." + claim.name + ".tmp");
+    fs::path path = failed_dir / claim.name;
+    std::error_code error;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(claim.payload.data(), static_cast<std::streamsize>(claim.payload.size()));
+        if (!out) {
+            Logger::instance().warn("Scheduler", "Could not write " + temp.string());
+            return;
+        }
+    }
+    fs::rename(temp, path, error);
+    if (error) {
+        Logger::instance().warn("Scheduler", "Could not write " + path.string() + ": " + error.message());
         return;
     }
+    Logger::instance().info("Scheduler", "Copied task to failed queue: " + path.string());
+}
+
+void Scheduler::startInference(const Config& config) {
+    if (config.getString("LLM_INFERENCE_MODE").value_or("cli") != "server") {
+        return;
+    }
+    m_llm = std::make_unique<LLMRunner>(config);
+    if (!m_llm->valid()) {
+        Logger::instance().error("Scheduler", "LLM server disabled: " + m_llm->error());
+        m_llm.reset();
+        return;
+    }
+    if (!m_promptGenerator.load(config)) {
+        Logger::instance().warn("Scheduler", "Could not read SYSTEM_PROMPT_FILE; prompts will have no system prompt.");
+    }
+    m_responseCache.open(config);
+    m_rules.load(config);
+    m_program.load(config);
+    if (config.getInt("LLM_BATCH_SIZE").value_or(1) > 1) {
+        m_batcher = std::make_unique<LLMBatcher>(*m_llm, config);
+        bool multi = m_batcher->mode() == LLMBatcher::Mode::Multi;
+        Logger::instance().info("Scheduler", "Batching LLM requests: up to " + std::to_string(m_batcher->batchSize()) +
+                                (multi ? " per multi-prompt request, " + std::to_string(m_batcher->window().count()) +
+                                             " ms window."
+                                       : " in flight, sent as they arrive."));
+    }
+}
+
+void Scheduler::run(const LiveConfig& live) {
+    const Keys& keys = Scheduler::keys();
+    // Components set up here read the startup configuration, which stays alive for the whole run.
+    const std::shared_ptr<const ConfigSnapshot> startup = live.current();
+    std::shared_ptr<const ConfigSnapshot> snapshot = startup;
+    if (!prepare_queue_dirs(*snapshot)) {
+        return;
+    }
+    const Config& config = startup->raw();
+
+    size_t workers = static_cast<size_t>(std::max(1, snapshot->get(keys.workers)));
+    auto aging_interval = std::chrono::seconds(std::max(1, snapshot->get(keys.agingInterval)));
+
+    if (const std::string& backend = snapshot->get(keys.queueBackend); backend == "wal") {
+        m_wal = std::make_unique<WalQueue>(aging_interval);
+        const std::string& log_path = snapshot->get(keys.queueLog);
+        if (!m_wal->open(log_path, std::chrono::seconds(std::max(1, snapshot->get(keys.queueLease))))) {
+            Logger::instance().error("Scheduler", "Cannot open task queue log " + log_path + ": " + m_wal->error());
+            return;
+        }
+        import_directory_queue(*snapshot, *m_wal);
+    } else if (backend != "dir") {
+        Logger::instance().warn("Scheduler", "Unknown QUEUE_BACKEND '" + backend + "'; using the queue directories.");
+    }
+
+    fs::path pending_dir = snapshot->get(keys.pendingDir);
+    int poll_interval = std::max(1, snapshot->get(keys.pollInterval));
+    auto watcher = std::make_unique<QueueWatcher>(pending_dir, std::chrono::seconds(poll_interval));
+    if (!watcher->start()) {
+        return;
+    }
+
+    startInference(config);
+
+    if (std::string socket = startup->get(keys.querySocket); !socket.empty()) {
+        m_queryService = std::make_unique<PQLQueryService>(live, keys.tasksFile, keys.pendingDir);
+        m_queryService->setQueue(m_wal.get());
+        if (!m_queryService->start(socket)) {
+            m_queryService.reset();
+        }
+    }
 
-    fs::path pending_dir = *pending_dir_opt;
-    fs::path in_progress_dir = *in_progress_dir_opt;
-    fs::path failed_dir = *failed_dir_opt;
+    m_metricsExporter.start(startup->get(keys.metricsListen), startup->get(keys.metricsFile),
+                            std::chrono::seconds(startup->get(keys.metricsDumpInterval)));
 
-    fs::create_directories(pending_dir);
-    fs::create_directories(in_progress_dir);
-    fs::create_directories(failed_dir);
+    ThreadPool pool(workers);
+    ReadyQueue ready(aging_interval);
+    Metrics& metrics = Metrics::instance();
 
-    std::cout << "Info: QuantaPorto C++ Daemon started." << std::endl;
-    std::cout << "Info: Monitoring queue: " << pending_dir.string() << std::endl;
+    Logger& log = Logger::instance();
+    log.info("Scheduler", "QuantaPorto C++ Daemon started with " + std::to_string(workers) + " worker(s).");
+    log.info("Scheduler", "Monitoring queue: " + pending_dir.string() + (watcher->usingInotify() ? " (inotify)" : " (polling)"));
 
+    std::shared_ptr<const ConfigSnapshot> refused;  // The last snapshot whose queue directories were unusable.
+    bool in_timeout = false;
     while (true) {
-        fs::path task_file;
-        bool found_task = false;
-        for (const auto& entry : fs::directory_iterator(pending_dir)) {
-            if (entry.is_regular_file()) {
-                task_file = entry.path();
-                found_task = true;
-                break;
+        // Pick up configuration changes; files already ranked keep their old paths.
+        if (std::shared_ptr<const ConfigSnapshot> latest = live.current(); latest != snapshot && latest != refused) {
+            if (!prepare_queue_dirs(*latest)) {
+                // Tasks would otherwise be claimed into whatever the broken paths resolve to.
+                log.error("Scheduler", "Ignoring configuration generation " + std::to_string(latest->generation()) +
+                          "; keeping the queue directories of generation " + std::to_string(snapshot->generation()) + ".");
+                refused = std::move(latest);
+                continue;
             }
+            fs::path latest_pending = latest->get(keys.pendingDir);
+            int latest_poll = std::max(1, latest->get(keys.pollInterval));
+            if (latest_pending != pending_dir || latest_poll != poll_interval) {
+                auto replacement = std::make_unique<QueueWatcher>(latest_pending, std::chrono::seconds(latest_poll));
+                if (replacement->start()) {
+                    watcher = std::move(replacement);
+                    pending_dir = latest_pending;
+                    poll_interval = latest_poll;
+                    log.info("Scheduler", "Monitoring queue: " + pending_dir.string() +
+                             (watcher->usingInotify() ? " (inotify)" : " (polling)"));
+                }
+            }
+            if (latest->get(keys.workers) != snapshot->get(keys.workers) ||
+                latest->get(keys.agingInterval) != snapshot->get(keys.agingInterval)) {
+                log.warn("Scheduler", "SCHEDULER_WORKERS and PRIORITY_AGING_SEC take effect after a restart.");
+            }
+            snapshot = std::move(latest);
         }
 
-        if (!found_task) {
-            std::this_thread::sleep_for(std::chrono::seconds(*poll_interval_opt));
+        // Dispatch only when a worker is free (at most `workers` jobs outstanding),
+        // so the choice of what runs next is made as late as possible and files
+        // stay claimable by other daemons.
+        pool.waitBelow(workers);
+
+        // A timeout imposed by a rule holds back new work until it expires; running tasks finish.
+        if (std::chrono::seconds paused = m_llm ? m_program.timeoutRemaining() : std::chrono::seconds(0); paused.count() > 0) {
+            if (!in_timeout) {
+                log.warn("Scheduler", "Dispatch paused for " + std::to_string(paused.count()) + " s by a rule timeout.");
+                in_timeout = true;
+            }
+            std::this_thread::sleep_for(std::min<std::chrono::seconds>(paused, std::chrono::seconds(poll_interval)));
             continue;
         }
+        if (in_timeout) {
+            log.info("Scheduler", "Rule timeout over; dispatching again.");
+            in_timeout = false;
+        }
 
-        fs::path in_progress_path = in_progress_dir / task_file.filename();
+        // Rank every file that has arrived since the last dispatch; block only
+        // when there is nothing at all to run.
+        bool idle = m_wal ? m_wal->pendingCount() == 0 : ready.empty();
+        auto timeout = idle ? std::chrono::milliseconds(std::chrono::seconds(poll_interval)) : std::chrono::milliseconds(0);
+
+        if (m_wal) {
+            // The pending directory is only an inbox: arrivals are committed to the log in one batch.
+            std::vector<fs::path> arrived;
+            while (std::optional<fs::path> file = watcher->next(timeout)) {
+                arrived.push_back(std::move(*file));
+                timeout = std::chrono::milliseconds(0);
+            }
+            m_wal->importFiles(arrived);
+            m_wal->maintain();
+            if (m_wal->failed()) {
+                log.error("Scheduler", "The task queue log can no longer be written; stopping once running tasks finish.");
+                pool.waitIdle();
+                return;
+            }
 
-        try {
-            fs::rename(task_file, in_progress_path);
-            std::cout << "Info: Moved task to in-progress: " << in_progress_path.string() << std::endl;
-        } catch (const fs::filesystem_error& e) {
-            std::cerr << "Error: Failed to move task file '" << task_file.string() << "': " << e.what() << std::endl;
+            // Claims cost no I/O, so every free worker is given a task in one pass.
+            while (pool.outstanding() < workers) {
+                StageTimer claim_timer(Stage::Claim);
+                std::optional<WalQueue::Claim> claim = m_wal->claim();
+                if (!claim) {
+                    claim_timer.cancel();
+                    break;
+                }
+                claim_timer.stop();
+                metrics.add(Counter::TasksClaimed);
+                metrics.add(Gauge::WorkersBusy, 1);
+                pool.submit([this, snapshot, claim = std::move(*claim)] {
+                    processClaim(*snapshot, claim);
+                    Metrics::instance().add(Gauge::WorkersBusy, -1);
+                });
+            }
+            metrics.set(Gauge::QueueDepth, static_cast<int64_t>(m_wal->pendingCount() + watcher->pendingCount()));
             continue;
         }
 
-        PQLParser parser;
-        std::vector<PQLTask> tasks = parser.parse(in_progress_path.string());
+        while (std::optional<fs::path> arrived = watcher->next(timeout)) {
+            ready.add(*arrived);
+            timeout = std::chrono::milliseconds(0);
+        }
 
-        if (tasks.empty() || tasks[0].id.empty()) {
-            std::cerr << "Error: Failed to parse task file or file is empty: " << in_progress_path.string() << std::endl;
-            fs::rename(in_progress_path, failed_dir / in_progress_path.filename());
+        std::optional<fs::path> next_file = ready.pop();
+        metrics.set(Gauge::QueueDepth, static_cast<int64_t>(ready.size() + watcher->pendingCount()));
+        if (!next_file) {
             continue;
         }
+        // The task runs with the configuration current at dispatch, whatever changes meanwhile.
+        metrics.add(Gauge::WorkersBusy, 1);
+        pool.submit([this, snapshot, task_file = *next_file] {
+            processTask(*snapshot, task_file);
+            Metrics::instance().add(Gauge::WorkersBusy, -1);
+        });
+    }
+}
 
-        const PQLTask& current_task = tasks[0];
+int Scheduler::runPlan(const LiveConfig& live, const std::string& plan_file) {
+    const Keys& keys = Scheduler::keys();
+    const std::shared_ptr<const ConfigSnapshot> snapshot = live.current();
+    Logger& log = Logger::instance();
+
+    // Tasks go straight from the parser's views into the graph's TaskTable.
+    TaskTable tasks;
+    bool fits = true;
+    if (!PQLParser().parse(plan_file, [&tasks, &fits](const PQLTaskView& view) {
+            fits = tasks.add(view);
+            return fits;
+        })) {
+        log.error("Scheduler", "Cannot read plan " + plan_file);
+        return 2;
+    }
+    if (!fits) {
+        log.error("Scheduler", "Cannot run plan " + plan_file + ": its tasks do not fit in a task table.");
+        return 2;
+    }
+    TaskGraph graph;
+    if (tasks.empty() || !graph.build(std::move(tasks))) {
+        log.error("Scheduler", "Cannot run plan " + plan_file + ": " +
+                  (graph.error().empty() ? "it contains no tasks" : graph.error()));
+        return 2;
+    }
 
-        ActionScriptGenerator generator;
-        if (generator.generate(config, current_task)) {
-            // Task successfully dispatched
-        } else {
-            std::cerr << "Error: Worker failed for task: " << current_task.id << std::endl;
-            fs::rename(in_progress_path, failed_dir / in_progress_path.filename());
-            std::cout << "Info: Moved task to failed queue: " << (failed_dir / in_progress_path.filename()).string() << std::endl;
+    startInference(snapshot->raw());
+    m_metricsExporter.start(snapshot->get(keys.metricsListen), snapshot->get(keys.metricsFile),
+                            std::chrono::seconds(snapshot->get(keys.metricsDumpInterval)));
+
+    size_t workers = static_cast<size_t>(std::max(1, snapshot->get(keys.workers)));
+    size_t already_done = graph.count(TaskGraph::State::Done);
+    log.info("Scheduler", "Running plan " + plan_file + ": " + std::to_string(graph.size() - already_done) +
+             " task(s) to run, " + std::to_string(already_done) + " already done, critical path of " +
+             std::to_string(static_cast<long long>(graph.criticalPathLength())) + ", " + std::to_string(workers) +
+             " worker(s).");
+
+    // The graph is only touched under the mutex; workers report back and the loop below hands out what became ready.
+    std::mutex mutex;
+    std::condition_variable finished_one;
+    size_t running = 0;
+    auto started = std::chrono::steady_clock::now();
+    ThreadPool pool(workers);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!graph.finished()) {
+            while (running < workers) {
+                std::optional<size_t> index = graph.next();
+                if (!index) {
+                    break;
+                }
+                ++running;
+                Metrics::instance().add(Gauge::WorkersBusy, 1);
+                pool.submit([&, index = *index] {
+                    // Tasks never change once the graph is built, so reading one needs no lock.
+                    bool succeeded = executeTask(*snapshot, graph.task(index));
+                    Metrics::instance().add(Gauge::WorkersBusy, -1);
+                    std::lock_guard<std::mutex> guard(mutex);
+                    std::string id(graph.id(index));
+                    if (!succeeded) {
+                        log.error("Scheduler", "Plan task failed: " + id);
+                    }
+                    for (size_t skipped : graph.finish(index, succeeded)) {
+                        log.warn("Scheduler", "Skipping plan task " + std::string(graph.id(skipped)) + ": it depends on " + id +
+                                 ", which failed.");
+                    }
+                    --running;
+                    finished_one.notify_one();
+                });
+            }
+            finished_one.wait(lock);
         }
     }
+    pool.waitIdle();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    size_t failed = graph.count(TaskGraph::State::Failed);
+    size_t skipped = graph.count(TaskGraph::State::Skipped);
+    log.info("Scheduler", "Plan " + plan_file + " finished in " + std::to_string(elapsed.count()) + " ms: " +
+             std::to_string(graph.count(TaskGraph::State::Done) - already_done) + " done, " + std::to_string(failed) +
+             " failed, " + std::to_string(skipped) + " skipped.");
+    return failed + skipped == 0 ? 0 : 1;
 }
 
-// --- Placeholder Implementations ---
+void Scheduler::processTask(const ConfigSnapshot& config, const fs::path& task_file) {
+    Logger& log = Logger::instance();
+    Metrics& metrics = Metrics::instance();
+    StageTimer task_timer(Stage::Task);
+    fs::path in_progress_path = fs::path(config.get(keys().inProgressDir)) / task_file.filename();
+
+    StageTimer claim_timer(Stage::Claim);
+    std::error_code rename_error;
+    fs::rename(task_file, in_progress_path, rename_error);
+    claim_timer.stop();
+    if (rename_error == std::errc::no_such_file_or_directory) {
+        // Removed or claimed by another worker or daemon since it was queued.
+        task_timer.cancel();
+        return;
+    }
+    if (rename_error) {
+        log.error("Scheduler", "Failed to move task file '" + task_file.string() + "': " + rename_error.message());
+        task_timer.cancel();
+        return;
+    }
+    metrics.add(Counter::TasksClaimed);
+    log.info("Scheduler", "Moved task to in-progress: " + in_progress_path.string());
+
+    // A queue file carries a single task; stop at the first one and copy it out of the mapping.
+    StageTimer parse_timer(Stage::Parse);
+    PQLParser parser;
+    PQLTask current_task;
+    parser.parse(in_progress_path.string(), [&current_task](const PQLTaskView& view) {
+        current_task = PQLTask(view);
+        return false;
+    });
+    parse_timer.stop();
+
+    fs::path failed_path = fs::path(config.get(keys().failedDir)) / in_progress_path.filename();
+    std::error_code move_error;
 
-std::string PromptGenerator::generate(const PQLTask& task) {
-    std::stringstream prompt;
-    prompt << "Task: " << task.description << std::endl;
-    prompt << "Commands:" << std::endl;
-    for (const auto& cmd : task.commands) {
-        prompt << "- " << cmd << std::endl;
+    if (current_task.id.empty()) {
+        log.error("Scheduler", "Failed to parse task file or file is empty: " + in_progress_path.string());
+        fs::rename(in_progress_path, failed_path, move_error);
+        metrics.add(Counter::TasksFailed);
+        return;
     }
-    prompt << "Criteria:" << std::endl;
-    for (const auto& crit : task.criteria) {
-        prompt << "- " << crit << std::endl;
+
+    if (!executeTask(config, current_task)) {
+        log.error("Scheduler", "Worker failed for task: " + current_task.id);
+        fs::rename(in_progress_path, failed_path, move_error);
+        log.info("Scheduler", "Moved task to failed queue: " + failed_path.string());
     }
-    return prompt.str();
 }
 
-std::string LLMRunner::run(const std::string& prompt) {
-    std::cout << "--- Running LLM with prompt ---" << std::endl;
-    std::cout << prompt << std::endl;
-    std::cout << "--- End of prompt ---" << std::endl;
-    return "This is a placeholder response from the LLM.";
+void Scheduler::processClaim(const ConfigSnapshot& config, const WalQueue::Claim& claim) {
+    Logger& log = Logger::instance();
+    StageTimer task_timer(Stage::Task);
+
+    StageTimer parse_timer(Stage::Parse);
+    PQLTask current_task;
+    PQLParser().parseBuffer(claim.payload, [&current_task](const PQLTaskView& view) {
+        current_task = PQLTask(view);
+        return false;
+    });
+    parse_timer.stop();
+
+    bool done = false;
+    std::string reason;
+    if (current_task.id.empty()) {
+        log.error("Scheduler", "Failed to parse task file or file is empty: " + claim.name);
+        Metrics::instance().add(Counter::TasksFailed);
+        reason = "parse error";
+    } else if (!(done = executeTask(config, current_task))) {
+        log.error("Scheduler", "Worker failed for task: " + current_task.id);
+        reason = "worker failed";
+    }
+
+    bool recorded = done ? m_wal->complete(claim) : m_wal->fail(claim, reason);
+    if (!recorded) {
+        log.warn("Scheduler", "Outcome of " + claim.name + " not recorded: it was queued again while it ran, or the queue log failed.");
+    } else if (!done) {
+        write_failed_copy(config, claim);
+    }
 }
 
-bool RuleEngine::evaluate(const std::string& response) {
-    std::cout << "Evaluating rules for response: " << response << std::endl;
-    return true;
+bool Scheduler::executeTask(const ConfigSnapshot& config, const PQLTask& task) {
+    bool dispatched = !m_llm || runInference(config, task);
+    if (dispatched) {
+        StageTimer script_timer(Stage::ActionScript);
+        ActionScriptGenerator generator;
+        dispatched = generator.generate(config.raw(), task);
+    }
+    Metrics::instance().add(dispatched ? Counter::TasksCompleted : Counter::TasksFailed);
+    return dispatched;
 }
 
-std::string ReflectionEngine::reflect(const std::string& failed_response) {
-    std::cout << "Reflecting on failed response: " << failed_response << std::endl;
-    return "This is a new prompt after reflection.";
+// Writes OUTPUT_DIR/<name>, replacing any previous file.
+static bool write_output(const ConfigSnapshot& config, const std::string& name, std::string_view content) {
+    fs::path output_dir = config.get(Scheduler::keys().outputDir);
+    std::error_code dir_error;
+    fs::create_directories(output_dir, dir_error);
+    fs::path path = output_dir / name;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!out) {
+        Logger::instance().error("Scheduler", "Could not write output file: " + path.string());
+        return false;
+    }
+    return true;
 }
 
-// --- main ---
+bool Scheduler::runInference(const ConfigSnapshot& config, const PQLTask& task) {
+    Logger& log = Logger::instance();
+    const int max_retries = std::max(0, config.get(keys().maxRetries));
+    const int token_budget = std::max(0, config.get(keys().taskTokenBudget));
+    Metrics& metrics = Metrics::instance();
+    StageTimer prompt_timer(Stage::Prompt);
+    std::string prompt = m_promptGenerator.generate(task);
+    prompt_timer.stop();
+    Hash128 key = m_llm->cacheKey(prompt);
+    InferenceStats stats;
+
+    // Rules may have changed since a cached response was stored, so it is checked again.
+    std::optional<std::string> cached = m_responseCache.get(key);
+    metrics.add(cached ? Counter::CacheHits : Counter::CacheMisses);
+    if (m_responseCache.isOpen() && (m_cacheLookups.fetch_add(1, std::memory_order_relaxed) + 1) % 100 == 0) {
+        ResponseCache::Stats cache = m_responseCache.stats();
+        log.info("ResponseCache", std::to_string(cache.hits) + " hits, " + std::to_string(cache.misses) + " misses (" +
+                 std::to_string(static_cast<int>(cache.hitRate() * 100)) + "% hit rate), " +
+                 std::to_string(cache.entries) + " entries, " + std::to_string(cache.evictions) + " evicted.");
+    }
+    if (cached) {
+        StageTimer check_timer(Stage::RuleCheck);
+        RuleReport report;
+        m_rules.evaluate(*cached, &report);
+        ResponseFeatures features;
+        features.text = *cached;
+        features.report = &report;
+        RuleOutcome outcome = m_program.enforce(m_program.evaluate(features), *cached);
+        check_timer.stop();
+        if (report.passed() && !outcome.rejected) {
+            log.info("LLMRunner", "Task " + task.id + ": response served from cache.");
+            stats.outcome = "cached";
+            recordStats(config, task, stats);
+            return write_output(config, task.id + ".response.txt", *cached);
+        }
+        log.info("LLMRunner", "Task " + task.id + ": cached response no longer passes the rules; generating a new one.");
+    }
 
-int main() {
-    std::cout << "QuantaPorto C++ Daemon Initializing..." << std::endl;
+    const int max_attempts = 1 + max_retries;
+    bool stream_rules = config.get(keys().streamRules) && !(m_batcher && m_batcher->mode() == LLMBatcher::Mode::Multi);
+    std::string conversation = std::move(prompt);
+    std::string reflection;
+    auto started = std::chrono::steady_clock::now();
+    auto finish = [&](const char* outcome) {
+        stats.outcome = outcome;
+        stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        recordStats(config, task, stats);
+        if (!reflection.empty()) {
+            write_output(config, task.id + ".reflection.txt", reflection);
+        }
+    };
+
+    for (int attempt = 1; attempt <= max_attempts; ++attempt) {
+        // Never generate past what is left of the task's budget.
+        int max_tokens = token_budget > 0 ? token_budget - stats.tokensPredicted : 0;
+
+        // Check the response as it streams, so a blocking violation stops the generation early.
+        std::optional<RuleEngine::Stream> stream;
+        LLMRunner::TokenCallback on_token;
+        if (stream_rules) {
+            stream.emplace(m_rules.stream());
+            on_token = [&stream](std::string_view token) { return stream->feed(token); };
+        }
+        if (attempt > 1) {
+            metrics.add(Counter::Retries);
+        }
+        StageTimer inference_timer(Stage::Inference);
+        LLMResult result = m_batcher ? m_batcher->submit(conversation, on_token, max_tokens).get()
+                                     : m_llm->run(conversation, on_token, max_tokens);
+        inference_timer.stop();
+        stats.attempts = attempt;
+        stats.tokensPredicted += result.tokensPredicted;
+        stats.tokensEvaluated += result.tokensEvaluated;
+        stats.tokensCached += result.tokensCached;
+
+        std::string label = "Task " + task.id + " attempt " + std::to_string(attempt) + "/" + std::to_string(max_attempts);
+        bool stopped = result.cancelled && stream && stream->blocked();
+        if (!result.ok && !stopped) {
+            metrics.add(Counter::InferenceErrors);
+            log.error("LLMRunner", "Inference failed for " + label + ": " + result.error);
+            finish("error");
+            return false;
+        }
 
-    Config config;
-    config.load("environment.txt");
-    config.load(".quanta");
+        // With streaming, most of the checking happened during generation; this is what is left.
+        StageTimer check_timer(Stage::RuleCheck);
+        RuleReport report;
+        if (stream) {
+            report = stream->finish();
+            m_rules.logViolations(report);
+        } else {
+            m_rules.evaluate(result.content, &report);
+        }
+        if (stopped) {
+            const RuleMatch* blocker = report.blocker();
+            log.warn("RuleEngine", label + ": generation stopped after " + std::to_string(result.tokensPredicted) +
+                     " tokens (" + std::to_string(result.duration.count()) + " ms) on " +
+                     (blocker ? blocker->violation() : std::string("a blocking rule")) + ".");
+        } else {
+            log.info("LLMRunner", label + ": " + std::to_string(result.tokensPredicted) + " tokens generated, " +
+                     std::to_string(result.tokensEvaluated) + " prompt tokens evaluated (" +
+                     std::to_string(result.tokensCached) + " cached) in " + std::to_string(result.duration.count()) + " ms.");
+        }
 
-    std::cout << "Configuration loaded." << std::endl;
+        ResponseFeatures features;
+        features.text = result.content;
+        features.report = &report;
+        features.tokens = result.tokensPredicted;
+        features.attempt = attempt;
+        RuleOutcome outcome = m_program.enforce(m_program.evaluate(features), result.content);
+        check_timer.stop();
+        // An answer cut off by the budget rather than by LLM_N_PREDICT is incomplete.
+        bool budget_cut = max_tokens > 0 && max_tokens < m_llm->nPredict() && result.tokensPredicted >= max_tokens &&
+                          result.stopReason != "eos" && result.stopReason != "word";
+        if (!stopped && !budget_cut && report.passed() && !outcome.rejected) {
+            // Cached under the task's own prompt, so a repeated task skips the retries as well.
+            m_responseCache.put(key, result.content);
+            finish("accepted");
+            return write_output(config, task.id + ".response.txt", result.content);
+        }
 
-    Scheduler scheduler;
-    scheduler.run(config);
+        if (!stopped && !budget_cut) {
+            std::string fired;
+            for (const auto& id : outcome.fired) {
+                fired += (fired.empty() ? "" : ", ") + id;
+            }
+            log.warn("RuleEngine", label + ": response rejected with " + std::to_string(report.violations.size()) +
+                     " violation(s), severity " + std::to_string(report.severityScore) +
+                     (fired.empty() ? std::string(".") : "; rules fired: " + fired + "."));
+        }
+        bool budget_spent = token_budget > 0 && stats.tokensPredicted >= token_budget;
+        if (attempt == max_attempts || budget_spent || outcome.timeout.count() > 0) {
+            reflection = m_reflection.reflect(result.content, report, outcome.instructions);
+            if (budget_spent && (budget_cut || attempt < max_attempts)) {
+                log.warn("Scheduler", "Task " + task.id + ": token budget of " + std::to_string(token_budget) +
+                         " spent after " + std::to_string(attempt) + " attempt(s).");
+                finish("budget");
+                return false;
+            }
+            if (outcome.timeout.count() > 0 && attempt < max_attempts) {
+                log.warn("Scheduler", "Task " + task.id + ": not retried during the timeout imposed by the rules.");
+            }
+            break;
+        }
+        m_reflection.appendRetry(conversation, result.content, report, outcome.instructions);
+    }
 
-    return 0; // Unreachable
+    finish("rejected");
+    return false;
+}
+
+void Scheduler::recordStats(const ConfigSnapshot& config, const PQLTask& task, const InferenceStats& stats) const {
+    Logger::instance().info("Scheduler", "Task " + task.id + ": " + stats.outcome + ", " + std::to_string(stats.attempts) +
+                            " attempt(s), " + std::to_string(stats.tokensPredicted) + " tokens generated, " +
+                            std::to_string(stats.tokensEvaluated) + " prompt tokens evaluated, " +
+                            std::to_string(stats.tokensCached) + " reused from the server cache.");
+    const std::string& path = config.get(keys().statsFile);
+    if (path.empty()) {
+        return;
+    }
+
+    std::string line;
+    JsonWriter json(line);
+    json.beginObject()
+        .key("task").value(task.id)
+        .key("outcome").value(stats.outcome)
+        .key("attempts").value(stats.attempts)
+        .key("tokens_predicted").value(stats.tokensPredicted)
+        .key("tokens_evaluated").value(stats.tokensEvaluated)
+        .key("tokens_cached").value(stats.tokensCached)
+        .key("duration_ms").value(static_cast<int64_t>(stats.duration.count()))
+        .endObject();
+    line.push_back('\n');
+
+    // One append-mode write keeps lines from concurrent workers whole.
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::instance().warn("Scheduler", "Could not open task stats file " + path);
+        return;
+    }
+    ssize_t written = ::write(fd, line.data(), line.size());
+    (void)written;
+    ::close(fd);
 }
@@ -1,57 +1,203 @@
 #ifndef PQ_DAEMON_H
 #define PQ_DAEMON_H
 
+#include "LLMBatcher.h"
+#include "LLMRunner.h"
+#include "LiveConfig.h"
+#include "MetricsExporter.h"
+#include "PQLParser.h"
+#include "PQLQueryService.h"
+#include "PromptGenerator.h"
+#include "ReflectionEngine.h"
+#include "ResponseCache.h"
+#include "RuleEngine.h"
+#include "RuleProgram.h"
+#include "WalQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <functional>
+#include <filesystem>
 
 // Forward declaration for Config class to avoid circular dependencies
 class Config;
 
-struct PQLTask {
-    std::string id;
-    std::string type;
-    std::string priority;
-    std::string status;
-    std::string created;
-    std::string description;
-    std::vector<std::string> commands;
-    std::vector<std::string> criteria;
-    std::string notes;
-};
-
-class PQLParser {
-public:
-    std::vector<PQLTask> parse(const std::string& filename);
-};
+namespace fs = std::filesystem;
 
 class ActionScriptGenerator {
 public:
     bool generate(const Config& config, const PQLTask& task);
 };
 
-class PromptGenerator {
-public:
-    std::string generate(const PQLTask& task);
+/**
+ * @brief What inference cost one task, over all of its attempts.
+ */
+struct InferenceStats {
+    std::string outcome;  ///< accepted, cached, rejected, budget or error.
+    int attempts = 0;     ///< Generations run; 0 when served from the cache.
+    int tokensPredicted = 0;
+    int tokensEvaluated = 0;
+    int tokensCached = 0;
+    std::chrono::milliseconds duration{0};
 };
 
-class LLMRunner {
+class Scheduler {
 public:
-    std::string run(const std::string& prompt);
-};
+    /**
+     * @brief The keys the scheduler reads while it runs, declared once so each lookup is an array index.
+     */
+    struct Keys {
+        ConfigSchema schema;
+        ConfigKey<std::string> pendingDir = schema.addString("QUEUE_PENDING_DIR", "");
+        ConfigKey<std::string> inProgressDir = schema.addString("QUEUE_IN_PROGRESS_DIR", "");
+        ConfigKey<std::string> failedDir = schema.addString("QUEUE_FAILED_DIR", "");
+        ConfigKey<std::string> queueBackend = schema.addString("QUEUE_BACKEND", "dir");
+        ConfigKey<std::string> queueLog = schema.addString("QUEUE_WAL_FILE", "queue/tasks.wal");
+        ConfigKey<int> queueLease = schema.addInt("QUEUE_LEASE_SEC", 1800);
+        ConfigKey<int> pollInterval = schema.addInt("POLL_INTERVAL_SEC", 60);
+        ConfigKey<int> workers = schema.addInt("SCHEDULER_WORKERS", 1);
+        ConfigKey<int> agingInterval = schema.addInt("PRIORITY_AGING_SEC", 300);
+        ConfigKey<std::string> outputDir = schema.addString("OUTPUT_DIR", "agent_output");
+        ConfigKey<bool> streamRules = schema.addBool("LLM_STREAM_RULES", true);
+        ConfigKey<int> maxRetries = schema.addInt("MAX_RETRIES", 3);
+        ConfigKey<int> taskTokenBudget = schema.addInt("LLM_TASK_TOKEN_BUDGET", 0);
+        ConfigKey<std::string> statsFile = schema.addString("TASK_STATS_FILE", "logs/task_stats.jsonl");
+        ConfigKey<std::string> tasksFile = schema.addString("TASKS_XML_FILE", "memory/tasks.xml");
+        ConfigKey<std::string> querySocket = schema.addString("PQL_QUERY_SOCKET", "");
+        ConfigKey<std::string> metricsListen = schema.addString("METRICS_LISTEN", "");
+        ConfigKey<std::string> metricsFile = schema.addString("METRICS_FILE", "");
+        ConfigKey<int> metricsDumpInterval = schema.addInt("METRICS_DUMP_SEC", 60);
+    };
 
-class RuleEngine {
-public:
-    bool evaluate(const std::string& response);
-};
+    static const Keys& keys();
 
-class ReflectionEngine {
-public:
-    std::string reflect(const std::string& failed_response);
-};
+    /**
+     * @brief Watches the pending queue and dispatches tasks until the process exits.
+     *
+     * Pending files are ranked by a ReadyQueue from their priority and created
+     * attributes, aged by PRIORITY_AGING_SEC (default 300) so that low-priority
+     * work cannot starve, and handed out whenever a worker is free.
+     * Tasks are processed by SCHEDULER_WORKERS threads (default 1), and no
+     * more than SCHEDULER_WORKERS are ever outstanding: a task that is not
+     * yet running stays in the queue, where a higher-priority arrival can
+     * overtake it and another daemon can claim it. Each worker
+     * claims its task by renaming it into QUEUE_IN_PROGRESS_DIR; the rename is
+     * atomic, so any number of workers or daemon processes can share one set
+     * of queue directories without dispatching a task twice.
+     *
+     * With QUEUE_BACKEND = wal the queue lives in a WalQueue at
+     * QUEUE_WAL_FILE instead: files dropped into the pending directory are
+     * moved into the log as they arrive, claims are log records rather than
+     * renames, and tasks claimed by a run that crashed, or held for longer
+     * than QUEUE_LEASE_SEC, are dispatched again. On startup, files left in
+     * QUEUE_IN_PROGRESS_DIR without an action script in ACTIONS_PENDING_DIR
+     * (claimed, never finished) are imported as pending. Failed tasks are
+     * recorded in the log and copied to QUEUE_FAILED_DIR for inspection. The
+     * log is opened by one daemon at a time.
+     *
+     * Queue files are dispatched independently: depends_on is honoured by
+     * runPlan(), which runs a whole plan, not here.
+     *
+     * With LLM_INFERENCE_MODE = server, each task's prompt is also run
+     * against the llama.cpp server and the response written to
+     * OUTPUT_DIR/<task id>.response.txt before its action script is generated.
+     * When LLM_BATCH_SIZE is above 1, prompts from concurrent workers are
+     * coalesced by an LLMBatcher. Responses are cached on disk (see
+     * ResponseCache), so retried and duplicate tasks skip inference.
+     * A response the rules reject is retried up to MAX_RETRIES times within
+     * LLM_TASK_TOKEN_BUDGET generated tokens (see runInference). While a
+     * timeout imposed by a rules.xml consequence lasts (TIMEOUT_MARKER), no
+     * new task is dispatched; tasks already running finish.
+     *
+     * When PQL_QUERY_SOCKET is set, the scripts' lookups in TASKS_XML_FILE
+     * are answered on that socket by a PQLQueryService for as long as the
+     * daemon runs.
+     *
+     * Each task's stages are timed into Metrics (see Stage); the histograms
+     * and counters are served as Prometheus text on METRICS_LISTEN and
+     * rewritten to METRICS_FILE every METRICS_DUMP_SEC when those are set.
+     *
+     * The keys in Keys follow the configuration files: each task runs with
+     * the snapshot current when it was dispatched, and a change to the queue
+     * directories or poll interval takes effect on the next pass of the
+     * dispatch loop. A configuration whose queue directories are unset or
+     * cannot be created is logged and ignored. SCHEDULER_WORKERS, PRIORITY_AGING_SEC, QUEUE_BACKEND,
+     * QUEUE_WAL_FILE, QUEUE_LEASE_SEC, PQL_QUERY_SOCKET, the METRICS_ keys
+     * and the LLM server, cache and rule settings are read once at startup.
+     */
+    void run(const LiveConfig& config);
 
-class Scheduler {
-public:
-    void run(const Config& config);
+    /**
+     * @brief Runs every task of a PQL plan file once, in dependency order, and returns when it is over.
+     *
+     * The plan is parsed straight into a TaskTable, whose tasks' depends_on
+     * attributes form a TaskGraph; a plan with an unknown dependency or a
+     * cycle is refused before anything runs. Each task is copied out of
+     * the table only when it is dispatched. Tasks
+     * go through executeTask() on SCHEDULER_WORKERS threads: whenever a
+     * worker is free it takes the ready task with the longest chain of
+     * work behind it, so independent branches run side by side and the
+     * critical path is never left waiting. A task that fails skips
+     * everything depending on it; tasks already marked done are not run.
+     * @return 0 if every task ran successfully, 1 if any failed or was skipped, 2 if the plan was refused.
+     */
+    int runPlan(const LiveConfig& config, const std::string& planFile);
+
+private:
+    /**
+     * @brief Sets up the LLM runner, batcher, cache and rules when LLM_INFERENCE_MODE = server.
+     */
+    void startInference(const Config& config);
+
+    /**
+     * @brief Claims, parses and dispatches a single pending task file.
+     */
+    void processTask(const ConfigSnapshot& config, const fs::path& task_file);
+
+    /**
+     * @brief Runs a task claimed from the WalQueue and records how it ended.
+     */
+    void processClaim(const ConfigSnapshot& config, const WalQueue::Claim& claim);
+
+    /**
+     * @brief Runs a parsed task through inference (when enabled) and writes its action script.
+     * @return False if the task failed.
+     */
+    bool executeTask(const ConfigSnapshot& config, const PQLTask& task);
+
+    /**
+     * @brief Runs the task's prompt through the LLM server, checks the response against the rules and stores it.
+     *
+     * A rejected response (stopped mid-generation when streaming) is
+     * followed by the ReflectionEngine's feedback and the conversation sent
+     * again, so each retry only adds to what the server's slot already
+     * holds. Retries stop after MAX_RETRIES, once LLM_TASK_TOKEN_BUDGET
+     * tokens have been generated for the task, or when a rule imposes a
+     * timeout; the last corrective prompt is then left in
+     * OUTPUT_DIR/<id>.reflection.txt. The attempts and tokens spent are
+     * appended to TASK_STATS_FILE.
+     * @return False if inference failed or every attempt was rejected.
+     */
+    bool runInference(const ConfigSnapshot& config, const PQLTask& task);
+
+    /** @brief Logs a task's inference cost and appends it to TASK_STATS_FILE as a JSON line. */
+    void recordStats(const ConfigSnapshot& config, const PQLTask& task, const InferenceStats& stats) const;
+
+    std::unique_ptr<LLMRunner> m_llm;  ///< Shared by all workers; null unless server mode is on.
+    std::unique_ptr<LLMBatcher> m_batcher;  ///< Coalesces workers' prompts; null unless LLM_BATCH_SIZE > 1.
+    PromptGenerator m_promptGenerator;
+    ResponseCache m_responseCache;
+    std::atomic<uint64_t> m_cacheLookups{0};  ///< Every 100th lookup logs the cache's hit rate.
+    RuleEngine m_rules;
+    RuleProgram m_program;  ///< rules.xml
+    ReflectionEngine m_reflection;
+    std::unique_ptr<WalQueue> m_wal;  ///< Null unless QUEUE_BACKEND = wal.
+    std::unique_ptr<PQLQueryService> m_queryService;  ///< Null unless PQL_QUERY_SOCKET is set.
+    MetricsExporter m_metricsExporter;
 };
 
 #endif // PQ_DAEMON_H
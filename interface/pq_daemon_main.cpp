@@ -0,0 +1,35 @@
+#include "pq_daemon.h"
+#include "Logger.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    std::string plan;
+    if (argc == 3 && std::strcmp(argv[1], "--plan") == 0) {
+        plan = argv[2];
+    } else if (argc != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--plan <tasks.xml>]" << std::endl;
+        return 2;
+    }
+
+    Logger& log = Logger::instance();
+    log.setConsole(true);
+    log.info("Daemon", "QuantaPorto C++ Daemon Initializing...");
+
+    LiveConfig config(Scheduler::keys().schema, {"environment.txt", ".quanta"});
+    config.watch();
+
+    if (!log.configure(config.current()->raw())) {
+        log.warn("Daemon", "Could not open log file; logging to console only.");
+    }
+    log.info("Daemon", "Configuration loaded.");
+
+    Scheduler scheduler;
+    if (!plan.empty()) {
+        return scheduler.runPlan(config, plan);
+    }
+    scheduler.run(config);
+
+    return 0; // Unreachable
+}
@@ -1,19 +1,221 @@
+#include <chrono>
 #include <iostream>
+#include <iterator>
+#include "Config.h"
+#include "MappedFile.h"
+#include "PQLStore.h"
+#include "RuleEngine.h"
+#include "RuleProgram.h"
 #include "xml_parser.h"
 
-int main(int argc, char* argv[]) {
-    std::cout << "QuantaPorto Interface" << std::endl;
-    std::cout << "This is the main entry point for the C++ application." << std::endl;
-    std::cout << "It will orchestrate the parsing, prompt generation, and LLM interaction." << std::endl;
+namespace {
+    // Reads a response from a file, or from stdin for "-".
+    bool read_input(const std::string& source, MappedFile& file, std::string& buffer, std::string_view& text) {
+        if (source == "-") {
+            buffer.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+            text = buffer;
+            return true;
+        }
+        if (file.open(source)) {
+            text = file.view();
+            return true;
+        }
+        return std::filesystem::exists(source);  // An empty file cannot be mapped.
+    }
+
+    // --check-ethics [file|-] [--json]: the compiled equivalent of ethics_bias_checker.sh.
+    int check_ethics(int argc, char* argv[]) {
+        std::string source = "-";
+        bool json = false;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--json") {
+                json = true;
+            } else {
+                source = arg;
+            }
+        }
+
+        Config config;
+        config.load("environment.txt");
+        RuleEngine rules;
+        rules.load(config);
+
+        MappedFile file;
+        std::string input;
+        std::string_view text;
+        if (!read_input(source, file, input, text)) {
+            std::cerr << "Error: File not found or not readable: " << source << std::endl;
+            return 2;
+        }
+
+        RuleReport report;
+        bool passed = rules.evaluate(text, &report);
+        std::cout << (json ? report.toJson() : report.toText());
+        return passed ? 0 : 1;
+    }
+
+    // --check-rules <rules.xml> [file|-]: compiles the rules and lists those a response fires, without enforcing them.
+    int check_rules(int argc, char* argv[]) {
+        if (argc < 3) {
+            std::cerr << "Usage: " << argv[0] << " --check-rules <rules.xml> [file|-]" << std::endl;
+            return 2;
+        }
+        using Clock = std::chrono::steady_clock;
+        auto micros = [](Clock::duration elapsed) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        };
+
+        RuleProgram program;
+        auto started = Clock::now();
+        bool compiled = program.loadFile(argv[2]);
+        auto compileTime = Clock::now() - started;
+        for (const auto& warning : program.warnings()) {
+            std::cerr << "Warning: " << warning << std::endl;
+        }
+        if (!compiled) {
+            std::cerr << "Error: " << program.error() << std::endl;
+            return 2;
+        }
+
+        std::string source = argc > 3 ? argv[3] : "-";
+        MappedFile file;
+        std::string input;
+        std::string_view text;
+        if (!read_input(source, file, input, text)) {
+            std::cerr << "Error: File not found or not readable: " << source << std::endl;
+            return 2;
+        }
+
+        Config config;
+        config.load("environment.txt");
+        RuleEngine ethics;
+        ethics.load(config);
+        RuleReport report = ethics.check(text);
 
-    // Example of how the XmlTool might be used (once implemented)
-    // This part is for demonstration and will be expanded later.
+        ResponseFeatures features;
+        features.text = text;
+        features.report = &report;
+        started = Clock::now();
+        std::vector<uint32_t> fired = program.evaluate(features);
+        auto evaluateTime = Clock::now() - started;
+
+        std::cout << program.ruleCount() << " rules, " << program.instructionCount() << " instructions; compiled in "
+                  << micros(compileTime) << " us, evaluated in " << micros(evaluateTime) << " us." << std::endl;
+        bool rejected = false;
+        for (uint32_t index : fired) {
+            const CompiledRule& rule = program.rule(index);
+            std::cout << "FIRED: " << rule.id << " (" << rule.severity << "): " << rule.condition << std::endl;
+            for (const auto& consequence : rule.consequences) {
+                std::cout << "  - " << consequence.typeName;
+                if (!consequence.message.empty()) {
+                    std::cout << ": " << consequence.message;
+                }
+                std::cout << std::endl;
+                using Type = RuleConsequence::Type;
+                rejected |= consequence.type == Type::Reprompt || consequence.type == Type::Repeat ||
+                            consequence.type == Type::Timeout;
+            }
+        }
+        return rejected ? 1 : 0;
+    }
+
+    // --pql <file> <list|list_by_status <status>|commands <id>|criteria <id>|compile [out]>:
+    // the queries of parse_pql.sh, answered from the compiled store.
+    int query_pql(int argc, char* argv[]) {
+        std::string action = argc > 3 ? argv[3] : "";
+        std::string argument = argc > 4 ? argv[4] : "";
+        bool needs_argument = action == "list_by_status" || action == "commands" || action == "criteria";
+        if (argc < 4 || (needs_argument && argument.empty()) ||
+            (!needs_argument && action != "list" && action != "compile")) {
+            std::cerr << "Usage: " << argv[0]
+                      << " --pql <file> <list | list_by_status <status> | commands <id> | criteria <id> | compile [out]>"
+                      << std::endl;
+            return 2;
+        }
+        std::string file = argv[2];
+
+        if (action == "compile") {
+            std::string out = argument.empty() ? PQLStore::storePathFor(file) : argument;
+            auto started = std::chrono::steady_clock::now();
+            std::string error;
+            if (!PQLStore::compile(file, out, &error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            PQLStore store;
+            if (!store.open(out) || !store.verify()) {
+                std::cerr << "Error: " << (store.error().empty() ? out + " failed verification" : store.error()) << std::endl;
+                return 1;
+            }
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+            std::cerr << "Compiled " << store.size() << " tasks into " << out << " in " << us << " us." << std::endl;
+            return 0;
+        }
+
+        PQLParser parser;
+        if (action == "commands" || action == "criteria") {
+            std::optional<PQLTask> task = parser.find(file, argument);
+            if (task) {
+                for (const auto& line : action == "commands" ? task->commands : task->criteria) {
+                    std::cout << line << "\n";
+                }
+            }
+            return 0;
+        }
+
+        // Listing visits every task anyway; read the store when it is current, else the XML.
+        std::string source = file;
+        PQLStore store;
+        if (store.open(PQLStore::storePathFor(file)) && store.isCurrent(file)) {
+            source = PQLStore::storePathFor(file);
+        }
+        bool ok = parser.parse(source, [&](const PQLTaskView& task) {
+            if (action == "list" || task.status == argument) {
+                std::cout << task.id << ": " << task.description << "\n";
+            }
+            return true;
+        });
+        if (!ok) {
+            std::cerr << "Error: File not found or not readable: " << file << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
     if (argc > 1) {
         std::string command = argv[1];
+        // --xml-file <path>: parse the file with XmlTool and print it back in normalized form.
         if (command == "--xml-file") {
-            std::cout << "XML parsing logic would be invoked here based on other arguments." << std::endl;
+            if (argc < 3) {
+                std::cerr << "Usage: " << argv[0] << " --xml-file <path>" << std::endl;
+                return 1;
+            }
+            try {
+                QuantaPorto::XmlNode root = QuantaPorto::XmlTool::parseFile(argv[2]);
+                std::cout << QuantaPorto::XmlTool::serialize(root);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        if (command == "--check-ethics") {
+            return check_ethics(argc, argv);
+        }
+        if (command == "--check-rules") {
+            return check_rules(argc, argv);
+        }
+        if (command == "--pql") {
+            return query_pql(argc, argv);
         }
     }
 
+    std::cout << "QuantaPorto Interface" << std::endl;
+    std::cout << "This is the main entry point for the C++ application." << std::endl;
+    std::cout << "It will orchestrate the parsing, prompt generation, and LLM interaction." << std::endl;
+    std::cout << "Usage: " << argv[0] << " [--xml-file <path> | --check-ethics [file|-] [--json] | --check-rules <rules.xml> [file|-] | --pql <file> <query>]" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
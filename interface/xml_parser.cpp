@@ -1,30 +1,595 @@
 #include "xml_parser.h"
-#include <iostream>
-#include <sstream>
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
 
 namespace QuantaPorto
 {
+    namespace
+    {
+        bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        bool is_name_end(char c) {
+            return is_space(c) || c == '/' || c == '>' || c == '=';
+        }
+
+        void append_utf8(uint32_t cp, std::string& out) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        // Resolves one reference starting at '&'. Returns the number of input
+        // bytes consumed, or 0 if the text is not a recognised reference.
+        size_t decode_reference(std::string_view raw, size_t pos, std::string& out) {
+            size_t semi = raw.find(';', pos + 1);
+            if (semi == std::string_view::npos || semi - pos > 12) {
+                return 0;
+            }
+            std::string_view ref = raw.substr(pos + 1, semi - pos - 1);
+            if (ref == "lt") out += '<';
+            else if (ref == "gt") out += '>';
+            else if (ref == "amp") out += '&';
+            else if (ref == "quot") out += '"';
+            else if (ref == "apos") out += '\'';
+            else if (ref.size() > 1 && ref[0] == '#') {
+                uint32_t cp = 0;
+                bool hex = ref[1] == 'x' || ref[1] == 'X';
+                std::string_view digits = ref.substr(hex ? 2 : 1);
+                if (digits.empty()) {
+                    return 0;
+                }
+                for (char c : digits) {
+                    uint32_t d;
+                    if (c >= '0' && c <= '9') d = static_cast<uint32_t>(c - '0');
+                    else if (hex && c >= 'a' && c <= 'f') d = static_cast<uint32_t>(c - 'a' + 10);
+                    else if (hex && c >= 'A' && c <= 'F') d = static_cast<uint32_t>(c - 'A' + 10);
+                    else return 0;
+                    cp = cp * (hex ? 16 : 10) + d;
+                    if (cp > 0x10FFFF) {
+                        return 0;
+                    }
+                }
+                append_utf8(cp, out);
+            } else {
+                return 0;
+            }
+            return semi - pos + 1;
+        }
+
+        size_t escaped_size(std::string_view str, bool attribute) {
+            size_t size = 0;
+            for (char c : str) {
+                switch (c) {
+                    case '&': size += 5; break;
+                    case '<': case '>': size += 4; break;
+                    case '"': size += attribute ? 6 : 1; break;
+                    default: size += 1; break;
+                }
+            }
+            return size;
+        }
+
+        void append_escaped(std::string_view str, bool attribute, std::string& out) {
+            for (char c : str) {
+                switch (c) {
+                    case '&': out += "&amp;"; break;
+                    case '<': out += "&lt;"; break;
+                    case '>': out += "&gt;"; break;
+                    case '"':
+                        if (attribute) out += "&quot;";
+                        else out += c;
+                        break;
+                    default: out += c; break;
+                }
+            }
+        }
+
+        void write_node(const XmlNode& node, std::string& out, int indent_level) {
+            size_t indent = static_cast<size_t>(indent_level) * 2;
+
+            out.append(indent, ' ');
+            out += '<';
+            out += node.tag;
+            for (const auto& [name, value] : node.attributes) {
+                out += ' ';
+                out += name;
+                out += "=\"";
+                append_escaped(value, true, out);
+                out += '"';
+            }
+
+            if (node.children.empty()) {
+                if (node.text.empty()) {
+                    out += "/>\n";
+                    return;
+                }
+                out += '>';
+                append_escaped(node.text, false, out);
+            } else {
+                out += ">\n";
+                if (!node.text.empty()) {
+                    out.append(indent + 2, ' ');
+                    append_escaped(node.text, false, out);
+                    out += '\n';
+                }
+                for (const auto& child : node.children) {
+                    write_node(child, out, indent_level + 1);
+                }
+                out.append(indent, ' ');
+            }
+            out += "</";
+            out += node.tag;
+            out += ">\n";
+        }
+
+        XmlNode to_node(const XmlElement& element) {
+            XmlNode node;
+            node.tag = std::string(element.name);
+            node.text = std::string(element.text);
+            node.attributes.reserve(element.attrCount);
+            for (uint32_t i = 0; i < element.attrCount; ++i) {
+                node.attributes.emplace_back(std::string(element.attrs[i].name), std::string(element.attrs[i].value));
+            }
+            for (const XmlElement* child = element.firstChild; child; child = child->nextSibling) {
+                node.children.push_back(to_node(*child));
+            }
+            return node;
+        }
+    } // namespace
+
+    // --- XmlReader ---
+
+    XmlReader::XmlReader(std::string_view input) : m_input(input) {}
+
+    XmlEvent XmlReader::fail(const std::string& message) {
+        m_failed = true;
+        m_error = message + " at offset " + std::to_string(m_pos);
+        return XmlEvent::Error;
+    }
+
+    void XmlReader::skipWhitespace() {
+        while (m_pos < m_input.size() && is_space(m_input[m_pos])) {
+            ++m_pos;
+        }
+    }
+
+    std::string_view XmlReader::readName() {
+        size_t start = m_pos;
+        while (m_pos < m_input.size() && !is_name_end(m_input[m_pos])) {
+            ++m_pos;
+        }
+        return m_input.substr(start, m_pos - start);
+    }
+
+    std::string_view XmlReader::attribute(std::string_view attrName) const {
+        for (const auto& attr : m_attributes) {
+            if (attr.name == attrName) {
+                return attr.value;
+            }
+        }
+        return {};
+    }
+
+    XmlEvent XmlReader::next() {
+        if (m_failed) {
+            return XmlEvent::Error;
+        }
+        if (m_pendingEnd) {
+            m_pendingEnd = false;
+            m_name = m_stack.back();
+            m_stack.pop_back();
+            return XmlEvent::EndElement;
+        }
+
+        while (m_pos < m_input.size()) {
+            if (m_input[m_pos] != '<') {
+                size_t end = m_input.find('<', m_pos);
+                if (end == std::string_view::npos) {
+                    end = m_input.size();
+                }
+                m_text = m_input.substr(m_pos, end - m_pos);
+                m_cdata = false;
+                m_pos = end;
+                if (m_stack.empty()) {
+                    // Whitespace around the root element is not content.
+                    continue;
+                }
+                return XmlEvent::Text;
+            }
+
+            std::string_view rest = m_input.substr(m_pos);
+            if (rest.compare(0, 4, "<!--") == 0) {
+                size_t end = m_input.find("-->", m_pos + 4);
+                if (end == std::string_view::npos) {
+                    return fail("Unterminated comment");
+                }
+                m_pos = end + 3;
+            } else if (rest.compare(0, 9, "<![CDATA[") == 0) {
+                size_t end = m_input.find("]]>", m_pos + 9);
+                if (end == std::string_view::npos) {
+                    return fail("Unterminated CDATA section");
+                }
+                m_text = m_input.substr(m_pos + 9, end - m_pos - 9);
+                m_cdata = true;
+                m_pos = end + 3;
+                return XmlEvent::Text;
+            } else if (rest.compare(0, 2, "<?") == 0) {
+                size_t end = m_input.find("?>", m_pos + 2);
+                if (end == std::string_view::npos) {
+                    return fail("Unterminated processing instruction");
+                }
+                m_pos = end + 2;
+            } else if (rest.compare(0, 2, "<!") == 0) {
+                // DOCTYPE, possibly with an internal subset in brackets.
+                int brackets = 0;
+                size_t i = m_pos + 2;
+                for (; i < m_input.size(); ++i) {
+                    char c = m_input[i];
+                    if (c == '[') ++brackets;
+                    else if (c == ']') --brackets;
+                    else if (c == '>' && brackets <= 0) break;
+                }
+                if (i >= m_input.size()) {
+                    return fail("Unterminated declaration");
+                }
+                m_pos = i + 1;
+            } else if (rest.compare(0, 2, "</") == 0) {
+                return readEndTag();
+            } else {
+                return readStartTag();
+            }
+        }
+
+        if (!m_stack.empty()) {
+            return fail("Unexpected end of document inside <" + std::string(m_stack.back()) + ">");
+        }
+        return XmlEvent::EndDocument;
+    }
+
+    XmlEvent XmlReader::readStartTag() {
+        ++m_pos; // '<'
+        m_name = readName();
+        if (m_name.empty()) {
+            return fail("Expected element name");
+        }
+        m_attributes.clear();
+
+        while (true) {
+            skipWhitespace();
+            if (m_pos >= m_input.size()) {
+                return fail("Unterminated start tag <" + std::string(m_name) + ">");
+            }
+            char c = m_input[m_pos];
+            if (c == '>') {
+                ++m_pos;
+                break;
+            }
+            if (c == '/') {
+                if (m_pos + 1 >= m_input.size() || m_input[m_pos + 1] != '>') {
+                    return fail("Expected '>' after '/'");
+                }
+                m_pos += 2;
+                m_pendingEnd = true;
+                break;
+            }
+
+            std::string_view attrName = readName();
+            if (attrName.empty()) {
+                return fail("Expected attribute name");
+            }
+            skipWhitespace();
+            if (m_pos >= m_input.size() || m_input[m_pos] != '=') {
+                return fail("Expected '=' after attribute " + std::string(attrName));
+            }
+            ++m_pos;
+            skipWhitespace();
+            if (m_pos >= m_input.size() || (m_input[m_pos] != '"' && m_input[m_pos] != '\'')) {
+                return fail("Expected quoted value for attribute " + std::string(attrName));
+            }
+            char quote = m_input[m_pos++];
+            size_t end = m_input.find(quote, m_pos);
+            if (end == std::string_view::npos) {
+                return fail("Unterminated value for attribute " + std::string(attrName));
+            }
+            m_attributes.push_back({attrName, m_input.substr(m_pos, end - m_pos)});
+            m_pos = end + 1;
+        }
+
+        m_stack.push_back(m_name);
+        return XmlEvent::StartElement;
+    }
+
+    XmlEvent XmlReader::readEndTag() {
+        m_pos += 2; // "</"
+        m_name = readName();
+        skipWhitespace();
+        if (m_pos >= m_input.size() || m_input[m_pos] != '>') {
+            return fail("Unterminated end tag </" + std::string(m_name) + ">");
+        }
+        ++m_pos;
+        if (m_stack.empty() || m_stack.back() != m_name) {
+            return fail("Mismatched end tag </" + std::string(m_name) + ">");
+        }
+        m_stack.pop_back();
+        return XmlEvent::EndElement;
+    }
+
+    std::string_view XmlReader::decode(std::string_view raw, std::string& scratch) {
+        if (raw.find('&') == std::string_view::npos) {
+            return raw;
+        }
+        scratch.clear();
+        appendDecoded(raw, scratch);
+        return scratch;
+    }
+
+    void XmlReader::appendDecoded(std::string_view raw, std::string& out) {
+        size_t pos = 0;
+        while (pos < raw.size()) {
+            size_t amp = raw.find('&', pos);
+            if (amp == std::string_view::npos) {
+                out.append(raw.substr(pos));
+                return;
+            }
+            out.append(raw.substr(pos, amp - pos));
+            size_t used = decode_reference(raw, amp, out);
+            if (used == 0) {
+                // Not a reference we understand; keep it verbatim.
+                out += '&';
+                used = 1;
+            }
+            pos = amp + used;
+        }
+    }
+
+    // --- XmlElement ---
+
+    const XmlElement* XmlElement::child(std::string_view childName) const {
+        for (const XmlElement* c = firstChild; c; c = c->nextSibling) {
+            if (c->name == childName) {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    const XmlElement* XmlElement::nextNamed(std::string_view siblingName) const {
+        for (const XmlElement* s = nextSibling; s; s = s->nextSibling) {
+            if (s->name == siblingName) {
+                return s;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string_view XmlElement::attribute(std::string_view attrName, std::string_view fallback) const {
+        for (uint32_t i = 0; i < attrCount; ++i) {
+            if (attrs[i].name == attrName) {
+                return attrs[i].value;
+            }
+        }
+        return fallback;
+    }
+
+    // --- XmlDocument ---
+
+    void* XmlDocument::allocate(size_t size, size_t align) {
+        size_t offset = (m_used + align - 1) & ~(align - 1);
+        if (offset + size > m_capacity) {
+            return nullptr;
+        }
+        m_used = offset + size;
+        return m_arena.get() + offset;
+    }
+
+    std::string_view XmlDocument::store(std::string_view str) {
+        if (str.empty()) {
+            return {};
+        }
+        char* dest = static_cast<char*>(allocate(str.size(), 1));
+        if (!dest) {
+            return {};
+        }
+        std::memcpy(dest, str.data(), str.size());
+        return std::string_view(dest, str.size());
+    }
+
+    bool XmlDocument::parse(std::string_view xml) {
+        m_root = nullptr;
+        m_error.clear();
+
+        // Every element starts with '<' and every attribute contains '=', and no
+        // stored string is longer than the input it came from, so this bound
+        // always holds and the tree never needs a second allocation.
+        size_t elements = static_cast<size_t>(std::count(xml.begin(), xml.end(), '<'));
+        size_t attrs = static_cast<size_t>(std::count(xml.begin(), xml.end(), '='));
+        size_t capacity = elements * (sizeof(XmlElement) + 2 * alignof(XmlElement)) +
+                          attrs * sizeof(XmlAttr) + xml.size() + alignof(XmlElement);
+        if (capacity > m_capacity) {
+            m_arena.reset(new char[capacity]);
+            m_capacity = capacity;
+        }
+        m_used = 0;
+
+        XmlReader reader(xml);
+        XmlElement* current = nullptr;
+        // Text of each open element is gathered here and copied into the arena
+        // once the element closes, so it stays contiguous around child elements.
+        std::vector<std::string> pending_text;
+        std::string scratch;
+
+        while (true) {
+            XmlEvent event = reader.next();
+            if (event == XmlEvent::EndDocument) {
+                break;
+            }
+            if (event == XmlEvent::Error) {
+                m_error = reader.error();
+                m_root = nullptr;
+                return false;
+            }
+
+            if (event == XmlEvent::StartElement) {
+                auto* element = static_cast<XmlElement*>(allocate(sizeof(XmlElement), alignof(XmlElement)));
+                if (!element) {
+                    m_error = "XML arena exhausted";
+                    return false;
+                }
+                new (element) XmlElement();
+                element->name = store(reader.name());
+
+                const auto& attributes = reader.attributes();
+                if (!attributes.empty()) {
+                    auto* array = static_cast<XmlAttr*>(allocate(sizeof(XmlAttr) * attributes.size(), alignof(XmlAttr)));
+                    if (!array) {
+                        m_error = "XML arena exhausted";
+                        return false;
+                    }
+                    for (size_t i = 0; i < attributes.size(); ++i) {
+                        new (&array[i]) XmlAttr{store(attributes[i].name),
+                                                store(XmlReader::decode(attributes[i].value, scratch))};
+                    }
+                    element->attrs = array;
+                    element->attrCount = static_cast<uint32_t>(attributes.size());
+                }
+
+                element->parent = current;
+                if (current) {
+                    if (current->lastChild) {
+                        current->lastChild->nextSibling = element;
+                    } else {
+                        current->firstChild = element;
+                    }
+                    current->lastChild = element;
+                } else if (!m_root) {
+                    m_root = element;
+                } else {
+                    m_error = "Multiple root elements";
+                    m_root = nullptr;
+                    return false;
+                }
+                current = element;
+                if (pending_text.size() < reader.depth()) {
+                    pending_text.resize(reader.depth());
+                }
+                pending_text[reader.depth() - 1].clear();
+            } else if (event == XmlEvent::Text) {
+                std::string& text = pending_text[reader.depth() - 1];
+                if (reader.isCData()) {
+                    text.append(reader.text());
+                } else {
+                    XmlReader::appendDecoded(reader.text(), text);
+                }
+            } else if (event == XmlEvent::EndElement) {
+                // Indentation between child elements is not content.
+                const std::string& text = pending_text[reader.depth()];
+                bool blank = std::all_of(text.begin(), text.end(), is_space);
+                current->text = blank ? std::string_view() : store(text);
+                current = current->parent;
+            }
+        }
+
+        if (!m_root) {
+            m_error = "Document has no root element";
+            return false;
+        }
+        return true;
+    }
+
+    // --- XmlTool ---
+
     /**
      * @brief Parses an XML string into a tree of XmlNode objects.
      * @param xmlContent The XML content as a string.
      * @return The root XmlNode of the parsed tree.
      * @throws std::runtime_error if parsing fails.
-     *
-     * This is a placeholder implementation. A full implementation will require
-     * a more robust state machine or recursive descent parser to handle nested
-     * tags, attributes, and text content correctly.
      */
     XmlNode XmlTool::parse(const std::string& xmlContent) {
         if (xmlContent.empty()) {
             throw std::runtime_error("XML content cannot be empty.");
         }
 
-        // Placeholder: A real implementation will be built here.
-        XmlNode root;
-        root.tag = "root";
-        root.text = "Parsing not fully implemented.";
-        
-        return root;
+        XmlDocument document;
+        if (!document.parse(xmlContent)) {
+            throw std::runtime_error("XML parse error: " + document.error());
+        }
+        return to_node(*document.root());
+    }
+
+    /**
+     * @brief Memory-maps and parses an XML file into a tree of XmlNode objects.
+     * @param path The file to parse.
+     * @return The root XmlNode of the parsed tree.
+     * @throws std::runtime_error if the file cannot be read or parsing fails.
+     */
+    XmlNode XmlTool::parseFile(const std::string& path) {
+        MappedFile file;
+        if (!file.open(path)) {
+            throw std::runtime_error("Could not open XML file: " + path);
+        }
+        if (file.size() == 0) {
+            throw std::runtime_error("XML content cannot be empty.");
+        }
+
+        XmlDocument document;
+        if (!document.parse(file.view())) {
+            throw std::runtime_error("XML parse error in " + path + ": " + document.error());
+        }
+        return to_node(*document.root());
+    }
+
+    /**
+     * @brief Computes the exact number of bytes serialize() will write for a tree.
+     */
+    size_t XmlTool::serializedSize(const XmlNode& rootNode, int indent_level) {
+        size_t indent = static_cast<size_t>(indent_level) * 2;
+        size_t size = indent + 1 + rootNode.tag.size();
+        for (const auto& [name, value] : rootNode.attributes) {
+            size += 1 + name.size() + 2 + escaped_size(value, true) + 1;
+        }
+        if (rootNode.children.empty()) {
+            if (rootNode.text.empty()) {
+                return size + 3; // "/>\n"
+            }
+            return size + 1 + escaped_size(rootNode.text, false) + 2 + rootNode.tag.size() + 2;
+        }
+        size += 2; // ">\n"
+        if (!rootNode.text.empty()) {
+            size += indent + 2 + escaped_size(rootNode.text, false) + 1;
+        }
+        for (const auto& child : rootNode.children) {
+            size += serializedSize(child, indent_level + 1);
+        }
+        return size + indent + 2 + rootNode.tag.size() + 2;
+    }
+
+    /**
+     * @brief Serializes a tree of XmlNode objects, appending to a caller-owned buffer.
+     * @param rootNode The root node of the tree to serialize.
+     * @param out The buffer to append to; reuse it across calls to avoid reallocating.
+     * @param indent_level The current indentation level for pretty-printing.
+     *
+     * The buffer is grown once to the exact serialized size before writing.
+     * Leaf elements are written on a single line so their text round-trips unchanged.
+     */
+    void XmlTool::serialize(const XmlNode& rootNode, std::string& out, int indent_level) {
+        out.reserve(out.size() + serializedSize(rootNode, indent_level));
+        write_node(rootNode, out, indent_level);
     }
 
     /**
@@ -34,16 +599,9 @@ namespace QuantaPorto
      * @return A string containing the well-formed XML.
      */
     std::string XmlTool::serialize(const XmlNode& rootNode, int indent_level) {
-        std::stringstream ss;
-        std::string indent(indent_level * 2, ' ');
-
-        ss << indent << "<" << rootNode.tag << ">" << std::endl;
-        if (!rootNode.text.empty()) {
-            ss << indent << "  " << rootNode.text << std::endl;
-        }
-        ss << indent << "</" << rootNode.tag << ">" << std::endl;
-
-        return ss.str();
+        std::string out;
+        serialize(rootNode, out, indent_level);
+        return out;
     }
 
-} // namespace QuantaPorto
\ No newline at end of file
+} // namespace QuantaPorto
@@ -0,0 +1,192 @@
+#ifndef QUANTAPORTO_XML_PARSER_H
+#define QUANTAPORTO_XML_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QuantaPorto
+{
+    /**
+     * @brief Events produced by XmlReader::next().
+     */
+    enum class XmlEvent {
+        StartElement,
+        EndElement,
+        Text,
+        EndDocument,
+        Error
+    };
+
+    /**
+     * @brief An attribute as it appears in the source; the value is not entity-decoded.
+     */
+    struct XmlAttributeView {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /**
+     * @brief Pull (StAX-style) tokenizer over an in-memory XML document.
+     *
+     * The reader never copies the input: names, attribute values and text are
+     * views into the buffer passed to the constructor and stay valid as long as
+     * that buffer does. Text and attribute values are reported raw; use decode()
+     * to resolve entity and character references. Comments, processing
+     * instructions and the DOCTYPE are skipped. Mismatched or unclosed tags
+     * produce an XmlEvent::Error with a message available from error().
+     */
+    class XmlReader {
+    public:
+        explicit XmlReader(std::string_view input);
+
+        /**
+         * @brief Advances to the next event. Self-closing tags produce a StartElement followed by an EndElement.
+         */
+        XmlEvent next();
+
+        /** @brief Element name for StartElement/EndElement events. */
+        std::string_view name() const { return m_name; }
+
+        /** @brief Raw text for Text events. */
+        std::string_view text() const { return m_text; }
+
+        /** @brief True if the current Text event came from a CDATA section (and must not be decoded). */
+        bool isCData() const { return m_cdata; }
+
+        /** @brief Attributes of the current StartElement; reused between events. */
+        const std::vector<XmlAttributeView>& attributes() const { return m_attributes; }
+
+        /**
+         * @brief Looks up a raw attribute value on the current StartElement.
+         * @return The value, or an empty view if the attribute is absent.
+         */
+        std::string_view attribute(std::string_view name) const;
+
+        /** @brief Number of currently open elements. */
+        size_t depth() const { return m_stack.size(); }
+
+        /** @brief Byte offset of the reader within the input. */
+        size_t offset() const { return m_pos; }
+
+        const std::string& error() const { return m_error; }
+
+        /**
+         * @brief Resolves entity references in raw text or attribute values.
+         * @param raw The raw text.
+         * @param scratch Storage used only when decoding is actually needed.
+         * @return raw itself if it contains no '&', otherwise a view of scratch.
+         */
+        static std::string_view decode(std::string_view raw, std::string& scratch);
+
+        /**
+         * @brief Appends the decoded form of raw to out.
+         */
+        static void appendDecoded(std::string_view raw, std::string& out);
+
+    private:
+        XmlEvent fail(const std::string& message);
+        XmlEvent readStartTag();
+        XmlEvent readEndTag();
+        std::string_view readName();
+        void skipWhitespace();
+
+        std::string_view m_input;
+        size_t m_pos = 0;
+        std::string_view m_name;
+        std::string_view m_text;
+        bool m_cdata = false;
+        bool m_pendingEnd = false;
+        bool m_failed = false;
+        std::vector<XmlAttributeView> m_attributes;
+        std::vector<std::string_view> m_stack;
+        std::string m_error;
+    };
+
+    /**
+     * @brief Decoded attribute of an XmlElement; strings live in the document arena.
+     */
+    struct XmlAttr {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /**
+     * @brief Element of an arena-backed XmlDocument.
+     */
+    struct XmlElement {
+        std::string_view name;
+        /** Concatenated, decoded character data directly inside this element. */
+        std::string_view text;
+        const XmlAttr* attrs = nullptr;
+        uint32_t attrCount = 0;
+        XmlElement* parent = nullptr;
+        XmlElement* firstChild = nullptr;
+        XmlElement* lastChild = nullptr;
+        XmlElement* nextSibling = nullptr;
+
+        /** @brief Returns the first child element with the given name, or nullptr. */
+        const XmlElement* child(std::string_view childName) const;
+
+        /** @brief Returns the next sibling with the given name, or nullptr. */
+        const XmlElement* nextNamed(std::string_view siblingName) const;
+
+        /** @brief Returns an attribute value, or fallback if it is absent. */
+        std::string_view attribute(std::string_view attrName, std::string_view fallback = {}) const;
+    };
+
+    /**
+     * @brief Read-only DOM whose nodes and strings share a single arena allocation.
+     *
+     * The arena is sized from the input before parsing, so building the tree
+     * makes exactly one heap allocation regardless of document size, and the
+     * document does not reference the input buffer once parse() returns.
+     */
+    class XmlDocument {
+    public:
+        /**
+         * @brief Parses a document, replacing any previous contents.
+         * @return False if the input is not well-formed; see error().
+         */
+        bool parse(std::string_view xml);
+
+        const XmlElement* root() const { return m_root; }
+        const std::string& error() const { return m_error; }
+
+    private:
+        void* allocate(size_t size, size_t align);
+        std::string_view store(std::string_view str);
+
+        std::unique_ptr<char[]> m_arena;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+        XmlElement* m_root = nullptr;
+        std::string m_error;
+    };
+
+    /**
+     * @brief Owning XML tree, convenient for building and serializing documents.
+     */
+    struct XmlNode {
+        std::string tag;
+        std::string text;
+        std::vector<std::pair<std::string, std::string>> attributes;
+        std::vector<XmlNode> children;
+    };
+
+    class XmlTool {
+    public:
+        static XmlNode parse(const std::string& xmlContent);
+        static XmlNode parseFile(const std::string& path);
+        static std::string serialize(const XmlNode& rootNode, int indent_level = 0);
+        static void serialize(const XmlNode& rootNode, std::string& out, int indent_level = 0);
+        static size_t serializedSize(const XmlNode& rootNode, int indent_level = 0);
+    };
+
+} // namespace QuantaPorto
+
+#endif // QUANTAPORTO_XML_PARSER_H
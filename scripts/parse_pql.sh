@@ -9,7 +9,10 @@
 #
 # This script can be executed directly or sourced by other scripts to use its functions.
 #
-# Dependencies: xmlstarlet
+# Dependencies: xmlstarlet, unless the compiled quantaporto_interface is available, in which case
+# list/commands/criteria are answered from the precompiled task store (tasks.pqlc) instead.
+# While the daemon runs with PQL_QUERY_SOCKET set, every command is answered by its resident
+# query service (see pql_query in utils.sh) and nothing is parsed here at all.
 #
 
 set -euo pipefail
@@ -23,6 +26,15 @@ setup_env
 PQL_FILE="$TASKS_XML_FILE"
 PQL_SCHEMA="$PQL_SCHEMA_FILE"
 
+# The compiled interface keeps tasks.xml compiled next to it (tasks.pqlc) and looks tasks up by id
+# without parsing; it recompiles whenever tasks.xml changes.
+PQ_INTERFACE="${QUANTAPORTO_INTERFACE:-$PRISM_QUANTA_ROOT/quantaporto_interface}"
+
+# Returns success if queries can go through the compiled interface.
+have_interface() {
+  [[ -x "$PQ_INTERFACE" ]]
+}
+
 # --- Core Logic ---
 
 # Lists all task IDs and their descriptions from the PQL file.
@@ -35,6 +47,12 @@ PQL_SCHEMA="$PQL_SCHEMA_FILE"
 # - `-v "description"`: Print the value of the 'description' element.
 # - `-n`: Print a newline.
 list_tasks() {
+  pql_query list && return
+  [[ $? -eq 2 ]] || return 1
+  if have_interface; then
+    "$PQ_INTERFACE" --pql "$PQL_FILE" list
+    return
+  fi
   xmlstarlet sel -t -m "/tasks/task" -v "@id" -o ": " -v "description" -n "$PQL_FILE"
 }
 
@@ -50,6 +68,12 @@ get_commands() {
     log_error "Task ID is required."
     usage
   fi
+  pql_query commands "$task_id" && return
+  [[ $? -eq 2 ]] || return 1
+  if have_interface; then
+    "$PQ_INTERFACE" --pql "$PQL_FILE" commands "$task_id"
+    return
+  fi
   xmlstarlet sel -t -m "/tasks/task[@id='$task_id']/commands/command" -v "." -n "$PQL_FILE"
 }
 
@@ -64,12 +88,26 @@ get_criteria() {
     log_error "Task ID is required."
     usage
   fi
+  pql_query criteria "$task_id" && return
+  [[ $? -eq 2 ]] || return 1
+  if have_interface; then
+    "$PQ_INTERFACE" --pql "$PQL_FILE" criteria "$task_id"
+    return
+  fi
   xmlstarlet sel -t -m "/tasks/task[@id='$task_id']/criteria/criterion" -v "." -n "$PQL_FILE"
 }
 
 # Validates the PQL file against its XSD schema.
 # This ensures the XML structure is correct and all required elements/attributes are present.
 validate_pql() {
+  # The service checks the same structure as the schema without xmlstarlet.
+  local report status=0
+  report=$(pql_query validate 2>&1) || status=$?
+  if [[ $status -ne 2 ]]; then
+    printf '%s\n' "$report"
+    [[ $status -eq 0 ]] || log_error "$PQL_FILE is invalid. Please check against the schema."
+    return
+  fi
   if [[ ! -f "$PQL_SCHEMA" ]]; then
     log_error "PQL schema file not found at '$PQL_SCHEMA'"
   fi
@@ -106,13 +144,24 @@ list_by_status() {
         log_error "Status is required."
         usage
     fi
+    pql_query list_by_status "$status" && return
+    [[ $? -eq 2 ]] || return 1
+    if have_interface; then
+        "$PQ_INTERFACE" --pql "$PQL_FILE" list_by_status "$status"
+        return
+    fi
     # The XPath `/tasks/task[@status='$status']` selects only tasks with the matching status.
     xmlstarlet sel -t -m "/tasks/task[@status='$status']" -v "@id" -o ": " -v "description" -n "$PQL_FILE"
 }
 
 main() {
-  # Ensure xmlstarlet is installed before proceeding.
-  check_deps "xmlstarlet"
+  # xmlstarlet is only needed without the query service: for validation, or for queries
+  # when the interface is not built either.
+  local service=0
+  pql_query ping > /dev/null 2>&1 || service=$?
+  if [[ $service -ne 0 ]] && { [[ "${1:-}" == "validate" ]] || ! have_interface; }; then
+    check_deps "xmlstarlet"
+  fi
 
   if [[ ! -f "$PQL_FILE" ]]; then
     log_error "PQL file not found at '$PQL_FILE'"
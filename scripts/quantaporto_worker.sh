@@ -32,23 +32,39 @@ fi
 
 # --- Logic ---
 
-# Ensure xmlstarlet is installed before proceeding.
-check_deps "xmlstarlet"
+# The daemon's query service reads the task file when it is running (see pql_query in utils.sh);
+# otherwise parse it here with xmlstarlet.
+query_status=0
+pql_query ping > /dev/null 2>&1 || query_status=$?
 
-# 1. Parse the Task ID from the XML file using xmlstarlet.
-#    - `sel -t -v "/task/@id"`: Selects the value of the 'id' attribute of the root <task> element.
-#    This is more robust than using grep and sed.
-TASK_ID=$(xmlstarlet sel -t -v "/task/@id" "$TASK_FILE")
+if [[ $query_status -eq 0 ]]; then
+    # 1. The Task ID, read by the daemon: one round trip, no XML parsing here.
+    TASK_ID=$(pql_query file_id "$TASK_FILE" || true)
+    TASK_ID="${TASK_ID%$'\n'}"
+else
+    # Ensure xmlstarlet is installed before proceeding.
+    check_deps "xmlstarlet"
+
+    # 1. Parse the Task ID from the XML file using xmlstarlet.
+    #    - `sel -t -v "/task/@id"`: Selects the value of the 'id' attribute of the root <task> element.
+    #    This is more robust than using grep and sed.
+    TASK_ID=$(xmlstarlet sel -t -v "/task/@id" "$TASK_FILE")
+fi
 if [[ -z "$TASK_ID" ]]; then
     log_error "Could not parse task ID from $TASK_FILE"
     exit 1
 fi
 log_info "QuantaPorto Worker: Processing task $TASK_ID..."
 
-# 2. Parse all commands from the XML file using xmlstarlet.
-#    - `sel -t -m "/task/commands/command"`: Matches all <command> elements.
-#    - `-v . -n`: Prints the value of each matched element, followed by a newline.
-COMMANDS=$(xmlstarlet sel -t -m "/task/commands/command" -v . -n "$TASK_FILE")
+if [[ $query_status -eq 0 ]]; then
+    # 2. The commands, one per line, likewise from the daemon.
+    COMMANDS=$(pql_query file_commands "$TASK_FILE")
+else
+    # 2. Parse all commands from the XML file using xmlstarlet.
+    #    - `sel -t -m "/task/commands/command"`: Matches all <command> elements.
+    #    - `-v . -n`: Prints the value of each matched element, followed by a newline.
+    COMMANDS=$(xmlstarlet sel -t -m "/task/commands/command" -v . -n "$TASK_FILE")
+fi
 
 if [[ -z "$COMMANDS" ]]; then
     log_warn "No commands found for task $TASK_ID. Creating an empty action script."
@@ -119,3 +119,24 @@ check_deps() {
         fi
     done
 }
+
+# --- PQL Query Service ---
+
+# Asks the running daemon's PQL query service (PQL_QUERY_SOCKET) instead of parsing XML here.
+#
+# The answer goes to stdout, the service's error message to stderr. Falls back to the
+# caller's own parsing only when the service is not running, so check for status 2.
+#
+# Usage: pql_query <request> [argument]
+#   Returns 0 on success, 1 if the service rejected the request, 2 if there is no service.
+pql_query() {
+    local client="$PRISM_QUANTA_ROOT/porto_manager"
+    local socket="${PQL_QUERY_SOCKET:-}"
+    if [[ -n "$socket" && "$socket" != /* ]]; then
+        socket="$PRISM_QUANTA_ROOT/$socket"
+    fi
+    if [[ -z "$socket" || ! -S "$socket" || ! -x "$client" ]]; then
+        return 2
+    fi
+    "$client" query --socket "$socket" "$@"
+}
@@ -0,0 +1,54 @@
+// Drives LLMRunner through a sequence of completions for tests/native/test-native.sh.
+//
+// Usage: llm_runner_driver CONFIG_FILE STEP...
+// A step is a prompt the stub server knows (plain, chunked, error), "stream"
+// (streamed with a token callback), or "cancel:N" (the slow stream, stopped
+// after N tokens). Each step prints one line:
+//   <step> ok=.. cancelled=.. tokens=.. cached=.. stop=.. connections=.. content=[..] error=[..]
+
+#include "Config.h"
+#include "LLMRunner.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " CONFIG_FILE STEP..." << std::endl;
+        return 2;
+    }
+    Config config;
+    if (!config.load(argv[1])) {
+        std::cerr << "Cannot read " << argv[1] << std::endl;
+        return 2;
+    }
+    LLMRunner runner(config);
+    if (!runner.valid()) {
+        std::cerr << runner.error() << std::endl;
+        return 2;
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        std::string step = argv[i];
+        LLMResult result;
+        if (step == "stream") {
+            std::string streamed;
+            result = runner.run("stream", [&streamed](std::string_view token) {
+                streamed.append(token).append("|");
+                return true;
+            });
+            result.content = streamed;
+        } else if (step.rfind("cancel:", 0) == 0) {
+            int stopAfter = std::atoi(step.c_str() + 7);
+            int seen = 0;
+            result = runner.run("slow", [&seen, stopAfter](std::string_view) { return ++seen < stopAfter; });
+        } else {
+            result = runner.run(step);
+        }
+        std::cout << step << " ok=" << result.ok << " cancelled=" << result.cancelled
+                  << " tokens=" << result.tokensPredicted << " cached=" << result.tokensCached
+                  << " stop=" << result.stopReason << " connections=" << runner.connectionsOpened()
+                  << " content=[" << result.content << "] error=[" << result.error << "]" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Exercises PQLStore for tests/native/test-native.sh.
+//
+// Usage: pql_store_driver COMMAND ARGS...
+//   generate FILE N             writes a synthetic tasks.xml of N tasks (bench/TaskGenerator)
+//   roundtrip SOURCE STORE      compiles SOURCE and compares every task, read back with
+//                               task() and find(), against PQLParser's parse of SOURCE
+//   compile SOURCE STORE        compiles SOURCE only
+//   open SOURCE STORE           opens an existing store and checks it
+//   find SOURCE ID              looks a task up with PQLParser::find (compiling as needed)
+// Each command prints one line starting with its name.
+
+#include "PQLParser.h"
+#include "PQLStore.h"
+#include "TaskGenerator.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace {
+    bool same(const PQLTaskView& a, const PQLTaskView& b) {
+        return a.id == b.id && a.type == b.type && a.priority == b.priority && a.status == b.status &&
+               a.created == b.created && a.description == b.description && a.notes == b.notes &&
+               a.commands == b.commands && a.criteria == b.criteria && a.dependsOn == b.dependsOn;
+    }
+
+    int roundtrip(const std::string& source, const std::string& storePath) {
+        std::string error;
+        if (!PQLStore::compile(source, storePath, &error)) {
+            std::cout << "roundtrip compiled=0 error=[" << error << "]" << std::endl;
+            return 1;
+        }
+        PQLStore store;
+        if (!store.open(storePath)) {
+            std::cout << "roundtrip compiled=1 opened=0 error=[" << store.error() << "]" << std::endl;
+            return 1;
+        }
+
+        // find() answers with the first task of an id, so only those are compared through it.
+        size_t tasks = 0;
+        size_t mismatches = 0;
+        std::map<std::string, bool> seen;
+        PQLParser().parse(source, [&](const PQLTaskView& parsed) {
+            PQLTaskView stored;
+            if (!store.task(tasks, stored) || !same(parsed, stored)) {
+                std::cerr << "task() differs at " << tasks << ": " << parsed.id << std::endl;
+                ++mismatches;
+            }
+            if (seen.emplace(std::string(parsed.id), true).second &&
+                (!store.find(parsed.id, stored) || !same(parsed, stored))) {
+                std::cerr << "find() differs for " << parsed.id << std::endl;
+                ++mismatches;
+            }
+            ++tasks;
+            return true;
+        });
+        PQLTaskView missing;
+        bool phantom = store.find("no-such-task", missing);
+        std::cout << "roundtrip tasks=" << tasks << " stored=" << store.size() << " ids=" << seen.size()
+                  << " mismatches=" << mismatches << " phantom=" << phantom << " verify=" << store.verify()
+                  << " current=" << store.isCurrent(source) << std::endl;
+        return mismatches == 0 && tasks == store.size() ? 0 : 1;
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " generate|roundtrip|compile|open|find ARGS..." << std::endl;
+        return 2;
+    }
+    std::string command = argv[1];
+    if (command == "generate") {
+        TaskGenerator::Options options;
+        options.tasks = static_cast<size_t>(std::atol(argv[3]));
+        options.dependencies = 2;
+        std::ofstream(argv[2]) << TaskGenerator(options).tasksXml();
+        std::cout << "generate tasks=" << options.tasks << std::endl;
+        return 0;
+    }
+    if (command == "roundtrip") {
+        return roundtrip(argv[2], argv[3]);
+    }
+    if (command == "compile") {
+        std::string error;
+        bool ok = PQLStore::compile(argv[2], argv[3], &error);
+        std::cout << "compile ok=" << ok << " error=[" << error << "]" << std::endl;
+        return ok ? 0 : 1;
+    }
+    if (command == "open") {
+        PQLStore store;
+        bool ok = store.open(argv[3]);
+        std::cout << "open ok=" << ok << " verify=" << store.verify() << " current=" << store.isCurrent(argv[2])
+                  << " tasks=" << store.size() << " error=[" << store.error() << "]" << std::endl;
+        return ok ? 0 : 1;
+    }
+    if (command == "find") {
+        std::optional<PQLTask> task = PQLParser().find(argv[2], argv[3]);
+        std::cout << "find found=" << task.has_value() << " description=[" << (task ? task->description : "") << "]"
+                  << std::endl;
+        return task ? 0 : 1;
+    }
+    std::cerr << "Unknown command " << command << std::endl;
+    return 2;
+}
@@ -0,0 +1,77 @@
+// Renders a PromptTemplate for tests/native/test-native.sh.
+//
+// Usage: prompt_template_driver TEMPLATE_FILE|-e SOURCE [CONTEXT.json]
+// The JSON object's members become the template's top-level names: objects
+// map to maps, arrays to lists, numbers to integers. Prints the rendering
+// exactly, or "error: <line N: ...>" and exits 1 if the template does not compile.
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "PromptTemplate.h"
+#include <deque>
+#include <iostream>
+#include <string>
+
+namespace {
+    // Decoded strings, kept alive for the views in the context.
+    std::deque<std::string> g_strings;
+
+    TemplateValue to_value(const JsonView& json) {
+        switch (json.type()) {
+        case JsonType::Bool:
+            return TemplateValue::of(json.toBool());
+        case JsonType::Number:
+            return TemplateValue::of(json.toInt());
+        case JsonType::String:
+            return TemplateValue::of(std::string_view(g_strings.emplace_back(json.toString())));
+        case JsonType::Array: {
+            TemplateValue list = TemplateValue::list();
+            json.forEachElement([&list](const JsonView& element) {
+                list.items.push_back(to_value(element));
+                return true;
+            });
+            return list;
+        }
+        case JsonType::Object: {
+            TemplateValue map = TemplateValue::map();
+            json.forEachMember([&map](std::string_view key, const JsonView& member) {
+                map.set(g_strings.emplace_back(key), to_value(member));
+                return true;
+            });
+            return map;
+        }
+        default:
+            return TemplateValue();
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool inline_source = argc > 2 && std::string(argv[1]) == "-e";
+    int context_arg = inline_source ? 3 : 2;
+    if (argc < 2 || (inline_source && argc < 3) || argc > context_arg + 1) {
+        std::cerr << "Usage: " << argv[0] << " TEMPLATE_FILE|-e SOURCE [CONTEXT.json]" << std::endl;
+        return 2;
+    }
+
+    PromptTemplate compiled;
+    if (!(inline_source ? compiled.compile(argv[2]) : compiled.loadFile(argv[1]))) {
+        std::cout << "error: " << compiled.error() << std::endl;
+        return 1;
+    }
+
+    TemplateValue context = TemplateValue::map();
+    MappedFile json;
+    if (argc > context_arg) {
+        if (!json.open(argv[context_arg])) {
+            std::cerr << "Cannot read " << argv[context_arg] << std::endl;
+            return 2;
+        }
+        context = to_value(JsonView::parse(json.view()));
+    }
+
+    std::string out;
+    compiled.render(context, out);
+    std::cout << out;
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Orders task files with ReadyQueue for tests/native/test-native.sh.
+//
+// Usage: ready_queue_driver AGING_SEC STEP...
+// Steps:
+//   add:FILE      rank a task file and queue it
+//   remove:FILE   drop a queued file
+//   pop           print the file that should run next
+//   pop-all       pop until the queue is empty
+// pop prints "pop NAME" (the file name only) or "pop none"; remove prints "remove NAME ok=0|1".
+
+#include "ReadyQueue.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " AGING_SEC STEP..." << std::endl;
+        return 2;
+    }
+    ReadyQueue queue(std::chrono::seconds(std::atoi(argv[1])));
+    auto pop = [&queue] {
+        std::optional<fs::path> next = queue.pop();
+        std::cout << "pop " << (next ? next->filename().string() : "none") << std::endl;
+        return next.has_value();
+    };
+    for (int i = 2; i < argc; ++i) {
+        std::string step = argv[i];
+        if (step.rfind("add:", 0) == 0) {
+            queue.add(step.substr(4));
+        } else if (step.rfind("remove:", 0) == 0) {
+            fs::path file = step.substr(7);
+            std::cout << "remove " << file.filename().string() << " ok=" << queue.remove(file) << std::endl;
+        } else if (step == "pop") {
+            pop();
+        } else if (step == "pop-all") {
+            while (pop()) {
+            }
+        } else {
+            std::cerr << "Unknown step " << step << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Drives a ResponseCache file for tests/native/test-native.sh.
+//
+// Usage: response_cache_driver CACHE_FILE STEP...
+// A step is "put:KEY=VALUE" or "get:KEY"; keys are hashed with Hasher::hash128.
+// The cache is opened once, with a 1 MB cap, and each step prints one line:
+//   put <key>
+//   get <key> hit=[value] | get <key> miss
+// followed by "entries=N" once the steps are done.
+
+#include "ResponseCache.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " CACHE_FILE STEP..." << std::endl;
+        return 2;
+    }
+    ResponseCache cache;
+    if (!cache.open(argv[1], 1 << 20)) {
+        std::cerr << "Cannot open " << argv[1] << ": " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        std::string step = argv[i];
+        if (step.rfind("put:", 0) == 0) {
+            size_t equals = step.find('=');
+            std::string key = step.substr(4, equals - 4);
+            cache.put(Hasher::hash128(key), equals == std::string::npos ? "" : step.substr(equals + 1));
+            std::cout << "put " << key << std::endl;
+        } else if (step.rfind("get:", 0) == 0) {
+            std::string key = step.substr(4);
+            std::optional<std::string> value = cache.get(Hasher::hash128(key));
+            std::cout << "get " << key << (value ? " hit=[" + *value + "]" : std::string(" miss")) << std::endl;
+        } else {
+            std::cerr << "Unknown step " << step << std::endl;
+            return 2;
+        }
+    }
+    std::cout << "entries=" << cache.stats().entries << std::endl;
+    return 0;
+}
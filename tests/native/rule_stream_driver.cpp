@@ -0,0 +1,57 @@
+// Feeds a response to RuleEngine::Stream chunk by chunk for tests/native/test-native.sh.
+//
+// Usage: rule_stream_driver BIAS_PATTERNS_FILE CHUNK...
+// Chunks may contain \n for a newline. Prints "feed K blocked=0|1" after each chunk,
+// then "finish chunks=N violations=[category:pattern ...]" for the whole response.
+
+#include "RuleEngine.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+    std::string unescape(const std::string& chunk) {
+        std::string out;
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            if (chunk[i] == '\\' && i + 1 < chunk.size() && chunk[i + 1] == 'n') {
+                out += '\n';
+                ++i;
+            } else {
+                out += chunk[i];
+            }
+        }
+        return out;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " BIAS_PATTERNS_FILE CHUNK..." << std::endl;
+        return 2;
+    }
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::cerr << "Cannot read " << argv[1] << std::endl;
+        return 2;
+    }
+    std::stringstream patterns;
+    patterns << in.rdbuf();
+
+    RuleEngine engine;
+    engine.setIntersectionalCheck(false);
+    engine.setBiasPatterns(patterns.str());
+
+    RuleEngine::Stream stream = engine.stream();
+    for (int i = 2; i < argc; ++i) {
+        bool ok = stream.feed(unescape(argv[i]));
+        std::cout << "feed " << i - 1 << " blocked=" << (ok ? 0 : 1) << std::endl;
+    }
+    RuleReport report = stream.finish();
+    std::cout << "finish chunks=" << stream.chunks() << " violations=[";
+    for (const auto& match : report.violations) {
+        std::cout << match.violation() << " ";
+    }
+    std::cout << "]" << std::endl;
+    return 0;
+}
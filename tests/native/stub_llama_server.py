@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""A stand-in for llama.cpp's /completion endpoint, for tests/native/test-native.sh.
+
+The reply depends on the prompt:
+  plain    one JSON document with a Content-Length
+  chunked  the same document, sent with Transfer-Encoding: chunked
+  error    HTTP 500 with a llama.cpp-style error document
+  stream   (with "stream": true) three token events and a final summary event
+  slow     (with "stream": true) up to 100 token events, 20 ms apart
+
+Usage: stub_llama_server.py PORT_FILE EVENT_LOG
+The chosen port is written to PORT_FILE. EVENT_LOG receives one line per
+new connection ("connect") and per abandoned stream ("cancelled N").
+"""
+
+import json
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+PORT_FILE, EVENT_LOG = sys.argv[1], sys.argv[2]
+
+DOCUMENT = {"content": "hello world", "tokens_predicted": 2, "tokens_evaluated": 5,
+            "tokens_cached": 3, "stop_type": "eos"}
+
+
+def log_event(text):
+    with open(EVENT_LOG, "a") as log:
+        log.write(text + "\n")
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        super().setup()
+        log_event("connect")
+
+    def log_message(self, *args):
+        pass
+
+    def send_body(self, status, body):
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def start_chunked(self, content_type):
+        self.send_response(200)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+
+    def chunk(self, data):
+        self.wfile.write(b"%x\r\n%s\r\n" % (len(data), data))
+        self.wfile.flush()
+
+    def event(self, payload):
+        self.chunk(b"data: " + json.dumps(payload).encode() + b"\n\n")
+
+    def do_POST(self):
+        request = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+        prompt = request.get("prompt")
+
+        if prompt == "plain":
+            self.send_body(200, json.dumps(DOCUMENT).encode())
+        elif prompt == "chunked":
+            body = json.dumps(DOCUMENT).encode()
+            self.start_chunked("application/json")
+            for i in range(0, len(body), 7):
+                self.chunk(body[i:i + 7])
+            self.chunk(b"")
+        elif prompt == "error":
+            self.send_body(500, b'{"error":{"code":500,"message":"model is loading","type":"unavailable_error"}}')
+        elif prompt == "stream" and request.get("stream"):
+            self.start_chunked("text/event-stream")
+            for token in ("a", "b", "c"):
+                self.event({"content": token, "stop": False})
+            self.event({"content": "", "stop": True, "tokens_predicted": 3, "stop_type": "limit"})
+            self.chunk(b"")
+        elif prompt == "slow" and request.get("stream"):
+            self.start_chunked("text/event-stream")
+            sent = 0
+            try:
+                for sent in range(1, 101):
+                    self.event({"content": "t%d " % sent, "stop": False})
+                    time.sleep(0.02)
+                self.event({"content": "", "stop": True, "stop_type": "limit"})
+                self.chunk(b"")
+            except (BrokenPipeError, ConnectionResetError):
+                log_event("cancelled %d" % sent)
+                self.close_connection = True
+        else:
+            self.send_body(400, b'{"error":"unexpected prompt"}')
+
+
+server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+with open(PORT_FILE, "w") as port_file:
+    port_file.write(str(server.server_address[1]))
+server.serve_forever()
@@ -0,0 +1,42 @@
+// Loads a plan into a TaskTable and runs it through TaskGraph one task at a time for tests/native/test-native.sh.
+//
+// Usage: task_graph_driver PLAN.xml [FAIL_ID...]
+// Prints "build critical_path=N" or "build error=[...]", then "run ID" as each task is
+// started, "skip ID" for each task skipped because a listed task failed, and finally
+// "end done=.. failed=.. skipped=..".
+
+#include "TaskGraph.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " PLAN.xml [FAIL_ID...]" << std::endl;
+        return 2;
+    }
+    std::vector<std::string> failing(argv + 2, argv + argc);
+
+    TaskTable tasks;
+    tasks.load(argv[1]);
+    TaskGraph graph;
+    if (!graph.build(std::move(tasks))) {
+        std::cout << "build error=[" << graph.error() << "]" << std::endl;
+        return 1;
+    }
+    std::cout << "build critical_path=" << graph.criticalPathLength() << std::endl;
+
+    while (auto index = graph.next()) {
+        std::string_view id = graph.id(*index);
+        std::cout << "run " << id << std::endl;
+        bool failed = std::find(failing.begin(), failing.end(), id) != failing.end();
+        for (size_t skipped : graph.finish(*index, !failed)) {
+            std::cout << "skip " << graph.id(skipped) << std::endl;
+        }
+    }
+    std::cout << "end done=" << graph.count(TaskGraph::State::Done) << " failed="
+              << graph.count(TaskGraph::State::Failed) << " skipped=" << graph.count(TaskGraph::State::Skipped)
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,964 @@
+#!/bin/bash
+# QuantaPorto - tests for the C++ components, run through small drivers.
+# Build and run with `make test`; the drivers live next to this script.
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NC='\033[0m' # No Color
+
+PASS_COUNT=0
+FAIL_COUNT=0
+
+NATIVE_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT_DIR="$(cd "$NATIVE_DIR/../.." && pwd)"
+WORK_DIR="$(mktemp -d)"
+SERVER_PID=""
+DAEMON_PID=""
+
+cleanup() {
+  if [ -n "$SERVER_PID" ]; then
+    kill "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+  fi
+  if [ -n "$DAEMON_PID" ]; then
+    kill "$DAEMON_PID" 2>/dev/null
+    wait "$DAEMON_PID" 2>/dev/null
+  fi
+  rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+log_pass() {
+  echo -e "${GREEN}✔ $1${NC}"
+  ((PASS_COUNT++))
+}
+
+log_fail() {
+  echo -e "${RED}✖ $1${NC}"
+  ((FAIL_COUNT++))
+}
+
+# expect <output> <line prefix> <substring>... <description>: the first line starting
+# with the prefix must contain every substring.
+expect() {
+  local output="$1" prefix="$2" description="${*: -1}"
+  local line
+  line=$(grep -m1 -F -- "$prefix" <<< "$output")
+  for needle in "${@:3:$#-3}"; do
+    if [[ "$line" != *"$needle"* ]]; then
+      log_fail "$description (missing '$needle' in: ${line:-no output})"
+      return
+    fi
+  done
+  log_pass "$description"
+}
+
+# 1. LLMRunner against a stub llama.cpp server
+test_llm_runner() {
+  if ! command -v python3 >/dev/null; then
+    log_pass "python3 not found, skipping LLMRunner tests."
+    return
+  fi
+  python3 "$NATIVE_DIR/stub_llama_server.py" "$WORK_DIR/port" "$WORK_DIR/events" &
+  SERVER_PID=$!
+  for _ in $(seq 50); do
+    [ -s "$WORK_DIR/port" ] && break
+    sleep 0.1
+  done
+  if [ ! -s "$WORK_DIR/port" ]; then
+    log_fail "Stub llama server did not start."
+    return
+  fi
+  cat > "$WORK_DIR/llm.conf" <<EOF
+LLAMACPP_SERVER_URL = http://127.0.0.1:$(cat "$WORK_DIR/port")
+LLM_TIMEOUT_SEC = 5
+EOF
+
+  local output
+  output=$("$NATIVE_DIR/llm_runner_driver" "$WORK_DIR/llm.conf" \
+           plain plain chunked error stream cancel:3 plain 2>&1 | nl -w1 -s' ')
+  expect "$output" "1 plain" "ok=1" "tokens=2" "cached=3" "stop=eos" "content=[hello world]" \
+         "Plain JSON completion is parsed."
+  expect "$output" "2 plain" "ok=1" "connections=1" "Second request reuses the keep-alive connection."
+  expect "$output" "3 chunked" "ok=1" "content=[hello world]" "connections=1" "Chunked reply is reassembled."
+  expect "$output" "4 error" "ok=0" "error=[server returned HTTP 500: model is loading]" "connections=1" \
+         "Server error is reported with its message, connection kept."
+  expect "$output" "5 stream" "ok=1" "content=[a|b|c|]" "tokens=3" "stop=limit" "connections=1" \
+         "Streamed tokens reach the callback in order."
+  expect "$output" "6 cancel:3" "ok=0" "cancelled=1" "content=[t1 t2 t3 ]" "Callback stops a stream."
+  expect "$output" "7 plain" "ok=1" "connections=2" "Cancelled stream's connection is not reused."
+
+  # The server notices the closed connection at its next write.
+  for _ in $(seq 20); do
+    grep -q "^cancelled" "$WORK_DIR/events" 2>/dev/null && break
+    sleep 0.1
+  done
+  local cancelled
+  cancelled=$(grep -m1 "^cancelled" "$WORK_DIR/events" | cut -d' ' -f2)
+  if [ -n "$cancelled" ] && [ "$cancelled" -lt 100 ]; then
+    log_pass "Server stopped generating after $cancelled of 100 tokens."
+  else
+    log_fail "Server did not see the stream cancelled."
+  fi
+  if [ "$(grep -c '^connect' "$WORK_DIR/events")" -eq 2 ]; then
+    log_pass "Seven requests used two connections."
+  else
+    log_fail "Expected 2 connections, server saw $(grep -c '^connect' "$WORK_DIR/events")."
+  fi
+
+  kill "$SERVER_PID" 2>/dev/null
+  wait "$SERVER_PID" 2>/dev/null
+  SERVER_PID=""
+}
+
+# wait_for <seconds> <command...>: polls every 0.1 s until the command succeeds.
+wait_for() {
+  local tries=$(($1 * 10))
+  shift
+  for _ in $(seq "$tries"); do
+    "$@" 2>/dev/null && return 0
+    sleep 0.1
+  done
+  return 1
+}
+
+# start_daemon <dir>: runs pq_daemon in <dir>, which holds its environment.txt, until it watches its queue.
+start_daemon() {
+  (cd "$1" && exec "$ROOT_DIR/pq_daemon" > "$1/console.log" 2>&1) &
+  DAEMON_PID=$!
+  wait_for 5 grep -q "Monitoring queue" "$1/console.log"
+}
+
+stop_daemon() {
+  kill "$DAEMON_PID" 2>/dev/null
+  wait "$DAEMON_PID" 2>/dev/null
+  DAEMON_PID=""
+}
+
+# write_task <file> <id>: a queue file holding one task.
+write_task() {
+  cat > "$1" <<EOF
+<tasks><task id="$2"><description>Queue test $2.</description>
+<commands><command>echo $2</command></commands></task></tasks>
+EOF
+}
+
+# 2. pq_daemon while its configuration is edited
+test_daemon_config_edit() {
+  local dir="$WORK_DIR/daemon"
+  mkdir -p "$dir/actions"
+  write_daemon_config() {
+    cat > "$dir/environment.txt" <<EOF
+QUEUE_PENDING_DIR = $dir/$1
+QUEUE_IN_PROGRESS_DIR = $dir/in_progress
+QUEUE_FAILED_DIR = $dir/failed
+ACTIONS_PENDING_DIR = $dir/actions
+POLL_INTERVAL_SEC = 1
+LOG_FILE = $dir/daemon.log
+PQL_QUERY_SOCKET =
+METRICS_LISTEN =
+METRICS_FILE =
+EOF
+  }
+  write_daemon_config pending
+  if ! start_daemon "$dir"; then
+    log_fail "pq_daemon did not start."
+    return
+  fi
+
+  # An editor that truncates the file before writing it: the daemon must keep its queue directories.
+  : > "$dir/environment.txt"
+  sleep 1.5
+  write_task "$dir/pending/edit-1.xml" edit-1
+  if wait_for 5 test -f "$dir/actions/edit-1.sh" && [ -f "$dir/in_progress/edit-1.xml" ]; then
+    log_pass "Task dispatched through the old queue while the config file is empty."
+  else
+    log_fail "Task not dispatched while the config file is empty."
+  fi
+  if [ ! -e "$dir/edit-1.xml" ]; then
+    log_pass "No task file claimed into the daemon's working directory."
+  else
+    log_fail "Task file claimed into the daemon's working directory."
+  fi
+  expect "$(cat "$dir/console.log")" "is missing or empty" "keeping the current configuration" \
+         "Empty config file is not published."
+
+  # Files being staged for the queue are left for their writer to rename in.
+  write_task "$dir/pending/.staged.xml.tmp" staged-1
+  write_task "$dir/pending/staged-2.xml.tmp" staged-2
+  sleep 1.5
+  if [ -f "$dir/pending/.staged.xml.tmp" ] && [ -f "$dir/pending/staged-2.xml.tmp" ] &&
+     [ ! -e "$dir/actions/staged-1.sh" ] && [ ! -e "$dir/actions/staged-2.sh" ]; then
+    log_pass "Hidden and .tmp files in the pending directory are not claimed."
+  else
+    log_fail "A staging file in the pending directory was claimed."
+  fi
+
+  # A complete edit moves the queue.
+  write_daemon_config pending2
+  if wait_for 5 grep -q "Monitoring queue: $dir/pending2" "$dir/console.log"; then
+    write_task "$dir/pending2/edit-2.xml" edit-2
+    if wait_for 5 test -f "$dir/actions/edit-2.sh"; then
+      log_pass "Edited queue directory takes effect without a restart."
+    else
+      log_fail "Task in the edited queue directory was not dispatched."
+    fi
+  else
+    log_fail "Daemon did not follow the edited queue directory."
+  fi
+
+  stop_daemon
+}
+
+# check_rules <text> [rules.xml]: runs the text through the rules (default rules/rules.xml); prints the fired
+# rule ids and the exit status.
+check_rules() {
+  local output status
+  output=$(cd "$WORK_DIR" && printf '%s\n' "$1" |
+           "$ROOT_DIR/quantaporto_interface" --check-rules "${2:-$ROOT_DIR/rules/rules.xml}" - 2>&1)
+  status=$?
+  echo "fired=[$(grep '^FIRED:' <<< "$output" | cut -d' ' -f2 | tr '\n' ' ')] status=$status"
+}
+
+# 3. rules/rules.xml against sample responses
+test_rules_xml() {
+  expect "$(check_rules "We should perform the unit tests before merging.")" "fired=" "fired=[]" "status=0" \
+         "'perform ... tests' does not fire no_test_deletion."
+  expect "$(check_rules "The form and term tests pass.")" "fired=" "fired=[]" "status=0" \
+         "'form'/'term' next to 'tests' do not fire no_test_deletion."
+  expect "$(check_rules "First run rm -rf tests/ to start over.")" "fired=" "fired=[no_test_deletion ]" "status=1" \
+         "'rm -rf tests/' fires no_test_deletion."
+  expect "$(check_rules "git rm spec/old_spec.rb")" "fired=" "fired=[no_test_deletion ]" "status=1" \
+         "'git rm spec/...' fires no_test_deletion."
+}
+
+# 4. pq_daemon holds back work while a rule timeout lasts
+test_daemon_rule_timeout() {
+  local dir="$WORK_DIR/timeout"
+  mkdir -p "$dir/actions" "$dir/logs"
+  # Inference fails against a closed port, which is enough to see whether a task was dispatched.
+  cat > "$dir/environment.txt" <<EOF
+QUEUE_PENDING_DIR = $dir/pending
+QUEUE_IN_PROGRESS_DIR = $dir/in_progress
+QUEUE_FAILED_DIR = $dir/failed
+ACTIONS_PENDING_DIR = $dir/actions
+POLL_INTERVAL_SEC = 1
+LOG_FILE = $dir/daemon.log
+LLM_INFERENCE_MODE = server
+LLAMACPP_SERVER_URL = http://127.0.0.1:9
+LLM_CACHE_MAX_MB = 0
+RULES_FILE = $ROOT_DIR/rules/rules.xml
+TIMEOUT_MARKER = $dir/logs/.timeout
+TIMEOUT_DURATION_SEC = 60
+PQL_QUERY_SOCKET =
+METRICS_LISTEN =
+METRICS_FILE =
+EOF
+  echo timeout > "$dir/logs/.timeout"
+  if ! start_daemon "$dir"; then
+    log_fail "pq_daemon did not start."
+    return
+  fi
+
+  write_task "$dir/pending/paused-1.xml" paused-1
+  sleep 2
+  if [ -f "$dir/pending/paused-1.xml" ] && grep -q "Dispatch paused" "$dir/console.log"; then
+    log_pass "No task dispatched while TIMEOUT_MARKER is fresh."
+  else
+    log_fail "Task dispatched during a rule timeout."
+  fi
+  rm -f "$dir/logs/.timeout"
+  if wait_for 5 test ! -f "$dir/pending/paused-1.xml" && grep -q "Rule timeout over" "$dir/console.log"; then
+    log_pass "Dispatch resumes once the timeout is over."
+  else
+    log_fail "Dispatch did not resume after the timeout."
+  fi
+
+  stop_daemon
+}
+
+# 5. ResponseCache records damaged after they were written
+test_response_cache() {
+  local cache="$WORK_DIR/responses.cache" driver="$NATIVE_DIR/response_cache_driver"
+  "$driver" "$cache" put:first=alpha-response put:second=beta-response > /dev/null
+  expect "$("$driver" "$cache" get:first get:second)" "get second" "hit=[beta-response]" \
+         "Cached responses survive a reopen."
+
+  # The first record's value starts after the 8-byte file header and its 40-byte record header.
+  printf 'XXXX' | dd of="$cache" bs=1 seek=50 conv=notrunc 2>/dev/null
+  local output
+  output=$("$driver" "$cache" get:first get:second 2>&1)
+  expect "$output" "get first" "miss" "A record with a damaged value is not returned."
+  expect "$output" "get second" "hit=[beta-response]" "Records after a damaged one are still served."
+  expect "$output" "entries=" "entries=1" "The damaged record is dropped from the index."
+
+  # A value zero-filled by a crash, found on a hit rather than when indexing.
+  output=$("$driver" "$cache" put:third=gamma-response get:third 2>&1)
+  local size
+  size=$(stat -c %s "$cache")
+  dd if=/dev/zero of="$cache" bs=1 seek=$((size - 16)) count=14 conv=notrunc 2>/dev/null
+  expect "$("$driver" "$cache" get:third 2>&1)" "get third" "miss" "A zero-filled value is not returned."
+}
+
+# 6. PQLStore: the compiled .pqlc format
+test_pql_store() {
+  local dir="$WORK_DIR/store" driver="$NATIVE_DIR/pql_store_driver"
+  mkdir -p "$dir"
+  expect "$("$driver" roundtrip "$ROOT_DIR/rules/tasks.xml" "$dir/tasks.pqlc" 2>&1)" "roundtrip" \
+         "tasks=8 stored=8" "mismatches=0" "phantom=0" "verify=1" "current=1" \
+         "rules/tasks.xml reads back the same from its store."
+
+  "$driver" generate "$dir/generated.xml" 3000 > /dev/null
+  expect "$("$driver" roundtrip "$dir/generated.xml" "$dir/generated.pqlc" 2>&1)" "roundtrip" \
+         "tasks=3000 stored=3000" "mismatches=0" "phantom=0" "verify=1" \
+         "3000 generated tasks read back the same, by position and by id."
+
+  # Entities, CDATA, empty fields and a duplicate id (find() returns the first).
+  cat > "$dir/edge.xml" <<'EOF'
+<?xml version="1.0"?>
+<tasks>
+  <task id="dup" type="t &amp; u" priority="high" depends_on="other  third">
+    <description>Fish &amp; chips &lt;b&gt; &#233;</description>
+    <commands><command><![CDATA[echo "<raw> & done"]]></command><command></command></commands>
+    <notes>  padded  </notes>
+  </task>
+  <task id="other"><description/></task>
+  <task id="dup"><description>second</description></task>
+</tasks>
+EOF
+  expect "$("$driver" roundtrip "$dir/edge.xml" "$dir/edge.pqlc" 2>&1)" "roundtrip" \
+         "tasks=3 stored=3 ids=2" "mismatches=0" "Entities, CDATA, empty fields and duplicate ids round-trip."
+
+  # A damaged byte in the string table passes the header checks but not verify().
+  cp "$dir/tasks.pqlc" "$dir/damaged.pqlc"
+  printf 'Z' | dd of="$dir/damaged.pqlc" bs=1 seek=$(($(stat -c %s "$dir/damaged.pqlc") - 5)) conv=notrunc 2>/dev/null
+  expect "$("$driver" open "$ROOT_DIR/rules/tasks.xml" "$dir/damaged.pqlc")" "open" "ok=1" "verify=0" \
+         "A damaged store fails verify()."
+  head -c 200 "$dir/tasks.pqlc" > "$dir/truncated.pqlc"
+  expect "$("$driver" open "$ROOT_DIR/rules/tasks.xml" "$dir/truncated.pqlc")" "open" "ok=0" "truncated or damaged" \
+         "A truncated store is refused."
+
+  # A store older than its source is stale, and find() recompiles it.
+  cp "$ROOT_DIR/rules/tasks.xml" "$dir/live.xml"
+  "$driver" compile "$dir/live.xml" "$dir/live.pqlc" > /dev/null
+  sed -i 's/Analyze the provided text for emotional sentiment./Edited description./' "$dir/live.xml"
+  expect "$("$driver" open "$dir/live.xml" "$dir/live.pqlc")" "open" "ok=1" "current=0" \
+         "A store is stale once its source changes."
+  expect "$("$driver" find "$dir/live.xml" task-001)" "find" "found=1" "description=[Edited description.]" \
+         "find() answers from the edited source, not the stale store."
+
+  # A malformed source fails the compile and keeps the previous store.
+  cp "$dir/live.pqlc" "$dir/live.before"
+  echo '<tasks><task id="x"><commands><command>y</command></task></tasks>' > "$dir/live.xml"
+  expect "$("$driver" compile "$dir/live.xml" "$dir/live.pqlc")" "compile" "ok=0" "is malformed" \
+         "A malformed source does not compile."
+  if cmp -s "$dir/live.pqlc" "$dir/live.before" && [ -z "$(ls "$dir" | grep 'live.pqlc.')" ]; then
+    log_pass "The previous store is kept and no temporary file is left."
+  else
+    log_fail "A malformed source replaced the store or left a temporary file."
+  fi
+}
+
+# 7. WalQueue recovery, leases, compaction and imports
+test_wal_queue() {
+  local dir="$WORK_DIR/wal" driver="$NATIVE_DIR/wal_queue_driver" output
+  mkdir -p "$dir"
+
+  # A torn tail: the last record loses its final bytes, as in a crash mid-append.
+  "$driver" "$dir/torn.wal" 60 enqueue:first=one enqueue:second=two > /dev/null
+  local size
+  size=$(stat -c %s "$dir/torn.wal")
+  truncate -s $((size - 3)) "$dir/torn.wal"
+  output=$("$driver" "$dir/torn.wal" 60 claim claim 2>&1)
+  expect "$output" "open" "pending=1" "A torn final record is dropped on reopen."
+  expect "$output" "claim 1" "first" "payload=[one]" "The records before it are kept."
+  if [ "$(stat -c %s "$dir/torn.wal")" -lt $((size - 3)) ]; then
+    log_pass "The torn bytes are cut from the log."
+  else
+    log_fail "The torn bytes were left in the log."
+  fi
+
+  # A corrupt tail: one payload byte of the last record flipped.
+  "$driver" "$dir/corrupt.wal" 60 enqueue:first=one enqueue:second=two > /dev/null
+  size=$(stat -c %s "$dir/corrupt.wal")
+  printf 'X' | dd of="$dir/corrupt.wal" bs=1 seek=$((size - 1)) conv=notrunc 2>/dev/null
+  output=$("$driver" "$dir/corrupt.wal" 60 claim claim 2>&1)
+  expect "$output" "open" "pending=1" "A record failing its checksum is dropped on reopen."
+  expect "$output" "claim none" "none" "Only the intact task can be claimed."
+
+  # Claims left by a process that died are offered again when the log is reopened.
+  "$driver" "$dir/crash.wal" 60 enqueue:job=payload claim crash > /dev/null
+  expect "$("$driver" "$dir/crash.wal" 60 claim 2>&1)" "claim 1" "job" \
+         "A claim held by a crashed run goes back to pending."
+
+  # An expired lease goes back to pending; the stale claim can no longer finish the task.
+  output=$("$driver" "$dir/lease.wal" 1 enqueue:slow=work claim sleep:1200 maintain claim complete:1 complete:2 2>&1)
+  expect "$output" "maintain" "released=1" "An expired lease is released."
+  expect "$output" "claim 2" "slow" "The released task is claimed again."
+  expect "$output" "complete 1" "ok=0" "The superseded claim cannot complete the task."
+  expect "$output" "complete 2" "ok=1" "The new claim completes it."
+
+  # Compaction once dead records outweigh the live ones; live tasks, claimed or not, survive it.
+  output=$("$driver" "$dir/compact.wal" 60 bulk:done:40:40000 enqueue:keep-a=A enqueue:keep-b=B \
+           claim-all complete-all enqueue:keep-a=A enqueue:keep-b=B claim maintain 2>&1)
+  expect "$output" "maintain" "compactions=1" "The log is compacted once it is mostly dead records."
+  expect "$output" "end pending" "pending=1 claimed=1" "Compaction keeps the pending and the claimed task."
+  if [ "$(stat -c %s "$dir/compact.wal")" -lt 100000 ]; then
+    log_pass "The compacted log holds only the live tasks."
+  else
+    log_fail "The compacted log is $(stat -c %s "$dir/compact.wal") bytes."
+  fi
+  output=$("$driver" "$dir/compact.wal" 60 claim-all 2>&1)
+  expect "$output" "claim-all" "claims=2" "Both live tasks are still there after reopening the compacted log."
+
+  # importDirectory leaves a producer's hidden temporaries alone.
+  mkdir -p "$dir/inbox"
+  write_task "$dir/inbox/visible.xml" visible
+  write_task "$dir/inbox/.staged.xml.tmp" staged
+  expect "$("$driver" "$dir/import.wal" 60 import:"$dir/inbox" claim claim 2>&1)" "import" "imported=1" \
+         "Only the visible file is imported."
+  if [ -f "$dir/inbox/.staged.xml.tmp" ] && [ ! -e "$dir/inbox/visible.xml" ]; then
+    log_pass "The imported file is removed and the hidden one is left."
+  else
+    log_fail "importDirectory touched the hidden file or kept the imported one."
+  fi
+}
+
+# 8. RuleEngine: bias patterns, regex patterns and ethics rules
+test_rule_engine() {
+  local dir="$WORK_DIR/ethics"
+  mkdir -p "$dir"
+  cat > "$dir/bias.txt" <<'EOF'
+stereotype|all [a-z]* people are
+gender|women are bad at
+EOF
+  cat > "$dir/ethics.txt" <<'EOF'
+rule_id|severity|condition|consequences
+no_harm|high|hurt someone|reprompt
+EOF
+  cat > "$dir/environment.txt" <<EOF
+BIAS_PATTERNS_FILE = $dir/bias.txt
+ETHICS_RULES_FILE = $dir/ethics.txt
+ENABLE_ETHICS_LOGGING = false
+EOF
+  # check_ethics <text>: prints the reported violations and the exit status.
+  check_ethics() {
+    local output status
+    output=$(cd "$dir" && printf '%s\n' "$1" | "$ROOT_DIR/quantaporto_interface" --check-ethics - 2>&1)
+    status=$?
+    echo "violations=[$(sed -n 's/^  - //p' <<< "$output" | tr '\n' ' ')] status=$status"
+  }
+
+  expect "$(check_ethics "The weather is fine today.")" "violations=" "violations=[]" "status=0" \
+         "Clean text passes."
+  expect "$(check_ethics "He claims WOMEN ARE BAD AT parking.")" "violations=" \
+         "violations=[gender:women are bad at ]" "status=1" "Bias patterns match case-insensitively."
+  expect "$(check_ethics "They said all tall people are loud.")" "violations=" \
+         "violations=[stereotype:all [a-z]* people are ]" "status=1" "A regex bias pattern matches."
+  expect "$(check_ethics "They said all 7 people are loud.")" "violations=" "violations=[]" "status=0" \
+         "A regex bias pattern does not match what its bracket excludes."
+  expect "$(printf 'They said all tall\npeople are loud.' | (cd "$dir" && "$ROOT_DIR/quantaporto_interface" --check-ethics -) | head -1)" \
+         "PASS" "No ethics or bias violations" "A regex bias pattern does not match across lines."
+  expect "$(check_ethics "Do not hurt someone.")" "violations=" "violations=[no_harm:hurt someone ]" "status=1" \
+         "An ethics rule condition fires."
+  expect "$(check_ethics "Do not Hurt Someone.")" "violations=" "violations=[]" "status=0" \
+         "Ethics rule conditions are case-sensitive."
+}
+
+# 9. RuleEngine::Stream: findings across chunk boundaries and early blocking
+test_rule_stream() {
+  local driver="$NATIVE_DIR/rule_stream_driver" patterns="$WORK_DIR/stream_bias.txt"
+  cat > "$patterns" <<'EOF'
+racial_stereotype|men are better at|all [a-z]* people are|bad at sport$
+style|harmless phrase
+EOF
+  local output
+  output=$("$driver" "$patterns" "Some say men are bet" "ter at chess." "More text." 2>&1)
+  expect "$output" "feed 1" "blocked=0" "Nothing blocks before the trigger is complete."
+  expect "$output" "feed 2" "blocked=1" "A trigger split across two chunks blocks the stream."
+  expect "$output" "feed 3" "blocked=1" "The stream stays blocked."
+  expect "$output" "finish" "chunks=3" "violations=[racial_stereotype:men are better at ]" \
+         "The final report has the split trigger."
+
+  output=$("$driver" "$patterns" "I hear all tall peo" "ple are" 2>&1)
+  expect "$output" "feed 2" "blocked=1" "A regex split across two chunks blocks the stream."
+
+  output=$("$driver" "$patterns" "He is bad at sport" "s, they say." 2>&1)
+  expect "$output" "feed 1" "blocked=0" "An end-of-line anchor waits while the line may still grow."
+  expect "$output" "finish" "violations=[]" "The anchored pattern does not match once the line grew."
+
+  output=$("$driver" "$patterns" "He is bad at sport" "\\nNext line." 2>&1)
+  expect "$output" "feed 2" "blocked=1" "An end-of-line anchor matches once the line ends."
+
+  output=$("$driver" "$patterns" "Just a harmless" " phrase here." 2>&1)
+  expect "$output" "feed 2" "blocked=0" "A low-severity finding does not block."
+  expect "$output" "finish" "violations=[style:harmless phrase ]" "The low-severity finding is still reported."
+}
+
+# 10. RuleProgram: and/or/not, precedence and rules that do not compile
+test_rule_program() {
+  local rules="$WORK_DIR/program_rules.xml"
+  cat > "$rules" <<'EOF'
+<rules>
+  <rule id="r_and" severity="low">
+    <condition>contains("alpha") and contains("beta")</condition>
+    <consequence id="c1"><type>log</type></consequence>
+  </rule>
+  <rule id="r_or" severity="low">
+    <condition>contains("alpha") or count("gamma") &gt; 1</condition>
+    <consequence id="c2"><type>log</type></consequence>
+  </rule>
+  <rule id="r_bad_syntax" severity="low">
+    <condition>contains("alpha" and</condition>
+    <consequence id="c3"><type>log</type></consequence>
+  </rule>
+  <rule id="r_not" severity="low">
+    <condition>not contains("alpha") and words &gt; 2</condition>
+    <consequence id="c4"><type>log</type></consequence>
+  </rule>
+  <rule id="r_nested" severity="low">
+    <condition>(contains("alpha") or contains("beta")) and !(contains("gamma") || lines &gt; 1)</condition>
+    <consequence id="c5"><type>log</type></consequence>
+  </rule>
+  <rule id="r_bad_feature" severity="low">
+    <condition>colour == 1</condition>
+    <consequence id="c6"><type>log</type></consequence>
+  </rule>
+  <rule id="r_chain" severity="low">
+    <condition>contains("beta") and contains("gamma") or words == 1</condition>
+    <consequence id="c7"><type>log</type></consequence>
+  </rule>
+  <rule id="r_compare" severity="low">
+    <condition>(contains("alpha") and contains("beta")) == false</condition>
+    <consequence id="c8"><type>log</type></consequence>
+  </rule>
+  <rule id="r_after" severity="low">
+    <condition>contains("delta")</condition>
+    <consequence id="c9"><type>log</type></consequence>
+  </rule>
+</rules>
+EOF
+  expect "$(check_rules "alpha beta" "$rules")" "fired=" "fired=[r_and r_or r_nested ]" \
+         "and/or/not evaluate correctly when both operands hold."
+  expect "$(check_rules "alpha" "$rules")" "fired=" "fired=[r_or r_nested r_chain r_compare ]" \
+         "A false right operand of and, and a short-circuited or, evaluate correctly."
+  expect "$(check_rules "gamma gamma beta" "$rules")" "fired=" "fired=[r_or r_not r_chain r_compare ]" \
+         "or falls through to its right operand and not inverts a guard literal."
+  expect "$(check_rules "delta" "$rules")" "fired=" "fired=[r_chain r_compare r_after ]" \
+         "and binds tighter than or."
+
+  local output
+  output=$(cd "$WORK_DIR" && echo "delta" | "$ROOT_DIR/quantaporto_interface" --check-rules "$rules" - 2>&1)
+  expect "$output" "Warning: Skipping rule 'r_bad_syntax'" "column" \
+         "A rule with a syntax error is skipped with a warning."
+  expect "$output" "Warning: Skipping rule 'r_bad_feature'" "colour" \
+         "A rule with an unknown feature is skipped with a warning."
+  expect "$output" "rules," "7 rules" "The other rules still compile."
+}
+
+# 11. TaskGraph: cycles, critical-path order and failed dependencies
+test_task_graph() {
+  local dir="$WORK_DIR/plan" driver="$NATIVE_DIR/task_graph_driver"
+  mkdir -p "$dir"
+  # setup -> build -> unit -> package is the critical path; docs and lint are one task each.
+  cat > "$dir/plan.xml" <<'EOF'
+<tasks>
+  <task id="setup"><description>Set up.</description></task>
+  <task id="build" depends_on="setup"><description>Build.</description></task>
+  <task id="unit" depends_on="build"><description>Unit tests.</description></task>
+  <task id="docs" depends_on="setup"><description>Docs.</description></task>
+  <task id="package" depends_on="unit"><description>Package.</description></task>
+  <task id="lint" priority="high"><description>Lint.</description></task>
+</tasks>
+EOF
+  local output
+  output=$("$driver" "$dir/plan.xml" 2>&1)
+  expect "$output" "build critical_path" "critical_path=4" "The critical path counts the longest chain."
+  expect "$(grep '^run' <<< "$output" | tr '\n' ' ')" "run" "run setup run build run unit run lint run docs run package" \
+         "Tasks start longest chain first; ties go to priority, then plan order."
+  expect "$output" "end done" "done=6" "failed=0" "skipped=0" "Every task of the plan runs."
+
+  output=$("$driver" "$dir/plan.xml" build 2>&1)
+  expect "$(grep -E '^(run|skip)' <<< "$output" | tr '\n' ' ')" "run" \
+         "run setup run build skip unit skip package run lint run docs" \
+         "A failed task skips everything that depends on it, directly or not."
+  expect "$output" "end done" "done=3" "failed=1" "skipped=2" "The others still run."
+
+  cat > "$dir/resume.xml" <<'EOF'
+<tasks>
+  <task id="setup" status="done"><description>Already done.</description></task>
+  <task id="build" depends_on="setup"><description>Build.</description></task>
+  <task id="check" depends_on="build setup"><description>Check.</description></task>
+</tasks>
+EOF
+  output=$("$driver" "$dir/resume.xml" 2>&1)
+  expect "$(grep '^run' <<< "$output" | tr '\n' ' ')" "run" "run build run check" "Tasks already done are not run again."
+  expect "$output" "build critical_path" "critical_path=2" "Tasks already done add nothing to the critical path."
+
+  printf '<tasks><task id="a"/><task id="b" depends_on="a"/><task id="a"/></tasks>' > "$dir/duplicate.xml"
+  expect "$("$driver" "$dir/duplicate.xml" 2>&1)" "build error" "duplicate task id 'a'" "A duplicate id is refused."
+  printf '<tasks><task id="a" depends_on="missing"/></tasks>' > "$dir/unknown.xml"
+  expect "$("$driver" "$dir/unknown.xml" 2>&1)" "build error" "task 'a' depends on unknown task 'missing'" \
+         "An unknown dependency is refused."
+
+  cat > "$dir/cycle.xml" <<'EOF'
+<tasks>
+  <task id="free"><description>No dependencies.</description></task>
+  <task id="a" depends_on="c"><description>A.</description></task>
+  <task id="b" depends_on="a"><description>B.</description></task>
+  <task id="c" depends_on="b"><description>C.</description></task>
+</tasks>
+EOF
+  expect "$("$driver" "$dir/cycle.xml" 2>&1)" "build error" "dependency cycle: a -> c -> b -> a" \
+         "A cycle is reported by the tasks on it."
+
+  cat > "$dir/environment.txt" <<EOF
+LOG_FILE = $dir/daemon.log
+ACTIONS_PENDING_DIR = $dir/actions
+PQL_QUERY_SOCKET =
+METRICS_LISTEN =
+EOF
+  output=$(cd "$dir" && timeout 10 "$ROOT_DIR/pq_daemon" --plan "$dir/cycle.xml" 2>&1)
+  local status=$?
+  expect "$output status=$status" "Cannot run plan" "dependency cycle: a -> c -> b -> a" \
+         "pq_daemon --plan refuses a plan with a cycle and names it."
+  if [ "$status" -eq 2 ]; then
+    log_pass "pq_daemon --plan exits with status 2 on a cycle."
+  else
+    log_fail "pq_daemon --plan exited with status $status on a cycle."
+  fi
+}
+
+# 12. ReadyQueue: priority with aging
+test_ready_queue() {
+  local dir="$WORK_DIR/ready" driver="$NATIVE_DIR/ready_queue_driver"
+  mkdir -p "$dir"
+  # ranked_task <name> <priority> <created>
+  ranked_task() {
+    cat > "$dir/$1.xml" <<EOF
+<tasks><task id="$1" priority="$2" created="$3"><description>Ready queue test.</description></task></tasks>
+EOF
+  }
+  # order <aging sec> <name>...: the names in the order they are popped.
+  order() {
+    local aging="$1" steps=() name
+    shift
+    for name in "$@"; do
+      steps+=("add:$dir/$name.xml")
+    done
+    "$driver" "$aging" "${steps[@]}" pop-all 2>&1 | sed -n 's/^pop \(.*\)\.xml$/\1/p' | tr '\n' ' '
+  }
+
+  ranked_task low_early low 2024-01-01T10:00:00Z
+  ranked_task medium_early medium 2024-01-01T10:00:00Z
+  ranked_task high_late high 2024-01-01T10:30:00Z
+  expect "order=$(order 3600 low_early medium_early high_late)" "order=" "order=high_late medium_early low_early " \
+         "Within one aging interval, higher priority runs first."
+
+  ranked_task low_old low 2024-01-01T07:00:00Z
+  ranked_task high_new high 2024-01-01T10:00:00Z
+  expect "order=$(order 3600 high_new low_old)" "order=" "order=low_old high_new " \
+         "A low-priority task older than two aging intervals overtakes a new high-priority one."
+  expect "order=$(order 36000 high_new low_old)" "order=" "order=high_new low_old " \
+         "With a longer aging interval the high-priority task still goes first."
+
+  ranked_task medium_a medium 2024-01-01T10:00:00Z
+  ranked_task medium_b medium 2024-01-01T10:00:00Z
+  expect "order=$(order 3600 medium_b medium_a)" "order=" "order=medium_b medium_a " \
+         "Equal keys keep their arrival order."
+
+  ranked_task zoned medium 2024-01-01T12:00:00+02:00
+  ranked_task utc medium 2024-01-01T10:30:00Z
+  expect "order=$(order 3600 utc zoned)" "order=" "order=zoned utc " "Zone offsets are applied to created."
+
+  ranked_task future high 2999-01-01T00:00:00Z
+  ranked_task past low 2024-01-01T00:00:00Z
+  expect "order=$(order 3600 future past)" "order=" "order=past future " \
+         "A created time in the future counts as the arrival time."
+
+  local output
+  output=$("$driver" 3600 add:"$dir/high_late.xml" add:"$dir/low_early.xml" remove:"$dir/high_late.xml" \
+           remove:"$dir/high_late.xml" pop pop 2>&1)
+  expect "$output" "remove high_late" "ok=1" "A queued file can be removed."
+  expect "$(sed -n 2p <<< "$output")" "remove high_late" "ok=0" "Removing it again reports it was not queued."
+  expect "$(grep '^pop' <<< "$output" | tr '\n' ' ')" "pop" "pop low_early.xml pop none" \
+         "A removed file is never popped."
+}
+
+# 13. XmlTool: entities, character references and CDATA
+test_xml_parser() {
+  local dir="$WORK_DIR/xml"
+  mkdir -p "$dir"
+  cat > "$dir/decode.xml" <<'EOF'
+<?xml version="1.0"?>
+<!-- Serialized back with --xml-file, which escapes only & < > and " in attributes. -->
+<root note="x &amp; &#65;&#x42; &apos;y&apos;">
+  <item>&lt;b&gt; &quot;q&quot; &#169; &#x263A;</item>
+  <code><![CDATA[if (a < b && c) { x = "&amp;"; }]]></code>
+  <mixed>one <![CDATA[<two>]]> three</mixed>
+  <unknown>&nbsp;</unknown>
+</root>
+EOF
+  local output
+  output=$("$ROOT_DIR/quantaporto_interface" --xml-file "$dir/decode.xml" 2>&1)
+  expect "$output" "<root" "note=\"x &amp; AB 'y'\"" "Attribute values decode entities and character references."
+  expect "$output" "<item>" "<item>&lt;b&gt; \"q\" © ☺</item>" \
+         "Text decodes predefined entities and decimal and hex character references."
+  expect "$output" "<code>" "<code>if (a &lt; b &amp;&amp; c) { x = \"&amp;amp;\"; }</code>" \
+         "CDATA is kept as written, entities included."
+  expect "$output" "<mixed>" "<mixed>one &lt;two&gt; three</mixed>" "CDATA joins the text around it."
+  expect "$output" "<unknown>" "<unknown>&amp;nbsp;</unknown>" "An unknown entity is kept literally."
+
+  printf '<root><a><![CDATA[x]]</a></root>' > "$dir/cdata.xml"
+  expect "$("$ROOT_DIR/quantaporto_interface" --xml-file "$dir/cdata.xml" 2>&1)" "Error" \
+         "Unterminated CDATA section" "An unterminated CDATA section is an error."
+  printf '<root><a>x</b></root>' > "$dir/mismatch.xml"
+  expect "$("$ROOT_DIR/quantaporto_interface" --xml-file "$dir/mismatch.xml" 2>&1)" "Error" \
+         "Mismatched end tag </b>" "A mismatched end tag is an error."
+}
+
+# 14. porto_manager logs: the LogIndex sidecar and time ranges
+test_log_index() {
+  local dir="$WORK_DIR/logs" pm="$ROOT_DIR/porto_manager"
+  mkdir -p "$dir"
+  # logs <args>...: porto_manager logs run in $dir, with --stats; prints its output and "status=N".
+  logs() {
+    (cd "$dir" && "$pm" logs --stats "$@" 2>&1)
+    echo "status=$?"
+  }
+  # big_log <file> <tag>: about 850 KB (four index blocks) of lines one second apart from midnight.
+  big_log() {
+    seq 0 11999 | awk -v tag="$2" '{ printf "2026-10-16 %02d:%02d:%02d [%s] line %05d %s\n", \
+        int($1 / 3600), int($1 % 3600 / 60), $1 % 60, tag, $1, "................................" }' > "$1"
+  }
+
+  cat > "$dir/app.log" <<'EOF'
+preamble without a time
+[Fri Oct 16 04:22:04 2026] [INFO] [Scheduler] first
+2026-10-16 04:22:05 Violation detected
+  - gender:women are bad at
+2026-10-16T23:59:59 [RuleEngine] late
+EOF
+  local output
+  output=$(logs --grep gender --since "2026-10-16 04:22:05" app.log)
+  expect "$output" "  - gender" "women are bad at" "A continuation line has the time of the entry above it."
+  expect "$(logs --grep gender --until "2026-10-16 04:22:04" app.log)" "status=" "status=1" \
+         "A continuation line is not before its entry."
+  expect "$(logs --grep preamble --since 2000-01-01 app.log)" "status=" "status=1" \
+         "A line before the first timestamp never matches a time range."
+  expect "$(logs --grep first --since "2026-10-16 04:22:04" --until "2026-10-16 04:22:04" app.log)" "status=" \
+         "status=0" "--since and --until are inclusive."
+  expect "$(logs --grep late --until "2026-10-16 23:59" app.log)" "status=" "status=0" \
+         "--until with minutes covers the whole minute."
+  expect "$(logs --grep late --until 2026-10-16 app.log)" "status=" "status=0" "--until with a date covers the whole day."
+  expect "$(logs --grep first --since "2026-10-16 04:22:05" app.log)" "status=" "status=1" \
+         "--since excludes the second before it."
+  expect "$(logs --since yesterday app.log)" "Bad time" "yesterday" "A malformed time is refused."
+
+  big_log "$dir/big.log" Worker
+  local size
+  size=$(wc -c < "$dir/big.log")
+  expect "$(logs --count big.log)" "big.log:" "read 4 of 4 blocks" "indexed $size new bytes" \
+         "The first run indexes the whole log."
+  expect "$(logs --count big.log)" "big.log:" "indexed 0 new bytes" "An unchanged log is not indexed again."
+  expect "$(logs --since "2026-10-16 03:00" big.log)" "big.log:" "1200 matching lines" "read 1 of 4 blocks" \
+         "A time range reads only the blocks that overlap it."
+
+  echo "2026-10-16 04:00:00 [Worker] appended" >> "$dir/big.log"
+  output=$(logs --grep appended big.log)
+  expect "$output" "2026-10-16 04:00:00" "appended" "An appended line is found."
+  local newBytes
+  newBytes=$(sed -n 's/.*indexed \([0-9]*\) new bytes.*/\1/p' <<< "$output")
+  if [ -n "$newBytes" ] && [ "$newBytes" -gt 0 ] && [ "$newBytes" -le $((size / 3)) ]; then
+    log_pass "After an append only the last block is indexed again ($newBytes bytes)."
+  else
+    log_fail "After an append ${newBytes:-?} of $size bytes were indexed again."
+  fi
+
+  # A rotated log of the same shape and a greater size: only the head hash tells it apart.
+  big_log "$dir/rotated.log" Rotated
+  echo "2026-10-16 04:00:00 [Rotated] longer" >> "$dir/rotated.log"
+  echo "2026-10-16 04:00:01 [Rotated] longer still" >> "$dir/rotated.log"
+  mv "$dir/rotated.log" "$dir/big.log"
+  size=$(wc -c < "$dir/big.log")
+  output=$(logs --component Worker big.log)
+  expect "$output" "big.log:" "0 matching lines" "indexed $size new bytes" \
+         "A rotated log is indexed again from the start."
+}
+
+# 15. PromptTemplate: the dev team template, loops, filters and syntax errors
+test_prompt_template() {
+  local driver="$NATIVE_DIR/prompt_template_driver" context="$ROOT_DIR/prompts/test_prompt.json"
+  # render <source>: the template rendered against prompts/test_prompt.json, in brackets.
+  render() {
+    echo "[$("$driver" -e "$1" "$context" 2>&1)]"
+  }
+
+  if "$driver" "$ROOT_DIR/prompts/dev_team_template.jinja" "$context" |
+       cmp -s - "$NATIVE_DIR/golden/dev_team_template.txt"; then
+    log_pass "dev_team_template.jinja renders as the golden file."
+  else
+    log_fail "dev_team_template.jinja differs from tests/native/golden/dev_team_template.txt."
+  fi
+
+  expect "$(render '{% for m in messages %}{{ loop.index }}/{{ loop.index0 }}/{{ loop.revindex }}/{{ loop.revindex0 }}/{{ loop.length }}/{{ loop.first }}/{{ loop.last }};{% endfor %}')" \
+         "[" "[1/0/2/1/2/True/False;2/1/1/0/2/False/True;]" "loop.* counts from both ends."
+  expect "$(render '{% for x in [1,2,3] %}{% for y in ["a","b"] %}{{ loop.index }}{% endfor %}{{ loop.index }}|{% endfor %}')" \
+         "[" "[121|122|123|]" "An inner loop's loop does not hide the outer one after it ends."
+  expect "$(render '{% for x in [] %}a{% else %}empty{% endfor %}')" "[" "[empty]" "An empty loop renders its else."
+
+  expect "$(render '{{ model | upper }}|{{ "  hi  " | trim }}|{{ "hello world" | title }}|{{ "abc" | capitalize }}|{{ "XyZ" | lower }}')" \
+         "[" "[MISTRAL|hi|Hello World|Abc|xyz]" "Case and trim filters."
+  expect "$(render '{{ messages | length }}|{{ [1,2,3] | join(", ") }}|{{ [3,4] | first }}|{{ [3,4] | last }}')" \
+         "[" "[2|1, 2, 3|3|4]" "List filters."
+  expect "$(render '{{ nothing | default("dflt") }}|{{ nothing | d("x") }}|{{ "a-b-c" | replace("-", "+") }}|{{ "42" | int + 1 }}|{{ 5 | string ~ "!" }}')" \
+         "[" "[dflt|x|a+b+c|43|5!]" "default, replace, int and string."
+  expect "$(render '{{ "one\ntwo" | indent(2) }}' | tr '\n' '/')" "[" "[one/  two]" \
+         "indent leaves the first line alone."
+  expect "$(render '{{ messages[0].role }}|{{ messages[-1]["role"] }}|{{ model is defined }}|{{ nope is undefined }}|{{ nope.deeper }}')" \
+         "[" "[system|user|True|True|]" "Attributes, subscripts, tests and undefined names."
+
+  expect "$(render '{{ 9223372036854775806 + 1 }}|{{ -9223372036854775807 - 1 }}')" "[" \
+         "[9223372036854775807|-9223372036854775808]" "Integer arithmetic reaches both 64-bit limits."
+  expect "$(render '{{ 9223372036854775807 + 1 }}|{{ -9223372036854775807 - 10 }}|{{ -(-9223372036854775807 - 1) }}|{{ (9223372036854775807 + 1) is undefined }}')" \
+         "[" "[|||True]" "Integer overflow is undefined instead of wrapping."
+
+  expect "$(render '{{ x ')" "[" "[error: line 1: unclosed {{]" "An unclosed expression is reported."
+  expect "$(render $'line one\n{% if x %}\n{% endfor %}')" "[" "[error: line 3: unexpected {% endfor %}]" \
+         "A stray end tag is reported on its line."
+  expect "$(render $'a\nb\n{{ 1 + }}')" "[" "[error: line 3: expected an expression]" \
+         "An incomplete expression is reported on its line."
+  expect "$(render $'{% if x %}\nnever closed')" "[" "[error: line 1: {% if %} without {% endif %}]" \
+         "An unclosed block is reported at its opening tag."
+  expect "$(render '{{ x | nosuchfilter }}')" "[" "[error: line 1: unknown filter 'nosuchfilter']" \
+         "Unknown filters are refused when compiling."
+}
+
+# 16. porto_manager: Ctrl-C during foreground commands, and background jobs when it stops
+test_porto_manager_signals() {
+  local dir="$WORK_DIR/porto" pm="$ROOT_DIR/porto_manager"
+  mkdir -p "$dir/scripts"
+  # slow.sh NAME: prints "NAME started", then "NAME got SIG" for the signal that stops it, on stderr.
+  cat > "$dir/scripts/slow.sh" <<'EOF'
+#!/bin/bash
+for sig in INT TERM; do trap "echo '$1 got $sig' >&2; exit 1" $sig; done
+echo "$1 started" >&2
+for _ in $(seq 300); do sleep 0.1; done
+EOF
+  chmod +x "$dir/scripts/slow.sh"
+
+  # session <SCRIPT_TIMEOUT_SEC>: porto_manager in $dir, leading a process group as under a terminal,
+  # reading commands written to fd 3; its output goes to $dir/out.
+  session() {
+    printf 'SCRIPTS_DIR = scripts\nLOG_FILE = porto.log\nSCRIPT_TIMEOUT_SEC = %s\n' "$1" > "$dir/environment.txt"
+    rm -f "$dir/in" "$dir/out"
+    mkfifo "$dir/in"
+    set -m
+    (cd "$dir" && exec "$pm") < "$dir/in" > "$dir/out" 2>&1 &
+    PM_PID=$!
+    set +m
+    exec 3> "$dir/in"
+  }
+  # await <text>: waits up to 5 s for the text to appear in the session's output.
+  await() {
+    for _ in $(seq 100); do
+      grep -qF -- "$1" "$dir/out" && return 0
+      sleep 0.05
+    done
+    return 1
+  }
+  # finish: ends the session with "exit" and appends "status=N" to its output.
+  finish() {
+    echo exit >&3
+    exec 3>&-
+    wait "$PM_PID"
+    echo "status=$?" >> "$dir/out"
+  }
+
+  local output
+  # With a timeout the script leads its own process group, out of reach of the terminal's Ctrl-C.
+  session 30
+  echo "run slow.sh a" >&3
+  await "a started"
+  kill -INT "$PM_PID"
+  await "Error: slow.sh failed"
+  finish
+  output=$(cat "$dir/out")
+  expect "$output" "a got" "a got INT" "Ctrl-C is passed on to a script in its own process group."
+  expect "$output" "status=" "status=0" "Ctrl-C during run stops the script, not porto_manager."
+
+  # Without one the terminal signals the script itself, along with porto_manager.
+  session 0
+  echo "run slow.sh b" >&3
+  await "b started"
+  kill -INT -- "-$PM_PID"
+  await "Error: slow.sh failed"
+  finish
+  output=$(cat "$dir/out")
+  expect "$output" "b got" "b got INT" "Ctrl-C reaches a script in porto_manager's process group."
+  expect "$output" "Exiting" "Exiting Porto Manager." "porto_manager survives Ctrl-C sent to its process group."
+
+  session 30
+  echo "pipe slow.sh c | slow.sh d" >&3
+  await "d started"
+  kill -INT "$PM_PID"
+  await "Failed"
+  finish
+  output=$(cat "$dir/out")
+  expect "$output" "c got" "[1 slow.sh] c got INT" "Ctrl-C is passed on to every stage of a foreground pipe."
+  expect "$output" "d got" "[1 slow.sh] d got INT" "Ctrl-C reaches the last stage of a foreground pipe."
+  expect "$output" "status=" "status=0" "Ctrl-C during pipe stops the job, not porto_manager."
+
+  session 0
+  echo "run slow.sh e &" >&3
+  await "e started"
+  echo "pipe slow.sh f" >&3
+  await "f started"
+  kill -INT -- "-$PM_PID"
+  await "Failed slow.sh f"
+  finish
+  output=$(cat "$dir/out")
+  expect "$output" "f got" "f got INT" "Ctrl-C reaches a foreground job in porto_manager's process group."
+  expect "$output" "e got" "e got TERM" "Ctrl-C does not reach a background job; exit terminates it."
+  expect "$output" "Terminating" "Terminating 1 running job(s)." "Background jobs still running at exit are stopped."
+
+  session 0
+  echo "run slow.sh g &" >&3
+  await "g started"
+  kill -TERM "$PM_PID"
+  wait "$PM_PID"
+  echo "status=$?" >> "$dir/out"
+  exec 3>&-
+  output=$(cat "$dir/out")
+  expect "$output" "g got" "g got TERM" "SIGTERM to porto_manager stops its background jobs."
+  expect "$output" "status=" "status=0" "porto_manager exits cleanly on SIGTERM."
+}
+
+# Run all tests
+echo "🔧 Running QuantaPorto native tests..."
+test_llm_runner
+test_daemon_config_edit
+test_rules_xml
+test_daemon_rule_timeout
+test_response_cache
+test_pql_store
+test_wal_queue
+test_rule_engine
+test_rule_stream
+test_rule_program
+test_task_graph
+test_ready_queue
+test_xml_parser
+test_log_index
+test_prompt_template
+test_porto_manager_signals
+
+# Summary
+echo
+echo -e "✅ Passed: ${GREEN}$PASS_COUNT${NC}    ❌ Failed: ${RED}$FAIL_COUNT${NC}"
+
+if [[ $FAIL_COUNT -gt 0 ]]; then
+  exit 1
+else
+  exit 0
+fi
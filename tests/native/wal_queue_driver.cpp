@@ -0,0 +1,117 @@
+// Drives a WalQueue log for tests/native/test-native.sh.
+//
+// Usage: wal_queue_driver LOG LEASE_SEC STEP...
+// Steps:
+//   enqueue:NAME=PAYLOAD   queue a task
+//   bulk:PREFIX:N:BYTES    queue N tasks PREFIX-0.. with BYTES-byte payloads
+//   claim                  claim the next task; claims are numbered from 1
+//   claim-all              claim every pending task
+//   complete:K | fail:K    finish claim K (complete-all finishes every open claim)
+//   maintain               release expired leases, compact if worth it
+//   import:DIR             importDirectory(DIR)
+//   sleep:MS
+//   crash                  exit without closing, once queued changes are committed
+// Each step prints one line; "end pending=.. claimed=.. compactions=.. file=.." follows when the log is closed.
+
+#include "WalQueue.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " LOG LEASE_SEC STEP..." << std::endl;
+        return 2;
+    }
+    WalQueue queue(std::chrono::seconds(300));
+    if (!queue.open(argv[1], std::chrono::seconds(std::atoi(argv[2])))) {
+        std::cout << "open error=[" << queue.error() << "]" << std::endl;
+        return 1;
+    }
+    std::cout << "open pending=" << queue.stats().pending << std::endl;
+
+    std::vector<WalQueue::Claim> claims;
+    std::vector<bool> open;
+    auto finish = [&](size_t k, bool failed) {
+        bool ok = k >= 1 && k <= claims.size() &&
+                  (failed ? queue.fail(claims[k - 1], "driver") : queue.complete(claims[k - 1]));
+        if (k >= 1 && k <= open.size()) {
+            open[k - 1] = false;
+        }
+        std::cout << (failed ? "fail " : "complete ") << k << " ok=" << ok << std::endl;
+    };
+    for (int i = 3; i < argc; ++i) {
+        std::string step = argv[i];
+        std::string arg = step.substr(step.find(':') + 1);
+        if (step.rfind("enqueue:", 0) == 0) {
+            size_t equals = arg.find('=');
+            bool ok = queue.enqueue(arg.substr(0, equals), equals == std::string::npos ? "" : arg.substr(equals + 1));
+            std::cout << "enqueue ok=" << ok << std::endl;
+        } else if (step.rfind("bulk:", 0) == 0) {
+            size_t first = arg.find(':');
+            size_t second = arg.find(':', first + 1);
+            std::string prefix = arg.substr(0, first);
+            int count = std::atoi(arg.substr(first + 1, second - first - 1).c_str());
+            std::string payload(static_cast<size_t>(std::atoi(arg.substr(second + 1).c_str())), 'x');
+            std::vector<std::pair<std::string, std::string>> tasks;
+            for (int n = 0; n < count; ++n) {
+                tasks.emplace_back(prefix + "-" + std::to_string(n), payload);
+            }
+            std::cout << "bulk ok=" << queue.enqueue(tasks) << std::endl;
+        } else if (step == "claim" || step == "claim-all") {
+            do {
+                std::optional<WalQueue::Claim> claim = queue.claim();
+                if (!claim) {
+                    if (step == "claim") {
+                        std::cout << "claim none" << std::endl;
+                    }
+                    break;
+                }
+                claims.push_back(*claim);
+                open.push_back(true);
+                if (step == "claim") {
+                    std::cout << "claim " << claims.size() << " " << claim->name << " payload=[" << claim->payload << "]"
+                              << std::endl;
+                }
+            } while (step == "claim-all");
+            if (step == "claim-all") {
+                std::cout << "claim-all claims=" << claims.size() << std::endl;
+            }
+        } else if (step.rfind("complete:", 0) == 0 || step.rfind("fail:", 0) == 0) {
+            finish(static_cast<size_t>(std::atoi(arg.c_str())), step[0] == 'f');
+        } else if (step == "complete-all") {
+            size_t done = 0;
+            for (size_t k = 0; k < claims.size(); ++k) {
+                if (open[k]) {
+                    done += queue.complete(claims[k]);
+                    open[k] = false;
+                }
+            }
+            std::cout << "complete-all done=" << done << std::endl;
+        } else if (step == "maintain") {
+            size_t released = queue.maintain();
+            std::cout << "maintain released=" << released << " compactions=" << queue.stats().compactions << std::endl;
+        } else if (step.rfind("import:", 0) == 0) {
+            std::cout << "import imported=" << queue.importDirectory(arg) << std::endl;
+        } else if (step.rfind("sleep:", 0) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::atoi(arg.c_str())));
+        } else if (step == "crash") {
+            // Claims are committed by the background thread within 10 ms.
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::cout << "crash" << std::endl;
+            std::_Exit(0);
+        } else {
+            std::cerr << "Unknown step " << step << std::endl;
+            return 2;
+        }
+    }
+    WalQueue::Stats stats = queue.stats();
+    queue.close();
+    std::cout << "end pending=" << stats.pending << " claimed=" << stats.claimed << " compactions=" << stats.compactions
+              << " file=" << stats.fileBytes << std::endl;
+    return 0;
+}